@@ -117,6 +117,7 @@ static const char HELP_STRING[] =
 	"  --no-show-fps            Set the turn off display FPS info\n"
 	"  --soft-renderer          Switch to 3D software renderer\n"
 	"  --no-soft-renderer       Switch to 3D hardware renderer\n"
+	"  --warm-text-cache        Parse all text resources into the cache at startup\n"
 #ifdef ENABLE_EVENTRECORDER
 	"  --record-mode=MODE       Specify record mode for event recorder (record, playback,\n"
 	"                           passthrough [default])\n"
@@ -494,6 +495,9 @@ Common::String parseCommandLine(Common::StringMap &settings, int argc, const cha
 			DO_LONG_OPTION_BOOL("show-fps")
 			END_OPTION
 
+			DO_LONG_OPTION_BOOL("warm-text-cache")
+			END_OPTION
+
 			DO_LONG_OPTION("savepath")
 				Common::FSNode path(option);
 				if (!path.exists()) {
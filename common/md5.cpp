@@ -33,12 +33,6 @@
 
 namespace Common {
 
-struct md5_context {
-	uint32 total[2];
-	uint32 state[4];
-	uint8 buffer[64];
-};
-
 static void md5_starts(md5_context *ctx);
 static void md5_update(md5_context *ctx, const uint8 *input, uint32 length);
 static void md5_finish(md5_context *ctx, uint8 digest[16]);
@@ -280,6 +274,25 @@ bool computeStreamMD5(ReadStream &stream, uint8 digest[16], uint32 length) {
 	return true;
 }
 
+MD5::MD5() {
+	md5_starts(&_ctx);
+}
+
+void MD5::update(const uint8 *data, uint32 length) {
+#ifndef DISABLE_MD5
+	md5_update(&_ctx, data, length);
+#endif
+}
+
+void MD5::finish(uint8 digest[16]) {
+#ifdef DISABLE_MD5
+	memset(digest, 0, 16);
+#else
+	md5_finish(&_ctx, digest);
+	md5_starts(&_ctx);
+#endif
+}
+
 String computeStreamMD5AsString(ReadStream &stream, uint32 length) {
 	String md5;
 	uint8 digest[16];
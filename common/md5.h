@@ -54,6 +54,33 @@ bool computeStreamMD5(ReadStream &stream, uint8 digest[16], uint32 length = 0);
  */
 String computeStreamMD5AsString(ReadStream &stream, uint32 length = 0);
 
+struct md5_context {
+	uint32 total[2];
+	uint32 state[4];
+	uint8 buffer[64];
+};
+
+/**
+ * Computes an MD5 checksum over data handed to it piece by piece, for
+ * callers that read their data in several goes.
+ */
+class MD5 {
+public:
+	MD5();
+
+	/** Adds the next length bytes of data to the checksum. */
+	void update(const uint8 *data, uint32 length);
+
+	/**
+	 * Writes the checksum of all the data added so far to digest, and
+	 * starts over.
+	 */
+	void finish(uint8 digest[16]);
+
+private:
+	md5_context _ctx;
+};
+
 } // End of namespace Common
 
 #endif
@@ -20,6 +20,7 @@
  *
  */
 
+#include "math/frustum.h"
 #include "math/line3d.h"
 #include "math/rect2d.h"
 
@@ -96,7 +97,7 @@ Actor::Actor() :
 		_globalAlpha(1.f), _alphaMode(AlphaOff),
 		 _mustPlaceText(false), 
 		_puckOrient(false), _talking(false), 
-		_inOverworld(false), _drawnToClean(false), _backgroundTalk(false),
+		_inOverworld(false), _drawnToClean(false), _culled(false), _backgroundTalk(false),
 		_sortOrder(0), _haveSectorSortOrder(false), _useParentSortOrder(false),
 		_sectorSortOrder(0), _cleanBuffer(0), _lightMode(LightFastDyn),
 		_hasFollowedBoxes(false), _lookAtActor(0) {
@@ -1638,7 +1639,52 @@ bool Actor::updateTalk(uint frameTime) {
 	return false;
 }
 
+void Actor::prepareForRender() {
+	if (_costumeStack.empty() || _culled)
+		return;
+
+	if (g_grim->getGameType() == GType_GRIM) {
+		_costumeStack.back()->prepareForRender();
+	} else {
+		for (Common::List<Costume *>::iterator it = _costumeStack.begin(); it != _costumeStack.end(); ++it) {
+			(*it)->prepareForRender();
+		}
+	}
+}
+
+bool Actor::updateCulling(const Math::Frustum &frustum) {
+	_culled = false;
+	if (_costumeStack.empty() || _inOverworld)
+		return false;
+
+	Math::AABB bounds;
+	if (g_grim->getGameType() == GType_GRIM) {
+		if (!_costumeStack.back()->getLocalBounds(&bounds))
+			return false;
+	} else {
+		for (Common::List<Costume *>::iterator it = _costumeStack.begin(); it != _costumeStack.end(); ++it) {
+			if (!(*it)->getLocalBounds(&bounds))
+				return false;
+		}
+	}
+	if (!bounds.isValid())
+		return false;
+
+	bounds.transform(getFinalMatrix());
+	_culled = !frustum.isInside(bounds);
+	return _culled;
+}
+
 void Actor::draw() {
+	if (_culled) {
+		// Only the text needs to be placed, if any.
+		_culled = false;
+		if (_mustPlaceText)
+			placeSayLineText();
+		_drawnToClean = false;
+		return;
+	}
+
 	for (Common::List<Costume *>::iterator i = _costumeStack.begin(); i != _costumeStack.end(); ++i) {
 		Costume *c = *i;
 		c->setupTextures();
@@ -1669,39 +1715,42 @@ void Actor::draw() {
 		}
 	}
 
-	if (_mustPlaceText) {
-		Common::Point p1, p2;
-		if (g_grim->getGameType() == GType_GRIM) {
-			if (!_costumeStack.empty()) {
-				int x1 = 1000, y1 = 1000, x2 = -1000, y2 = -1000;
-				g_driver->startActorDraw(this);
-				_costumeStack.back()->getBoundingBox(&x1, &y1, &x2, &y2);
-				g_driver->finishActorDraw();
-				p1.x = x1;
-				p1.y = y1;
-				p2.x = x2;
-				p2.y = y2;
-			}
-		} else {
-			g_driver->getActorScreenBBox(this, p1, p2);
-		}
+	if (_mustPlaceText)
+		placeSayLineText();
 
-		TextObject *textObject = TextObject::getPool().getObject(_sayLineText);
-		if (textObject) {
-			if (p1.x == 1000 || p2.x == -1000 || p2.x == -1000) {
-				textObject->setX(640 / 2);
-				textObject->setY(463);
-			} else {
-				textObject->setX((p1.x + p2.x) / 2);
-				textObject->setY(p1.y);
-			}
-			// Deletes the original text and rebuilds it with the newly placed text
-			textObject->reset();
+	_drawnToClean = false;
+}
+
+void Actor::placeSayLineText() {
+	Common::Point p1, p2;
+	if (g_grim->getGameType() == GType_GRIM) {
+		if (!_costumeStack.empty()) {
+			int x1 = 1000, y1 = 1000, x2 = -1000, y2 = -1000;
+			g_driver->startActorDraw(this);
+			_costumeStack.back()->getBoundingBox(&x1, &y1, &x2, &y2);
+			g_driver->finishActorDraw();
+			p1.x = x1;
+			p1.y = y1;
+			p2.x = x2;
+			p2.y = y2;
 		}
-		_mustPlaceText = false;
+	} else {
+		g_driver->getActorScreenBBox(this, p1, p2);
 	}
 
-	_drawnToClean = false;
+	TextObject *textObject = TextObject::getPool().getObject(_sayLineText);
+	if (textObject) {
+		if (p1.x == 1000 || p2.x == -1000 || p2.x == -1000) {
+			textObject->setX(640 / 2);
+			textObject->setY(463);
+		} else {
+			textObject->setX((p1.x + p2.x) / 2);
+			textObject->setY(p1.y);
+		}
+		// Deletes the original text and rebuilds it with the newly placed text
+		textObject->reset();
+	}
+	_mustPlaceText = false;
 }
 
 void Actor::drawCostume(Costume *costume) {
@@ -2436,6 +2485,25 @@ void Actor::clearCleanBuffer() {
 	}
 }
 
+void Actor::releaseDriverData() {
+	clearCleanBuffer();
+	for (int i = 0; i < MAX_SHADOWS; ++i) {
+		Shadow &shadow = _shadowArray[i];
+		g_driver->destroyShadow(&shadow);
+		// The mask size depends on the renderer
+		delete[] shadow.shadowMask;
+		shadow.shadowMask = nullptr;
+		shadow.shadowMaskSize = 0;
+	}
+}
+
+void Actor::createDriverData() {
+	if (_drawnToClean && !_cleanBuffer) {
+		_cleanBuffer = g_driver->genBuffer();
+		g_driver->clearBuffer(_cleanBuffer);
+	}
+}
+
 void Actor::restoreCleanBuffer() {
 	if (_cleanBuffer) {
 		update(0);
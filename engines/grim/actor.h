@@ -30,6 +30,10 @@
 #include "math/angle.h"
 #include "math/quat.h"
 
+namespace Math {
+class Frustum;
+}
+
 namespace Grim {
 
 class TextObject;
@@ -491,6 +495,19 @@ public:
 	 * Check if the actor is still talking. If it is returns true, otherwise false.
 	 */
 	bool updateTalk(uint frameTime);
+	/**
+	 * Do the CPU side work needed before the actor can be drawn, e.g. skinning
+	 * the EMI meshes. This does not talk to the renderer.
+	 */
+	void prepareForRender();
+	/**
+	 * Test the actor's bounds against the frustum. A culled actor is neither
+	 * prepared for rendering nor drawn, but draw() still places its text.
+	 * The state is reset after the next draw().
+	 *
+	 * @return true if the actor was culled.
+	 */
+	bool updateCulling(const Math::Frustum &frustum);
 	void draw();
 
 	bool isLookAtVectorZero() {
@@ -550,6 +567,13 @@ public:
 	void drawToCleanBuffer();
 	void clearCleanBuffer();
 
+	/**
+	 * Drops the clean buffer and shadow masks before the renderer is
+	 * replaced; createDriverData() recreates the clean buffer on the new one.
+	 */
+	void releaseDriverData();
+	void createDriverData();
+
 	bool isTalkingForeground() const;
 
 	LightMode getLightMode() const { return _lightMode; }
@@ -569,6 +593,7 @@ private:
 	void stopTalking();
 	bool stopMumbleChore();
 	void drawCostume(Costume *costume);
+	void placeSayLineText();
 	/**
 	 * Given a start point and a destination this function returns a position
 	 * that doesn't collide with any actor.
@@ -712,6 +737,7 @@ private:
 
 	int _cleanBuffer;
 	bool _drawnToClean;
+	bool _culled;
 
 	LightMode _lightMode;
 
@@ -32,12 +32,19 @@ namespace Grim {
 
 Animation::Animation(const Common::String &keyframe, AnimManager *manager, int pr1, int pr2) :
 		_manager(manager), _priority1(pr1), _priority2(pr2), _paused(true),
-		_active(false), _time(-1), _fade(1.f), _fadeMode(None) {
+		_active(false), _time(-1), _fade(1.f), _fadeMode(None), _cursors(nullptr) {
 	_keyframe = g_resourceloader->getKeyframe(keyframe);
+	if (_keyframe) {
+		int numJoints = _keyframe->getNumJoints();
+		_cursors = new int[numJoints];
+		for (int i = 0; i < numJoints; i++)
+			_cursors[i] = 0;
+	}
 }
 
 Animation::~Animation() {
 	deactivate();
+	delete[] _cursors;
 }
 
 void Animation::activate() {
@@ -280,7 +287,7 @@ void AnimManager::animate(ModelNode *hier, int numNodes) {
 			if (layerWeight > 1.0f)
 				weight /= layerWeight;
 			weight *= remainingWeight;
-			j->_anim->_keyframe->animate(hier, i, time, weight, j->_tagged);
+			j->_anim->_keyframe->animate(hier, i, time, weight, j->_tagged, j->_anim->_cursors);
 		}
 	}
 }
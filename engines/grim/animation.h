@@ -72,6 +72,8 @@ private:
 	RepeatMode _repeatMode;
 	FadeMode _fadeMode;
 	int _fadeLength;
+	// Keyframe cursors for KeyframeAnim::animate(), one per joint.
+	int *_cursors;
 
 	friend class AnimManager;
 };
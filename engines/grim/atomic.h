@@ -0,0 +1,94 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef GRIM_ATOMIC_H
+#define GRIM_ATOMIC_H
+
+#include "common/scummsys.h"
+
+#ifdef _MSC_VER
+#include "common/math.h" // for intrin.h
+#endif
+
+namespace Grim {
+
+/**
+ * Loads and stores for values shared between timer procs, the mixer and
+ * the main thread. Each value has a single writer, so ordered loads and
+ * stores are all that is needed.
+ */
+template<typename T>
+inline T atomicLoad(const volatile T &value) {
+#if defined(__GNUC__)
+	return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+#else
+	return value;
+#endif
+}
+
+template<typename T>
+inline void atomicStore(volatile T &value, T newValue) {
+#if defined(__GNUC__)
+	__atomic_store_n(&value, newValue, __ATOMIC_RELEASE);
+#else
+	value = newValue;
+#endif
+}
+
+/**
+ * Replaces value with newValue if it still holds expected, for values that
+ * more than one thread writes. Returns whether the swap happened. Outside
+ * GCC and Clang only 32-bit values are supported.
+ */
+template<typename T>
+inline bool atomicCompareExchange(volatile T &value, T expected, T newValue) {
+#if defined(__GNUC__)
+	return __atomic_compare_exchange_n(&value, &expected, newValue, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#elif defined(_MSC_VER)
+	// long is 32 bits wide on Windows; this fails to compile for other sizes
+	typedef char SizeCheck[sizeof(T) == sizeof(long) ? 1 : -1];
+	(void)sizeof(SizeCheck);
+	return _InterlockedCompareExchange((volatile long *)&value, (long)newValue, (long)expected) == (long)expected;
+#else
+#error "atomicCompareExchange() has no implementation for this compiler"
+#endif
+}
+
+/**
+ * Orders the plain loads and stores around it, for data published under a
+ * sequence counter.
+ */
+inline void atomicFence() {
+#if defined(__GNUC__)
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+#elif defined(_MSC_VER)
+	// Interlocked operations are full barriers
+	volatile long barrier = 0;
+	_InterlockedExchange(&barrier, 0);
+#else
+#error "atomicFence() has no implementation for this compiler"
+#endif
+}
+
+} // end of namespace Grim
+
+#endif
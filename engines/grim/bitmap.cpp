@@ -29,6 +29,7 @@
 #include "engines/grim/savegame.h"
 #include "engines/grim/debug.h"
 #include "engines/grim/bitmap.h"
+#include "engines/grim/bitmapcache.h"
 #include "engines/grim/resource.h"
 #include "engines/grim/gfx_base.h"
 
@@ -109,6 +110,39 @@ void BitmapData::load() {
 	_loaded = true;
 }
 
+void BitmapData::releaseDriverData() {
+	if (!_loaded) {
+		return;
+	}
+	g_driver->destroyBitmap(this);
+	_texIds = nullptr;
+	_numTex = 0;
+	_loaded = false;
+
+	if (_bitmaps && _bitmaps->getVal(_fname, nullptr) == this) {
+		delete[] _data;
+		_data = nullptr;
+		delete[] _texc;
+		_texc = nullptr;
+		delete[] _layers;
+		_layers = nullptr;
+		delete[] _verts;
+		_verts = nullptr;
+	}
+}
+
+void BitmapData::createDriverData() {
+	if (_loaded || !_data) {
+		return;
+	}
+	// The previous renderer may have converted the pixels to its own format.
+	if (_colorFormat == BM_RGB565) {
+		convertToColorFormat(Graphics::PixelFormat(2, 5, 6, 5, 0, 11, 5, 0, 0));
+	}
+	g_driver->createBitmap(this);
+	_loaded = true;
+}
+
 bool BitmapData::loadGrimBm(Common::SeekableReadStream *data) {
 	uint32 tag2 = data->readUint32BE();
 	if (tag2 != (MKTAG('F','\0','\0','\0')))
@@ -138,34 +172,57 @@ bool BitmapData::loadGrimBm(Common::SeekableReadStream *data) {
 	_colorFormat = BM_RGB565;
 	_hasTransparency = false;
 
+	const uint32 imageSize = _bpp / 8 * _width * _height;
+	BitmapCache *cache = g_resourceloader->getBitmapCache();
+	BitmapCache::Key key;
+	const byte *cached = nullptr;
+	if (codec == 3) {
+		cached = cache->find(_fname, data, imageSize * _numImages, key);
+	}
+
 	_data = new Graphics::PixelBuffer[_numImages];
 	data->seek(0x80, SEEK_SET);
+	bool decoded = true;
 	for (int i = 0; i < _numImages; i++) {
 		data->seek(8, SEEK_CUR);
 		_data[i].create(pixelFormat, _width * _height, DisposeAfterUse::YES);
-		if (codec == 0) {
-			uint32 dsize = _bpp / 8 * _width * _height;
-			data->read(_data[i].getRawBuffer(), dsize);
+		if (cached) {
+			memcpy(_data[i].getRawBuffer(), cached + i * imageSize, imageSize);
+		} else if (codec == 0) {
+			data->read(_data[i].getRawBuffer(), imageSize);
 		} else if (codec == 3) {
 			int compressed_len = data->readUint32LE();
 			char *compressed = new char[compressed_len];
 			data->read(compressed, compressed_len);
-			bool success = decompress_codec3(compressed, (char *)_data[i].getRawBuffer(), _bpp / 8 * _width * _height);
+			bool success = decompress_codec3(compressed, (char *)_data[i].getRawBuffer(), imageSize);
 			delete[] compressed;
-			if (!success)
+			if (!success) {
 				warning(".. when loading image %s.\n", _fname.c_str());
+				decoded = false;
+			}
 		} else
 			Debug::error(Debug::Bitmaps, "Unknown image codec in BitmapData ctor!");
+	}
+
+	if (codec == 3 && !cached && decoded) {
+		byte *pixels = new byte[imageSize * _numImages];
+		for (int i = 0; i < _numImages; i++) {
+			memcpy(pixels + i * imageSize, _data[i].getRawBuffer(), imageSize);
+		}
+		cache->store(key, pixels, imageSize * _numImages);
+		delete[] pixels;
+	}
 
 #ifdef SCUMM_BIG_ENDIAN
-		if (_format == 1) {
+	if (_format == 1) {
+		for (int i = 0; i < _numImages; i++) {
 			uint16 *d = (uint16 *)_data[i].getRawBuffer();
 			for (int j = 0; j < _width * _height; ++j) {
 				d[j] = SWAP_BYTES_16(d[j]);
 			}
 		}
-#endif
 	}
+#endif
 
 	// Initially, no GPU-side textures created. the createBitmap
 	// function will allocate some if necessary (and successful)
@@ -493,62 +550,93 @@ void BitmapData::convertToColorFormat(const Graphics::PixelFormat &format) {
 	bitstr_len--; \
 	bitstr_value >>= 1; \
 	if (bitstr_len == 0) { \
-		bitstr_value = READ_LE_UINT16(compressed); \
+		bitstr_value = READ_LE_UINT16(src); \
 		bitstr_len = 16; \
-		compressed += 2; \
+		src += 2; \
 	} \
 } while (0)
 
 static bool decompress_codec3(const char *compressed, char *result, int maxBytes) {
-	int bitstr_value = READ_LE_UINT16(compressed);
+	const uint8 *src = (const uint8 *)compressed;
+	uint8 *dst = (uint8 *)result;
+	uint8 *const dstEnd = dst + maxBytes;
+	uint32 bitstr_value = READ_LE_UINT16(src);
 	int bitstr_len = 16;
-	compressed += 2;
+	src += 2;
 	bool bit;
 
-	int byteIndex = 0;
 	for (;;) {
+		// Copy a run of literals in one go. The run stops before the last
+		// bit of the control word, since the next word is read from the
+		// stream ahead of that bit's literal.
+		int run = 0;
+		while (run < bitstr_len - 1 && ((bitstr_value >> run) & 1))
+			++run;
+		if (run > 0) {
+			if (dstEnd - dst < run) {
+				memcpy(dst, src, dstEnd - dst);
+				warning("Buffer overflow when decoding image: decompress_codec3 walked past the input buffer!");
+				return false;
+			}
+			memcpy(dst, src, run);
+			dst += run;
+			src += run;
+			bitstr_value >>= run;
+			bitstr_len -= run;
+		}
+
 		GET_BIT;
 		if (bit == 1) {
-			if (byteIndex >= maxBytes) {
+			if (dst == dstEnd) {
 				warning("Buffer overflow when decoding image: decompress_codec3 walked past the input buffer!");
 				return false;
-			} else {
-				*result++ = *compressed++;
 			}
-			++byteIndex;
-		} else {
+			*dst++ = *src++;
+			continue;
+		}
+
+		GET_BIT;
+		int copy_len, copy_offset;
+		if (bit == 0) {
 			GET_BIT;
-			int copy_len, copy_offset;
-			if (bit == 0) {
-				GET_BIT;
-				copy_len = 2 * bit;
-				GET_BIT;
-				copy_len += bit + 3;
-				copy_offset = *(const uint8 *)(compressed++) - 0x100;
-			} else {
-				copy_offset = (*(const uint8 *)(compressed) | (*(const uint8 *)(compressed + 1) & 0xf0) << 4) - 0x1000;
-				copy_len = (*(const uint8 *)(compressed + 1) & 0xf) + 3;
-				compressed += 2;
-				if (copy_len == 3) {
-					copy_len = *(const uint8 *)(compressed++) + 1;
-					if (copy_len == 1)
-						return true;
-				}
-			}
-			while (copy_len > 0) {
-				if (byteIndex >= maxBytes) {
-					warning("Buffer overflow when decoding image: decompress_codec3 walked past the input buffer!");
-					return false;
-				} else {
-					assert(byteIndex + copy_offset >= 0);
-					assert(byteIndex + copy_offset < maxBytes);
-					*result = result[copy_offset];
-					result++;
-				}
-				++byteIndex;
-				copy_len--;
+			copy_len = 2 * bit;
+			GET_BIT;
+			copy_len += bit + 3;
+			copy_offset = *src++ - 0x100;
+		} else {
+			copy_offset = (src[0] | (src[1] & 0xf0) << 4) - 0x1000;
+			copy_len = (src[1] & 0xf) + 3;
+			src += 2;
+			if (copy_len == 3) {
+				copy_len = *src++ + 1;
+				if (copy_len == 1)
+					return true;
 			}
 		}
+
+		assert(dst - (uint8 *)result + copy_offset >= 0);
+		const uint8 *from = dst + copy_offset;
+		if (dstEnd - dst < copy_len) {
+			while (dst != dstEnd)
+				*dst++ = *from++;
+			warning("Buffer overflow when decoding image: decompress_codec3 walked past the input buffer!");
+			return false;
+		}
+		if (copy_offset <= -8 && dstEnd - dst >= copy_len + 7) {
+			// Eight bytes at a time. Every word read was written before
+			// this copy or by an earlier word of it, and the overshoot past
+			// the match is rewritten by what follows.
+			uint8 *end = dst + copy_len;
+			do {
+				memcpy(dst, from, 8);
+				dst += 8;
+				from += 8;
+			} while (dst < end);
+			dst = end;
+		} else {
+			for (int n = 0; n < copy_len; ++n)
+				*dst++ = *from++;
+		}
 	}
 	return true;
 }
@@ -59,6 +59,17 @@ public:
 
 	void load();
 
+	/**
+	 * Releases what the renderer holds for this bitmap, before the renderer
+	 * is replaced. Bitmaps read from a file are read again on their next use,
+	 * as the renderers convert the pixels in place.
+	 */
+	void releaseDriverData();
+	/**
+	 * Recreates a bitmap built from memory on the current renderer.
+	 */
+	void createDriverData();
+
 	/**
 	 * Loads an EMI TILE-bitmap.
 	 *
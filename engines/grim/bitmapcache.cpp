@@ -0,0 +1,245 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#include "common/savefile.h"
+#include "common/stream.h"
+#include "common/system.h"
+
+#include "engines/grim/bitmapcache.h"
+#include "engines/grim/debug.h"
+#include "engines/grim/resource.h"
+
+namespace Grim {
+
+// Enough for the backgrounds and z-buffers of the last dozen or so sets.
+// The cache file is capped at the same size.
+#define BITMAP_CACHE_MEMORY (32 * 1024 * 1024)
+
+// File layout, all little endian:
+//   'BMCA', uint32 version, uint32 count,
+//   count * { uint16 len, char[len] name, uint16 len, char[len] lab,
+//             uint32 lab offset, uint32 lab size, uint32 size },
+//   then the decoded images of each bitmap, size bytes each, in order
+#define BITMAP_CACHE_VERSION 3
+
+BitmapCache::BitmapCache(const Common::String &target, bool useDisk) :
+		_memorySize(0), _diskName(target + ".bmcache"), _useDisk(useDisk), _dirty(false) {
+	if (_useDisk) {
+		loadDiskIndex();
+	}
+}
+
+BitmapCache::~BitmapCache() {
+	if (_useDisk && _dirty) {
+		saveDisk();
+	}
+}
+
+const byte *BitmapCache::find(const Common::String &name, Common::SeekableReadStream *source, uint32 size, Key &key) {
+	key.name = name;
+	key.lab.clear();
+	if (size == 0) {
+		return nullptr;
+	}
+	// The size check catches a caller that names a file other than the one it read
+	if (!g_resourceloader->getLabEntry(name, key.lab, key.offset, key.size) || key.size != (uint32)source->size()) {
+		key.lab.clear();
+		return nullptr;
+	}
+
+	EntryMap::iterator i = _entries.find(name);
+	if (i != _entries.end() && i->_value.offset == key.offset && i->_value.size == key.size &&
+			i->_value.lab.equalsIgnoreCase(key.lab) && i->_value.pixels.size() == size) {
+		_lru.remove(name);
+		_lru.push_front(name);
+		return &i->_value.pixels[0];
+	}
+	if (!_useDisk) {
+		return nullptr;
+	}
+	return loadFromDisk(key, size);
+}
+
+void BitmapCache::store(const Key &key, const byte *pixels, uint32 size) {
+	if (size == 0 || key.lab.empty()) {
+		return;
+	}
+	Entry &entry = insert(key, size);
+	memcpy(&entry.pixels[0], pixels, size);
+	_dirty = true;
+}
+
+BitmapCache::Entry &BitmapCache::insert(const Key &key, uint32 size) {
+	const Common::String &name = key.name;
+	EntryMap::iterator i = _entries.find(name);
+	if (i != _entries.end()) {
+		_memorySize -= i->_value.pixels.size();
+		_lru.remove(name);
+	}
+	// Make room by dropping the least recently used bitmaps.
+	while (!_lru.empty() && _memorySize + size > BITMAP_CACHE_MEMORY) {
+		Common::String oldest = _lru.back();
+		_lru.pop_back();
+		_memorySize -= _entries[oldest].pixels.size();
+		_entries.erase(oldest);
+	}
+
+	Entry &entry = _entries[name];
+	entry.lab = key.lab;
+	entry.offset = key.offset;
+	entry.size = key.size;
+	entry.pixels.resize(size);
+	_memorySize += size;
+	_lru.push_front(name);
+	return entry;
+}
+
+const byte *BitmapCache::loadFromDisk(const Key &key, uint32 size) {
+	DiskEntryMap::const_iterator d = _diskEntries.find(key.name);
+	if (d == _diskEntries.end() || d->_value.offset != key.offset || d->_value.size != key.size ||
+			!d->_value.lab.equalsIgnoreCase(key.lab) || d->_value.pixelSize != size) {
+		return nullptr;
+	}
+
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(_diskName);
+	if (!file) {
+		return nullptr;
+	}
+	Entry &entry = insert(key, size);
+	const byte *pixels = nullptr;
+	if (file->seek(d->_value.filePos, SEEK_SET) && file->read(&entry.pixels[0], size) == size) {
+		pixels = &entry.pixels[0];
+	} else {
+		Debug::debug(Debug::Bitmaps, "Ignoring damaged decoded bitmap cache entry for %s", key.name.c_str());
+		_lru.remove(key.name);
+		_memorySize -= size;
+		_entries.erase(key.name);
+	}
+	delete file;
+	return pixels;
+}
+
+static Common::String readName(Common::SeekableReadStream *file) {
+	uint16 len = file->readUint16LE();
+	Common::String name;
+	for (uint16 j = 0; j < len; j++) {
+		name += (char)file->readByte();
+	}
+	return name;
+}
+
+// Only the index is read up front, the images when they are first used.
+void BitmapCache::loadDiskIndex() {
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(_diskName);
+	if (!file) {
+		return;
+	}
+
+	bool ok = file->readUint32BE() == MKTAG('B', 'M', 'C', 'A') && file->readUint32LE() == BITMAP_CACHE_VERSION;
+	uint32 count = ok ? file->readUint32LE() : 0;
+	for (uint32 i = 0; ok && i < count; i++) {
+		Common::String name = readName(file);
+		DiskEntry &entry = _diskEntries[name];
+		entry.lab = readName(file);
+		entry.offset = file->readUint32LE();
+		entry.size = file->readUint32LE();
+		entry.pixelSize = file->readUint32LE();
+		_diskOrder.push_back(name);
+		ok = !file->eos() && !file->err();
+	}
+	// The images follow the index, check that they are all there.
+	uint32 pos = file->pos();
+	for (uint32 i = 0; ok && i < _diskOrder.size(); i++) {
+		DiskEntry &entry = _diskEntries[_diskOrder[i]];
+		entry.filePos = pos;
+		ok = entry.pixelSize <= (uint32)file->size() - pos;
+		pos += entry.pixelSize;
+	}
+	if (!ok || _diskOrder.size() != _diskEntries.size()) {
+		Debug::debug(Debug::Bitmaps, "Ignoring stale decoded bitmap cache %s", _diskName.c_str());
+		_diskEntries.clear();
+		_diskOrder.clear();
+	}
+	delete file;
+}
+
+void BitmapCache::saveDisk() {
+	// Bitmaps that are only in the old file go after the ones in memory, as
+	// long as they fit in the budget.
+	Common::InSaveFile *in = nullptr;
+	for (uint i = 0; i < _diskOrder.size(); i++) {
+		const Common::String &name = _diskOrder[i];
+		const DiskEntry &disk = _diskEntries[name];
+		if (_entries.contains(name) || _memorySize + disk.pixelSize > BITMAP_CACHE_MEMORY) {
+			continue;
+		}
+		if (!in) {
+			in = g_system->getSavefileManager()->openForLoading(_diskName);
+			if (!in) {
+				break;
+			}
+		}
+		Entry &entry = _entries[name];
+		entry.lab = disk.lab;
+		entry.offset = disk.offset;
+		entry.size = disk.size;
+		entry.pixels.resize(disk.pixelSize);
+		if (in->seek(disk.filePos, SEEK_SET) && in->read(&entry.pixels[0], disk.pixelSize) == disk.pixelSize) {
+			_memorySize += disk.pixelSize;
+			_lru.push_back(name);
+		} else {
+			_entries.erase(name);
+		}
+	}
+	delete in;
+
+	Common::OutSaveFile *file = g_system->getSavefileManager()->openForSaving(_diskName, false);
+	if (!file) {
+		warning("Cannot write decoded bitmap cache %s", _diskName.c_str());
+		return;
+	}
+	file->writeUint32BE(MKTAG('B', 'M', 'C', 'A'));
+	file->writeUint32LE(BITMAP_CACHE_VERSION);
+	file->writeUint32LE(_lru.size());
+	for (Common::List<Common::String>::const_iterator i = _lru.begin(); i != _lru.end(); ++i) {
+		const Entry &entry = _entries[*i];
+		file->writeUint16LE(i->size());
+		file->write(i->c_str(), i->size());
+		file->writeUint16LE(entry.lab.size());
+		file->write(entry.lab.c_str(), entry.lab.size());
+		file->writeUint32LE(entry.offset);
+		file->writeUint32LE(entry.size);
+		file->writeUint32LE(entry.pixels.size());
+	}
+	for (Common::List<Common::String>::const_iterator i = _lru.begin(); i != _lru.end(); ++i) {
+		const Entry &entry = _entries[*i];
+		file->write(&entry.pixels[0], entry.pixels.size());
+	}
+	file->finalize();
+	if (file->err()) {
+		warning("Error writing decoded bitmap cache %s", _diskName.c_str());
+	}
+	delete file;
+}
+
+} // end of namespace Grim
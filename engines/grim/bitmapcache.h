@@ -0,0 +1,104 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#ifndef GRIM_BITMAPCACHE_H
+#define GRIM_BITMAPCACHE_H
+
+#include "common/array.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/list.h"
+#include "common/str.h"
+
+namespace Common {
+class SeekableReadStream;
+}
+
+namespace Grim {
+
+/**
+ * Keeps the decompressed images of codec 3 bitmaps, so that going back to
+ * a set does not decompress its backgrounds and z-buffers again. Recently
+ * used bitmaps stay in memory up to a budget. Optionally they are also
+ * written to one file per target when the cache is destroyed, up to the same
+ * budget, and reused across sessions. Bitmaps are keyed by name and by the
+ * LAB entry the name resolves to, so a hit doesn't read the source file.
+ */
+class BitmapCache {
+public:
+	struct Key {
+		Common::String name;
+		Common::String lab; //< Empty if the bitmap can't be cached
+		uint32 offset;
+		uint32 size;
+	};
+
+	BitmapCache(const Common::String &target, bool useDisk);
+	~BitmapCache();
+
+	/**
+	 * Returns the 'size' bytes of decoded images of the bitmap 'name' read
+	 * from 'source', or nullptr if they are not cached. The pointer stays
+	 * valid until the next store(). Fills in 'key' for a following store().
+	 */
+	const byte *find(const Common::String &name, Common::SeekableReadStream *source, uint32 size, Key &key);
+	void store(const Key &key, const byte *pixels, uint32 size);
+
+private:
+	struct Entry {
+		Common::String lab;
+		uint32 offset;
+		uint32 size;
+		Common::Array<byte> pixels;
+	};
+	struct DiskEntry {
+		Common::String lab;
+		uint32 offset;
+		uint32 size;
+		uint32 pixelSize;
+		uint32 filePos;
+	};
+	typedef Common::HashMap<Common::String, Entry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> EntryMap;
+	typedef Common::HashMap<Common::String, DiskEntry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> DiskEntryMap;
+
+	Entry &insert(const Key &key, uint32 size);
+	const byte *loadFromDisk(const Key &key, uint32 size);
+	void loadDiskIndex();
+	void saveDisk();
+
+	EntryMap _entries;
+	// Names in _entries, most recently used first.
+	Common::List<Common::String> _lru;
+	uint32 _memorySize;
+
+	// Bitmaps in the cache file, in the order they are stored there.
+	DiskEntryMap _diskEntries;
+	Common::Array<Common::String> _diskOrder;
+	Common::String _diskName;
+	bool _useDisk;
+	bool _dirty;
+};
+
+} // end of namespace Grim
+
+#endif
@@ -114,7 +114,7 @@ Costume::Costume(const Common::String &fname, Actor *owner, Costume *prevCost) :
 }
 
 void Costume::load(Common::SeekableReadStream *data) {
-	TextSplitter ts(_fname, data);
+	TextSplitter ts(_fname, data, g_resourceloader->getTextCache());
 	ts.expectString("costume v0.1");
 	ts.expectString("section tags");
 	int numTags;
@@ -426,6 +426,12 @@ void Costume::setupTextures() {
 			_components[i]->setupTexture();
 }
 
+void Costume::prepareForRender() {
+	for (int i = 0; i < _numComponents; i++)
+		if (_components[i])
+			_components[i]->prepareForRender();
+}
+
 void Costume::draw() {
 	for (int i = 0; i < _numComponents; i++)
 		if (_components[i])
@@ -26,6 +26,7 @@
 #include "common/str.h"
 
 #include "math/matrix4.h"
+#include "math/aabb.h"
 
 #include "engines/grim/object.h"
 
@@ -83,8 +84,14 @@ public:
 	virtual int update(uint frameTime);
 	void animate();
 	void setupTextures();
+	virtual void prepareForRender();
 	virtual void draw();
 	void getBoundingBox(int *x1, int *y1, int *x2, int *y2);
+	/**
+	 * Expand bounds with the bounding box of what draw() would draw, in model space.
+	 * Returns false if the costume cannot be bounded.
+	 */
+	virtual bool getLocalBounds(Math::AABB *bounds) { return false; }
 	void setPosRotate(const Math::Vector3d &pos, const Math::Angle &pitch,
 					  const Math::Angle &yaw, const Math::Angle &roll);
 	Math::Matrix4 getMatrix() const;
@@ -50,6 +50,7 @@ public:
 	virtual int update(uint time) { return 0; }
 	virtual void animate() { }
 	virtual void setupTexture() { }
+	virtual void prepareForRender() { }
 	virtual void draw() { }
 	virtual void reset() { }
 	virtual void fade(Animation::FadeMode, int) { }
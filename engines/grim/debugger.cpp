@@ -21,10 +21,20 @@
  */
 
 #include "common/config-manager.h"
+#include "common/memstream.h"
+#include "common/system.h"
 
 #include "engines/grim/debugger.h"
 #include "engines/grim/md5check.h"
 #include "engines/grim/grim.h"
+#include "engines/grim/lua.h"
+#include "engines/grim/emi/modelemi.h"
+#include "engines/grim/sector.h"
+#include "engines/grim/set.h"
+#include "engines/grim/textsplit.h"
+#include "engines/grim/movie/codecs/blocky16.h"
+#include "engines/grim/movie/codecs/vima.h"
+#include "engines/grim/lua/lua.h"
 
 namespace Grim {
 
@@ -37,6 +47,15 @@ Debugger::Debugger() :
 	registerCmd("swap_renderer", WRAP_METHOD(Debugger, cmd_swap_renderer));
 	registerCmd("save", WRAP_METHOD(Debugger, cmd_save));
 	registerCmd("load", WRAP_METHOD(Debugger, cmd_load));
+	registerCmd("bench_skinning", WRAP_METHOD(Debugger, cmd_bench_skinning));
+	registerCmd("actor_culling", WRAP_METHOD(Debugger, cmd_actor_culling));
+	registerCmd("savegame_timings", WRAP_METHOD(Debugger, cmd_savegame_timings));
+	registerCmd("lua_gc", WRAP_METHOD(Debugger, cmd_lua_gc));
+	registerCmd("lua_tasks", WRAP_METHOD(Debugger, cmd_lua_tasks));
+	registerCmd("bench_lua_tables", WRAP_METHOD(Debugger, cmd_bench_lua_tables));
+	registerCmd("bench_vima", WRAP_METHOD(Debugger, cmd_bench_vima));
+	registerCmd("bench_blocky16", WRAP_METHOD(Debugger, cmd_bench_blocky16));
+	registerCmd("bench_textsplit", WRAP_METHOD(Debugger, cmd_bench_textsplit));
 }
 
 Debugger::~Debugger() {
@@ -49,6 +68,7 @@ bool Debugger::cmd_checkFiles(int argc, const char **argv) {
 	} else {
 		debugPrintf("Some files are corrupted or missing.\n");
 	}
+	debugPrintf("Hashed at %.1f MB/s\n", MD5Check::getThroughput());
 
 	return true;
 }
@@ -108,4 +128,437 @@ bool Debugger::cmd_load(int argc, const char **argv) {
 	return true;
 }
 
+// The bench_* commands build their inputs from the same pseudo-random
+// sequence on every run, so that timings can be compared between runs.
+class BenchRandom {
+public:
+	BenchRandom() : _seed(0x12345678) {}
+	uint32 next() {
+		_seed = _seed * 1103515245 + 12345;
+		return _seed >> 16;
+	}
+
+private:
+	uint32 _seed;
+};
+
+static int benchIterations(int argc, const char **argv, int iterations) {
+	return argc >= 2 ? MAX(1, atoi(argv[1])) : iterations;
+}
+
+// Milliseconds since start, at least 1 so that rates can be divided by it.
+static uint32 benchElapsed(uint32 start) {
+	return MAX<uint32>(1, g_system->getMillis() - start);
+}
+
+bool Debugger::cmd_bench_skinning(int argc, const char **argv) {
+	const int numVertices = 5000;
+	const int numJoints = 40;
+	const int maxInfluences = 4;
+	int iterations = benchIterations(argc, argv, 200);
+
+	// Build a synthetic mesh with one to four influences per vertex.
+	Math::Vector3d *vertices = new Math::Vector3d[numVertices];
+	Math::Vector3d *normals = new Math::Vector3d[numVertices];
+	Math::Vector3d *outVertices = new Math::Vector3d[numVertices];
+	Math::Vector3d *outNormals = new Math::Vector3d[numVertices];
+	int *influenceStart = new int[numVertices + 1];
+	int *joints = new int[numVertices * maxInfluences];
+	float *weights = new float[numVertices * maxInfluences];
+	Math::Matrix4 *skinMatrices = new Math::Matrix4[numJoints];
+
+	BenchRandom random;
+	int numInfluences = 0;
+	for (int i = 0; i < numVertices; i++) {
+		uint32 xy = random.next(), z = random.next();
+		vertices[i].set((xy & 0xff) / 255.0f, (xy >> 8) / 255.0f, (z & 0xff) / 255.0f);
+		normals[i].set(0.0f, 1.0f, 0.0f);
+
+		influenceStart[i] = numInfluences;
+		int count = 1 + (z >> 8) % maxInfluences;
+		for (int j = 0; j < count; j++) {
+			joints[numInfluences] = (i + j * 7) % numJoints;
+			weights[numInfluences] = 1.0f / count;
+			numInfluences++;
+		}
+	}
+	influenceStart[numVertices] = numInfluences;
+
+	for (int i = 0; i < numJoints; i++) {
+		skinMatrices[i].buildFromXYZ(Math::Angle(i * 3.0f), Math::Angle(i * 5.0f), Math::Angle(i * 7.0f), Math::EO_XYZ);
+		skinMatrices[i].setPosition(Math::Vector3d(i * 0.1f, 0.0f, -i * 0.1f));
+		skinMatrices[i].transpose();
+	}
+
+	uint32 start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		EMIModel::skinVertices(numVertices, influenceStart, joints, weights, skinMatrices,
+		                       vertices, normals, outVertices, outNormals);
+	}
+	uint32 elapsed = benchElapsed(start);
+
+	debugPrintf("Skinned %d vertices (%d influences, %d joints) %d times in %u ms\n",
+	            numVertices, numInfluences, numJoints, iterations, elapsed);
+	debugPrintf("%.3f ms per mesh, %.1f Mvertices/s\n", (float)elapsed / iterations,
+	            (float)numVertices * iterations / elapsed / 1000.0f);
+
+	delete[] vertices;
+	delete[] normals;
+	delete[] outVertices;
+	delete[] outNormals;
+	delete[] influenceStart;
+	delete[] joints;
+	delete[] weights;
+	delete[] skinMatrices;
+	return true;
+}
+
+bool Debugger::cmd_actor_culling(int argc, const char **argv) {
+	debugPrintf("%d of %d actors culled in the last frame\n", g_grim->getNumCulledActors(), g_grim->getNumTestedActors());
+	return true;
+}
+
+bool Debugger::cmd_savegame_timings(int argc, const char **argv) {
+	debugPrintf("Last save took %d ms, last load took %d ms\n", g_grim->getLastSaveTime(), g_grim->getLastLoadTime());
+	return true;
+}
+
+bool Debugger::cmd_lua_gc(int argc, const char **argv) {
+	if (argc >= 2)
+		LuaBase::instance()->setGCStepBudget(MAX(1, atoi(argv[1])));
+
+	lua_GCStats stats;
+	lua_getgcstats(&stats);
+	debugPrintf("Step budget: %d us, work rate: %d units/ms, cycle %s\n", LuaBase::instance()->getGCStepBudget(),
+				stats.workRate, stats.running ? "marking" : stats.sweeping ? "sweeping" : "idle");
+	debugPrintf("%d cycles in %d steps, %d full collections\n", stats.cycles, stats.steps, stats.fullCollections);
+	debugPrintf("Last step: %d of %d units of work, estimated at %d us\n", stats.lastStepWork, stats.lastStepLimit,
+				stats.lastStepEstimate);
+	debugPrintf("Step pause: last %d ms, max %d ms\n", stats.lastStepTime, stats.maxStepTime);
+	debugPrintf("Final mark step pause: last %d ms, max %d ms\n", stats.lastFinishTime, stats.maxFinishTime);
+	debugPrintf("Last full collection: %d ms\n", stats.lastFullTime);
+	return true;
+}
+
+bool Debugger::cmd_lua_tasks(int argc, const char **argv) {
+	lua_TaskStats stats;
+	lua_gettaskstats(&stats);
+	debugPrintf("Scripts: %d runnable, %d sleeping, %d paused\n", stats.runnable, stats.sleeping, stats.paused);
+	debugPrintf("Last frame: %d tasks run in %d passes, max %d tasks per frame\n", stats.lastTasksRun,
+				stats.lastPasses, stats.maxTasksRun);
+	return true;
+}
+
+bool Debugger::cmd_bench_lua_tables(int argc, const char **argv) {
+	const int numKeys = 512;
+	int iterations = benchIterations(argc, argv, 200000);
+
+	// Half of the keys are short identifiers, half are long, path-like strings.
+	Common::String *keys = new Common::String[numKeys];
+	for (int i = 0; i < numKeys; i++) {
+		if (i & 1)
+			keys[i] = Common::String::format("scripts/actors/manny/costumes/%d/chore_%d.cos", i, i * 7);
+		else
+			keys[i] = Common::String::format("key_%d", i);
+	}
+	static lua_ConstString constKey = LUA_CONSTSTRING("frameTime");
+
+	lua_beginblock();
+	lua_Object table = lua_createtable();
+
+	uint32 start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		lua_beginblock();
+		lua_pushstring(keys[i % numKeys].c_str());
+		lua_endblock();
+	}
+	uint32 internTime = benchElapsed(start);
+
+	start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		lua_beginblock();
+		lua_pushconststring(&constKey);
+		lua_endblock();
+	}
+	uint32 constTime = benchElapsed(start);
+
+	start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		lua_beginblock();
+		lua_pushobject(table);
+		lua_pushstring(keys[i % numKeys].c_str());
+		lua_pushnumber(i);
+		lua_settable();
+		lua_endblock();
+	}
+	uint32 setTime = benchElapsed(start);
+
+	float sum = 0.0f;
+	start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		lua_beginblock();
+		lua_pushobject(table);
+		lua_pushstring(keys[i % numKeys].c_str());
+		sum += lua_getnumber(lua_gettable());
+		lua_endblock();
+	}
+	uint32 getTime = benchElapsed(start);
+
+	start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		lua_beginblock();
+		lua_pushobject(table);
+		lua_pushnumber(i % 4096);
+		lua_pushnumber(i);
+		lua_settable();
+		lua_endblock();
+	}
+	uint32 numberTime = benchElapsed(start);
+
+	lua_endblock();
+	delete[] keys;
+
+	debugPrintf("%d operations over %d string keys (checksum %.0f)\n", iterations, numKeys, sum);
+	debugPrintf("Intern string:   %5u ms, %.2f Mops/s\n", internTime, (float)iterations / internTime / 1000.0f);
+	debugPrintf("Constant string: %5u ms, %.2f Mops/s\n", constTime, (float)iterations / constTime / 1000.0f);
+	debugPrintf("Set string key:  %5u ms, %.2f Mops/s\n", setTime, (float)iterations / setTime / 1000.0f);
+	debugPrintf("Get string key:  %5u ms, %.2f Mops/s\n", getTime, (float)iterations / getTime / 1000.0f);
+	debugPrintf("Set number key:  %5u ms, %.2f Mops/s\n", numberTime, (float)iterations / numberTime / 1000.0f);
+	return true;
+}
+
+bool Debugger::cmd_bench_vima(int argc, const char **argv) {
+	const int numStreams = 64;
+	const int blockSize = 0x2000;
+	// Every sample takes at most 7 + 16 bits, plus the header and the two
+	// bytes the decoder may read ahead.
+	const int streamSize = blockSize / 2 * 23 / 8 + 8;
+	int iterations = benchIterations(argc, argv, 20);
+
+	// Random bitstreams behind valid mono and stereo headers exercise every
+	// code width, both signs and the literal sample escape.
+	uint16 *destTable = new uint16[5786];
+	vimaInit(destTable);
+	byte *streams = new byte[numStreams * streamSize];
+	BenchRandom random;
+	for (int i = 0; i < numStreams * streamSize; i++)
+		streams[i] = random.next() >> 8;
+	for (int i = 0; i < numStreams; i++) {
+		byte *header = streams + i * streamSize;
+		header[0] = header[0] % 89;
+		if (i & 1) {
+			header[0] = ~header[0];
+			header[3] = header[3] % 89;
+		}
+	}
+
+	int16 *reference = new int16[blockSize / 2];
+	int16 *output = new int16[blockSize / 2];
+	int mismatches = 0;
+	for (int i = 0; i < numStreams; i++) {
+		decompressVimaReference(streams + i * streamSize, reference, blockSize, destTable);
+		decompressVima(streams + i * streamSize, output, blockSize);
+		if (memcmp(reference, output, blockSize) != 0)
+			mismatches++;
+	}
+
+	uint32 start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		for (int j = 0; j < numStreams; j++)
+			decompressVimaReference(streams + j * streamSize, output, blockSize, destTable);
+	}
+	uint32 referenceTime = benchElapsed(start);
+
+	start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		for (int j = 0; j < numStreams; j++)
+			decompressVima(streams + j * streamSize, output, blockSize);
+	}
+	uint32 decodeTime = benchElapsed(start);
+
+	float megabytes = (float)iterations * numStreams * blockSize / (1024 * 1024);
+	debugPrintf("Decoded %d blocks of %d bytes %d times, %d of %d blocks differ from the reference\n",
+	            numStreams, blockSize, iterations, mismatches, numStreams);
+	debugPrintf("Reference: %5u ms, %.1f MB/s\n", referenceTime, megabytes * 1000.0f / referenceTime);
+	debugPrintf("Decoder:   %5u ms, %.1f MB/s\n", decodeTime, megabytes * 1000.0f / decodeTime);
+
+	delete[] destTable;
+	delete[] streams;
+	delete[] reference;
+	delete[] output;
+	return true;
+}
+
+// Writes one random Blocky16 block opcode, with its operands, for a block at
+// the given subdivision level. Blocks near the top and bottom edges only use
+// the null motion vector, so that no copy reads outside of the frame buffers.
+static byte *writeBlocky16Op(byte *dst, int level, bool edge, BenchRandom &random) {
+	int op = random.next() % 100;
+	if (op < 45) {
+		*dst++ = edge ? 0 : random.next() % 0xF5;
+	} else if (op < 55) {
+		*dst++ = 0xF6;
+	} else if (op < 65) {
+		*dst++ = 0xFE;
+		*dst++ = random.next();
+		*dst++ = random.next();
+	} else if (op < 70) {
+		*dst++ = 0xFD;
+		*dst++ = random.next();
+	} else if (op < 75) {
+		*dst++ = 0xF9 + random.next() % 4;
+	} else if (op < 80) {
+		if (level == 3) {
+			*dst++ = 0xF7;
+			for (int i = 0; i < 4; i++)
+				*dst++ = random.next();
+		} else {
+			*dst++ = 0xF8;
+			for (int i = 0; i < 5; i++)
+				*dst++ = random.next();
+		}
+	} else {
+		*dst++ = 0xFF;
+		if (level == 3) {
+			for (int i = 0; i < 8; i++)
+				*dst++ = random.next();
+		} else {
+			for (int i = 0; i < 4; i++)
+				dst = writeBlocky16Op(dst, level + 1, edge, random);
+		}
+	}
+	return dst;
+}
+
+bool Debugger::cmd_bench_blocky16(int argc, const char **argv) {
+	const int width = 640;
+	const int height = 480;
+	const int numFrames = 30;
+	const int blocksWidth = width / 8;
+	const int blocksHeight = height / 8;
+	// The header, and at most 149 bytes for a fully subdivided block
+	const int maxFrameSize = 560 + blocksWidth * blocksHeight * 149;
+	int iterations = benchIterations(argc, argv, 10);
+
+	// Codec 47 frames of random block opcodes, every third one rotating the
+	// delta buffers like the movies do.
+	byte *buffer = new byte[maxFrameSize];
+	byte *frames[numFrames];
+	BenchRandom random;
+	for (int f = 0; f < numFrames; f++) {
+		memset(buffer, 0, 560);
+		WRITE_LE_UINT16(buffer + 16, f);
+		buffer[18] = 2;
+		buffer[19] = (f % 3 == 2) ? 1 : 0;
+		for (int i = 24; i < 552; i++)
+			buffer[i] = random.next();
+
+		byte *dst = buffer + 560;
+		for (int y = 0; y < blocksHeight; y++) {
+			for (int x = 0; x < blocksWidth; x++)
+				dst = writeBlocky16Op(dst, 1, y < 6 || y >= blocksHeight - 6, random);
+		}
+		frames[f] = new byte[dst - buffer];
+		memcpy(frames[f], buffer, dst - buffer);
+	}
+	delete[] buffer;
+
+	Blocky16 blocky16;
+	blocky16.init(width, height);
+	uint32 checksum = 0;
+	uint32 start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		for (int f = 0; f < numFrames; f++) {
+			const byte *frame = blocky16.decode(frames[f]);
+			checksum = checksum * 31 + frame[(f * 7919) % (width * height * 2)];
+		}
+	}
+	uint32 elapsed = benchElapsed(start);
+
+	debugPrintf("Decoded %d frames of %dx%d %d times in %u ms (checksum %08x)\n", numFrames, width, height,
+	            iterations, elapsed, checksum);
+	debugPrintf("%.3f ms per frame, %.1f frames/s\n", (float)elapsed / (iterations * numFrames),
+	            iterations * numFrames * 1000.0f / elapsed);
+
+	for (int f = 0; f < numFrames; f++)
+		delete[] frames[f];
+	return true;
+}
+
+bool Debugger::cmd_bench_textsplit(int argc, const char **argv) {
+	int iterations = benchIterations(argc, argv, 10);
+	int numSectors = 2000;
+	if (argc >= 3)
+		numSectors = MAX(1, atoi(argv[2]));
+	const int numLights = numSectors / 20 + 1;
+
+	// The lights and sectors sections of a .set file, laid out the way the
+	// game's sets are, with random coordinates.
+	BenchRandom random;
+	Common::String text("section: lights\n");
+	text += Common::String::format("\tnumlights %d\n", numLights);
+	for (int i = 0; i < numLights; i++) {
+		text += Common::String::format("\n\tlight light_%d\n\ttype %s\n", i, i % 2 ? "spot" : "omni");
+		text += Common::String::format("\tposition %d.%06u %d.%06u %d.%06u\n", (int)(random.next() % 20) - 10, random.next() % 1000000,
+		                               (int)(random.next() % 20) - 10, random.next() % 1000000, (int)(random.next() % 5), random.next() % 1000000);
+		text += "\tdirection 0.000000 0.000000 -1.000000\n\tintensity 1.000000\n";
+		text += "\tumbraangle 45.000000\n\tpenumbraangle 60.000000\n\tcolor 255 240 200\n";
+	}
+	text += "\nsection: sectors\n";
+	for (int i = 0; i < numSectors; i++) {
+		int numVertices = 4 + random.next() % 8;
+		text += Common::String::format("\tsector sector_%d # sector comment\n\tid %d\n\ttype %s\n", i, i, i % 3 ? "walk" : "camera");
+		text += Common::String::format("\tdefault visibility visible\n\theight 0.000000\n\tnumvertices %d\n", numVertices);
+		for (int v = 0; v < numVertices; v++) {
+			text += Common::String::format(v ? "\t            %d.%06u %d.%06u %d.%06u\n" : "\tvertices:   %d.%06u %d.%06u %d.%06u\n",
+			                               (int)(random.next() % 20) - 10, random.next() % 1000000,
+			                               (int)(random.next() % 20) - 10, random.next() % 1000000,
+			                               (int)(random.next() % 3), random.next() % 1000000);
+		}
+		text += "\n";
+	}
+
+	float checksum = 0.f;
+	int lines = 0;
+	uint32 start = g_system->getMillis();
+	for (int i = 0; i < iterations; i++) {
+		Common::MemoryReadStream stream((const byte *)text.c_str(), text.size());
+		TextSplitter ts("bench_textsplit.set", &stream);
+
+		int count;
+		ts.expectString("section: lights");
+		ts.scanString(" numlights %d", 1, &count);
+		for (int l = 0; l < count; l++) {
+			Light light;
+			light.load(ts);
+			checksum += light._pos.x();
+		}
+
+		// Count then load the sectors in two passes, as Set::loadText does
+		ts.expectString("section: sectors");
+		int sectorStart = ts.getLineNumber();
+		char buf[256];
+		count = 0;
+		while (!ts.isEof()) {
+			ts.scanString(" %s", 1, buf);
+			if (!scumm_stricmp(buf, "sector"))
+				count++;
+		}
+		lines = ts.getLineNumber();
+		ts.setLineNumber(sectorStart);
+		for (int s = 0; s < count; s++) {
+			Sector sector;
+			sector.load(ts);
+			checksum += sector.getNormal().z();
+		}
+	}
+	uint32 elapsed = benchElapsed(start);
+
+	debugPrintf("Parsed a %u byte set text (%d lights, %d sectors) %d times in %u ms (checksum %f)\n", text.size(),
+	            numLights, numSectors, iterations, elapsed, checksum);
+	debugPrintf("%.3f ms per file, %.1f MB/s, %.0f lines/s\n", (float)elapsed / iterations,
+	            (float)text.size() * iterations / (elapsed * 1000.0f), (float)lines * iterations * 1000.0f / elapsed);
+	return true;
+}
+
 }
@@ -40,6 +40,15 @@ public:
 	bool cmd_swap_renderer(int argc, const char **argv);
 	bool cmd_save(int argc, const char **argv);
 	bool cmd_load(int argc, const char **argv);
+	bool cmd_bench_skinning(int argc, const char **argv);
+	bool cmd_actor_culling(int argc, const char **argv);
+	bool cmd_savegame_timings(int argc, const char **argv);
+	bool cmd_lua_gc(int argc, const char **argv);
+	bool cmd_lua_tasks(int argc, const char **argv);
+	bool cmd_bench_lua_tables(int argc, const char **argv);
+	bool cmd_bench_vima(int argc, const char **argv);
+	bool cmd_bench_blocky16(int argc, const char **argv);
+	bool cmd_bench_textsplit(int argc, const char **argv);
 };
 
 }
@@ -72,18 +72,20 @@ void Bone::loadBinary(Common::SeekableReadStream *data) {
 
 	char temp[4];
 	if (_operation == 3) { // Translation
-		_translations = new AnimTranslation[_count];
+		_translations = new Math::Vector3d[_count];
+		_times = new float[_count];
 		for (int j = 0; j < _count; j++) {
-			_translations[j]._vec.readFromStream(data);
+			_translations[j].readFromStream(data);
 			data->read(temp, 4);
-			_translations[j]._time = 1000 * get_float(temp);
+			_times[j] = 1000 * get_float(temp);
 		}
 	} else if (_operation == 4) { // Rotation
-		_rotations = new AnimRotation[_count];
+		_rotations = new Math::Quaternion[_count];
+		_times = new float[_count];
 		for (int j = 0; j < _count; j++) {
-			_rotations[j]._quat.readFromStream(data);
+			_rotations[j].readFromStream(data);
 			data->read(temp, 4);
-			_rotations[j]._time = 1000 * get_float(temp);
+			_times[j] = 1000 * get_float(temp);
 		}
 	} else {
 		error("Unknown animation-operation %d", _operation);
@@ -91,25 +93,54 @@ void Bone::loadBinary(Common::SeekableReadStream *data) {
 }
 
 Bone::~Bone() {
-	if (_operation == 3) {
-		delete[] _translations;
-	} else if (_operation == 4) {
-		delete[] _rotations;
+	delete[] _times;
+	delete[] _translations;
+	delete[] _rotations;
+}
+
+int Bone::findKeyframe(float time, int cursor) const {
+	if (cursor < 0 || cursor > _count || (cursor > 0 && _times[cursor - 1] >= time)) {
+		// Seeked backwards or looped, search the whole range.
+		cursor = 0;
+	} else {
+		// Playback moves forward, so the key is usually the same as the
+		// last time or one of the next few.
+		for (int i = 0; i < 4; ++i) {
+			if (cursor == _count || _times[cursor] >= time)
+				return cursor;
+			++cursor;
+		}
+	}
+
+	// Binary search in [cursor, _count). All the keys before cursor are known to be < time.
+	int low = cursor, high = _count;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (_times[mid] >= time)
+			high = mid;
+		else
+			low = mid + 1;
 	}
+	return low;
 }
 
 AnimationStateEmi::AnimationStateEmi(const Common::String &anim) :
 		_skel(nullptr), _looping(false), _active(false),
 		_fadeMode(Animation::None), _fade(1.0f), _fadeLength(0), _time(0), _startFade(1.0f),
-		_boneJoints(nullptr) {
+		_boneJoints(nullptr), _boneCursors(nullptr) {
 	_anim = g_resourceloader->getAnimationEmi(anim);
-	if (_anim)
+	if (_anim) {
 		_boneJoints = new int[_anim->_numBones];
+		_boneCursors = new int[_anim->_numBones];
+		for (int i = 0; i < _anim->_numBones; i++)
+			_boneCursors[i] = 0;
+	}
 }
 
 AnimationStateEmi::~AnimationStateEmi() {
 	deactivate();
 	delete[] _boneJoints;
+	delete[] _boneCursors;
 }
 
 void AnimationStateEmi::activate() {
@@ -207,8 +238,10 @@ void AnimationStateEmi::animate() {
 		AnimationLayer *layer = _skel->getLayer(curBone._priority);
 		JointAnimation &jointAnim = layer->_jointAnims[jointIndex];
 
+		int keyfIdx = curBone.findKeyframe((float)_time, _boneCursors[bone]);
+		_boneCursors[bone] = keyfIdx;
+
 		if (curBone._rotations) {
-			int keyfIdx = -1;
 			Math::Quaternion quat;
 
 			// Normalize the weight so that the sum of applied weights will equal 1.
@@ -218,24 +251,17 @@ void AnimationStateEmi::animate() {
 				normalizedRotWeight = _fade / jointAnim._rotWeight;
 			}
 
-			for (int curKeyFrame = 0; curKeyFrame < curBone._count; curKeyFrame++) {
-				if (curBone._rotations[curKeyFrame]._time >= _time) {
-					keyfIdx = curKeyFrame;
-					break;
-				}
-			}
-
 			if (keyfIdx == 0) {
-				quat = curBone._rotations[0]._quat;
+				quat = curBone._rotations[0];
 			}
-			else if (keyfIdx != -1) {
-				float timeDelta = curBone._rotations[keyfIdx]._time - curBone._rotations[keyfIdx - 1]._time;
-				float interpVal = (_time - curBone._rotations[keyfIdx - 1]._time) / timeDelta;
+			else if (keyfIdx != curBone._count) {
+				float timeDelta = curBone._times[keyfIdx] - curBone._times[keyfIdx - 1];
+				float interpVal = (_time - curBone._times[keyfIdx - 1]) / timeDelta;
 
-				quat = curBone._rotations[keyfIdx - 1]._quat.slerpQuat(curBone._rotations[keyfIdx]._quat, interpVal);
+				quat = curBone._rotations[keyfIdx - 1].slerpQuat(curBone._rotations[keyfIdx], interpVal);
 			}
 			else {
-				quat = curBone._rotations[curBone._count - 1]._quat;
+				quat = curBone._rotations[curBone._count - 1];
 			}
 
 			Math::Quaternion &quatFinal = jointAnim._quat;
@@ -245,7 +271,6 @@ void AnimationStateEmi::animate() {
 		}
 
 		if (curBone._translations) {
-			int keyfIdx = -1;
 			Math::Vector3d vec;
 
 			// Normalize the weight so that the sum of applied weights will equal 1.
@@ -255,25 +280,18 @@ void AnimationStateEmi::animate() {
 				normalizedTransWeight = _fade / jointAnim._transWeight;
 			}
 
-			for (int curKeyFrame = 0; curKeyFrame < curBone._count; curKeyFrame++) {
-				if (curBone._translations[curKeyFrame]._time >= _time) {
-					keyfIdx = curKeyFrame;
-					break;
-				}
-			}
-
 			if (keyfIdx == 0) {
-				vec = curBone._translations[0]._vec;
+				vec = curBone._translations[0];
 			}
-			else if (keyfIdx != -1) {
-				float timeDelta = curBone._translations[keyfIdx]._time - curBone._translations[keyfIdx - 1]._time;
-				float interpVal = (_time - curBone._translations[keyfIdx - 1]._time) / timeDelta;
+			else if (keyfIdx != curBone._count) {
+				float timeDelta = curBone._times[keyfIdx] - curBone._times[keyfIdx - 1];
+				float interpVal = (_time - curBone._times[keyfIdx - 1]) / timeDelta;
 
-				vec = curBone._translations[keyfIdx - 1]._vec +
-					(curBone._translations[keyfIdx]._vec - curBone._translations[keyfIdx - 1]._vec) * interpVal;
+				vec = curBone._translations[keyfIdx - 1] +
+					(curBone._translations[keyfIdx] - curBone._translations[keyfIdx - 1]) * interpVal;
 			}
 			else {
-				vec = curBone._translations[curBone._count - 1]._vec;
+				vec = curBone._translations[curBone._count - 1];
 			}
 
 			Math::Vector3d &posFinal = jointAnim._pos;
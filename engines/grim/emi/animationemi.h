@@ -32,28 +32,28 @@
 
 namespace Grim {
 
-struct AnimRotation {
-	Math::Quaternion _quat;
-	float _time;
-};
-
-struct AnimTranslation {
-	Math::Vector3d _vec;
-	float _time;
-};
-
 struct Bone {
 	Common::String _boneName;
 	int _operation;
 	int _priority;
 	int _c;
 	int _count;
-	AnimRotation *_rotations;
-	AnimTranslation *_translations;
+	// The keys are stored as separate arrays, so that searching the key times
+	// does not have to touch the key values. Only one of _rotations and
+	// _translations is set, depending on _operation.
+	float *_times;
+	Math::Quaternion *_rotations;
+	Math::Vector3d *_translations;
 	Joint *_target;
-	Bone() : _rotations(NULL), _translations(NULL), _boneName(""), _operation(0), _target(NULL) {}
+	Bone() : _times(NULL), _rotations(NULL), _translations(NULL), _boneName(""), _operation(0), _target(NULL) {}
 	~Bone();
 	void loadBinary(Common::SeekableReadStream *data);
+	/**
+	 * Find the index of the first key whose time is >= time, or _count if there is none.
+	 *
+	 * @param cursor The index returned by the previous call, used as a starting point.
+	 */
+	int findKeyframe(float time, int cursor) const;
 };
 
 class AnimationEmi : public Object {
@@ -105,6 +105,7 @@ private:
 	Animation::FadeMode _fadeMode;
 	int _fadeLength;
 	int *_boneJoints;
+	int *_boneCursors;
 };
 
 } // end of namespace Grim
@@ -66,6 +66,13 @@ void EMIMeshComponent::reset() {
 	_visible = true;
 }
 
+void EMIMeshComponent::prepareForRender() {
+	if (_parent && _parent->isVisible())
+		return;
+	if (_obj)
+		_obj->skin();
+}
+
 void EMIMeshComponent::draw() {
 	// If the object was drawn by being a component
 	// of it's parent then don't draw it
@@ -88,6 +95,19 @@ void EMIMeshComponent::draw() {
 	//translateObject(true);
 }
 
+void EMIMeshComponent::getLocalBounds(Math::AABB *bounds) const {
+	if (_parent && _parent->isVisible())
+		return;
+
+	if (_obj) {
+		const Math::AABB &meshBounds = _obj->getLocalBounds();
+		if (meshBounds.isValid()) {
+			bounds->expand(meshBounds.getMin());
+			bounds->expand(meshBounds.getMax());
+		}
+	}
+}
+
 void EMIMeshComponent::getBoundingBox(int *x1, int *y1, int *x2, int *y2) const {
 	// If the object was drawn by being a component
 	// of it's parent then don't draw it
@@ -24,6 +24,7 @@
 #define GRIM_EMI_MESH_COMPONENT_H
 
 #include "engines/grim/costume/component.h"
+#include "math/aabb.h"
 
 namespace Grim {
 
@@ -37,8 +38,10 @@ public:
 	void init() override;
 	int update(uint time) override;
 	void reset() override;
+	void prepareForRender() override;
 	void draw() override;
 	void getBoundingBox(int *x1, int *y1, int *x2, int *y2) const;
+	void getLocalBounds(Math::AABB *bounds) const;
 
 public:
 	EMICostume *_costume;
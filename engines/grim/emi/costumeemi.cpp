@@ -190,6 +190,54 @@ Component *EMICostume::loadEMIComponent(Component *parent, int parentID, const c
 	return nullptr;
 }
 
+void EMICostume::prepareForRender() {
+	// Only prepare the components which draw() is going to use.
+	bool preparedMesh = false;
+	for (Common::List<Chore*>::iterator it = _playingChores.begin(); it != _playingChores.end(); ++it) {
+		Chore *c = (*it);
+		if (!c->_playing)
+			continue;
+		for (int i = 0; i < c->_numTracks; ++i) {
+			if (c->_tracks[i].component) {
+				c->_tracks[i].component->prepareForRender();
+				if (c->_tracks[i].component->isComponentType('m', 'e', 's', 'h'))
+					preparedMesh = true;
+			}
+		}
+	}
+
+	if (_wearChore && !preparedMesh && _isWearChoreActive) {
+		_wearChore->getMesh()->prepareForRender();
+	}
+}
+
+bool EMICostume::getLocalBounds(Math::AABB *bounds) {
+	// Bound the components which draw() is going to draw.
+	bool boundedMesh = false;
+	for (Common::List<Chore*>::iterator it = _playingChores.begin(); it != _playingChores.end(); ++it) {
+		Chore *c = (*it);
+		if (!c->_playing)
+			continue;
+		for (int i = 0; i < c->_numTracks; ++i) {
+			Component *component = c->_tracks[i].component;
+			if (!component)
+				continue;
+			if (component->isComponentType('m', 'e', 's', 'h')) {
+				static_cast<EMIMeshComponent *>(component)->getLocalBounds(bounds);
+				boundedMesh = true;
+			} else if (component->isComponentType('s', 'p', 'r', 't')) {
+				// Sprites are not bounded.
+				return false;
+			}
+		}
+	}
+
+	if (_wearChore && !boundedMesh && _isWearChoreActive) {
+		_wearChore->getMesh()->getLocalBounds(bounds);
+	}
+	return true;
+}
+
 void EMICostume::draw() {
 	bool drewMesh = false;
 	for (Common::List<Chore*>::iterator it = _playingChores.begin(); it != _playingChores.end(); ++it) {
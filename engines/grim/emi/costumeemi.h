@@ -43,7 +43,9 @@ public:
 
 	void load(Common::SeekableReadStream *data) override;
 
+	void prepareForRender() override;
 	void draw() override;
+	bool getLocalBounds(Math::AABB *bounds) override;
 	int update(uint time) override;
 
 	void playChore(int num, uint msecs = 0) override;
@@ -144,6 +144,16 @@ void EMIEngine::drawNormalMode() {
 	buildActiveActorsList();
 	sortActiveActorsList();
 
+	// Skin all the actors which are going to be drawn in one batch, as in
+	// GrimEngine::drawNormalMode(). The list is sorted by sort order, and the
+	// actors with a negative one are not drawn below.
+	_numTestedActors = 0;
+	_numCulledActors = 0;
+	foreach (Actor *a, _activeActors) {
+		if (a->isInOverworld() || (a->isVisible() && a->getEffectiveSortOrder() >= 0))
+			prepareActorForRender(a);
+	}
+
 	Bitmap *background = _currSet->getCurrSetup()->_bkgndBm;
 	background->_data->load();
 	uint32 numLayers = background->_data->_numLayers;
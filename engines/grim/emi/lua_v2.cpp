@@ -403,17 +403,19 @@ void Lua_V2::ThumbnailFromFile() {
 		lua_pushnil();
 		return;
 	}
-	int dataSize = savedState->beginSection('SIMG');
-	if (dataSize != width * height * 2) {
+	savedState->beginSection('SIMG');
+	uint16 *data = new uint16[width * height];
+	int l = 0;
+	for (; l < width * height && !savedState->isSectionEnd(); l++) {
+		data[l] = savedState->readLEUint16();
+	}
+	if (l != width * height || !savedState->isSectionEnd()) {
 		warning("Lua_V2::ThumbnailFromFile: savegame uses unexpected thumbnail size, ignore it");
 		lua_pushnil();
+		delete[] data;
 		delete savedState;
 		return;
 	}
-	uint16 *data = new uint16[dataSize / 2];
-	for (int l = 0; l < dataSize / 2; l++) {
-		data[l] = savedState->readLEUint16();
-	}
 	Graphics::PixelBuffer buf(Graphics::createPixelFormat<565>(), (byte *)data);
 	screenshot = new Bitmap(buf, width, height, "screenshot");
 	if (!screenshot) {
@@ -33,6 +33,11 @@
 #include "engines/grim/emi/animationemi.h"
 #include "engines/grim/emi/skeleton.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GRIM_SKINNING_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace Grim {
 
 struct Vector3int {
@@ -216,52 +221,152 @@ void EMIModel::setSkeleton(Skeleton *skel) {
 		return;
 	}
 	_skeleton = skel;
+	_hasSkinned = false;
+	_hasLocalBounds = false;
 	if (!skel || !_numBoneInfos) {
 		return;
 	}
-	delete[] _vertexBoneInfo; _vertexBoneInfo = nullptr;
-	_vertexBoneInfo = new int[_numBoneInfos];
-	for (int i = 0; i < _numBoneInfos; i++) {
-		_vertexBoneInfo[i] = _skeleton->findJointIndex(_boneNames[_boneInfos[i]._joint]);
-	}
-}
-
-void EMIModel::prepareForRender() {
-	if (!_skeleton || !_vertexBoneInfo)
-		return;
-
-	for (int i = 0; i < _numVertices; i++) {
-		_drawVertices[i].set(0.0f, 0.0f, 0.0f);
-		_drawNormals[i].set(0.0f, 0.0f, 0.0f);
+	delete[] _skinInfluenceStart;
+	delete[] _skinJoints;
+	delete[] _skinWeights;
+	_skinInfluenceStart = new int[_numVertices + 1];
+	_skinJoints = new int[_numBoneInfos];
+	_skinWeights = new float[_numBoneInfos];
+
+	for (int i = 0; i <= _numVertices; i++) {
+		_skinInfluenceStart[i] = 0;
 	}
 
+	// The bone infos are sorted by vertex, a new vertex starts whenever _incFac is set.
+	int numInfluences = 0;
 	int boneVert = -1;
 	for (int i = 0; i < _numBoneInfos; i++) {
 		if (_boneInfos[i]._incFac == 1) {
 			boneVert++;
 		}
+		if (boneVert < 0 || boneVert >= _numVertices)
+			continue;
 
-		int jointIndex = _vertexBoneInfo[i];
-		const Math::Matrix4 &jointMatrix = _skeleton->_joints[jointIndex]._finalMatrix;
-		const Math::Matrix4 &bindPose = _skeleton->_joints[jointIndex]._absMatrix;
+		int jointIndex = _skeleton->findJointIndex(_boneNames[_boneInfos[i]._joint]);
+		if (jointIndex < 0)
+			continue;
 
-		Math::Vector3d vert = _vertices[boneVert];
-		bindPose.inverseTranslate(&vert);
-		bindPose.inverseRotate(&vert);
-		jointMatrix.transform(&vert, true);
-		_drawVertices[boneVert] += vert * _boneInfos[i]._weight;
+		_skinJoints[numInfluences] = jointIndex;
+		_skinWeights[numInfluences] = _boneInfos[i]._weight;
+		_skinInfluenceStart[boneVert + 1]++;
+		numInfluences++;
+	}
 
-		Math::Vector3d normal = _normals[boneVert];
-		bindPose.inverseRotate(&normal);
-		jointMatrix.transform(&normal, false);
-		_drawNormals[boneVert] += normal * _boneInfos[i]._weight;
+	for (int i = 0; i < _numVertices; i++) {
+		_skinInfluenceStart[i + 1] += _skinInfluenceStart[i];
 	}
 
+	Math::AABB *jointBoxes = new Math::AABB[_skeleton->_numJoints];
 	for (int i = 0; i < _numVertices; i++) {
-		_drawNormals[i].normalize();
+		for (int j = _skinInfluenceStart[i]; j < _skinInfluenceStart[i + 1]; j++) {
+			jointBoxes[_skinJoints[j]].expand(_vertices[i]);
+		}
 	}
 
-	g_driver->updateEMIModel(this);
+	delete[] _boundJoints;
+	delete[] _boundJointBoxes;
+	_numBoundJoints = 0;
+	for (int i = 0; i < _skeleton->_numJoints; i++) {
+		if (jointBoxes[i].isValid())
+			_numBoundJoints++;
+	}
+	_boundJoints = new int[_numBoundJoints];
+	_boundJointBoxes = new Math::AABB[_numBoundJoints];
+	for (int i = 0, j = 0; i < _skeleton->_numJoints; i++) {
+		if (jointBoxes[i].isValid()) {
+			_boundJoints[j] = i;
+			_boundJointBoxes[j] = jointBoxes[i];
+			j++;
+		}
+	}
+	delete[] jointBoxes;
+}
+
+void EMIModel::skin() {
+	if (!_skeleton || !_skinInfluenceStart)
+		return;
+
+	// Nothing to do if the skeleton has not moved since the last call.
+	if (_hasSkinned && _skinnedVersion == _skeleton->_skinVersion)
+		return;
+
+	skinVertices(_numVertices, _skinInfluenceStart, _skinJoints, _skinWeights, _skeleton->_skinMatrices,
+	             _vertices, _normals, _drawVertices, _drawNormals);
+
+	_skinnedVersion = _skeleton->_skinVersion;
+	_hasSkinned = true;
+	_drawBuffersDirty = true;
+}
+
+void EMIModel::prepareForRender() {
+	skin();
+
+	if (_drawBuffersDirty) {
+		g_driver->updateEMIModel(this);
+		_drawBuffersDirty = false;
+	}
+}
+
+void EMIModel::skinVertices(int numVertices, const int *influenceStart, const int *joints, const float *weights,
+                            const Math::Matrix4 *skinMatrices, const Math::Vector3d *vertices, const Math::Vector3d *normals,
+                            Math::Vector3d *outVertices, Math::Vector3d *outNormals) {
+	for (int i = 0; i < numVertices; i++) {
+		const Math::Vector3d &vert = vertices[i];
+		const Math::Vector3d &normal = normals[i];
+		const int last = influenceStart[i + 1];
+
+#ifdef GRIM_SKINNING_SSE
+		const __m128 vx = _mm_set1_ps(vert.x());
+		const __m128 vy = _mm_set1_ps(vert.y());
+		const __m128 vz = _mm_set1_ps(vert.z());
+		const __m128 nx = _mm_set1_ps(normal.x());
+		const __m128 ny = _mm_set1_ps(normal.y());
+		const __m128 nz = _mm_set1_ps(normal.z());
+		__m128 accVert = _mm_setzero_ps();
+		__m128 accNormal = _mm_setzero_ps();
+
+		for (int j = influenceStart[i]; j < last; j++) {
+			const float *m = skinMatrices[joints[j]].getData();
+			const __m128 col0 = _mm_loadu_ps(m);
+			const __m128 col1 = _mm_loadu_ps(m + 4);
+			const __m128 col2 = _mm_loadu_ps(m + 8);
+			const __m128 col3 = _mm_loadu_ps(m + 12);
+			const __m128 weight = _mm_set1_ps(weights[j]);
+
+			__m128 rot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, vx), _mm_mul_ps(col1, vy)), _mm_mul_ps(col2, vz));
+			accVert = _mm_add_ps(accVert, _mm_mul_ps(_mm_add_ps(rot, col3), weight));
+
+			rot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col0, nx), _mm_mul_ps(col1, ny)), _mm_mul_ps(col2, nz));
+			accNormal = _mm_add_ps(accNormal, _mm_mul_ps(rot, weight));
+		}
+
+		float v[4], n[4];
+		_mm_storeu_ps(v, accVert);
+		_mm_storeu_ps(n, accNormal);
+#else
+		float v[3] = { 0.0f, 0.0f, 0.0f };
+		float n[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (int j = influenceStart[i]; j < last; j++) {
+			const float *m = skinMatrices[joints[j]].getData();
+			const float weight = weights[j];
+			for (int k = 0; k < 3; k++) {
+				const float rot = m[k] * vert.x() + m[k + 4] * vert.y() + m[k + 8] * vert.z();
+				v[k] += (rot + m[k + 12]) * weight;
+				n[k] += (m[k] * normal.x() + m[k + 4] * normal.y() + m[k + 8] * normal.z()) * weight;
+			}
+		}
+#endif
+
+		outVertices[i].set(v[0], v[1], v[2]);
+		outNormals[i].set(n[0], n[1], n[2]);
+		outNormals[i].normalize();
+	}
 }
 
 void EMIModel::prepareTextures() {
@@ -272,8 +377,6 @@ void EMIModel::prepareTextures() {
 }
 
 void EMIModel::draw() {
-	prepareForRender();
-
 	Actor *actor = _costume->getOwner();
 	Math::Matrix4 modelToWorld = actor->getFinalMatrix();
 
@@ -283,6 +386,8 @@ void EMIModel::draw() {
 			return;
 	}
 
+	prepareForRender();
+
 	if (!g_driver->supportsShaders()) {
 		// If shaders are not available, we calculate lighting in software.
 		Actor::LightMode lightMode = actor->getLightMode();
@@ -411,12 +516,43 @@ void EMIModel::getBoundingBox(int *x1, int *y1, int *x2, int *y2) const {
 	}
 }
 
-Math::AABB EMIModel::calculateWorldBounds(const Math::Matrix4 &matrix) const {
-	Math::AABB bounds;
-	for (int i = 0; i < _numVertices; i++) {
-		bounds.expand(_drawVertices[i]);
+const Math::AABB &EMIModel::getLocalBounds() {
+	if (!_skeleton || !_skinInfluenceStart) {
+		// Not animated, the draw vertices never change.
+		if (!_hasLocalBounds) {
+			_localBounds.reset();
+			for (int i = 0; i < _numVertices; i++) {
+				_localBounds.expand(_drawVertices[i]);
+			}
+			_hasLocalBounds = true;
+		}
+		return _localBounds;
+	}
+
+	if (_hasLocalBounds && _localBoundsVersion == _skeleton->_skinVersion)
+		return _localBounds;
+
+	// A skinned vertex is a weighted average of the vertex transformed by each of
+	// its joints, so it lies inside the union of the transformed joint boxes.
+	_localBounds.reset();
+	for (int i = 0; i < _numBoundJoints; i++) {
+		Math::Matrix4 skinMatrix = _skeleton->_skinMatrices[_boundJoints[i]];
+		skinMatrix.transpose();
+
+		Math::AABB box = _boundJointBoxes[i];
+		box.transform(skinMatrix);
+		_localBounds.expand(box.getMin());
+		_localBounds.expand(box.getMax());
 	}
-	bounds.transform(matrix);
+	_localBoundsVersion = _skeleton->_skinVersion;
+	_hasLocalBounds = true;
+	return _localBounds;
+}
+
+Math::AABB EMIModel::calculateWorldBounds(const Math::Matrix4 &matrix) {
+	Math::AABB bounds = getLocalBounds();
+	if (bounds.isValid())
+		bounds.transform(matrix);
 	return bounds;
 }
 
@@ -437,7 +573,17 @@ EMIModel::EMIModel(const Common::String &filename, Common::SeekableReadStream *d
 	_numBones = 0;
 	_boneInfos = nullptr;
 	_numBoneInfos = 0;
-	_vertexBoneInfo = nullptr;
+	_skinInfluenceStart = nullptr;
+	_skinJoints = nullptr;
+	_skinWeights = nullptr;
+	_skinnedVersion = 0;
+	_hasSkinned = false;
+	_drawBuffersDirty = false;
+	_numBoundJoints = 0;
+	_boundJoints = nullptr;
+	_boundJointBoxes = nullptr;
+	_localBoundsVersion = 0;
+	_hasLocalBounds = false;
 	_skeleton = nullptr;
 	_radius = 0;
 	_center = new Math::Vector3d();
@@ -455,6 +601,9 @@ EMIModel::EMIModel(const Common::String &filename, Common::SeekableReadStream *d
 }
 
 EMIModel::~EMIModel() {
+	g_driver->destroyEMIModel(this);
+	g_resourceloader->uncacheModelEMI(this);
+
 	delete[] _vertices;
 	delete[] _drawVertices;
 	delete[] _normals;
@@ -465,7 +614,11 @@ EMIModel::~EMIModel() {
 	delete[] _texNames;
 	delete[] _mats;
 	delete[] _boneInfos;
-	delete[] _vertexBoneInfo;
+	delete[] _skinInfluenceStart;
+	delete[] _skinJoints;
+	delete[] _skinWeights;
+	delete[] _boundJoints;
+	delete[] _boundJointBoxes;
 	delete[] _boneNames;
 	delete[] _lighting;
 	delete[] _texFlags;
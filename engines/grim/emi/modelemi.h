@@ -108,7 +108,25 @@ public:
 	int _numBoneInfos;
 	BoneInfo *_boneInfos;
 	Common::String *_boneNames;
-	int *_vertexBoneInfo;
+
+	// Skinning influences resolved against the current skeleton. The influences
+	// of vertex i are stored at [_skinInfluenceStart[i], _skinInfluenceStart[i + 1]).
+	int *_skinInfluenceStart;
+	int *_skinJoints;
+	float *_skinWeights;
+	// Skeleton::_skinVersion the draw buffers were last skinned with.
+	uint32 _skinnedVersion;
+	bool _hasSkinned;
+	bool _drawBuffersDirty;
+
+	// Bind pose bounds of the vertices influenced by each joint, used to bound
+	// the animated mesh without having to skin it.
+	int _numBoundJoints;
+	int *_boundJoints;
+	Math::AABB *_boundJointBoxes;
+	Math::AABB _localBounds;
+	uint32 _localBoundsVersion;
+	bool _hasLocalBounds;
 
 	// Stuff we dont know how to use:
 	float _radius;
@@ -130,12 +148,29 @@ public:
 	void setTex(uint32 index);
 	void setSkeleton(Skeleton *skel);
 	void loadMesh(Common::SeekableReadStream *data);
+	void skin();
 	void prepareForRender();
 	void prepareTextures();
 	void draw();
 	void updateLighting(const Math::Matrix4 &modelToWorld);
 	void getBoundingBox(int *x1, int *y1, int *x2, int *y2) const;
-	Math::AABB calculateWorldBounds(const Math::Matrix4 &matrix) const;
+	/**
+	 * Get a conservative bounding box of the animated mesh in model space.
+	 * This does not require the mesh to be skinned, and is only recalculated
+	 * when the skeleton moves.
+	 */
+	const Math::AABB &getLocalBounds();
+	Math::AABB calculateWorldBounds(const Math::Matrix4 &matrix);
+
+	/**
+	 * Linear blend skinning of a mesh.
+	 *
+	 * @param skinMatrices The transposed per-joint skinning matrices, see Skeleton::_skinMatrices.
+	 * The remaining parameters follow the layout of the _skin* members.
+	 */
+	static void skinVertices(int numVertices, const int *influenceStart, const int *joints, const float *weights,
+	                         const Math::Matrix4 *skinMatrices, const Math::Vector3d *vertices, const Math::Vector3d *normals,
+	                         Math::Vector3d *outVertices, Math::Vector3d *outNormals);
 };
 
 } // end of namespace Grim
@@ -34,7 +34,7 @@ namespace Grim {
 #define TRANSLATE_OP 3
 
 Skeleton::Skeleton(const Common::String &filename, Common::SeekableReadStream *data) :
-		_numJoints(0), _joints(nullptr), _animLayers(nullptr) {
+		_numJoints(0), _joints(nullptr), _skinMatrices(nullptr), _skinVersion(0), _animLayers(nullptr) {
 	loadSkeleton(data);
 }
 
@@ -43,6 +43,7 @@ Skeleton::~Skeleton() {
 		delete[] _animLayers[i]._jointAnims;
 	}
 	delete[] _animLayers;
+	delete[] _skinMatrices;
 	delete[] _joints;
 }
 
@@ -82,11 +83,19 @@ void Skeleton::initBone(int index) {
 		// Might be the other way around.
 		_joints[index]._absMatrix =  _joints[index]._absMatrix * _joints[index]._relMatrix;
 	}
+
+	_joints[index]._inverseBindMatrix = _joints[index]._absMatrix;
+	_joints[index]._inverseBindMatrix.invertAffineOrthonormal();
 }
 
 void Skeleton::initBones() {
+	_skinMatrices = new Math::Matrix4[_numJoints];
 	for (int i = 0; i < _numJoints; i++) {
 		initBone(i);
+
+		// The final matrix is identity until the skeleton is animated.
+		_skinMatrices[i] = _joints[i]._inverseBindMatrix;
+		_skinMatrices[i].transpose();
 	}
 
 	_animLayers = new AnimationLayer[MAX_ANIMATION_LAYERS];
@@ -180,7 +189,10 @@ void Skeleton::commitAnim() {
 			_joints[m]._finalMatrix = _joints[m]._animMatrix;
 			_joints[m]._finalQuat = _joints[m]._animQuat;
 		}
+		_skinMatrices[m] = _joints[m]._finalMatrix * _joints[m]._inverseBindMatrix;
+		_skinMatrices[m].transpose();
 	}
+	_skinVersion++;
 }
 
 int Skeleton::findJointIndex(const Common::String &name) const {
@@ -46,6 +46,7 @@ struct Joint {
 	Math::Quaternion _quat;
 	int _parentIndex;
 	Math::Matrix4 _absMatrix;
+	Math::Matrix4 _inverseBindMatrix;
 	Math::Matrix4 _relMatrix;
 	Math::Matrix4 _animMatrix;
 	Math::Quaternion _animQuat;
@@ -77,6 +78,12 @@ public:
 	int _numJoints;
 	Joint *_joints;
 
+	// Per-joint skinning matrices (final * inverse bind pose), updated by commitAnim().
+	// The matrices are stored transposed, so that each column is contiguous in memory.
+	Math::Matrix4 *_skinMatrices;
+	// Incremented whenever _skinMatrices change.
+	uint32 _skinVersion;
+
 	typedef Common::HashMap<Common::String, int, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> JointMap;
 	JointMap _jointsMap;
 
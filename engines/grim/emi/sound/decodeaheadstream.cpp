@@ -0,0 +1,212 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#include "common/util.h"
+#include "engines/grim/atomic.h"
+#include "engines/grim/emi/sound/decodeaheadstream.h"
+
+namespace Grim {
+
+struct DecodeAheadStream::Ring {
+	Ring(Audio::AudioStream *s, Audio::RewindableAudioStream *r) :
+			source(s), rewindable(r), buffer(nullptr), size(0), readPos(0), writePos(0),
+			sourceDone(false), looping(false), channels(1), users(0), retired(false) {}
+	~Ring() {
+		delete[] buffer;
+		delete source;
+	}
+
+	Audio::AudioStream *source;
+	Audio::RewindableAudioStream *rewindable;
+	Common::Mutex fillMutex;
+	int16 *buffer;
+	uint32 size;
+	volatile uint32 readPos;
+	volatile uint32 writePos;
+	volatile bool sourceDone;
+	volatile bool looping;
+	int channels;
+
+	// Guarded by _ringsMutex. A ring whose stream was deleted while the timer
+	// was filling it is retired, and freed by the timer once it is done.
+	int users;
+	bool retired;
+};
+
+Common::List<DecodeAheadStream::Ring *> *DecodeAheadStream::_rings = nullptr;
+Common::Array<DecodeAheadStream::Ring *> *DecodeAheadStream::_filling = nullptr;
+Common::Mutex *DecodeAheadStream::_ringsMutex = nullptr;
+
+DecodeAheadStream::DecodeAheadStream(Audio::AudioStream *source, Audio::RewindableAudioStream *rewindable) {
+	_rate = source->getRate();
+	_stereo = source->isStereo();
+	_ring = new Ring(source, rewindable);
+	_ring->channels = _stereo ? 2 : 1;
+
+	// Positions are free running and masked on access, so the size must be a power of two
+	uint32 samples = _rate * _ring->channels * kBufferMillis / 1000;
+	_ring->size = 4;
+	while (_ring->size < samples)
+		_ring->size <<= 1;
+	_ring->buffer = new int16[_ring->size];
+
+	if (_ringsMutex) {
+		Common::StackLock lock(*_ringsMutex);
+		_rings->push_back(_ring);
+	}
+}
+
+DecodeAheadStream::~DecodeAheadStream() {
+	if (_ringsMutex) {
+		Common::StackLock lock(*_ringsMutex);
+		_rings->remove(_ring);
+		if (_ring->users > 0) {
+			_ring->retired = true;
+			return;
+		}
+	}
+	delete _ring;
+}
+
+void DecodeAheadStream::startDecodeAhead() {
+	if (_ringsMutex)
+		return;
+	_ringsMutex = new Common::Mutex();
+	_rings = new Common::List<Ring *>();
+	_filling = new Common::Array<Ring *>();
+}
+
+void DecodeAheadStream::stopDecodeAhead() {
+	delete _rings;
+	_rings = nullptr;
+	delete _filling;
+	_filling = nullptr;
+	delete _ringsMutex;
+	_ringsMutex = nullptr;
+}
+
+void DecodeAheadStream::decodeAhead() {
+	if (!_ringsMutex)
+		return;
+
+	// Only hold the registry lock to take and drop references, so a stream
+	// being created or deleted never waits for the decoding.
+	{
+		Common::StackLock lock(*_ringsMutex);
+		for (Common::List<Ring *>::iterator i = _rings->begin(); i != _rings->end(); ++i) {
+			(*i)->users++;
+			_filling->push_back(*i);
+		}
+	}
+
+	for (uint i = 0; i < _filling->size(); i++) {
+		fill((*_filling)[i]);
+	}
+
+	Common::StackLock lock(*_ringsMutex);
+	for (uint i = 0; i < _filling->size(); i++) {
+		Ring *ring = (*_filling)[i];
+		if (--ring->users == 0 && ring->retired)
+			delete ring;
+	}
+	_filling->clear();
+}
+
+int DecodeAheadStream::readBuffer(int16 *buffer, const int numSamples) {
+	Ring *ring = _ring;
+	uint32 readPos = ring->readPos;
+	uint32 available = atomicLoad(ring->writePos) - readPos;
+	int samples = MIN<uint32>(numSamples, available);
+
+	int done = 0;
+	while (done < samples) {
+		uint32 offset = readPos & (ring->size - 1);
+		int count = MIN<uint32>(samples - done, ring->size - offset);
+		memcpy(buffer + done, ring->buffer + offset, count * sizeof(int16));
+		done += count;
+		readPos += count;
+	}
+
+	atomicStore(ring->readPos, readPos);
+	return samples;
+}
+
+bool DecodeAheadStream::endOfData() const {
+	return atomicLoad(_ring->sourceDone) && atomicLoad(_ring->writePos) == atomicLoad(_ring->readPos);
+}
+
+void DecodeAheadStream::fill() {
+	fill(_ring);
+}
+
+void DecodeAheadStream::fill(Ring *ring) {
+	Common::StackLock lock(ring->fillMutex);
+	bool decoded = true;
+
+	while (!ring->sourceDone) {
+		uint32 writePos = ring->writePos;
+		uint32 offset = writePos & (ring->size - 1);
+		uint32 space = ring->size - (writePos - atomicLoad(ring->readPos));
+		int count = MIN(space, ring->size - offset);
+		count -= count % ring->channels;
+		if (count == 0)
+			break;
+
+		int samples = ring->source->readBuffer(ring->buffer + offset, count);
+		if (samples > 0) {
+			atomicStore(ring->writePos, writePos + samples);
+			decoded = true;
+		}
+		if (samples < count) {
+			if (!ring->source->endOfData())
+				break;
+			// Only loop around if the last pass produced anything, a source that
+			// is empty right after a rewind would otherwise spin here forever.
+			if (atomicLoad(ring->looping) && ring->rewindable && decoded && ring->rewindable->rewind()) {
+				decoded = false;
+				continue;
+			}
+			atomicStore(ring->sourceDone, true);
+		}
+	}
+}
+
+bool DecodeAheadStream::rewind() {
+	Common::StackLock lock(_ring->fillMutex);
+	if (!_ring->rewindable || !_ring->rewindable->rewind())
+		return false;
+	atomicStore(_ring->readPos, (uint32)0);
+	atomicStore(_ring->writePos, (uint32)0);
+	atomicStore(_ring->sourceDone, false);
+	return true;
+}
+
+void DecodeAheadStream::setLooping(bool looping) {
+	atomicStore(_ring->looping, looping);
+}
+
+uint32 DecodeAheadStream::getFramesRead() const {
+	return atomicLoad(_ring->readPos) / _ring->channels;
+}
+
+} // end of namespace Grim
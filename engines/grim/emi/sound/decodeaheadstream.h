@@ -0,0 +1,102 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#ifndef GRIM_DECODEAHEADSTREAM_H
+#define GRIM_DECODEAHEADSTREAM_H
+
+#include "common/array.h"
+#include "common/list.h"
+#include "common/mutex.h"
+#include "audio/audiostream.h"
+
+namespace Grim {
+
+/**
+ * Wraps the stream of an EMI sound track and decodes it ahead of the mixer
+ * into a ring of samples. The EMISound timer fills every such stream through
+ * decodeAhead(), so the mixer only copies samples and no decompression runs
+ * while the mixer or EMISound holds a lock. The timer is the only producer and
+ * the mixer the only consumer, and the ring positions are published through
+ * the iMuse atomics.
+ *
+ * The ring and the source live in a separate Ring that the timer holds a
+ * reference to while it decodes, so the mixer can delete the stream at any
+ * time without waiting for the decoder.
+ */
+class DecodeAheadStream : public Audio::AudioStream {
+public:
+	/**
+	 * @param source      the decoder to read ahead from, owned by this stream
+	 * @param rewindable  source again if it can be rewound, otherwise nullptr
+	 */
+	DecodeAheadStream(Audio::AudioStream *source, Audio::RewindableAudioStream *rewindable);
+	~DecodeAheadStream();
+
+	int readBuffer(int16 *buffer, const int numSamples) override;
+	bool isStereo() const override { return _stereo; }
+	int getRate() const override { return _rate; }
+	bool endOfData() const override;
+
+	/** Decodes until the ring is full or the source has ended. */
+	void fill();
+
+	/**
+	 * Restarts the source from the beginning and drops the decoded samples.
+	 * Only valid while the mixer is not playing this stream.
+	 */
+	bool rewind();
+
+	/** Rewinds the source whenever it ends, if it can be rewound. */
+	void setLooping(bool looping);
+
+	/** Frames handed to the mixer since the stream was created or rewound. */
+	uint32 getFramesRead() const;
+
+	static void startDecodeAhead();
+	static void stopDecodeAhead();
+
+	/** Fills every stream, called from the EMISound timer. */
+	static void decodeAhead();
+
+private:
+	enum {
+		kBufferMillis = 500
+	};
+
+	struct Ring;
+
+	static void fill(Ring *ring);
+
+	Ring *_ring;
+	int _rate;
+	bool _stereo;
+
+	// The rings of the live streams, and the ones decodeAhead() is filling.
+	static Common::List<Ring *> *_rings;
+	static Common::Array<Ring *> *_filling;
+	static Common::Mutex *_ringsMutex;
+};
+
+} // end of namespace Grim
+
+#endif
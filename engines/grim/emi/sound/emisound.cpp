@@ -40,6 +40,9 @@
 #include "engines/grim/emi/sound/mp3track.h"
 #include "engines/grim/emi/sound/scxtrack.h"
 #include "engines/grim/emi/sound/vimatrack.h"
+#include "engines/grim/emi/sound/decodeaheadstream.h"
+#include "engines/grim/atomic.h"
+#include "engines/grim/imuse/imuse_mcmp_mgr.h"
 #include "engines/grim/movie/codecs/vima.h"
 
 namespace Grim {
@@ -188,7 +191,11 @@ EMISound::EMISound(int fps) {
 	_musicTrack = nullptr;
 	_curTrackId = 0;
 	_callbackFps = fps;
+	_mixerQueueHead = 0;
+	_mixerQueueTail = 0;
 	vimaInit(imuseDestTable);
+	McmpMgr::startReadAhead();
+	DecodeAheadStream::startDecodeAhead();
 	initMusicTable();
 	g_system->getTimerManager()->installTimerProc(timerHandler, 1000000 / _callbackFps, this, "emiSoundCallback");
 }
@@ -201,6 +208,8 @@ EMISound::~EMISound() {
 	if (g_grim->getGamePlatform() != Common::kPlatformPS2) {
 		delete[] _musicTable;
 	}
+	DecodeAheadStream::stopDecodeAhead();
+	McmpMgr::stopReadAhead();
 }
 
 EMISound::TrackList::iterator EMISound::getPlayingTrackByName(const Common::String &name) {
@@ -239,12 +248,14 @@ bool EMISound::startSfxFrom(const Common::String &soundName, const Math::Vector3
 }
 
 bool EMISound::startSound(const Common::String &soundName, Audio::Mixer::SoundType soundType, int volume, int pan) {
-	Common::StackLock lock(_mutex);
+	// The track isn't visible to the timer until it is in the list, so it can be
+	// opened and started without the lock.
 	SoundTrack *track = initTrack(soundName, soundType);
 	if (track) {
 		track->setBalance(pan * 2 - 127);
 		track->setVolume(volume);
 		track->play();
+		Common::StackLock lock(_mutex);
 		_playingTracks.push_back(track);
 		return true;
 	}
@@ -252,12 +263,12 @@ bool EMISound::startSound(const Common::String &soundName, Audio::Mixer::SoundTy
 }
 
 bool EMISound::startSoundFrom(const Common::String &soundName, Audio::Mixer::SoundType soundType, const Math::Vector3d &pos, int volume) {
-	Common::StackLock lock(_mutex);
 	SoundTrack *track = initTrack(soundName, soundType);
 	if (track) {
 		track->setVolume(volume);
 		track->setPosition(true, pos);
 		track->play();
+		Common::StackLock lock(_mutex);
 		_playingTracks.push_back(track);
 		return true;
 	}
@@ -270,17 +281,21 @@ bool EMISound::getSoundStatus(const Common::String &soundName) {
 	if (it == _playingTracks.end())  // We have no such sound.
 		return false;
 
-	return (*it)->isPlaying();
+	return (*it)->getPlayingStatus();
 }
 
 void EMISound::stopSound(const Common::String &soundName) {
-	Common::StackLock lock(_mutex);
 	TrackList::iterator it = getPlayingTrackByName(soundName);
 	if (it == _playingTracks.end()) {
 		warning("Sound track '%s' could not be found to stop", soundName.c_str());
 	} else {
-		delete (*it);
-		_playingTracks.erase(it);
+		SoundTrack *track = *it;
+		{
+			Common::StackLock lock(_mutex);
+			processMixerQueue();
+			_playingTracks.erase(it);
+		}
+		delete track;
 	}
 }
 
@@ -295,29 +310,29 @@ int32 EMISound::getPosIn16msTicks(const Common::String &soundName) {
 }
 
 void EMISound::setVolume(const Common::String &soundName, int volume) {
-	Common::StackLock lock(_mutex);
 	TrackList::iterator it = getPlayingTrackByName(soundName);
 	if (it == _playingTracks.end()) {
 		warning("Sound track '%s' could not be found to set volume", soundName.c_str());
 	} else {
-		(*it)->setVolume(volume);
+		(*it)->storeVolume(volume);
+		queueMixerUpdate(*it);
 	}
 }
 
 void EMISound::setPan(const Common::String &soundName, int pan) {
-	Common::StackLock lock(_mutex);
 	TrackList::iterator it = getPlayingTrackByName(soundName);
 	if (it == _playingTracks.end()) {
 		warning("Sound track '%s' could not be found to set pan", soundName.c_str());
 	} else {
-		(*it)->setBalance(pan * 2 - 127);
+		(*it)->storeBalance(pan * 2 - 127);
+		queueMixerUpdate(*it);
 	}
 }
 
 bool EMISound::loadSfx(const Common::String &soundName, int &id) {
-	Common::StackLock lock(_mutex);
 	SoundTrack *track = initTrack(soundName, Audio::Mixer::kSFXSoundType);
 	if (track) {
+		Common::StackLock lock(_mutex);
 		id = _curTrackId++;
 		_preloadedTrackMap[id] = track;
 		return true;
@@ -327,7 +342,6 @@ bool EMISound::loadSfx(const Common::String &soundName, int &id) {
 }
 
 void EMISound::playLoadedSound(int id, bool looping) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
 		it->_value->setLooping(looping);
@@ -339,7 +353,6 @@ void EMISound::playLoadedSound(int id, bool looping) {
 }
 
 void EMISound::playLoadedSoundFrom(int id, const Math::Vector3d &pos, bool looping) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
 		it->_value->setLooping(looping);
@@ -352,7 +365,6 @@ void EMISound::playLoadedSoundFrom(int id, const Math::Vector3d &pos, bool loopi
 }
 
 void EMISound::setLoadedSoundLooping(int id, bool looping) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
 		it->_value->setLooping(looping);
@@ -362,7 +374,6 @@ void EMISound::setLoadedSoundLooping(int id, bool looping) {
 }
 
 void EMISound::stopLoadedSound(int id) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
 		it->_value->stop();
@@ -372,58 +383,60 @@ void EMISound::stopLoadedSound(int id) {
 }
 
 void EMISound::freeLoadedSound(int id) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
-		delete it->_value;
-		_preloadedTrackMap.erase(it);
+		SoundTrack *track = it->_value;
+		{
+			Common::StackLock lock(_mutex);
+			processMixerQueue();
+			_preloadedTrackMap.erase(it);
+		}
+		delete track;
 	} else {
 		warning("EMISound::freeLoadedSound called with invalid sound id");
 	}
 }
 
 void EMISound::setLoadedSoundVolume(int id, int volume) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
-		it->_value->setVolume(volume);
+		it->_value->storeVolume(volume);
+		queueMixerUpdate(it->_value);
 	} else {
 		warning("EMISound::setLoadedSoundVolume called with invalid sound id");
 	}
 }
 
 void EMISound::setLoadedSoundPan(int id, int pan) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
-		it->_value->setBalance(pan * 2 - 127);
+		it->_value->storeBalance(pan * 2 - 127);
+		queueMixerUpdate(it->_value);
 	} else {
 		warning("EMISound::setLoadedSoundPan called with invalid sound id");
 	}
 }
 
 void EMISound::setLoadedSoundPosition(int id, const Math::Vector3d &pos) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
-		it->_value->setPosition(true, pos);
+		it->_value->storePosition(true, pos);
+		queueMixerUpdate(it->_value);
 	} else {
 		warning("EMISound::setLoadedSoundPosition called with invalid sound id");
 	}
 }
 
 bool EMISound::getLoadedSoundStatus(int id) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
-		return it->_value->isPlaying();
+		return it->_value->getPlayingStatus();
 	}
 	warning("EMISound::getLoadedSoundStatus called with invalid sound id");
 	return false;
 }
 
 int EMISound::getLoadedSoundVolume(int id) {
-	Common::StackLock lock(_mutex);
 	TrackMap::iterator it = _preloadedTrackMap.find(id);
 	if (it != _preloadedTrackMap.end()) {
 		return it->_value->getVolume();
@@ -480,7 +493,6 @@ bool EMISound::stateHasEnded(int stateId) {
 }
 
 void EMISound::setMusicState(int stateId) {
-	Common::StackLock lock(_mutex);
 	// The demo calls ImSetState with state id 1000, which exceeds the number of states in the
 	// music table.
 	if (stateId >= _numMusicStates)
@@ -504,6 +516,7 @@ void EMISound::setMusicState(int stateId) {
 				_curMusicState = stateId;
 				return;
 			}
+			Common::StackLock lock(_mutex);
 			_musicTrack->fadeOut();
 			_playingTracks.push_back(_musicTrack);
 			_musicTrack = nullptr;
@@ -553,6 +566,7 @@ void EMISound::setMusicState(int stateId) {
 			music->setFade(0.0f);
 			music->fadeIn();
 		}
+		Common::StackLock lock(_mutex);
 		_musicTrack = music;
 	}
 }
@@ -708,17 +722,27 @@ void EMISound::selectMusicSet(int setId) {
 	}
 
 	// Immediately switch all currently active music tracks to the new quality.
+	// The new tracks are opened before taking the lock, and the old ones deleted after.
 	for (TrackList::iterator it = _playingTracks.begin(); it != _playingTracks.end(); ++it) {
 		SoundTrack *track = (*it);
 		if (track && track->getSoundType() == Audio::Mixer::kMusicSoundType) {
-			(*it) = restartTrack(track);
+			SoundTrack *newTrack = restartTrack(track);
+			{
+				Common::StackLock lock(_mutex);
+				processMixerQueue();
+				(*it) = newTrack;
+			}
 			delete track;
 		}
 	}
 	for (uint32 i = 0; i < _stateStack.size(); ++i) {
 		SoundTrack *track = _stateStack[i]._track;
 		if (track) {
-			_stateStack[i]._track = restartTrack(track);
+			SoundTrack *newTrack = restartTrack(track);
+			{
+				Common::StackLock lock(_mutex);
+				_stateStack[i]._track = newTrack;
+			}
 			delete track;
 		}
 	}
@@ -810,9 +834,39 @@ void EMISound::pause(bool paused) {
 	}
 }
 
+void EMISound::queueMixerUpdate(SoundTrack *track) {
+	uint32 head = _mixerQueueHead;
+	if (head - atomicLoad(_mixerQueueTail) == kMixerQueueSize) {
+		// The timer has fallen behind, catch up here.
+		Common::StackLock lock(_mutex);
+		processMixerQueue();
+	}
+	_mixerQueue[head & (kMixerQueueSize - 1)] = track;
+	atomicStore(_mixerQueueHead, head + 1);
+}
+
+void EMISound::processMixerQueue() {
+	// Called with _mutex held, so none of the queued tracks can be deleted meanwhile.
+	uint32 tail = _mixerQueueTail;
+	uint32 head = atomicLoad(_mixerQueueHead);
+	for (; tail != head; ++tail) {
+		_mixerQueue[tail & (kMixerQueueSize - 1)]->applyMixerSettings();
+	}
+	atomicStore(_mixerQueueTail, tail);
+}
+
 void EMISound::callback() {
-	Common::StackLock lock(_mutex);
+	{
+		Common::StackLock lock(_mutex);
+		processMixerQueue();
+		updateTracks();
+	}
 
+	// Decompression for the tracks happens here, after the lock has been let go.
+	DecodeAheadStream::decodeAhead();
+}
+
+void EMISound::updateTracks() {
 	if (_musicTrack) {
 		updateTrack(_musicTrack);
 	}
@@ -830,7 +884,8 @@ void EMISound::callback() {
 
 	for (TrackList::iterator it = _playingTracks.begin(); it != _playingTracks.end(); ++it) {
 		SoundTrack *track = (*it);
-		if (track->isPaused() || !track->isPlaying())
+		track->publishPlayingStatus();
+		if (track->isPaused() || !track->getPlayingStatus())
 			continue;
 
 		updateTrack(track);
@@ -838,6 +893,10 @@ void EMISound::callback() {
 			track->stop();
 		}
 	}
+
+	for (TrackMap::iterator it = _preloadedTrackMap.begin(); it != _preloadedTrackMap.end(); ++it) {
+		it->_value->publishPlayingStatus();
+	}
 }
 
 void EMISound::updateTrack(SoundTrack *track) {
@@ -860,25 +919,38 @@ void EMISound::updateTrack(SoundTrack *track) {
 }
 
 void EMISound::flushTracks() {
-	Common::StackLock lock(_mutex);
-	for (TrackList::iterator it = _playingTracks.begin(); it != _playingTracks.end(); ++it) {
-		SoundTrack *track = (*it);
-		if (!track->isPlaying()) {
-			delete track;
-			it = _playingTracks.erase(it);
+	TrackList finished;
+	{
+		Common::StackLock lock(_mutex);
+		processMixerQueue();
+		TrackList::iterator it = _playingTracks.begin();
+		while (it != _playingTracks.end()) {
+			if (!(*it)->isPlaying()) {
+				finished.push_back(*it);
+				it = _playingTracks.erase(it);
+			} else {
+				++it;
+			}
 		}
 	}
+	for (TrackList::iterator it = finished.begin(); it != finished.end(); ++it) {
+		delete (*it);
+	}
 }
 
 void EMISound::restoreState(SaveGame *savedState) {
-	Common::StackLock lock(_mutex);
 	// Clear any current music
 	flushStack();
 	setMusicState(0);
-	freePlayingSounds();
-	freeLoadedSounds();
-	delete _musicTrack;
-	_musicTrack = nullptr;
+	{
+		Common::StackLock lock(_mutex);
+		processMixerQueue();
+		freePlayingSounds();
+		freeLoadedSounds();
+		delete _musicTrack;
+		_musicTrack = nullptr;
+	}
+	// The tracks are reopened without the lock and only added under it.
 	// Actually load:
 	savedState->beginSection('SOUN');
 	_musicPrefix = savedState->readString();
@@ -906,6 +978,7 @@ void EMISound::restoreState(SaveGame *savedState) {
 			}
 		}
 		StackEntry entry = { state, track };
+		Common::StackLock lock(_mutex);
 		_stateStack.push(entry);
 	}
 
@@ -914,17 +987,21 @@ void EMISound::restoreState(SaveGame *savedState) {
 		uint32 hasActiveTrack = savedState->readLEUint32();
 		if (hasActiveTrack) {
 			Common::String soundName = savedState->readString();
-			_musicTrack = initTrack(soundName, Audio::Mixer::kMusicSoundType);
-			if (_musicTrack) {
-				_musicTrack->play();
+			SoundTrack *music = initTrack(soundName, Audio::Mixer::kMusicSoundType);
+			if (music) {
+				music->play();
 			} else {
 				error("Couldn't reopen %s", soundName.c_str());
 			}
+			Common::StackLock lock(_mutex);
+			_musicTrack = music;
 		}
 	} else if (savedState->saveMinorVersion() >= 21) {
 		bool musicActive = savedState->readBool();
 		if (musicActive) {
-			_musicTrack = restoreTrack(savedState);
+			SoundTrack *music = restoreTrack(savedState);
+			Common::StackLock lock(_mutex);
+			_musicTrack = music;
 		}
 	}
 
@@ -937,6 +1014,7 @@ void EMISound::restoreState(SaveGame *savedState) {
 		}
 		if (channelIsActive) {
 			SoundTrack *track = restoreTrack(savedState);
+			Common::StackLock lock(_mutex);
 			_playingTracks.push_back(track);
 		}
 	}
@@ -947,7 +1025,9 @@ void EMISound::restoreState(SaveGame *savedState) {
 		uint32 numLoaded = savedState->readLEUint32();
 		for (uint32 i = 0; i < numLoaded; ++i) {
 			int id = savedState->readLESint32();
-			_preloadedTrackMap[id] = restoreTrack(savedState);
+			SoundTrack *track = restoreTrack(savedState);
+			Common::StackLock lock(_mutex);
+			_preloadedTrackMap[id] = track;
 		}
 	}
 
@@ -1054,16 +1134,20 @@ SoundTrack *EMISound::restoreTrack(SaveGame *savedState) {
 }
 
 void EMISound::updateSoundPositions() {
-	Common::StackLock lock(_mutex);
-
 	for (TrackList::iterator it = _playingTracks.begin(); it != _playingTracks.end(); ++it) {
 		SoundTrack *track = (*it);
-		track->updatePosition();
+		if (track->isPositioned()) {
+			track->storePosition(true, track->getWorldPos());
+			queueMixerUpdate(track);
+		}
 	}
 
 	for (TrackMap::iterator it = _preloadedTrackMap.begin(); it != _preloadedTrackMap.end(); ++it) {
 		SoundTrack *track = (*it)._value;
-		track->updatePosition();
+		if (track->isPositioned()) {
+			track->storePosition(true, track->getWorldPos());
+			queueMixerUpdate(track);
+		}
 	}
 }
 
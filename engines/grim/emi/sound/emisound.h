@@ -107,9 +107,21 @@ private:
 	Common::String _musicPrefix;
 	Common::Stack<StackEntry> _stateStack;
 	// A mutex to avoid concurrent modification of the sound channels by the engine thread
-	// and the timer callback, which may run in a different thread.
+	// and the timer callback, which may run in a different thread. Only the engine thread
+	// changes the track lists, so it reads them without locking and takes the mutex just
+	// around the changes. Files are opened and decoded outside of it.
 	Common::Mutex _mutex;
 
+	// Tracks whose volume, balance or position the engine thread has changed. The engine
+	// thread is the only producer; the timer applies them to the mixer under _mutex,
+	// which also keeps the queued tracks alive.
+	enum {
+		kMixerQueueSize = 256
+	};
+	SoundTrack *_mixerQueue[kMixerQueueSize];
+	volatile uint32 _mixerQueueHead;
+	volatile uint32 _mixerQueueTail;
+
 	typedef Common::HashMap<int, SoundTrack *> TrackMap;
 	TrackMap _preloadedTrackMap;
 
@@ -125,6 +137,9 @@ private:
 	void initMusicTable();
 
 	void callback();
+	void updateTracks();
+	void queueMixerUpdate(SoundTrack *track);
+	void processMixerQueue();
 	void updateTrack(SoundTrack *track);
 	void freePlayingSounds();
 	void freeLoadedSounds();
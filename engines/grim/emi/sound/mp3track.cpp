@@ -28,6 +28,7 @@
 #include "engines/grim/resource.h"
 #include "engines/grim/textsplit.h"
 #include "engines/grim/emi/sound/mp3track.h"
+#include "engines/grim/emi/sound/decodeaheadstream.h"
 
 namespace Grim {
 
@@ -141,6 +142,8 @@ MP3Track::JMMCuePoints MP3Track::parseJMMFile(const Common::String &filename) {
 
 MP3Track::MP3Track(Audio::Mixer::SoundType soundType) {
 	_soundType = soundType;
+	// getPos() and hasLooped() keep reading the stream after the mixer is done with it.
+	_disposeAfterPlaying = DisposeAfterUse::NO;
 	_headerSize = 0;
 	_regionLength = 0;
 	_freq = 0;
@@ -182,23 +185,34 @@ bool MP3Track::openSound(const Common::String &filename, const Common::String &s
 	Audio::SeekableAudioStream *mp3Stream = Audio::makeMP3Stream(file, DisposeAfterUse::YES);
 
 	if (cuePoints._loopEnd <= cuePoints._loopStart) {
-		_stream = mp3Stream;
 		mp3Stream->seek(cuePoints._start);
+		_aheadStream = new DecodeAheadStream(mp3Stream, mp3Stream);
 		_looping = false;
 	} else {
-		_stream = new EMISubLoopingAudioStream(mp3Stream, 0, cuePoints._start, cuePoints._loopStart, cuePoints._loopEnd);
+		_aheadStream = new DecodeAheadStream(new EMISubLoopingAudioStream(mp3Stream, 0, cuePoints._start, cuePoints._loopStart, cuePoints._loopEnd), nullptr);
 		_looping = true;
 	}
+	_cuePoints = cuePoints;
+	_stream = _aheadStream;
 	_handle = new Audio::SoundHandle();
 	return true;
 #endif
 }
 
+int32 MP3Track::getPlayedFrame(int32 &loopStart, int32 &loopEnd) {
+	int rate = _stream->getRate();
+	loopStart = _cuePoints._loopStart.convertToFramerate(rate).totalNumberOfFrames();
+	loopEnd = _cuePoints._loopEnd.convertToFramerate(rate).totalNumberOfFrames();
+	return _cuePoints._start.convertToFramerate(rate).totalNumberOfFrames() + _aheadStream->getFramesRead();
+}
+
 bool MP3Track::hasLooped() {
 	if (!_stream || !_looping)
 		return false;
-	EMISubLoopingAudioStream *las = static_cast<EMISubLoopingAudioStream*>(_stream);
-	return las->hasLooped();
+	// The looping stream is decoded ahead, so work out from the frames played
+	// whether the mixer has actually passed the loop end yet.
+	int32 loopStart, loopEnd;
+	return getPlayedFrame(loopStart, loopEnd) >= loopEnd;
 }
 
 bool MP3Track::isPlaying() {
@@ -212,8 +226,11 @@ Audio::Timestamp MP3Track::getPos() {
 	if (!_stream)
 		return Audio::Timestamp(0);
 	if (_looping) {
-		EMISubLoopingAudioStream *slas = static_cast<EMISubLoopingAudioStream*>(_stream);
-		return slas->getPos();
+		int32 loopStart, loopEnd;
+		int32 pos = getPlayedFrame(loopStart, loopEnd);
+		if (pos >= loopEnd)
+			pos = loopStart + (pos - loopStart) % (loopEnd - loopStart);
+		return Audio::Timestamp(0, pos, _stream->getRate());
 	} else {
 		return g_system->getMixer()->getSoundElapsedTime(*_handle);
 	}
@@ -48,8 +48,10 @@ class MP3Track : public SoundTrack {
 	char _channels;
 	bool _endFlag;
 	bool _looping;
+	JMMCuePoints _cuePoints;
 	void parseRIFFHeader(Common::SeekableReadStream *data);
 	JMMCuePoints parseJMMFile(const Common::String &filename);
+	int32 getPlayedFrame(int32 &loopStart, int32 &loopEnd);
 public:
 	MP3Track(Audio::Mixer::SoundType soundType);
 	~MP3Track();
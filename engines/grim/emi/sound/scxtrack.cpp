@@ -28,6 +28,7 @@
 #include "engines/grim/resource.h"
 #include "engines/grim/emi/sound/codecs/scx.h"
 #include "engines/grim/emi/sound/scxtrack.h"
+#include "engines/grim/emi/sound/decodeaheadstream.h"
 
 namespace Grim {
 
@@ -52,8 +53,12 @@ bool SCXTrack::openSound(const Common::String &filename, const Common::String &s
 		return false;
 	}
 	_soundName = soundName;
-	Audio::RewindableAudioStream *scxStream = makeSCXStream(file, start, DisposeAfterUse::YES);
-	_stream = scxStream;
+	SCXStream *scxStream = makeSCXStream(file, start, DisposeAfterUse::YES);
+	if (scxStream) {
+		_startPos = scxStream->getPos();
+		_aheadStream = new DecodeAheadStream(scxStream, scxStream);
+		_stream = _aheadStream;
+	}
 	_handle = new Audio::SoundHandle();
 	return true;
 }
@@ -68,14 +73,18 @@ bool SCXTrack::isPlaying() {
 Audio::Timestamp SCXTrack::getPos() {
 	if (!_stream || _looping)
 		return Audio::Timestamp(0);
-	return static_cast<SCXStream*>(_stream)->getPos();
+	// The decoder runs ahead of the mixer, so count what has been played instead.
+	return _startPos.convertToFramerate(_stream->getRate()).addFrames(_aheadStream->getFramesRead());
 }
 
 bool SCXTrack::play() {
 	if (_stream) {
-		Audio::RewindableAudioStream *stream = static_cast<Audio::RewindableAudioStream *>(_stream);
 		if (!_looping) {
-			stream->rewind();
+			// The decode-ahead buffer can only be rewound while it isn't being mixed.
+			if (isPlaying())
+				stop();
+			_aheadStream->rewind();
+			_startPos = Audio::Timestamp(0);
 		}
 		return SoundTrack::play();
 	}
@@ -86,8 +95,8 @@ void SCXTrack::setLooping(bool looping) {
 	if (_looping == looping)
 		return;
 	_looping = looping;
-	if (looping && _stream) {
-		_stream = Audio::makeLoopingAudioStream(static_cast<Audio::RewindableAudioStream *>(_stream), 0);
+	if (_aheadStream) {
+		_aheadStream->setLooping(looping);
 	}
 }
 
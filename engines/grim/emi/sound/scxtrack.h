@@ -25,6 +25,7 @@
 
 #include "common/str.h"
 #include "common/stream.h"
+#include "audio/timestamp.h"
 #include "engines/grim/emi/sound/track.h"
 
 namespace Audio {
@@ -46,6 +47,7 @@ public:
 
 private:
 	bool _looping;
+	Audio::Timestamp _startPos;
 };
 
 }
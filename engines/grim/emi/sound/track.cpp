@@ -27,6 +27,8 @@
 #include "audio/audiostream.h"
 #include "engines/grim/savegame.h"
 #include "engines/grim/emi/sound/track.h"
+#include "engines/grim/emi/sound/decodeaheadstream.h"
+#include "engines/grim/atomic.h"
 #include "common/textconsole.h"
 #include "engines/grim/grim.h"
 #include "engines/grim/set.h"
@@ -35,16 +37,19 @@ namespace Grim {
 
 SoundTrack::SoundTrack() {
 	_stream = nullptr;
+	_aheadStream = nullptr;
 	_handle = nullptr;
 	_paused = false;
 	_positioned = false;
 	_balance = 0;
 	_volume = 100;
+	_playingStatus = 0;
 	_disposeAfterPlaying = DisposeAfterUse::YES;
 	_sync = 0;
 	_fadeMode = FadeNone;
 	_fade = 1.0f;
 	_attenuation = 1.0f;
+	_positionSeq = 0;
 
 	// Initialize to a plain sound for now
 	_soundType = Audio::Mixer::kPlainSoundType;
@@ -64,66 +69,138 @@ void SoundTrack::setSoundName(const Common::String &name) {
 }
 
 void SoundTrack::setVolume(int volume) {
-	if (volume > 100) {
-		volume = 100;
-	}
-	_volume = volume;
+	storeVolume(volume);
 	if (_handle) {
 		g_system->getMixer()->setChannelVolume(*_handle, (byte)getEffectiveVolume());
 	}
 }
 
+void SoundTrack::storeVolume(int volume) {
+	if (volume > 100) {
+		volume = 100;
+	}
+	atomicStore(_volume, volume);
+}
+
+int SoundTrack::getVolume() const {
+	return atomicLoad(_volume);
+}
+
 void SoundTrack::setPosition(bool positioned, const Math::Vector3d &pos) {
-	_positioned = positioned;
-	_pos = pos;
-	updatePosition();
+	storePosition(positioned, pos);
+	if (positioned)
+		applyMixerSettings();
 }
 
-void SoundTrack::updatePosition() {
-	if (!_positioned)
+void SoundTrack::storePosition(bool positioned, const Math::Vector3d &pos) {
+	if (!positioned) {
+		publishPosition(false, pos, _attenuation);
 		return;
+	}
 
 	Set *set = g_grim->getCurrSet();
 	Set::Setup *setup = set->getCurrSetup();
 	Math::Vector3d cameraPos = setup->_pos;
-	Math::Vector3d vector = _pos - cameraPos;
+	Math::Vector3d vector = pos - cameraPos;
 	float distance = vector.getMagnitude();
-	_attenuation = MAX(0.0f, 1.0f - distance / _volume);
+	publishPosition(true, pos, MAX(0.0f, 1.0f - distance / getVolume()));
 
 	Math::Quaternion q = Math::Quaternion(
 		setup->_interest.x(), setup->_interest.y(), setup->_interest.z(),
 		setup->_roll);
 	Math::Matrix4 worldRot = q.toMatrix();
-	Math::Vector3d relPos = (_pos - setup->_pos);
+	Math::Vector3d relPos = (pos - setup->_pos);
 	Math::Vector3d p(relPos);
 	worldRot.inverseRotate(&p);
 	float angle = atan2(p.x(), p.z());
 	float pan = sin(angle);
-	_balance = (int)(pan * 127.0f);
+	atomicStore(_balance, (int)(pan * 127.0f));
+}
 
-	if (_handle) {
-		g_system->getMixer()->setChannelBalance(*_handle, _balance);
-		g_system->getMixer()->setChannelVolume(*_handle, (byte)getEffectiveVolume());
+void SoundTrack::publishPosition(bool positioned, const Math::Vector3d &pos, float attenuation) {
+	uint32 seq = _positionSeq;
+	atomicStore(_positionSeq, seq + 1);
+	atomicFence();
+	_positioned = positioned;
+	_pos = pos;
+	_attenuation = attenuation;
+	atomicStore(_positionSeq, seq + 2);
+}
+
+float SoundTrack::getAttenuation() const {
+	for (;;) {
+		uint32 seq = atomicLoad(_positionSeq);
+		float attenuation = _attenuation;
+		atomicFence();
+		if (!(seq & 1) && atomicLoad(_positionSeq) == seq)
+			return attenuation;
 	}
 }
 
+void SoundTrack::updatePosition() {
+	if (!_positioned)
+		return;
+
+	storePosition(true, _pos);
+	applyMixerSettings();
+}
+
 void SoundTrack::setBalance(int balance) {
 	if (_positioned)
 		return;
-	_balance = balance;
+	storeBalance(balance);
+	if (_handle) {
+		g_system->getMixer()->setChannelBalance(*_handle, getBalance());
+	}
+}
+
+void SoundTrack::storeBalance(int balance) {
+	if (_positioned)
+		return;
+	atomicStore(_balance, balance);
+}
+
+int SoundTrack::getBalance() const {
+	return atomicLoad(_balance);
+}
+
+void SoundTrack::applyMixerSettings() {
 	if (_handle) {
-		g_system->getMixer()->setChannelBalance(*_handle, _balance);
+		g_system->getMixer()->setChannelBalance(*_handle, getBalance());
+		g_system->getMixer()->setChannelVolume(*_handle, (byte)getEffectiveVolume());
 	}
 }
 
+bool SoundTrack::getPlayingStatus() const {
+	return (atomicLoad(_playingStatus) & 1) != 0;
+}
+
+void SoundTrack::setPlayingStatus(bool playing) {
+	uint32 status;
+	do {
+		status = atomicLoad(_playingStatus);
+	} while (!atomicCompareExchange(_playingStatus, status, (status & ~1u) + 2 + (playing ? 1 : 0)));
+}
+
+void SoundTrack::publishPlayingStatus() {
+	uint32 status = atomicLoad(_playingStatus);
+	uint32 playing = isPlaying() ? 1 : 0;
+	// Lose the race to a play() or stop() that happened meanwhile.
+	atomicCompareExchange(_playingStatus, status, (status & ~1u) | playing);
+}
+
 bool SoundTrack::play() {
 	if (_stream) {
 		if (isPlaying()) {
 			warning("sound: %s already playing, don't start again!", _soundName.c_str());
 			return true;
 		}
+		// Decode the first part here, the EMISound timer keeps the rest coming.
+		if (_aheadStream)
+			_aheadStream->fill();
 		// If _disposeAfterPlaying is NO, the destructor will take care of the stream.
-		g_system->getMixer()->playStream(_soundType, _handle, _stream, -1, (byte)getEffectiveVolume(), _balance, _disposeAfterPlaying);
+		g_system->getMixer()->playStream(_soundType, _handle, _stream, -1, (byte)getEffectiveVolume(), getBalance(), _disposeAfterPlaying);
+		setPlayingStatus(true);
 		return true;
 	}
 	return false;
@@ -139,6 +216,7 @@ void SoundTrack::pause() {
 void SoundTrack::stop() {
 	if (_handle)
 		g_system->getMixer()->stopHandle(*_handle);
+	setPlayingStatus(false);
 }
 
 void SoundTrack::setFade(float fade) {
@@ -149,8 +227,8 @@ void SoundTrack::setFade(float fade) {
 }
 
 int SoundTrack::getEffectiveVolume() {
-	int mixerVolume = _volume * Audio::Mixer::kMaxChannelVolume / 100;
-	return mixerVolume * _attenuation * _fade;
+	int mixerVolume = getVolume() * Audio::Mixer::kMaxChannelVolume / 100;
+	return mixerVolume * getAttenuation() * _fade;
 }
 
 } // end of namespace Grim
@@ -39,6 +39,7 @@ namespace Audio {
 namespace Grim {
 
 class SaveGame;
+class DecodeAheadStream;
 
 /**
  * @class Super-class for the different codecs used in EMI
@@ -53,6 +54,7 @@ public:
 protected:
 	Common::String _soundName;
 	Audio::AudioStream *_stream;
+	DecodeAheadStream *_aheadStream;
 	Audio::SoundHandle *_handle;
 	Audio::Mixer::SoundType _soundType;
 	DisposeAfterUse::Flag _disposeAfterPlaying;
@@ -62,8 +64,15 @@ protected:
 	FadeMode _fadeMode;
 	float _fade;
 	float _attenuation;
-	int _balance;
-	int _volume;
+	// _positioned, _pos and _attenuation are only written by the main thread,
+	// which also reads them directly. The EMISound timer reads them through
+	// getAttenuation(), which retries while the counter is odd or changed.
+	volatile uint32 _positionSeq;
+	volatile int _balance;
+	volatile int _volume;
+	// Bit 0 is the playing state, the rest counts play() and stop() calls so
+	// the timer can tell when its view of the mixer has gone stale.
+	volatile uint32 _playingStatus;
 	int _sync;
 public:
 	SoundTrack();
@@ -84,10 +93,30 @@ public:
 	void setVolume(int volume);
 	void setPosition(bool positioned, const Math::Vector3d &pos = Math::Vector3d());
 	void updatePosition();
+	/**
+	 * Like the setters above, but only store the new value. The mixer picks it
+	 * up once applyMixerSettings() runs on the EMISound timer, so scripts never
+	 * wait for the mixer or the sound callback.
+	 */
+	void storeBalance(int balance);
+	void storeVolume(int volume);
+	void storePosition(bool positioned, const Math::Vector3d &pos);
+	void applyMixerSettings();
+	/**
+	 * The playing state as last seen by the EMISound timer, or as set by
+	 * play() and stop(). Unlike isPlaying() it never asks the mixer.
+	 */
+	bool getPlayingStatus() const;
+	void publishPlayingStatus();
+protected:
+	void setPlayingStatus(bool playing);
+	void publishPosition(bool positioned, const Math::Vector3d &pos, float attenuation);
+public:
 	void setSync(int sync) { _sync = sync; }
+	float getAttenuation() const;
 	int getEffectiveVolume();
-	int getVolume() const { return _volume; }
-	int getBalance() const { return _balance; }
+	int getVolume() const;
+	int getBalance() const;
 	int getSync() const { return _sync; }
 	virtual Audio::Timestamp getPos() = 0;
 	Common::String getSoundName();
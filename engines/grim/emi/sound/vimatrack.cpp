@@ -20,16 +20,17 @@
  *
  */
 
+#include "common/endian.h"
 #include "common/stream.h"
 #include "common/mutex.h"
 #include "common/textconsole.h"
 #include "audio/audiostream.h"
 #include "audio/mixer.h"
-#include "audio/decoders/raw.h"
 #include "engines/grim/debug.h"
 #include "engines/grim/resource.h"
 #include "engines/grim/imuse/imuse_mcmp_mgr.h"
 #include "engines/grim/emi/sound/vimatrack.h"
+#include "engines/grim/emi/sound/decodeaheadstream.h"
 
 namespace Grim {
 
@@ -55,6 +56,69 @@ struct SoundDesc {
 	Common::SeekableReadStream *inStream;
 };
 
+/**
+ * Reads the 16-bit big endian samples of a VIMA sound straight out of the
+ * McmpMgr block cache and hands them out in native order. Only the
+ * decode-ahead stream wrapping it reads from it.
+ */
+class VimaStream : public Audio::AudioStream {
+public:
+	VimaStream(SoundDesc *desc, int32 region, int32 offset) :
+		_desc(desc), _region(region), _offset(offset), _done(false) {}
+
+	int readBuffer(int16 *buffer, const int numSamples) override;
+	bool isStereo() const override { return _desc->channels == 2; }
+	int getRate() const override { return _desc->freq; }
+	bool endOfData() const override { return _done; }
+
+private:
+	SoundDesc *_desc;
+	int32 _region;
+	int32 _offset;
+	bool _done;
+};
+
+int VimaStream::readBuffer(int16 *buffer, const int numSamples) {
+	int samples = 0;
+	while (samples < numSamples && !_done) {
+		int32 size = (numSamples - samples) * 2;
+		int32 regionLength = _desc->region[_region].length;
+		if (_offset + size > regionLength)
+			size = regionLength - _offset;
+
+		const byte *data = nullptr;
+		byte temp[0x1000];
+		if (size > 0) {
+			int32 offset = _desc->region[_region].offset + _offset;
+			if (_desc->mcmpData) {
+				size = _desc->mcmpMgr->getSampleView(offset, size, data);
+			} else {
+				size = MIN<int32>(size, sizeof(temp));
+				_desc->inStream->seek(offset + _desc->headerSize, SEEK_SET);
+				size = _desc->inStream->read(temp, size);
+				data = temp;
+			}
+		}
+		size &= ~1;
+
+		if (size == 0) {
+			if (_region + 1 < _desc->numRegions) {
+				_region++;
+				_offset = 0;
+			} else {
+				_done = true;
+			}
+			continue;
+		}
+
+		for (int32 i = 0; i < size; i += 2)
+			*buffer++ = (int16)READ_BE_UINT16(data + i);
+		samples += size / 2;
+		_offset += size;
+	}
+	return samples;
+}
+
 bool VimaTrack::isPlaying() {
 	// FIXME: Actually clean up the data better
 	// (we don't currently handle the case where it isn't asked for through isPlaying, or deleted explicitly).
@@ -89,9 +153,26 @@ bool VimaTrack::openSound(const Common::String &filename, const Common::String &
 	if (_mcmp->openSound(voiceName.c_str(), file, headerSize)) {
 		parseSoundHeader(_desc, headerSize);
 
-		_stream = Audio::makeQueuingAudioStream(_desc->freq, (false));
+		int32 region = 0;
+		int32 regionOffset = 0;
+		if (start) {
+			int32 bytesPerSecond = _desc->freq * _desc->channels * 2;
+			regionOffset = (start->msecs() * bytesPerSecond) / 1000;
+			regionOffset -= regionOffset % (_desc->channels * 2); // Start on a whole frame.
+			while (region < _desc->numRegions && regionOffset > _desc->region[region].length) {
+				regionOffset -= _desc->region[region].length;
+				++region;
+			}
+			if (region >= _desc->numRegions) {
+				// Past the end, leave the stream empty.
+				region = _desc->numRegions - 1;
+				regionOffset = _desc->region[region].length;
+			}
+		}
 
-		playTrack(start);
+		// The samples are decoded on the EMISound timer instead of all at once here.
+		_aheadStream = new DecodeAheadStream(new VimaStream(_desc, region, regionOffset), nullptr);
+		_stream = _aheadStream;
 		return true;
 	} else {
 		return false;
@@ -121,109 +202,6 @@ void VimaTrack::parseSoundHeader(SoundDesc *sound, int &headerSize) {
 	}
 }
 
-int32 VimaTrack::getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size) {
-	//assert(checkForProperHandle(sound));
-	assert(buf && offset >= 0 && size >= 0);
-	assert(region >= 0 && region < sound->numRegions);
-
-	int32 region_offset = sound->region[region].offset;
-	int32 region_length = sound->region[region].length;
-
-	if (offset + size > region_length) {
-		size = region_length - offset;
-		sound->endFlag = true;
-	} else {
-		sound->endFlag = false;
-	}
-
-	if (sound->mcmpData) {
-		size = sound->mcmpMgr->decompressSample(region_offset + offset, size, buf);
-	} else {
-		*buf = new byte[size];
-		sound->inStream->seek(region_offset + offset + sound->headerSize, SEEK_SET);
-		sound->inStream->read(*buf, size);
-	}
-
-	return size;
-}
-void VimaTrack::playTrack(const Audio::Timestamp *start) {
-	//Common::StackLock lock(_mutex);
-	if (!_stream) {
-		error("Stream not loaded");
-	}
-	byte *data = nullptr;
-	int32 result = 0;
-
-	int32 curRegion = -1;
-	int32 regionOffset = 0;
-	int32 mixerFlags = Audio::FLAG_16BITS;
-
-	curRegion++;
-
-	int channels = _desc->channels;
-
-	//int32 mixer_size = track->feedSize / _callbackFps;
-	int32 mixer_size = _desc->freq * channels * 2;
-
-	if (start) {
-		regionOffset = (start->msecs() * mixer_size) / 1000;
-		regionOffset = (regionOffset / 2) * 2; // Ensure that the offset is divisible by 2.
-		while (regionOffset > _desc->region[curRegion].length) {
-			regionOffset -= _desc->region[curRegion].length;
-			++curRegion;
-		}
-
-		if (curRegion > _desc->numRegions - 1)
-			return;
-	}
-
-	if (_stream->endOfData()) { // FIXME: Currently we just allocate a bunch here, try to find the correct size instead.
-		mixer_size *= 8;
-	}
-
-	if (channels == 1)
-		mixer_size &= ~1;
-	if (channels == 2)
-		mixer_size &= ~3;
-
-	if (mixer_size == 0)
-		return;
-
-	do {
-		result = getDataFromRegion(_desc, curRegion, &data, regionOffset, mixer_size);
-		if (channels == 1) {
-			result &= ~1;
-		}
-		if (channels == 2) {
-			result &= ~3;
-		}
-
-		if (result > mixer_size)
-			result = mixer_size;
-
-		if (g_system->getMixer()->isReady()) {
-			((Audio::QueuingAudioStream *)_stream)->queueBuffer(data, result, DisposeAfterUse::YES, mixerFlags);
-			regionOffset += result;
-		} else
-			delete[] data;
-
-		if (curRegion >= 0 && curRegion < _desc->numRegions - 1) {
-			curRegion++;
-			regionOffset = 0;
-
-			if (!_stream) {
-				return;
-			}
-		}
-		mixer_size -= result;
-		assert(mixer_size >= 0);
-	} while (mixer_size && !_desc->endFlag);
-	if (g_system->getMixer()->isReady()) {
-		//g_system->getMixer()->setChannelVolume(track->handle, track->getVol());
-		//g_system->getMixer()->setChannelBalance(track->handle, track->getPan());
-	}
-}
-
 Audio::Timestamp VimaTrack::getPos() {
 	// FIXME: Return actual stream position.
 	return g_system->getMixer()->getSoundElapsedTime(*_handle);
@@ -231,6 +209,8 @@ Audio::Timestamp VimaTrack::getPos() {
 
 VimaTrack::VimaTrack() {
 	_soundType = Audio::Mixer::kSpeechSoundType;
+	// Keep the stream when the mixer is done with it, isPlaying() still looks at it.
+	_disposeAfterPlaying = DisposeAfterUse::NO;
 	_handle = new Audio::SoundHandle();
 	_file = nullptr;
 	_mcmp = nullptr;
@@ -240,6 +220,11 @@ VimaTrack::VimaTrack() {
 VimaTrack::~VimaTrack() {
 	stop();
 
+	// The stream reads from _mcmp until it is gone, so it goes first.
+	delete _stream;
+	_stream = nullptr;
+	_aheadStream = nullptr;
+
 	delete _mcmp;
 
 	if (_desc) {
@@ -39,14 +39,12 @@ class McmpMgr;
 class VimaTrack : public SoundTrack {
 	Common::SeekableReadStream *_file;
 	void parseSoundHeader(SoundDesc *sound, int &headerSize);
-	int32 getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size);
 public:
 	VimaTrack();
 	virtual ~VimaTrack();
 
 	bool isPlaying();
 	bool openSound(const Common::String &filename, const Common::String &soundName, const Audio::Timestamp *start = nullptr) override;
-	void playTrack(const Audio::Timestamp *start);
 	Audio::Timestamp getPos() override;
 	SoundDesc *_desc;
 	McmpMgr *_mcmp;
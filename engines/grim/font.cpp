@@ -36,7 +36,8 @@ Font::Font() :
 		_fontData(nullptr), _charHeaders(nullptr), _charIndex(nullptr),
 		_numChars(0), _dataSize(0), _kernedHeight(0), _baseOffsetY(0),
 		_firstChar(0), _lastChar(0) {
-
+	for (uint i = 0; i < 256; ++i)
+		_charLookup[i] = kNoChar;
 }
 
 Font::~Font() {
@@ -61,6 +62,14 @@ void Font::load(const Common::String &filename, Common::SeekableReadStream *data
 	for (uint i = 0; i < _numChars; ++i)
 		_charIndex[i] = data->readUint16LE();
 
+	// Resolve every character code once, instead of searching the index on each lookup
+	for (uint i = 0; i < 256; ++i)
+		_charLookup[i] = kNoChar;
+	for (uint i = 0; i < _numChars; ++i) {
+		if (_charIndex[i] < 256 && _charLookup[_charIndex[i]] == kNoChar)
+			_charLookup[_charIndex[i]] = i;
+	}
+
 	// Read character headers
 	_charHeaders = new CharHeader[_numChars];
 	for (uint i = 0; i < _numChars; ++i) {
@@ -97,14 +106,10 @@ uint16 Font::getCharIndex(unsigned char c) const {
 	// 'í' character will either show up as a different
 	// character or it crashes the game.
 
-	if (_charIndex[c2] == c2) {
-		return c2;
+	if (_charLookup[c2] != kNoChar) {
+		return _charLookup[c2];
 	}
 
-	for (uint i = 0; i < _numChars; ++i) {
-		if (_charIndex[i] == c2)
-			return i;
-	}
 	Debug::warning(Debug::Fonts, "The requsted character (code 0x%x) does not correspond to anything in the font data!", c2);
 	// If we couldn't find the character then default to
 	// the first character in the font so that something
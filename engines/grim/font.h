@@ -66,9 +66,7 @@ public:
 	void restoreState(SaveGame *state);
 
 	static const uint8 emerFont[][13];
-private:
 
-	uint16 getCharIndex(unsigned char c) const;
 	struct CharHeader {
 		int32 offset;
 		int8  kernedWidth;
@@ -78,11 +76,20 @@ private:
 		int32 bitmapHeight;
 	};
 
+	uint16 getCharIndex(unsigned char c) const;
+	uint32 getNumChars() const { return _numChars; }
+	const CharHeader &getCharHeader(uint16 index) const { return _charHeaders[index]; }
+	const byte *getGlyphData(uint16 index) const { return _fontData + _charHeaders[index].offset; }
+
+private:
+	static const uint16 kNoChar = 0xffff;
+
 	uint32 _numChars;
 	uint32 _dataSize;
 	uint32 _kernedHeight, _baseOffsetY;
 	uint32 _firstChar, _lastChar;
 	uint16 *_charIndex;
+	uint16 _charLookup[256];
 	CharHeader *_charHeaders;
 	byte *_fontData;
 	Common::String _filename;
@@ -50,7 +50,7 @@ GfxBase::GfxBase() :
 		_currentPos(0, 0, 0), _currentQuat(0, 0, 0, 1), _dimLevel(0.0f),
 		_screenWidth(0), _screenHeight(0), _isFullscreen(false),
 		_scaleW(1.0f), _scaleH(1.0f), _currentShadowArray(nullptr),
-		_shadowColorR(255), _shadowColorG(255), _shadowColorB(255) {
+		_shadowColorR(255), _shadowColorG(255), _shadowColorB(255), _zBitmapDepth(nullptr) {
 			for (unsigned int i = 0; i < _numSpecialtyTextures; i++) {
 				_specialtyTextures[i]._isShared = true;
 			}
@@ -175,6 +175,17 @@ void GfxBase::createSpecialtyTexture(uint id, const uint8 *data, int width, int
 	g_driver->createTexture(&_specialtyTextures[id], data, nullptr, true);
 }
 
+const uint32 *GfxBase::getZBitmapDepthTable() {
+	if (!_zBitmapDepth) {
+		_zBitmapDepth = new uint32[0x10000];
+		for (uint32 val = 0; val < 0x10000; val++) {
+			_zBitmapDepth[val] = val * 0x10000 / 100 / (0x10000 - val);
+		}
+		_zBitmapDepth[0xf81f] = _zBitmapDepth[0];
+	}
+	return _zBitmapDepth;
+}
+
 Bitmap *GfxBase::createScreenshotBitmap(const Graphics::PixelBuffer src, int w, int h, bool flipOrientation) {
         Graphics::PixelBuffer buffer = Graphics::PixelBuffer::createBuffer<565>(w * h, DisposeAfterUse::YES);
 
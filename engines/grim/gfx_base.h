@@ -71,7 +71,7 @@ enum colorFormat {
 class GfxBase {
 public:
 	GfxBase();
-	virtual ~GfxBase() { ; }
+	virtual ~GfxBase() { delete[] _zBitmapDepth; }
 
 	/**
 	 * Creates a render-context.
@@ -257,13 +257,17 @@ public:
 
 	virtual void renderBitmaps(bool render);
 	virtual void renderZBitmaps(bool render);
+	bool getRenderBitmaps() const { return _renderBitmaps; }
+	bool getRenderZBitmaps() const { return _renderZBitmaps; }
 
 	virtual void makeScreenTextures();
 
 	virtual void createMesh(Mesh *mesh) {}
 	virtual void destroyMesh(const Mesh *mesh) {}
 	virtual void createEMIModel(EMIModel *model) {}
+	virtual void destroyEMIModel(EMIModel *model) {}
 	virtual void updateEMIModel(const EMIModel *model) {}
+	virtual void destroyShadow(Shadow *shadow) {}
 
 	virtual int genBuffer() { return 0; }
 	virtual void delBuffer(int buffer) {}
@@ -283,6 +287,12 @@ public:
 	virtual void setBlendMode(bool additive) = 0;
 protected:
 	Bitmap *createScreenshotBitmap(const Graphics::PixelBuffer src, int w, int h, bool flipOrientation);
+	/**
+	 * Maps each 16-bit z-bitmap value to val * 0x10000 / 100 / (0x10000 - val),
+	 * which the renderers turn into their depth format. The transparency
+	 * color 0xf81f, which some z-bitmaps wrongly contain, maps like 0.
+	 */
+	const uint32 *getZBitmapDepthTable();
 	static const unsigned int _numSpecialtyTextures = 22;
 	Texture _specialtyTextures[_numSpecialtyTextures];
 	static const int _gameHeight = 480;
@@ -301,6 +311,7 @@ protected:
 	Math::Vector3d _currentPos;
 	Math::Quaternion _currentQuat;
 	float _dimLevel;
+	uint32 *_zBitmapDepth;
 };
 
 // Factory-like functions:
@@ -1017,15 +1017,11 @@ void GfxOpenGL::createBitmap(BitmapData *bitmap) {
 	GLuint *textures;
 
 	if (bitmap->_format != 1) {
+		const uint32 *depth = getZBitmapDepthTable();
 		for (int pic = 0; pic < bitmap->_numImages; pic++) {
 			uint16 *zbufPtr = reinterpret_cast<uint16 *>(bitmap->getImageData(pic).getRawBuffer());
 			for (int i = 0; i < (bitmap->_width * bitmap->_height); i++) {
-				uint16 val = READ_LE_UINT16(zbufPtr + i);
-				// fix the value if it is incorrectly set to the bitmap transparency color
-				if (val == 0xf81f) {
-					val = 0;
-				}
-				zbufPtr[i] = 0xffff - ((uint32)val) * 0x10000 / 100 / (0x10000 - val);
+				zbufPtr[i] = 0xffff - depth[READ_LE_UINT16(zbufPtr + i)];
 			}
 
 			// Flip the zbuffer image to match what GL expects
@@ -1181,15 +1181,11 @@ void GfxOpenGLS::destroyTexture(Texture *texture) {
 
 void GfxOpenGLS::createBitmap(BitmapData *bitmap) {
 	if (bitmap->_format != 1) {
+		const uint32 *depth = getZBitmapDepthTable();
 		for (int pic = 0; pic < bitmap->_numImages; pic++) {
 			uint16 *zbufPtr = reinterpret_cast<uint16 *>(bitmap->getImageData(pic).getRawBuffer());
 			for (int i = 0; i < (bitmap->_width * bitmap->_height); i++) {
-				uint16 val = READ_LE_UINT16(zbufPtr + i);
-				// fix the value if it is incorrectly set to the bitmap transparency color
-				if (val == 0xf81f) {
-					val = 0;
-				}
-				zbufPtr[i] = 0xffff - ((uint32)val) * 0x10000 / 100 / (0x10000 - val);
+				zbufPtr[i] = 0xffff - depth[READ_LE_UINT16(zbufPtr + i)];
 			}
 		}
 	}
@@ -1931,6 +1927,37 @@ void GfxOpenGLS::createEMIModel(EMIModel *model) {
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+void GfxOpenGLS::destroyEMIModel(EMIModel *model) {
+	EMIModelUserData *mud = static_cast<EMIModelUserData *>(model->_userData);
+	if (!mud)
+		return;
+
+	Graphics::Shader::freeBuffer(mud->_verticesVBO);
+	Graphics::Shader::freeBuffer(mud->_normalsVBO);
+	Graphics::Shader::freeBuffer(mud->_texCoordsVBO);
+	Graphics::Shader::freeBuffer(mud->_colorMapVBO);
+	for (uint32 i = 0; i < model->_numFaces; ++i) {
+		EMIMeshFace *face = &model->_faces[i];
+		Graphics::Shader::freeBuffer(face->_indicesEBO);
+		face->_indicesEBO = 0;
+	}
+
+	delete mud->_shader;
+	delete mud;
+	model->_userData = nullptr;
+}
+
+void GfxOpenGLS::destroyShadow(Shadow *shadow) {
+	ShadowUserData *sud = static_cast<ShadowUserData *>(shadow->userData);
+	if (!sud)
+		return;
+
+	Graphics::Shader::freeBuffer(sud->_verticesVBO);
+	Graphics::Shader::freeBuffer(sud->_indicesVBO);
+	delete sud;
+	shadow->userData = nullptr;
+}
+
 void GfxOpenGLS::createMesh(Mesh *mesh) {
 	Common::Array<GrimVertex> meshInfo;
 	meshInfo.reserve(mesh->_numVertices * 5);
@@ -203,6 +203,8 @@ public:
 	virtual void createMesh(Mesh *mesh) override;
 	virtual void destroyMesh(const Mesh *mesh) override;
 	virtual void createEMIModel(EMIModel *model) override;
+	virtual void destroyEMIModel(EMIModel *model) override;
+	virtual void destroyShadow(Shadow *shadow) override;
 	virtual void updateEMIModel(const EMIModel* model) override;
 
 	virtual void setBlendMode(bool additive) override;
@@ -932,16 +932,12 @@ void GfxTinyGL::createBitmap(BitmapData *bitmap) {
 	bitmap->_texIds = (void *)imgs;
 
 	if (bitmap->_format != 1) {
+		const uint32 *depth = getZBitmapDepthTable();
 		for (int pic = 0; pic < bitmap->_numImages; pic++) {
 			uint32 *buf = new uint32[bitmap->_width * bitmap->_height];
 			uint16 *bufPtr = reinterpret_cast<uint16 *>(bitmap->getImageData(pic).getRawBuffer());
 			for (int i = 0; i < (bitmap->_width * bitmap->_height); i++) {
-				uint16 val = READ_LE_UINT16(bufPtr + i);
-				// fix the value if it is incorrectly set to the bitmap transparency color
-				if (val == 0xf81f) {
-					val = 0;
-				}
-				buf[i] = ((uint32)val) * 0x10000 / 100 / (0x10000 - val) << 14;
+				buf[i] = depth[READ_LE_UINT16(bufPtr + i)] << 14;
 			}
 			delete[] bufPtr;
 			bitmap->_data[pic] = Graphics::PixelBuffer(Graphics::PixelFormat(4, 8, 8, 8, 8, 0, 8, 16, 24), (byte *)buf);
@@ -1037,109 +1033,231 @@ void GfxTinyGL::destroyBitmap(BitmapData *bitmap) {
 	delete[] imgs;
 }
 
+struct FontAtlas {
+	Graphics::BlitImage *image;
+	Common::Point *glyphPos;
+};
+
+static const int kFontAtlasWidth = 256;
+static const int kTextKeyColor = 0xFFF800F8;
+
 void GfxTinyGL::createFont(Font *font) {
+	int numChars = font->getNumChars();
+	if (numChars == 0)
+		return;
+
+	// Pack the glyphs in rows, so that text can be drawn before it gets its own images
+	FontAtlas *atlas = new FontAtlas;
+	atlas->glyphPos = new Common::Point[numChars];
+	int x = 0, y = 0, rowHeight = 0;
+	for (int i = 0; i < numChars; i++) {
+		const Font::CharHeader &header = font->getCharHeader(i);
+		if (x + header.bitmapWidth > kFontAtlasWidth) {
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+		atlas->glyphPos[i] = Common::Point(x, y);
+		x += header.bitmapWidth;
+		rowHeight = MAX<int>(rowHeight, header.bitmapHeight);
+	}
+	int height = MAX(y + rowHeight, 1);
+
+	Graphics::PixelBuffer buf(_pixelFormat, kFontAtlasWidth * height, DisposeAfterUse::YES);
+	for (int i = 0; i < kFontAtlasWidth * height; i++) {
+		buf.setPixelAt(i, 0xf81f);
+	}
+
+	// Glyphs are white and get tinted with the text color when drawn
+	uint32 white = _zb->cmode.RGBToColor(255, 255, 255);
+	for (int i = 0; i < numChars; i++) {
+		const Font::CharHeader &header = font->getCharHeader(i);
+		const byte *glyph = font->getGlyphData(i);
+		const Common::Point &pos = atlas->glyphPos[i];
+		for (int line = 0; line < header.bitmapHeight; line++) {
+			for (int col = 0; col < header.bitmapWidth; col++) {
+				byte pixel = glyph[line * header.bitmapWidth + col];
+				int offset = (pos.y + line) * kFontAtlasWidth + pos.x + col;
+				if (pixel == 0x80) {
+					buf.setPixelAt(offset, 0);
+				} else if (pixel == 0xFF) {
+					buf.setPixelAt(offset, white);
+				}
+			}
+		}
+	}
+
+	Graphics::Surface sourceSurface;
+	sourceSurface.setPixels(buf.getRawBuffer());
+	sourceSurface.format = buf.getFormat();
+	sourceSurface.w = kFontAtlasWidth;
+	sourceSurface.h = height;
+	sourceSurface.pitch = sourceSurface.w * buf.getFormat().bytesPerPixel;
+	atlas->image = Graphics::tglGenBlitImage();
+	Graphics::tglUploadBlitImage(atlas->image, sourceSurface, kTextKeyColor, true);
+
+	font->setUserData(atlas);
 }
 
 void GfxTinyGL::destroyFont(Font *font) {
+	const FontAtlas *atlas = (const FontAtlas *)font->getUserData();
+	if (atlas) {
+		Graphics::tglDeleteBlitImage(atlas->image);
+		delete[] atlas->glyphPos;
+		delete atlas;
+		font->setUserData(nullptr);
+	}
 }
 
-struct TextObjectData {
+struct TextLineData {
 	Graphics::BlitImage *image;
-	int width, height, x, y;
+	int x, y;
 };
 
+struct TextObjectData {
+	TextLineData *lines;
+	mutable int numDraws;
+};
+
+// Text still shown after this many draws gets an image per line. Text that
+// changes or goes away sooner is drawn glyph by glyph from the font atlas.
+static const int kTextLineImageDraws = 2;
+
 void GfxTinyGL::createTextObject(TextObject *text) {
 	int numLines = text->getNumLines();
-	const Common::String *lines = text->getLines();
 	const Font *font = text->getFont();
-	const Color &fgColor = text->getFGColor();
-	TextObjectData *userData = new TextObjectData[numLines];
+	TextObjectData *userData = new TextObjectData;
+	userData->lines = new TextLineData[numLines];
+	userData->numDraws = 0;
 	text->setUserData(userData);
 	for (int j = 0; j < numLines; j++) {
-		const Common::String &currentLine = lines[j];
+		userData->lines[j].image = nullptr;
+		userData->lines[j].x = text->getLineX(j);
+		userData->lines[j].y = text->getLineY(j);
 
-		int width = font->getStringLength(currentLine) + 1;
-		int height = font->getStringHeight(currentLine) + 1;
+		if (g_grim->getGameType() == GType_MONKEY4) {
+			userData->lines[j].y -= font->getBaseOffsetY();
+			if (userData->lines[j].y < 0)
+				userData->lines[j].y = 0;
+		}
+	}
+}
 
-		uint8 *_textBitmap = new uint8[height * width];
-		memset(_textBitmap, 0, height * width);
+Graphics::BlitImage *GfxTinyGL::createTextLineImage(const TextObject *text, int line) {
+	const Common::String &currentLine = text->getLines()[line];
+	const Font *font = text->getFont();
+	const Color &fgColor = text->getFGColor();
 
-		int startColumn = 0;
-		for (unsigned int d = 0; d < currentLine.size(); d++) {
-			int ch = currentLine[d];
-			int32 charBitmapWidth = font->getCharBitmapWidth(ch);
-			int8 fontRow = font->getCharStartingLine(ch) + font->getBaseOffsetY();
-			int8 fontCol = font->getCharStartingCol(ch);
-
-			for (int line = 0; line < font->getCharBitmapHeight(ch); line++) {
-				int lineOffset = ((fontRow + line) * width);
-				for (int bitmapCol = 0; bitmapCol < charBitmapWidth; bitmapCol++) {
-					int columnOffset = startColumn + fontCol + bitmapCol;
-					int fontOffset = (charBitmapWidth * line) + bitmapCol;
-					int8 pixel = font->getCharData(ch)[fontOffset];
-					assert(lineOffset + columnOffset < width*height);
-					if (pixel != 0)
-						_textBitmap[lineOffset + columnOffset] = pixel;
-				}
+	int width = font->getStringLength(currentLine) + 1;
+	int height = font->getStringHeight(currentLine) + 1;
+
+	uint8 *_textBitmap = new uint8[height * width];
+	memset(_textBitmap, 0, height * width);
+
+	int startColumn = 0;
+	for (unsigned int d = 0; d < currentLine.size(); d++) {
+		const Font::CharHeader &header = font->getCharHeader(font->getCharIndex(currentLine[d]));
+		const byte *glyph = font->getGlyphData(font->getCharIndex(currentLine[d]));
+		int32 charBitmapWidth = header.bitmapWidth;
+		int8 fontRow = header.startingLine + font->getBaseOffsetY();
+		int8 fontCol = header.startingCol;
+
+		for (int row = 0; row < header.bitmapHeight; row++) {
+			int lineOffset = ((fontRow + row) * width);
+			for (int bitmapCol = 0; bitmapCol < charBitmapWidth; bitmapCol++) {
+				int columnOffset = startColumn + fontCol + bitmapCol;
+				int fontOffset = (charBitmapWidth * row) + bitmapCol;
+				int8 pixel = glyph[fontOffset];
+				assert(lineOffset + columnOffset < width*height);
+				if (pixel != 0)
+					_textBitmap[lineOffset + columnOffset] = pixel;
 			}
-			startColumn += font->getCharKernedWidth(ch);
 		}
+		startColumn += header.kernedWidth;
+	}
 
-		Graphics::PixelBuffer buf(_pixelFormat, width * height, DisposeAfterUse::YES);
-
-		uint8 *bitmapData = _textBitmap;
-		uint8 r = fgColor.getRed();
-		uint8 g = fgColor.getGreen();
-		uint8 b = fgColor.getBlue();
-		uint32 color = _zb->cmode.RGBToColor(r, g, b);
-
-		if (color == 0xf81f)
-			color = 0xf81e;
-
-		int txData = 0;
-		for (int i = 0; i < width * height; i++, txData++, bitmapData++) {
-			byte pixel = *bitmapData;
-			if (pixel == 0x00) {
-				buf.setPixelAt(txData, 0xf81f);
-			} else if (pixel == 0x80) {
-				buf.setPixelAt(txData, 0);
-			} else if (pixel == 0xFF) {
-				buf.setPixelAt(txData, color);
-			}
+	Graphics::PixelBuffer buf(_pixelFormat, width * height, DisposeAfterUse::YES);
+
+	uint8 *bitmapData = _textBitmap;
+	uint8 r = fgColor.getRed();
+	uint8 g = fgColor.getGreen();
+	uint8 b = fgColor.getBlue();
+	uint32 color = _zb->cmode.RGBToColor(r, g, b);
+
+	if (color == 0xf81f)
+		color = 0xf81e;
+
+	int txData = 0;
+	for (int i = 0; i < width * height; i++, txData++, bitmapData++) {
+		byte pixel = *bitmapData;
+		if (pixel == 0x00) {
+			buf.setPixelAt(txData, 0xf81f);
+		} else if (pixel == 0x80) {
+			buf.setPixelAt(txData, 0);
+		} else if (pixel == 0xFF) {
+			buf.setPixelAt(txData, color);
 		}
+	}
 
-		userData[j].width = width;
-		userData[j].height = height;
+	Graphics::Surface sourceSurface;
+	sourceSurface.setPixels(buf.getRawBuffer());
+	sourceSurface.format = buf.getFormat();
+	sourceSurface.w = width;
+	sourceSurface.h = height;
+	sourceSurface.pitch = sourceSurface.w * buf.getFormat().bytesPerPixel;
+	Graphics::BlitImage *image = Graphics::tglGenBlitImage();
+	Graphics::tglUploadBlitImage(image, sourceSurface, kTextKeyColor, true);
 
-		const int kKitmapColorkey = 0xFFF800F8;
+	delete[] _textBitmap;
+	return image;
+}
 
-		Graphics::Surface sourceSurface;
-		sourceSurface.setPixels(buf.getRawBuffer());
-		sourceSurface.format = buf.getFormat();
-		sourceSurface.w = width;
-		sourceSurface.h = height;
-		sourceSurface.pitch = sourceSurface.w * buf.getFormat().bytesPerPixel;
-		userData[j].image = Graphics::tglGenBlitImage();
-		Graphics::tglUploadBlitImage(userData[j].image, sourceSurface, kKitmapColorkey, true);
-		userData[j].x = text->getLineX(j);
-		userData[j].y = text->getLineY(j);
+void GfxTinyGL::drawTextObject(const TextObject *text) {
+	const TextObjectData *userData = (const TextObjectData *)text->getUserData();
+	if (!userData)
+		return;
 
-		if (g_grim->getGameType() == GType_MONKEY4) {
-			userData[j].y -= font->getBaseOffsetY();
-			if (userData[j].y < 0)
-				userData[j].y = 0;
+	int numLines = text->getNumLines();
+	if (userData->numDraws < kTextLineImageDraws && ++userData->numDraws == kTextLineImageDraws) {
+		for (int i = 0; i < numLines; ++i) {
+			userData->lines[i].image = createTextLineImage(text, i);
 		}
-
-		delete[] _textBitmap;
 	}
-}
 
-void GfxTinyGL::drawTextObject(const TextObject *text) {
-	const TextObjectData *userData = (const TextObjectData *)text->getUserData();
-	if (userData) {
-		int numLines = text->getNumLines();
+	if (userData->numDraws >= kTextLineImageDraws) {
 		for (int i = 0; i < numLines; ++i) {
-			Graphics::tglBlit(userData[i].image, userData[i].x, userData[i].y);
+			Graphics::tglBlit(userData->lines[i].image, userData->lines[i].x, userData->lines[i].y);
+		}
+		return;
+	}
+
+	const Font *font = text->getFont();
+	const FontAtlas *atlas = (const FontAtlas *)font->getUserData();
+	if (!atlas)
+		return;
+
+	// The half step keeps the tinted white glyphs from rounding down a shade
+	const Color &fgColor = text->getFGColor();
+	float rTint = (fgColor.getRed() + 0.5f) / 255.f;
+	float gTint = (fgColor.getGreen() + 0.5f) / 255.f;
+	float bTint = (fgColor.getBlue() + 0.5f) / 255.f;
+
+	const Common::String *lines = text->getLines();
+	for (int i = 0; i < numLines; ++i) {
+		const Common::String &currentLine = lines[i];
+		int startColumn = 0;
+		for (uint d = 0; d < currentLine.size(); ++d) {
+			uint16 index = font->getCharIndex(currentLine[d]);
+			const Font::CharHeader &header = font->getCharHeader(index);
+			if (header.bitmapWidth > 0 && header.bitmapHeight > 0) {
+				const Common::Point &pos = atlas->glyphPos[index];
+				Graphics::BlitTransform transform(userData->lines[i].x + startColumn + header.startingCol,
+				                                  userData->lines[i].y + header.startingLine + font->getBaseOffsetY());
+				transform.sourceRectangle(pos.x, pos.y, header.bitmapWidth, header.bitmapHeight);
+				transform.tint(1.0f, rTint, gTint, bTint);
+				Graphics::tglBlit(atlas->image, transform);
+			}
+			startColumn += header.kernedWidth;
 		}
 	}
 }
@@ -1149,9 +1267,10 @@ void GfxTinyGL::destroyTextObject(TextObject *text) {
 	if (userData) {
 		int numLines = text->getNumLines();
 		for (int i = 0; i < numLines; ++i) {
-			Graphics::tglDeleteBlitImage(userData[i].image);
+			Graphics::tglDeleteBlitImage(userData->lines[i].image);
 		}
-		delete[] userData;
+		delete[] userData->lines;
+		delete userData;
 	}
 }
 
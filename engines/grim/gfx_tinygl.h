@@ -148,6 +148,7 @@ private:
 	TGLenum _depthFunc;
 
 	void readPixels(int x, int y, int width, int height, uint8 *buffer);
+	Graphics::BlitImage *createTextLineImage(const TextObject *text, int line);
 };
 
 } // end of namespace Grim
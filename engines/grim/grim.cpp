@@ -57,6 +57,8 @@
 #include "engines/grim/gfx_base.h"
 #include "engines/grim/bitmap.h"
 #include "engines/grim/font.h"
+#include "engines/grim/material.h"
+#include "engines/grim/textobject.h"
 #include "engines/grim/primitives.h"
 #include "engines/grim/objectstate.h"
 #include "engines/grim/set.h"
@@ -100,6 +102,7 @@ GrimEngine::GrimEngine(OSystem *syst, uint32 gameFlags, GrimGameType gameType, C
 	ConfMan.registerDefault("engine_speed", 60);
 	ConfMan.registerDefault("fullscreen", false);
 	ConfMan.registerDefault("show_fps", false);
+	ConfMan.registerDefault("disk_bitmap_cache", false);
 	ConfMan.registerDefault("use_arb_shaders", true);
 
 	_showFps = ConfMan.getBool("show_fps");
@@ -131,9 +134,13 @@ GrimEngine::GrimEngine(OSystem *syst, uint32 gameFlags, GrimGameType gameType, C
 	ConfMan.setInt("engine_speed", 1000 / _speedLimitMs);
 	_listFilesIter = nullptr;
 	_savedState = nullptr;
+	_lastSaveTime = 0;
+	_lastLoadTime = 0;
 	_fps[0] = 0;
 	_iris = new Iris();
 	_buildActiveActorsList = false;
+	_numTestedActors = 0;
+	_numCulledActors = 0;
 
 	Color c(0, 0, 0);
 
@@ -238,6 +245,78 @@ void GrimEngine::createRenderer() {
 	}
 }
 
+void GrimEngine::recreateRenderer(bool fullscreen) {
+	uint32 startTime = g_system->getMillis();
+
+	uint screenWidth = g_driver->getScreenWidth();
+	uint screenHeight = g_driver->getScreenHeight();
+	byte shadowR, shadowG, shadowB;
+	g_driver->getShadowColor(&shadowR, &shadowG, &shadowB);
+	bool renderBitmaps = g_driver->getRenderBitmaps();
+	bool renderZBitmaps = g_driver->getRenderZBitmaps();
+
+	// Hand back everything the old renderer created. The objects themselves
+	// stay alive, so there is no need to save and restore the whole game.
+	foreach (TextObject *t, TextObject::getPool()) {
+		t->destroy();
+	}
+	foreach (Font *f, Font::getPool()) {
+		g_driver->destroyFont(f);
+		f->setUserData(nullptr);
+	}
+	foreach (Actor *a, Actor::getPool()) {
+		a->releaseDriverData();
+	}
+	foreach (Bitmap *b, Bitmap::getPool()) {
+		b->_data->releaseDriverData();
+	}
+	if (MaterialData::_materials) {
+		foreach (MaterialData *m, *MaterialData::_materials) {
+			m->releaseDriverData();
+		}
+	}
+	g_resourceloader->releaseDriverData();
+
+	delete g_driver;
+	createRenderer();
+	g_driver->setupScreen(screenWidth, screenHeight, fullscreen);
+	g_driver->loadEmergFont();
+	g_driver->setShadowColor(shadowR, shadowG, shadowB);
+	g_driver->renderBitmaps(renderBitmaps);
+	g_driver->renderZBitmaps(renderZBitmaps);
+
+	if (MaterialData::_materials) {
+		foreach (MaterialData *m, *MaterialData::_materials) {
+			m->createDriverData();
+		}
+	}
+	foreach (Bitmap *b, Bitmap::getPool()) {
+		b->_data->createDriverData();
+	}
+	foreach (Font *f, Font::getPool()) {
+		g_driver->createFont(f);
+	}
+	foreach (Actor *a, Actor::getPool()) {
+		a->createDriverData();
+	}
+	g_resourceloader->createDriverData();
+
+	invalidateActiveActorsList();
+	buildActiveActorsList();
+
+	g_driver->refreshBuffers();
+	if (_currSet) {
+		_currSet->setupCamera();
+	}
+	g_driver->set3DMode();
+	foreach (Actor *a, Actor::getPool()) {
+		a->restoreCleanBuffer();
+	}
+	flagRefreshShadowMask(true);
+
+	debug("GrimEngine::recreateRenderer() took %d ms.", g_system->getMillis() - startTime);
+}
+
 const char *GrimEngine::getUpdateFilename() {
 	if (!(getGameFlags() & ADGF_DEMO))
 		return "gfupd101.exe";
@@ -322,6 +401,10 @@ Common::Error GrimEngine::run() {
 	if (_softRenderer)
 		g_driver->flipBuffer();
 
+	ConfMan.registerDefault("warm_text_cache", false);
+	if (ConfMan.getBool("warm_text_cache"))
+		g_resourceloader->warmTextCache();
+
 	LuaBase *lua = createLua();
 
 	lua->registerOpcodes();
@@ -497,6 +580,7 @@ void GrimEngine::updateDisplayScene() {
 
 	if (_mode == SmushMode) {
 		if (g_movie->isPlaying()) {
+			g_movie->presentFrame();
 			_movieTime = g_movie->getMovieTime();
 			if (g_movie->isUpdateNeeded()) {
 				g_driver->prepareMovieFrame(g_movie->getDstSurface());
@@ -540,6 +624,15 @@ void GrimEngine::updateNormalMode() {
 	drawTextObjects();
 }
 
+void GrimEngine::prepareActorForRender(Actor *a) {
+	// Actors outside of the view are not skinned nor drawn.
+	_numTestedActors++;
+	if (a->updateCulling(_currSet->getFrustum()))
+		_numCulledActors++;
+	else
+		a->prepareForRender();
+}
+
 void GrimEngine::updateDrawMode() {
 	_doFlip = false;
 	_prevSmushFrame = 0;
@@ -568,6 +661,7 @@ void GrimEngine::drawNormalMode() {
 	// This should not occur on top of everything though or Manny gets covered
 	// up when he's next to Glottis's service room
 	if (g_movie->isPlaying() && _movieSetup == _currSet->getCurrSetup()->_name) {
+		g_movie->presentFrame();
 		_movieTime = g_movie->getMovieTime();
 		if (g_movie->isUpdateNeeded()) {
 			g_driver->prepareMovieFrame(g_movie->getDstSurface());
@@ -600,6 +694,17 @@ void GrimEngine::drawNormalMode() {
 
 	// Draw actors
 	buildActiveActorsList();
+
+	// Skin all the visible actors in one batch before drawing them, so that
+	// drawing only has to hand the finished vertex buffers to the renderer.
+	// The actors are still submitted in list order.
+	_numTestedActors = 0;
+	_numCulledActors = 0;
+	foreach (Actor *a, _activeActors) {
+		if (a->isVisible())
+			prepareActorForRender(a);
+	}
+
 	foreach (Actor *a, _activeActors) {
 		if (a->isVisible())
 			a->draw();
@@ -679,19 +784,9 @@ void GrimEngine::mainLoop() {
 			g_system->setFeatureState(OSystem::kFeatureFullscreenMode, fullscreen);
 			ConfMan.setBool("fullscreen", fullscreen);
 
-			uint screenWidth = g_driver->getScreenWidth();
-			uint screenHeight = g_driver->getScreenHeight();
-
 			EngineMode mode = getMode();
 
-			_savegameFileName = "";
-			savegameSave();
-			clearPools();
-
-			delete g_driver;
-			createRenderer();
-			g_driver->setupScreen(screenWidth, screenHeight, fullscreen);
-			savegameRestore();
+			recreateRenderer(fullscreen);
 
 			if (mode == DrawMode) {
 				setMode(GrimEngine::NormalMode);
@@ -814,6 +909,7 @@ void GrimEngine::savegameRestore() {
 	} else {
 		filename = _savegameFileName;
 	}
+	uint32 startTime = g_system->getMillis();
 	_savedState = SaveGame::openForLoading(filename);
 	if (!_savedState || !_savedState->isCompatible())
 		return;
@@ -880,6 +976,7 @@ void GrimEngine::savegameRestore() {
 	Debug::debug(Debug::Engine, "Lua restored successfully.");
 
 	delete _savedState;
+	_lastLoadTime = g_system->getMillis() - startTime;
 
 	//Re-read the values, since we may have been in some state that changed them when loading the savegame,
 	//e.g. running a cutscene, which sets the sfx volume to 0.
@@ -982,6 +1079,7 @@ void GrimEngine::savegameSave() {
 	if (getGameType() == GType_MONKEY4 && filename.contains('/')) {
 		filename = Common::lastPathComponent(filename, '/');
 	}
+	uint32 startTime = g_system->getMillis();
 	_savedState = SaveGame::openForSaving(filename);
 	if (!_savedState) {
 		//TODO: Translate this!
@@ -1044,6 +1142,7 @@ void GrimEngine::savegameSave() {
 	lua_Save(_savedState);
 
 	delete _savedState;
+	_lastSaveTime = g_system->getMillis() - startTime;
 
 	if (g_imuse)
 		g_imuse->pause(false);
@@ -160,6 +160,17 @@ public:
 	 * Return a list of the currently active actors, i. e. the actors in the current set.
 	 */
 	const Common::List<Actor *> &getActiveActors() const { return _activeActors; }
+	/**
+	 * Return how many actors were tested against the view frustum in the last
+	 * frame, and how many of them were culled.
+	 */
+	int getNumTestedActors() const { return _numTestedActors; }
+	int getNumCulledActors() const { return _numCulledActors; }
+	/**
+	 * Return how long, in milliseconds, the last save and the last load took.
+	 */
+	uint32 getLastSaveTime() const { return _lastSaveTime; }
+	uint32 getLastLoadTime() const { return _lastLoadTime; }
 
 	/**
 	 * Add an actor to the list of actors that are talking
@@ -199,8 +210,10 @@ protected:
 	void cameraChangeHandle(int prev, int next);
 	void cameraPostChangeHandle(int num);
 	void buildActiveActorsList();
+	void prepareActorForRender(Actor *a);
 	void savegameCallback();
 	void createRenderer();
+	void recreateRenderer(bool fullscreen);
 	virtual LuaBase *createLua();
 	virtual void updateNormalMode();
 	virtual void updateDrawMode();
@@ -218,6 +231,8 @@ protected:
 	bool _savegameSaveRequest;
 	Common::String _savegameFileName;
 	SaveGame *_savedState;
+	uint32 _lastSaveTime;
+	uint32 _lastLoadTime;
 
 	Set *_currSet;
 	EngineMode _mode, _previousMode;
@@ -252,6 +267,8 @@ protected:
 
 	bool _buildActiveActorsList;
 	Common::List<Actor *> _activeActors;
+	int _numTestedActors;
+	int _numCulledActors;
 	Common::List<Actor *> _talkingActors;
 
 	uint32 _gameFlags;
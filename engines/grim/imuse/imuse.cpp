@@ -27,6 +27,7 @@
 #include "engines/grim/debug.h"
 
 #include "engines/grim/imuse/imuse.h"
+#include "engines/grim/imuse/imuse_mcmp_mgr.h"
 #include "engines/grim/movie/codecs/vima.h"
 
 #include "audio/audiostream.h"
@@ -54,6 +55,7 @@ Imuse::Imuse(int fps, bool demo) {
 	_sound = new ImuseSndMgr(_demo);
 	assert(_sound);
 	_callbackFps = fps;
+	_decodeTrack = nullptr;
 	resetState();
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		_track[l] = new Track;
@@ -62,6 +64,7 @@ Imuse::Imuse(int fps, bool demo) {
 		_track[l]->trackId = l;
 	}
 	vimaInit(imuseDestTable);
+	McmpMgr::startReadAhead();
 	if (_demo) {
 		_stateMusicTable = grimDemoStateMusicTable;
 		_seqMusicTable = grimDemoSeqMusicTable;
@@ -79,6 +82,7 @@ Imuse::~Imuse() {
 		delete _track[l];
 	}
 	delete _sound;
+	McmpMgr::stopReadAhead();
 }
 
 void Imuse::resetState() {
@@ -89,6 +93,7 @@ void Imuse::resetState() {
 
 void Imuse::restoreState(SaveGame *savedState) {
 	Common::StackLock lock(_mutex);
+	waitForDecode();
 
 	savedState->beginSection('IMUS');
 	_curMusicState = savedState->readLESint32();
@@ -142,10 +147,7 @@ void Imuse::restoreState(SaveGame *savedState) {
 		if (channels == 2)
 			track->mixerFlags |= kFlagStereo | kFlagReverseStereo;
 
-		track->stream = Audio::makeQueuingAudioStream(freq, (track->mixerFlags & kFlagStereo) != 0);
-		g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1, track->getVol(),
-											track->getPan(), DisposeAfterUse::YES, false,
-											(track->mixerFlags & kFlagReverseStereo) != 0);
+		playTrackStream(track, freq);
 		g_system->getMixer()->pauseHandle(track->handle, true);
 	}
 	savedState->endSection();
@@ -164,6 +166,7 @@ void Imuse::saveState(SaveGame *savedState) {
 
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		Track *track = _track[l];
+		track->applyTargets();
 		savedState->writeLESint32(track->pan);
 		savedState->writeLESint32(track->panFadeDest);
 		savedState->writeLESint32(track->panFadeDelay);
@@ -187,19 +190,6 @@ void Imuse::saveState(SaveGame *savedState) {
 	savedState->endSection();
 }
 
-int32 Imuse::makeMixerFlags(int32 flags) {
-	int32 mixerFlags = 0;
-	if (flags & kFlagUnsigned)
-		mixerFlags |= Audio::FLAG_UNSIGNED;
-	if (flags & kFlag16Bits)
-		mixerFlags |= Audio::FLAG_16BITS;
-	if (flags & kFlagLittleEndian)
-		mixerFlags |= Audio::FLAG_LITTLE_ENDIAN;
-	if (flags & kFlagStereo)
-		mixerFlags |= Audio::FLAG_STEREO;
-	return mixerFlags;
-}
-
 void Imuse::callback() {
 	Common::StackLock lock(_mutex);
 
@@ -217,6 +207,7 @@ void Imuse::callback() {
 			if (_pause)
 				return;
 
+			track->applyTargets();
 			if (track->volFadeUsed) {
 				if (track->volFadeStep < 0) {
 					if (track->vol > track->volFadeDest) {
@@ -265,7 +256,6 @@ void Imuse::callback() {
 			}
 
 			assert(track->stream);
-			byte *data = nullptr;
 			int32 result = 0;
 
 			if (track->curRegion == -1) {
@@ -274,6 +264,9 @@ void Imuse::callback() {
 					continue;
 			}
 
+			if (!g_system->getMixer()->isReady())
+				continue;
+
 			int channels = _sound->getChannels(track->soundDesc);
 			int32 mixer_size = track->feedSize / _callbackFps;
 
@@ -290,7 +283,35 @@ void Imuse::callback() {
 				continue;
 
 			do {
-				result = _sound->getDataFromRegion(track->soundDesc, track->curRegion, &data, track->regionOffset, mixer_size);
+				// Decode straight into the track's ring buffer. When it is full the
+				// mixer is behind, and the rest is fed on a later tick.
+				int32 size = mixer_size;
+				byte *data = track->stream->getWriteSpan(size);
+				if (channels == 1)
+					size &= ~1;
+				if (channels == 2)
+					size &= ~3;
+				if (size == 0)
+					break;
+
+				// Decode without the mutex, so script calls don't wait for it.
+				// Whatever stops or moves the track waits for the decode first
+				// and clears _decodeTrack, and the result is then dropped.
+				ImuseSndMgr::SoundDesc *soundDesc = track->soundDesc;
+				int region = track->curRegion;
+				int offset = track->regionOffset;
+				_decodeMutex.lock();
+				_decodeTrack = track;
+				_mutex.unlock();
+				result = _sound->getDataFromRegion(soundDesc, region, data, offset, size);
+				_decodeMutex.unlock();
+				_mutex.lock();
+				if (_decodeTrack != track) {
+					track = nullptr;
+					break;
+				}
+				_decodeTrack = nullptr;
+
 				if (channels == 1) {
 					result &= ~1;
 				}
@@ -298,31 +319,43 @@ void Imuse::callback() {
 					result &= ~3;
 				}
 
-				if (result > mixer_size)
-					result = mixer_size;
-
-				if (g_system->getMixer()->isReady()) {
-					track->stream->queueBuffer(data, result, DisposeAfterUse::YES, makeMixerFlags(track->mixerFlags));
-					track->regionOffset += result;
-				} else
-					delete[] data;
+				track->stream->commitWrite(result);
+				track->regionOffset += result;
 
 				if (_sound->isEndOfRegion(track->soundDesc, track->curRegion)) {
 					switchToNextRegion(track);
 					if (!track->stream)
 						break;
+				} else if (result == 0) {
+					break;
 				}
 				mixer_size -= result;
 				assert(mixer_size >= 0);
 			} while (mixer_size);
-			if (g_system->getMixer()->isReady()) {
-				g_system->getMixer()->setChannelVolume(track->handle, track->getVol());
-				g_system->getMixer()->setChannelBalance(track->handle, track->getPan());
+			if (!track)
+				continue;
+
+			// Only talk to the mixer, which takes its own lock, when something changed
+			int vol = track->getVol();
+			int pan = track->getPan();
+			if (vol != track->mixerVol) {
+				g_system->getMixer()->setChannelVolume(track->handle, vol);
+				track->mixerVol = vol;
+			}
+			if (pan != track->mixerPan) {
+				g_system->getMixer()->setChannelBalance(track->handle, pan);
+				track->mixerPan = pan;
 			}
 		}
 	}
 }
 
+void Imuse::waitForDecode() {
+	// Called with _mutex held, the callback can't start another decode meanwhile
+	Common::StackLock lock(_decodeMutex);
+	_decodeTrack = nullptr;
+}
+
 void Imuse::switchToNextRegion(Track *track) {
 	assert(track);
 
@@ -43,6 +43,9 @@ private:
 	Track *_track[MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS];
 
 	Common::Mutex _mutex;
+	// Held by the callback while it decodes without _mutex, always taken after it
+	Common::Mutex _decodeMutex;
+	Track *_decodeTrack;
 	ImuseSndMgr *_sound;
 
 	bool _pause;
@@ -55,10 +58,10 @@ private:
 	const ImuseTable *_stateMusicTable;
 	const ImuseTable *_seqMusicTable;
 
-	int32 makeMixerFlags(int32 flags);
 	static void timerHandler(void *refConf);
 	void callback();
 	void switchToNextRegion(Track *track);
+	void playTrackStream(Track *track, int freq);
 	int allocSlot(int priority);
 	void selectVolumeGroup(const char *soundName, int volGroupId);
 
@@ -70,6 +73,7 @@ private:
 	void playMusic(const ImuseTable *table, int atribPos, bool sequence);
 
 	void flushTrack(Track *track);
+	void waitForDecode();
 
 public:
 	Imuse(int fps, bool demo);
@@ -21,6 +21,8 @@
  */
 
 #include "common/file.h"
+#include "common/system.h"
+#include "common/timer.h"
 
 #include "engines/grim/resource.h"
 
@@ -31,19 +33,71 @@ namespace Grim {
 
 uint16 imuseDestTable[5786];
 
+Common::List<McmpMgr *> *McmpMgr::_readAheadList = nullptr;
+Common::Mutex *McmpMgr::_readAheadMutex = nullptr;
+
 McmpMgr::McmpMgr() {
 	_compTable = nullptr;
 	_numCompItems = 0;
 	_curSample = -1;
 	_compInput = nullptr;
-	_outputSize = 0;
 	_file = nullptr;
-	_lastBlock = -1;
+	_cache = new CacheBlock[kCacheBlocks];
+	for (int i = 0; i < kCacheBlocks; i++) {
+		_cache[i].block = -1;
+		_cache[i].size = 0;
+		_cache[i].lastUse = 0;
+	}
+	_viewBlock = nullptr;
+	_useCounter = 0;
+	_readAheadBlock = -1;
 }
 
 McmpMgr::~McmpMgr() {
+	if (_readAheadMutex) {
+		Common::StackLock lock(*_readAheadMutex);
+		_readAheadList->remove(this);
+	}
 	delete[] _compTable;
 	delete[] _compInput;
+	delete[] _cache;
+}
+
+void McmpMgr::startReadAhead() {
+	if (_readAheadMutex)
+		return;
+	_readAheadMutex = new Common::Mutex();
+	_readAheadList = new Common::List<McmpMgr *>();
+	g_system->getTimerManager()->installTimerProc(readAheadHandler, 50000, nullptr, "mcmpReadAhead");
+}
+
+void McmpMgr::stopReadAhead() {
+	if (!_readAheadMutex)
+		return;
+	g_system->getTimerManager()->removeTimerProc(readAheadHandler);
+	delete _readAheadList;
+	_readAheadList = nullptr;
+	delete _readAheadMutex;
+	_readAheadMutex = nullptr;
+}
+
+void McmpMgr::readAheadHandler(void *refCon) {
+	Common::StackLock lock(*_readAheadMutex);
+	for (Common::List<McmpMgr *>::iterator i = _readAheadList->begin(); i != _readAheadList->end(); ++i) {
+		(*i)->readAhead();
+	}
+}
+
+void McmpMgr::readAhead() {
+	Common::StackLock lock(_mutex);
+	if (_readAheadBlock < 0)
+		return;
+
+	for (int32 i = _readAheadBlock; i < _readAheadBlock + kReadAheadBlocks && i < _numCompItems; i++) {
+		if (!findBlock(i))
+			decodeBlock(i)->lastUse = ++_useCounter;
+	}
+	_readAheadBlock = -1;
 }
 
 bool McmpMgr::openSound(const char *filename, Common::SeekableReadStream *data, int &offsetData) {
@@ -85,64 +139,90 @@ bool McmpMgr::openSound(const char *filename, Common::SeekableReadStream *data,
 	_compInput = new byte[maxSize + 2];
 	offsetData = headerSize;
 
+	if (_readAheadMutex) {
+		Common::StackLock lock(*_readAheadMutex);
+		_readAheadList->push_back(this);
+	}
+
 	return true;
 }
 
-int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
-	int32 i, final_size, output_size;
-	int skip, first_block, last_block;
+McmpMgr::CacheBlock *McmpMgr::findBlock(int32 block) {
+	for (int i = 0; i < kCacheBlocks; i++) {
+		if (_cache[i].block == block)
+			return &_cache[i];
+	}
+	return nullptr;
+}
+
+McmpMgr::CacheBlock *McmpMgr::decodeBlock(int32 block) {
+	CacheBlock *dst = nullptr;
+	for (int i = 0; i < kCacheBlocks; i++) {
+		if (&_cache[i] == _viewBlock)
+			continue;
+		if (!dst || _cache[i].lastUse < dst->lastUse)
+			dst = &_cache[i];
+	}
+
+	// hack: two more zero bytes at the end of input buffer
+	_compInput[_compTable[block].compSize] = 0;
+	_compInput[_compTable[block].compSize + 1] = 0;
+	_file->seek(_compTable[block].offset, SEEK_SET);
+	_file->read(_compInput, _compTable[block].compSize);
+	if (_compTable[block].decompSize > 0x2000) {
+		error("McmpMgr::decodeBlock() decompSize: %d", _compTable[block].decompSize);
+	}
+	decompressVima(_compInput, (int16 *)dst->data, _compTable[block].decompSize);
+	dst->block = block;
+	dst->size = _compTable[block].decompSize;
+	return dst;
+}
 
+int32 McmpMgr::getSampleView(int32 offset, int32 size, const byte *&data) {
 	if (!_file) {
-		error("McmpMgr::decompressSampleByName() File is not open!");
+		error("McmpMgr::getSampleView() File is not open!");
 		return 0;
 	}
 
-	first_block = offset / 0x2000;
-	last_block = (offset + size - 1) / 0x2000;
-	skip = offset % 0x2000;
+	Common::StackLock lock(_mutex);
 
-	// Clip last_block by the total number of blocks (= "comp items")
-	if ((last_block >= _numCompItems) && (_numCompItems > 0))
-		last_block = _numCompItems - 1;
+	int32 block = offset / 0x2000;
+	int32 skip = offset % 0x2000;
+	if (block >= _numCompItems)
+		return 0;
 
-	int32 blocks_final_size = 0x2000 * (1 + last_block - first_block);
-	*comp_final = (byte *)malloc(blocks_final_size * sizeof(byte));
-	final_size = 0;
+	CacheBlock *cached = findBlock(block);
+	if (!cached)
+		cached = decodeBlock(block);
+	cached->lastUse = ++_useCounter;
+	_viewBlock = cached;
 
-	for (i = first_block; i <= last_block; i++) {
-		if (_lastBlock != i) {
-			// hack: two more zero bytes at the end of input buffer
-			_compInput[_compTable[i].compSize] = 0;
-			_compInput[_compTable[i].compSize + 1] = 0;
-			_file->seek(_compTable[i].offset, SEEK_SET);
-			_file->read(_compInput, _compTable[i].compSize);
-			decompressVima(_compInput, (int16 *)_compOutput, _compTable[i].decompSize, imuseDestTable);
-			_outputSize = _compTable[i].decompSize;
-			if (_outputSize > 0x2000) {
-				error("McmpMgr::decompressSample() _outputSize: %d", _outputSize);
-			}
-			_lastBlock = i;
-		}
+	if (block + 1 < _numCompItems && !findBlock(block + 1))
+		_readAheadBlock = block + 1;
 
-		output_size = _outputSize - skip;
+	int32 outputSize = cached->size - skip;
+	if (outputSize < 0)
+		outputSize = 0;
+	if (outputSize > size)
+		outputSize = size;
 
-		if ((output_size + skip) > 0x2000) // workaround
-			output_size -= (output_size + skip) - 0x2000;
+	data = cached->data + skip;
+	return outputSize;
+}
 
-		if (output_size > size)
-			output_size = size;
+int32 McmpMgr::decompressSample(int32 offset, int32 size, byte *comp_final) {
+	int32 final_size = 0;
 
-		assert(final_size + output_size <= blocks_final_size);
+	while (size > 0) {
+		const byte *data;
+		int32 output_size = getSampleView(offset, size, data);
+		if (output_size == 0)
+			break;
 
-		memcpy(*comp_final + final_size, _compOutput + skip, output_size);
+		memcpy(comp_final + final_size, data, output_size);
 		final_size += output_size;
-
+		offset += output_size;
 		size -= output_size;
-		assert(size >= 0);
-		if (size == 0)
-			break;
-
-		skip = 0;
 	}
 
 	return final_size;
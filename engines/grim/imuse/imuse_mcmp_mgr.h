@@ -23,6 +23,9 @@
 #ifndef GRIM_MCMP_MGR_H
 #define GRIM_MCMP_MGR_H
 
+#include "common/list.h"
+#include "common/mutex.h"
+
 namespace Grim {
 
 class McmpMgr {
@@ -35,14 +38,37 @@ private:
 		int32 offset;
 	};
 
+	struct CacheBlock {
+		int32 block;
+		int32 size;
+		uint32 lastUse;
+		byte data[0x2000];
+	};
+
+	static const int kCacheBlocks = 8;
+	static const int kReadAheadBlocks = 2;
+
 	CompTable *_compTable;
 	int16 _numCompItems;
 	int _curSample;
 	Common::SeekableReadStream *_file;
-	byte _compOutput[0x2000];
 	byte *_compInput;
-	int _outputSize;
-	int _lastBlock;
+
+	// Decoded blocks, least recently used first to go. The block the last
+	// view points into is never evicted.
+	CacheBlock *_cache;
+	CacheBlock *_viewBlock;
+	uint32 _useCounter;
+	int32 _readAheadBlock;
+	Common::Mutex _mutex;
+
+	CacheBlock *findBlock(int32 block);
+	CacheBlock *decodeBlock(int32 block);
+	void readAhead();
+
+	static void readAheadHandler(void *refCon);
+	static Common::List<McmpMgr *> *_readAheadList;
+	static Common::Mutex *_readAheadMutex;
 
 public:
 
@@ -50,7 +76,21 @@ public:
 	~McmpMgr();
 
 	bool openSound(const char *filename, Common::SeekableReadStream *data, int &offsetData);
-	int32 decompressSample(int32 offset, int32 size, byte **comp_final);
+	int32 decompressSample(int32 offset, int32 size, byte *comp_final);
+
+	/**
+	 * Points data at the decoded samples at offset, inside the block cache,
+	 * and returns how many bytes can be read there, at most size. The view
+	 * stays valid until the next call.
+	 */
+	int32 getSampleView(int32 offset, int32 size, const byte *&data);
+
+	/**
+	 * Starts and stops decoding the blocks that follow the last request of
+	 * every open sound on the timer thread.
+	 */
+	static void startReadAhead();
+	static void stopReadAhead();
 };
 
 } // end of namespace Grim
@@ -29,6 +29,7 @@
 namespace Grim {
 
 void Imuse::flushTrack(Track *track) {
+	waitForDecode();
 	track->toBeRemoved = true;
 
 	if (track->stream) {
@@ -159,6 +160,7 @@ void Imuse::stopSound(const char *soundName) {
 void Imuse::stopAllSounds() {
 	Common::StackLock lock(_mutex);
 	Debug::debug(Debug::Sound, "Imuse::stopAllSounds()");
+	waitForDecode();
 
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		Track *track = _track[l];
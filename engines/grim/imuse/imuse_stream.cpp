@@ -0,0 +1,84 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#include "common/endian.h"
+#include "common/util.h"
+
+#include "engines/grim/atomic.h"
+#include "engines/grim/imuse/imuse_stream.h"
+
+namespace Grim {
+
+ImuseStream::ImuseStream(int rate, bool stereo, uint32 bufferSize) :
+		_readPos(0), _writePos(0), _finished(false), _rate(rate), _stereo(stereo) {
+	// Positions are free running and masked on access, so the size must be a power of two
+	_size = 4;
+	while (_size < bufferSize)
+		_size <<= 1;
+	_buffer = new byte[_size];
+}
+
+ImuseStream::~ImuseStream() {
+	delete[] _buffer;
+}
+
+int ImuseStream::readBuffer(int16 *buffer, const int numSamples) {
+	uint32 readPos = _readPos;
+	uint32 available = (atomicLoad(_writePos) - readPos) / 2;
+	int samples = MIN<uint32>(numSamples, available);
+
+	for (int i = 0; i < samples; i++, readPos += 2) {
+		buffer[i] = (int16)READ_BE_UINT16(_buffer + (readPos & (_size - 1)));
+	}
+
+	atomicStore(_readPos, readPos);
+	return samples;
+}
+
+bool ImuseStream::endOfData() const {
+	return atomicLoad(_writePos) == atomicLoad(_readPos);
+}
+
+bool ImuseStream::endOfStream() const {
+	return atomicLoad(_finished) && endOfData();
+}
+
+byte *ImuseStream::getWriteSpan(int32 &size) {
+	uint32 writePos = _writePos;
+	uint32 offset = writePos & (_size - 1);
+	uint32 space = _size - (writePos - atomicLoad(_readPos));
+	space = MIN(space, _size - offset);
+	if ((uint32)size > space)
+		size = space;
+	return _buffer + offset;
+}
+
+void ImuseStream::commitWrite(int32 size) {
+	atomicStore(_writePos, _writePos + size);
+}
+
+void ImuseStream::finish() {
+	atomicStore(_finished, true);
+}
+
+} // end of namespace Grim
@@ -0,0 +1,71 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#ifndef GRIM_IMUSE_STREAM_H
+#define GRIM_IMUSE_STREAM_H
+
+#include "audio/audiostream.h"
+
+namespace Grim {
+
+/**
+ * Ring buffer the iMuse callback decodes into and the mixer pulls from.
+ * The callback is the only producer and the mixer the only consumer, so
+ * neither side takes a lock and no memory is allocated after creation.
+ * The samples are kept as they come from the sound files: 16 bits,
+ * signed, big endian.
+ */
+class ImuseStream : public Audio::AudioStream {
+public:
+	ImuseStream(int rate, bool stereo, uint32 bufferSize);
+	~ImuseStream();
+
+	int readBuffer(int16 *buffer, const int numSamples) override;
+	bool isStereo() const override { return _stereo; }
+	int getRate() const override { return _rate; }
+	bool endOfData() const override;
+	bool endOfStream() const override;
+
+	/**
+	 * Returns where the next bytes go, and clips size to the free space
+	 * that follows it without wrapping.
+	 */
+	byte *getWriteSpan(int32 &size);
+	void commitWrite(int32 size);
+
+	/** No more data will be written; the stream ends once it is drained. */
+	void finish();
+
+private:
+	byte *_buffer;
+	uint32 _size;
+	volatile uint32 _readPos;
+	volatile uint32 _writePos;
+	volatile bool _finished;
+	int _rate;
+	bool _stereo;
+};
+
+} // end of namespace Grim
+
+#endif
@@ -55,6 +55,7 @@ int Imuse::allocSlot(int priority) {
 			Track *track = _track[trackId];
 
 			// Stop the track immediately
+			waitForDecode();
 			g_system->getMixer()->stopHandle(track->handle);
 			if (track->soundDesc) {
 				_sound->closeSound(track->soundDesc);
@@ -75,6 +76,7 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 	Track *track = nullptr;
 	int i;
 
+	waitForDecode();
 	// If the track is fading out bring it back to the normal running tracks
 	for (i = MAX_IMUSE_TRACKS; i < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; i++) {
 		if (!scumm_stricmp(_track[i]->soundName, soundName) && !_track[i]->toBeRemoved) {
@@ -161,15 +163,22 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 		track->regionOffset = otherTrack->regionOffset;
 	}
 
-	track->stream = Audio::makeQueuingAudioStream(freq, track->mixerFlags & kFlagStereo);
-	g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1,
-											track->getVol(), track->getPan(), DisposeAfterUse::YES,
-											false, (track->mixerFlags & kFlagReverseStereo) != 0);
+	playTrackStream(track, freq);
 	track->used = true;
 
 	return true;
 }
 
+void Imuse::playTrackStream(Track *track, int freq) {
+	// One second of audio; the callback only stays a tick or two ahead of the mixer
+	track->stream = new ImuseStream(freq, (track->mixerFlags & kFlagStereo) != 0, track->feedSize);
+	track->mixerVol = track->getVol();
+	track->mixerPan = track->getPan();
+	g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1,
+											track->mixerVol, track->mixerPan, DisposeAfterUse::YES,
+											false, (track->mixerFlags & kFlagReverseStereo) != 0);
+}
+
 Track *Imuse::findTrack(const char *soundName) {
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
 		Track *track = _track[l];
@@ -199,8 +208,11 @@ void Imuse::setPriority(const char *soundName, int priority) {
 	changeTrack->priority = priority;
 }
 
+// setVolume() and setPan() don't take the mutex, they only publish a target
+// that the callback applies on its next tick, before running the fades. Only
+// the main thread starts tracks, and a slot is cleared when it is reused, so a
+// target left on a track that went away meanwhile is harmless.
 void Imuse::setVolume(const char *soundName, int volume) {
-	Common::StackLock lock(_mutex);
 	Track *changeTrack;
 
 	changeTrack = findTrack(soundName);
@@ -208,11 +220,11 @@ void Imuse::setVolume(const char *soundName, int volume) {
 		warning("Unable to find track '%s' to change volume", soundName);
 		return;
 	}
-	changeTrack->vol = volume * 1000;
+	atomicStore(changeTrack->targetVol, (int32)(volume * 1000));
+	atomicStore(changeTrack->targetVolCount, changeTrack->targetVolCount + 1);
 }
 
 void Imuse::setPan(const char *soundName, int pan) {
-	Common::StackLock lock(_mutex);
 	Track *changeTrack;
 
 	changeTrack = findTrack(soundName);
@@ -220,7 +232,8 @@ void Imuse::setPan(const char *soundName, int pan) {
 		warning("Unable to find track '%s' to change pan", soundName);
 		return;
 	}
-	changeTrack->pan = pan * 1000;
+	atomicStore(changeTrack->targetPan, (int32)(pan * 1000));
+	atomicStore(changeTrack->targetPanCount, changeTrack->targetPanCount + 1);
 }
 
 int Imuse::getVolume(const char *soundName) {
@@ -232,6 +245,7 @@ int Imuse::getVolume(const char *soundName) {
 		warning("Unable to find track '%s' to get volume", soundName);
 		return 0;
 	}
+	getTrack->applyTargets();
 	return getTrack->vol / 1000;
 }
 
@@ -286,6 +300,7 @@ void Imuse::setFadeVolume(const char *soundName, int destVolume, int duration) {
 		warning("Unable to find track '%s' to change fade volume", soundName);
 		return;
 	}
+	changeTrack->applyTargets();
 	changeTrack->volFadeDelay = duration;
 	changeTrack->volFadeDest = destVolume * 1000;
 	changeTrack->volFadeStep = (changeTrack->volFadeDest - changeTrack->vol) * 60 * (1000 / _callbackFps) / (1000 * duration);
@@ -301,6 +316,7 @@ void Imuse::setFadePan(const char *soundName, int destPan, int duration) {
 		warning("Unable to find track '%s' to change fade pan", soundName);
 		return;
 	}
+	changeTrack->applyTargets();
 	changeTrack->panFadeDelay = duration;
 	changeTrack->panFadeDest = destPan * 1000;
 	changeTrack->panFadeStep = (changeTrack->panFadeDest - changeTrack->pan) * 60 * (1000 / _callbackFps) / (1000 * duration);
@@ -323,6 +339,7 @@ int Imuse::getCurMusicPan() {
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
 		Track *track = _track[l];
 		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
+			track->applyTargets();
 			return track->pan / 1000;
 		}
 	}
@@ -334,6 +351,7 @@ int Imuse::getCurMusicVol() {
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
 		Track *track = _track[l];
 		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
+			track->applyTargets();
 			return track->vol / 1000;
 		}
 	}
@@ -372,6 +390,8 @@ Track *Imuse::cloneToFadeOutTrack(Track *track, int fadeDelay) {
 		error("cloneToFadeOutTrack: Tried to clone a track to be removed, please bug report");
 		return nullptr;
 	}
+	waitForDecode();
+	track->applyTargets();
 
 	assert(track->trackId < MAX_IMUSE_TRACKS);
 	fadeTrack = _track[track->trackId + MAX_IMUSE_TRACKS];
@@ -398,10 +418,7 @@ Track *Imuse::cloneToFadeOutTrack(Track *track, int fadeDelay) {
 	fadeTrack->volFadeUsed = true;
 
 	// Create an appendable output buffer
-	fadeTrack->stream = Audio::makeQueuingAudioStream(_sound->getFreq(fadeTrack->soundDesc), track->mixerFlags & kFlagStereo);
-	g_system->getMixer()->playStream(track->getType(), &fadeTrack->handle, fadeTrack->stream, -1, fadeTrack->getVol(),
-											fadeTrack->getPan(), DisposeAfterUse::YES, false,
-											(track->mixerFlags & kFlagReverseStereo) != 0);
+	playTrackStream(fadeTrack, _sound->getFreq(fadeTrack->soundDesc));
 	fadeTrack->used = true;
 
 	return fadeTrack;
@@ -415,6 +432,8 @@ Track *Imuse::moveToFadeOutTrack(Track *track, int fadeDelay) {
 		error("moveToFadeOutTrack: Tried to move a track to be removed, please bug report");
 		return nullptr;
 	}
+	waitForDecode();
+	track->applyTargets();
 
 	// Clamp fade time to remaining time in the current region
 	if (track->curRegion != -1) {
@@ -23,7 +23,9 @@
 #ifndef GRIM_IMUSE_TRACK_H
 #define GRIM_IMUSE_TRACK_H
 
+#include "engines/grim/atomic.h"
 #include "engines/grim/imuse/imuse_sndmgr.h"
+#include "engines/grim/imuse/imuse_stream.h"
 
 namespace Grim {
 
@@ -60,15 +62,39 @@ struct Track {
 	int32 volGroupId;
 	int32 feedSize;
 	int32 mixerFlags;
+	int mixerVol;
+	int mixerPan;
+
+	// Volume and pan set by scripts without the mutex, picked up by applyTargets()
+	volatile int32 targetVol;
+	volatile int32 targetPan;
+	volatile uint32 targetVolCount;
+	volatile uint32 targetPanCount;
+	uint32 appliedVolCount;
+	uint32 appliedPanCount;
 
 	ImuseSndMgr::SoundDesc *soundDesc;
 	Audio::SoundHandle handle;
-	Audio::QueuingAudioStream *stream;
+	ImuseStream *stream;
 
 	Track() : used(false), stream(NULL) {
 		soundName[0] = 0;
 	}
 
+	// Must be called with the mutex held
+	void applyTargets() {
+		uint32 count = atomicLoad(targetVolCount);
+		if (count != appliedVolCount) {
+			appliedVolCount = count;
+			vol = atomicLoad(targetVol);
+		}
+		count = atomicLoad(targetPanCount);
+		if (count != appliedPanCount) {
+			appliedPanCount = count;
+			pan = atomicLoad(targetPan);
+		}
+	}
+
 	/* getPan() returns -127 ... 127 */
 	int getPan() const { return (pan != 64000) ? 2 * (pan / 1000) - 127 : 0; }
 	int getVol() const { return vol / 1000; }
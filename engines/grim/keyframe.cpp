@@ -38,7 +38,7 @@ KeyframeAnim::KeyframeAnim(const Common::String &fname, Common::SeekableReadStre
 		loadBinary(data);
 	else {
 		data->seek(0, SEEK_SET);
-		TextSplitter ts(fname, data);
+		TextSplitter ts(fname, data, g_resourceloader->getTextCache());
 		loadText(ts);
 	}
 }
@@ -178,7 +178,7 @@ bool KeyframeAnim::isNodeAnimated(ModelNode *nodes, int num, float time, bool ta
 	}
 }
 
-void KeyframeAnim::animate(ModelNode *nodes, int num, float time, float fade, bool tagged) const {
+void KeyframeAnim::animate(ModelNode *nodes, int num, float time, float fade, bool tagged, int *cursors) const {
 	// Without this sending the bread down the tube in "mo" often crashes,
 	// because it goes outside the bounds of the array of the nodes.
 	if (num >= _numJoints)
@@ -190,7 +190,7 @@ void KeyframeAnim::animate(ModelNode *nodes, int num, float time, float fade, bo
 		frame = _numFrames;
 
 	if (_nodes[num] && tagged == ((_type & nodes[num]._type) != 0)) {
-		_nodes[num]->animate(nodes[num], frame, fade, (_flags & 256) == 0);
+		_nodes[num]->animate(nodes[num], frame, fade, (_flags & 256) == 0, &cursors[num]);
 	}
 }
 
@@ -263,13 +263,22 @@ KeyframeAnim::KeyframeNode::~KeyframeNode() {
 	delete[] _entries;
 }
 
-void KeyframeAnim::KeyframeNode::animate(ModelNode &node, float frame, float fade, bool useDelta) const {
-	if (_numEntries == 0)
-		return;
+int KeyframeAnim::KeyframeNode::findEntry(float frame, int cursor) const {
+	// During normal playback the frame only moves forward, so the entry is either
+	// the one used the last time or one of the next few.
+	if (cursor >= 0 && cursor < _numEntries && _entries[cursor]._frame <= frame) {
+		for (int i = 0; i < 4; ++i) {
+			if (cursor + 1 == _numEntries || frame < _entries[cursor + 1]._frame)
+				return cursor;
+			++cursor;
+		}
+	} else {
+		cursor = 0;
+	}
 
-	// Do a binary search for the nearest previous frame
+	// Seeked or looped: do a binary search for the nearest previous frame
 	// Loop invariant: entries_[low].frame_ <= frame < entries_[high].frame_
-	int low = 0, high = _numEntries;
+	int low = cursor, high = _numEntries;
 	while (high > low + 1) {
 		int mid = (low + high) / 2;
 		if (_entries[mid]._frame <= frame)
@@ -277,6 +286,15 @@ void KeyframeAnim::KeyframeNode::animate(ModelNode &node, float frame, float fad
 		else
 			high = mid;
 	}
+	return low;
+}
+
+void KeyframeAnim::KeyframeNode::animate(ModelNode &node, float frame, float fade, bool useDelta, int *cursor) const {
+	if (_numEntries == 0)
+		return;
+
+	int low = findEntry(frame, *cursor);
+	*cursor = low;
 
 	float dt = frame - _entries[low]._frame;
 	Math::Vector3d pos = _entries[low]._pos;
@@ -44,10 +44,17 @@ public:
 	void loadBinary(Common::SeekableReadStream *data);
 	void loadText(TextSplitter &ts);
 	bool isNodeAnimated(ModelNode *nodes, int num, float time, bool tagged) const;
-	void animate(ModelNode *nodes, int num, float time, float fade, bool tagged) const;
+	/**
+	 * Apply the animation to the node num.
+	 *
+	 * @param cursors Per-joint keyframe cursors owned by the caller, see getNumJoints().
+	 *                They must be zero-initialized and are updated on each call.
+	 */
+	void animate(ModelNode *nodes, int num, float time, float fade, bool tagged, int *cursors) const;
 	int getMarker(float startTime, float stopTime) const;
 
 	float getLength() const { return _numFrames / _fps; }
+	int getNumJoints() const { return _numJoints; }
 	const Common::String &getFilename() const { return _fname; }
 
 private:
@@ -84,7 +91,8 @@ private:
 		void loadText(TextSplitter &ts);
 		~KeyframeNode();
 
-		void animate(ModelNode &node, float frame, float fade, bool useDelta) const;
+		void animate(ModelNode &node, float frame, float fade, bool useDelta, int *cursor) const;
+		int findEntry(float frame, int cursor) const;
 
 		char _meshName[32];
 		int _numEntries;
@@ -41,12 +41,15 @@ public:
 	LabEntry(const Common::String &name, uint32 offset, uint32 len, Lab *parent);
 	Common::String getName() const override { return _name; }
 	Common::SeekableReadStream *createReadStream() const override;
+	uint32 getOffset() const { return _offset; }
+	uint32 getSize() const { return _len; }
 	friend class Lab;
 };
 
 class Lab : public Common::Archive {
 public:
 	bool open(const Common::String &filename);
+	const Common::String &getFileName() const { return _labFileName; }
 
 	// Common::Archive implementation
 	virtual bool hasFile(const Common::String &name) const override;
@@ -20,6 +20,7 @@
  *
  */
 
+#include "common/config-manager.h"
 #include "common/endian.h"
 #include "common/foreach.h"
 #include "common/system.h"
@@ -44,6 +45,7 @@
 #include "engines/grim/primitives.h"
 
 #include "engines/grim/lua/lauxlib.h"
+#include "engines/grim/lua/lcache.h"
 #include "engines/grim/lua/luadebug.h"
 #include "engines/grim/lua/lualib.h"
 
@@ -103,21 +105,28 @@ void LuaObjects::pushObjects() const {
 	}
 }
 
+// system table fields updated every frame
+static lua_ConstString keyFrameTime = LUA_CONSTSTRING("frameTime");
+static lua_ConstString keyMovieTime = LUA_CONSTSTRING("movieTime");
 
 LuaBase *LuaBase::s_instance = nullptr;
 
 LuaBase::LuaBase() :
-		_translationMode(0), _frameTimeCollection(0) {
+		_translationMode(0), _frameTimeCollection(0), _gcStepBudget(1000) {
 	s_instance = this;
 
 	lua_iolibopen();
 	lua_strlibopen();
 	lua_mathlibopen();
+
+	// Loaded scripts are cached per target, to skip parsing them on the next launch
+	luaU_opencache(ConfMan.getActiveDomainName() + ".luacache");
 }
 
 LuaBase::~LuaBase() {
 	s_instance = nullptr;
 
+	luaU_closecache();
 	lua_removelibslists();
 	lua_close();
 	lua_iolibclose();
@@ -247,6 +256,7 @@ void LuaBase::registerOpcodes() {
 
 void LuaBase::loadSystemScript() {
 	dofile("_system.lua");
+	luaU_flushcache();
 }
 
 void LuaBase::boot() {
@@ -259,8 +269,9 @@ void LuaBase::update(int frameTime, int movieTime) {
 	_frameTimeCollection += frameTime;
 	if (_frameTimeCollection > 10000) {
 		_frameTimeCollection = 0;
-		lua_collectgarbage(0);
+		lua_startgarbage();
 	}
+	lua_stepgarbage(_gcStepBudget);
 
 	lua_beginblock();
 	setFrameTime(frameTime);
@@ -276,14 +287,14 @@ void LuaBase::update(int frameTime, int movieTime) {
 
 void LuaBase::setFrameTime(float frameTime) {
 	lua_pushobject(lua_getref(refSystemTable));
-	lua_pushstring("frameTime");
+	lua_pushconststring(&keyFrameTime);
 	lua_pushnumber(frameTime);
 	lua_settable();
 }
 
 void LuaBase::setMovieTime(float movieTime) {
 	lua_pushobject(lua_getref(refSystemTable));
-	lua_pushstring("movieTime");
+	lua_pushconststring(&keyMovieTime);
 	lua_pushnumber(movieTime);
 	lua_settable();
 }
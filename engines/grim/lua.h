@@ -116,6 +116,12 @@ public:
 	virtual void setTextObjectParams(TextObjectCommon *textObject, lua_Object tableObj);
 
 	void update(int frameTime, int movieTime);
+	/**
+	 * Set how many microseconds of garbage collection work update() may do
+	 * every frame.
+	 */
+	void setGCStepBudget(int budget) { _gcStepBudget = budget; }
+	int getGCStepBudget() const { return _gcStepBudget; }
 	void setFrameTime(float frameTime);
 	void setMovieTime(float movieTime);
 	virtual void registerLua();
@@ -161,6 +167,7 @@ private:
 	// 2 - return '/msgId/'
 	int _translationMode;
 	unsigned int _frameTimeCollection;
+	int _gcStepBudget;
 
 	int refSystemTable;
 	int refTypeOverride;
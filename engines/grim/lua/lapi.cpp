@@ -273,6 +273,12 @@ void lua_pushstring(const char *s) {
 	luaC_checkGC();
 }
 
+void lua_pushconststring(lua_ConstString *s) {
+	tsvalue(lua_state->stack.top) = luaS_newconst(s);
+	ttype(lua_state->stack.top) = LUA_T_STRING;
+	incr_top;
+}
+
 void lua_pushCclosure(lua_CFunction fn, int32 n) {
 	if (!fn)
 		lua_error("API error - attempt to push a NULL Cfunction");
@@ -0,0 +1,542 @@
+/*
+** Persistent cache of loaded chunks
+** See Copyright Notice in lua.h
+*/
+
+#define FORBIDDEN_SYMBOL_EXCEPTION_setjmp
+#define FORBIDDEN_SYMBOL_EXCEPTION_longjmp
+
+#include "common/endian.h"
+#include "common/hash-str.h"
+#include "common/hashmap.h"
+#include "common/md5.h"
+#include "common/memstream.h"
+#include "common/savefile.h"
+#include "common/system.h"
+
+#include "engines/grim/debug.h"
+
+#include "engines/grim/lua/lcache.h"
+#include "engines/grim/lua/lauxlib.h"
+#include "engines/grim/lua/lfunc.h"
+#include "engines/grim/lua/lmem.h"
+#include "engines/grim/lua/lopcodes.h"
+#include "engines/grim/lua/lstring.h"
+#include "engines/grim/lua/lvm.h"
+
+namespace Grim {
+
+/*
+** The cache maps a script (by name, size and MD5 of its source) to the
+** chunks it loaded, after parsing or undumping and opcode fusion. A chunk
+** is stored as:
+**   uint32 nstrings, nstrings * { uint32 hash, uint16 len, char[len] }, function
+** and a function as:
+**   int32 lineDefined, int32 fileName, uint32 codesize, byte[codesize] code,
+**   uint32 nconsts, nconsts * { int8 type, float | int32 string | function },
+**   int32 nlocvars (-1 if none), nlocvars * { int32 line, int32 varname }
+** Strings are referenced by index, -1 meaning NULL, and are interned once
+** per chunk with their stored hash, so the file header records the hash
+** of a probe string to detect a change of the hash function. All values
+** are little endian. Each entry also records the MD5 of its chunks; an
+** entry that doesn't match it is dropped, and the script parsed again.
+*/
+
+#define LUA_CACHE_VERSION	3
+#define LUA_CACHE_PROBE		"_system.lua, a probe longer than the sampling threshold"
+
+struct CacheEntry {
+	uint32 size;
+	byte md5[16];
+	byte chunksMD5[16];  // of the chunks, to catch a damaged file
+	bool checked;
+	Common::Array<byte> chunks;
+};
+
+typedef Common::HashMap<Common::String, CacheEntry> CacheMap;
+
+static CacheMap *cache = nullptr;
+static Common::String cacheFileName;
+static bool cacheDirty = false;
+
+void luaU_opencache(const Common::String &filename) {
+	luaU_closecache();
+	cache = new CacheMap();
+	cacheFileName = filename;
+	cacheDirty = false;
+
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(filename);
+	if (!file)
+		return;
+
+	bool ok = file->readUint32BE() == MKTAG('L', 'U', 'A', 'C') && file->readUint32LE() == LUA_CACHE_VERSION &&
+	          file->readUint32LE() == NUM_OPCODES && file->readUint32LE() == luaS_hash(LUA_CACHE_PROBE);
+	uint32 count = file->readUint32LE();
+	for (uint32 i = 0; ok && i < count; i++) {
+		uint16 len = file->readUint16LE();
+		char *name = new char[len + 1];
+		file->read(name, len);
+		name[len] = 0;
+		CacheEntry &entry = (*cache)[name];
+		delete[] name;
+		entry.size = file->readUint32LE();
+		file->read(entry.md5, sizeof(entry.md5));
+		file->read(entry.chunksMD5, sizeof(entry.chunksMD5));
+		entry.checked = false;
+		uint32 dataSize = file->readUint32LE();
+		if (file->eos() || file->err() || dataSize > (uint32)(file->size() - file->pos())) {
+			ok = false;
+			break;
+		}
+		entry.chunks.resize(dataSize);
+		if (dataSize)
+			file->read(&entry.chunks[0], dataSize);
+	}
+	if (!ok || file->err()) {
+		Debug::warning(Debug::Lua, "Discarding invalid Lua chunk cache %s", filename.c_str());
+		cache->clear();
+	}
+	delete file;
+}
+
+void luaU_flushcache() {
+	if (!cache || !cacheDirty)
+		return;
+
+	Common::OutSaveFile *file = g_system->getSavefileManager()->openForSaving(cacheFileName, false);
+	if (!file) {
+		Debug::warning(Debug::Lua, "Cannot write Lua chunk cache %s", cacheFileName.c_str());
+		return;
+	}
+	file->writeUint32BE(MKTAG('L', 'U', 'A', 'C'));
+	file->writeUint32LE(LUA_CACHE_VERSION);
+	file->writeUint32LE(NUM_OPCODES);
+	file->writeUint32LE(luaS_hash(LUA_CACHE_PROBE));
+	file->writeUint32LE(cache->size());
+	for (CacheMap::const_iterator i = cache->begin(); i != cache->end(); ++i) {
+		file->writeUint16LE(i->_key.size());
+		file->write(i->_key.c_str(), i->_key.size());
+		file->writeUint32LE(i->_value.size);
+		file->write(i->_value.md5, sizeof(i->_value.md5));
+		file->write(i->_value.chunksMD5, sizeof(i->_value.chunksMD5));
+		file->writeUint32LE(i->_value.chunks.size());
+		if (!i->_value.chunks.empty())
+			file->write(&i->_value.chunks[0], i->_value.chunks.size());
+	}
+	file->finalize();
+	if (file->err())
+		Debug::warning(Debug::Lua, "Error writing Lua chunk cache %s", cacheFileName.c_str());
+	delete file;
+	cacheDirty = false;
+}
+
+void luaU_closecache() {
+	luaU_flushcache();
+	delete cache;
+	cache = nullptr;
+}
+
+bool luaU_cacheenabled() {
+	return cache != nullptr;
+}
+
+void luaU_cachekey(LuaCacheKey *key, const char *name, const char *buff, int32 size) {
+	key->name = name;
+	key->size = size;
+	Common::MemoryReadStream stream((const byte *)buff, size);
+	Common::computeStreamMD5(stream, key->md5);
+}
+
+static void chunksMD5(const Common::Array<byte> &chunks, byte *md5) {
+	Common::MemoryReadStream stream(chunks.empty() ? nullptr : &chunks[0], chunks.size());
+	Common::computeStreamMD5(stream, md5);
+}
+
+bool luaU_findcached(const LuaCacheKey &key, Common::Array<byte> &chunks) {
+	if (!cache)
+		return false;
+	CacheMap::iterator i = cache->find(key.name);
+	if (i == cache->end() || i->_value.size != key.size || memcmp(i->_value.md5, key.md5, sizeof(key.md5)) != 0)
+		return false;
+	CacheEntry &entry = i->_value;
+	if (!entry.checked) {
+		byte md5[16];
+		chunksMD5(entry.chunks, md5);
+		if (memcmp(md5, entry.chunksMD5, sizeof(md5)) != 0) {
+			cache->erase(i);
+			cacheDirty = true;
+			return false;
+		}
+		entry.checked = true;
+	}
+	chunks = entry.chunks;
+	return true;
+}
+
+void luaU_storecached(const LuaCacheKey &key, const Common::Array<byte> &chunks) {
+	if (!cache)
+		return;
+	CacheEntry &entry = (*cache)[key.name];
+	entry.size = key.size;
+	memcpy(entry.md5, key.md5, sizeof(key.md5));
+	chunksMD5(chunks, entry.chunksMD5);
+	entry.checked = true;
+	entry.chunks = chunks;
+	cacheDirty = true;
+}
+
+/*
+** Dumping
+*/
+
+struct TaggedStringHash {
+	uint operator()(const TaggedString *ts) const { return ts->hash; }
+};
+
+typedef Common::HashMap<TaggedString *, int32, TaggedStringHash> StringIndex;
+
+static byte *reserve(Common::Array<byte> &out, uint32 n) {
+	uint32 old = out.size();
+	out.resize(old + n);
+	return &out[old];
+}
+
+static void DumpInt(Common::Array<byte> &out, int32 v) {
+	WRITE_LE_UINT32(reserve(out, 4), v);
+}
+
+static void DumpBlock(Common::Array<byte> &out, const void *b, uint32 size) {
+	if (size)
+		memcpy(reserve(out, size), b, size);
+}
+
+static void AddString(TaggedString *ts, StringIndex &index, Common::Array<TaggedString *> &strings) {
+	if (ts && !index.contains(ts)) {
+		index[ts] = strings.size();
+		strings.push_back(ts);
+	}
+}
+
+static bool CollectStrings(TProtoFunc *tf, StringIndex &index, Common::Array<TaggedString *> &strings) {
+	AddString(tf->fileName, index, strings);
+	for (int32 i = 0; i < tf->nconsts; i++) {
+		TObject *o = tf->consts + i;
+		switch (ttype(o)) {
+		case LUA_T_NUMBER:
+			break;
+		case LUA_T_STRING:
+			AddString(tsvalue(o), index, strings);
+			break;
+		case LUA_T_PROTO:
+			if (!tfvalue(o) || !CollectStrings(tfvalue(o), index, strings))
+				return false;
+			break;
+		default:
+			return false;
+		}
+	}
+	if (tf->locvars) {
+		for (LocVar *v = tf->locvars; v->line != -1; v++)
+			AddString(v->varname, index, strings);
+	}
+	return true;
+}
+
+static int32 StringRef(TaggedString *ts, const StringIndex &index) {
+	return ts ? index.getVal(ts) : -1;
+}
+
+static void DumpFunction(Common::Array<byte> &out, TProtoFunc *tf, const StringIndex &index) {
+	DumpInt(out, tf->lineDefined);
+	DumpInt(out, StringRef(tf->fileName, index));
+
+	const byte *p = tf->code + 2;
+	int32 opcode;
+	do {
+		opcode = *p;
+		p += luaV_opcodeSize[opcode];
+	} while (opcode != ENDCODE);
+	uint32 codeSize = p - tf->code;
+	DumpInt(out, codeSize);
+	DumpBlock(out, tf->code, codeSize);
+
+	DumpInt(out, tf->nconsts);
+	for (int32 i = 0; i < tf->nconsts; i++) {
+		TObject *o = tf->consts + i;
+		*reserve(out, 1) = (byte)(int8)ttype(o);
+		switch (ttype(o)) {
+		case LUA_T_NUMBER: {
+			float f = nvalue(o);
+			uint32 bits;
+			memcpy(&bits, &f, sizeof(bits));
+			DumpInt(out, bits);
+			break;
+		}
+		case LUA_T_STRING:
+			DumpInt(out, StringRef(tsvalue(o), index));
+			break;
+		default:
+			DumpFunction(out, tfvalue(o), index);
+			break;
+		}
+	}
+
+	if (!tf->locvars) {
+		DumpInt(out, -1);
+	} else {
+		int32 n = 0;
+		while (tf->locvars[n].line != -1)
+			n++;
+		DumpInt(out, n);
+		for (int32 i = 0; i < n; i++) {
+			DumpInt(out, tf->locvars[i].line);
+			DumpInt(out, StringRef(tf->locvars[i].varname, index));
+		}
+	}
+}
+
+bool luaU_dumpchunk(Common::Array<byte> &chunks, TProtoFunc *tf) {
+	StringIndex index;
+	Common::Array<TaggedString *> strings;
+	if (!CollectStrings(tf, index, strings))
+		return false;
+
+	DumpInt(chunks, strings.size());
+	for (uint32 i = 0; i < strings.size(); i++) {
+		uint32 len = strlen(strings[i]->str);
+		DumpInt(chunks, strings[i]->hash);
+		WRITE_LE_UINT16(reserve(chunks, 2), len);
+		DumpBlock(chunks, strings[i]->str, len);
+	}
+	DumpFunction(chunks, tf, index);
+	return true;
+}
+
+/*
+** Checking. An entry is checked as a whole before any of its chunks is
+** loaded, so a corrupted or stale entry can't leave a script half run.
+*/
+
+#define MAX_NESTING	200  // of functions in a chunk
+
+struct ChunkChecker {
+	const byte *pos;
+	const byte *end;
+	int32 nstrings;
+};
+
+static const byte *CheckNeed(ChunkChecker *c, uint32 n) {
+	if ((uint32)(c->end - c->pos) < n)
+		return nullptr;
+	const byte *p = c->pos;
+	c->pos += n;
+	return p;
+}
+
+static bool CheckInt(ChunkChecker *c, int32 *v) {
+	const byte *p = CheckNeed(c, 4);
+	if (!p)
+		return false;
+	*v = (int32)READ_LE_UINT32(p);
+	return true;
+}
+
+static bool CheckString(ChunkChecker *c) {
+	int32 i;
+	return CheckInt(c, &i) && i >= -1 && i < c->nstrings;
+}
+
+static bool CheckCode(const byte *code, uint32 codeSize) {
+	uint32 pc = 2;
+	while (pc < codeSize) {
+		byte opcode = code[pc];
+		if (opcode >= NUM_OPCODES)
+			return false;
+		pc += luaV_opcodeSize[opcode];
+		if (opcode == ENDCODE)
+			return pc == codeSize;
+	}
+	return false;
+}
+
+static bool CheckFunction(ChunkChecker *c, int32 depth) {
+	int32 lineDefined, codeSize, nconsts, nlocvars;
+	if (depth > MAX_NESTING || !CheckInt(c, &lineDefined) || !CheckString(c) || !CheckInt(c, &codeSize) || codeSize < 0)
+		return false;
+	const byte *code = CheckNeed(c, codeSize);
+	if (!code || !CheckCode(code, codeSize))
+		return false;
+
+	if (!CheckInt(c, &nconsts) || nconsts < 0)
+		return false;
+	for (int32 i = 0; i < nconsts; i++) {
+		const byte *type = CheckNeed(c, 1);
+		if (!type)
+			return false;
+		int32 v;
+		switch ((int8)*type) {
+		case LUA_T_NUMBER:
+			if (!CheckInt(c, &v))
+				return false;
+			break;
+		case LUA_T_STRING:
+			if (!CheckString(c))
+				return false;
+			break;
+		case LUA_T_PROTO:
+			if (!CheckFunction(c, depth + 1))
+				return false;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	if (!CheckInt(c, &nlocvars) || nlocvars < -1 || (nlocvars > 0 && (uint32)nlocvars > (uint32)(c->end - c->pos) / 8))
+		return false;
+	for (int32 i = 0; i < nlocvars; i++) {
+		int32 line;
+		if (!CheckInt(c, &line) || !CheckString(c))
+			return false;
+	}
+	return true;
+}
+
+bool luaU_checkchunks(const byte *pos, const byte *end, int32 *maxStrings) {
+	ChunkChecker c;
+	c.pos = pos;
+	c.end = end;
+	*maxStrings = 0;
+	while (c.pos != c.end) {
+		int32 nstrings;
+		if (!CheckInt(&c, &nstrings) || nstrings < 0 || (uint32)nstrings > (uint32)(c.end - c.pos) / 6)
+			return false;
+		for (int32 i = 0; i < nstrings; i++) {
+			const byte *header = CheckNeed(&c, 4 + 2);
+			if (!header)
+				return false;
+			uint16 len = READ_LE_UINT16(header + 4);
+			const char *str = (const char *)CheckNeed(&c, len);
+			// The stored hash is trusted: the chunks passed their MD5 check and
+			// the header probe ruled out a change of the hash function.
+			if (!str || memchr(str, 0, len))
+				return false;
+		}
+		c.nstrings = nstrings;
+		if (!CheckFunction(&c, 0))
+			return false;
+		*maxStrings = MAX(*maxStrings, nstrings);
+	}
+	return true;
+}
+
+/*
+** Loading
+*/
+
+struct ChunkReader {
+	const byte *pos;
+	const byte *end;
+	TaggedString **strings;
+	int32 nstrings;
+};
+
+static const byte *Need(ChunkReader *r, uint32 n) {
+	if ((uint32)(r->end - r->pos) < n)
+		luaL_verror("corrupted entry in the Lua chunk cache");
+	const byte *p = r->pos;
+	r->pos += n;
+	return p;
+}
+
+static int32 LoadInt(ChunkReader *r) {
+	return (int32)READ_LE_UINT32(Need(r, 4));
+}
+
+static TaggedString *LoadString(ChunkReader *r) {
+	int32 i = LoadInt(r);
+	if (i < -1 || i >= r->nstrings)
+		luaL_verror("corrupted entry in the Lua chunk cache");
+	return i == -1 ? nullptr : r->strings[i];
+}
+
+static TProtoFunc *LoadFunction(ChunkReader *r) {
+	TProtoFunc *tf = luaF_newproto();
+	tf->lineDefined = LoadInt(r);
+	tf->fileName = LoadString(r);
+
+	uint32 codeSize = LoadInt(r);
+	const byte *code = Need(r, codeSize);
+	tf->code = (byte *)luaM_malloc(codeSize);
+	memcpy(tf->code, code, codeSize);
+
+	int32 nconsts = LoadInt(r);
+	if (nconsts < 0)
+		luaL_verror("corrupted entry in the Lua chunk cache");
+	if (nconsts) {
+		tf->consts = luaM_newvector(nconsts, TObject);
+		tf->nconsts = nconsts;
+	}
+	for (int32 i = 0; i < nconsts; i++) {
+		TObject *o = tf->consts + i;
+		int8 type = (int8)*Need(r, 1);
+		switch (type) {
+		case LUA_T_NUMBER: {
+			uint32 bits = LoadInt(r);
+			float f;
+			memcpy(&f, &bits, sizeof(f));
+			nvalue(o) = f;
+			break;
+		}
+		case LUA_T_STRING:
+			tsvalue(o) = LoadString(r);
+			break;
+		case LUA_T_PROTO:
+			tfvalue(o) = LoadFunction(r);
+			break;
+		default:
+			luaL_verror("corrupted entry in the Lua chunk cache");
+		}
+		ttype(o) = (lua_Type)type;
+	}
+
+	int32 nlocvars = LoadInt(r);
+	if (nlocvars >= 0) {
+		tf->locvars = luaM_newvector(nlocvars + 1, LocVar);
+		for (int32 i = 0; i < nlocvars; i++) {
+			tf->locvars[i].line = LoadInt(r);
+			tf->locvars[i].varname = LoadString(r);
+		}
+		tf->locvars[nlocvars].line = -1;  // flag end of vector
+		tf->locvars[nlocvars].varname = nullptr;
+	}
+	return tf;
+}
+
+TProtoFunc *luaU_loadchunk(const byte *&pos, const byte *end, TaggedString **strings) {
+	if (pos == end)
+		return nullptr;
+
+	ChunkReader r;
+	r.pos = pos;
+	r.end = end;
+	r.strings = strings;
+	r.nstrings = 0;
+
+	int32 nstrings = LoadInt(&r);
+	for (int32 i = 0; i < nstrings; i++) {
+		uint32 h = LoadInt(&r);
+		uint16 len = READ_LE_UINT16(Need(&r, 2));
+		char *s = luaL_openspace(len + 1);
+		memcpy(s, Need(&r, len), len);
+		s[len] = 0;
+		strings[i] = luaS_newhashed(s, h);
+	}
+	r.nstrings = nstrings;
+
+	TProtoFunc *tf = LoadFunction(&r);
+	pos = r.pos;
+	return tf;
+}
+
+} // end of namespace Grim
@@ -0,0 +1,39 @@
+/*
+** Persistent cache of loaded chunks
+** See Copyright Notice in lua.h
+*/
+
+#ifndef GRIM_LCACHE_H
+#define GRIM_LCACHE_H
+
+#include "common/array.h"
+#include "common/str.h"
+
+#include "engines/grim/lua/lobject.h"
+
+namespace Grim {
+
+struct LuaCacheKey {
+	Common::String name;
+	uint32 size;
+	byte md5[16];
+};
+
+void luaU_opencache(const Common::String &filename);
+void luaU_flushcache();
+void luaU_closecache();
+bool luaU_cacheenabled();
+
+void luaU_cachekey(LuaCacheKey *key, const char *name, const char *buff, int32 size);
+bool luaU_findcached(const LuaCacheKey &key, Common::Array<byte> &chunks);
+void luaU_storecached(const LuaCacheKey &key, const Common::Array<byte> &chunks);
+
+bool luaU_dumpchunk(Common::Array<byte> &chunks, TProtoFunc *tf);  // append one chunk
+// Checks all the chunks of an entry, and returns how many strings the largest one has.
+bool luaU_checkchunks(const byte *pos, const byte *end, int32 *maxStrings);
+// Loads one chunk of a checked entry, nullptr at end; strings must hold maxStrings entries.
+TProtoFunc *luaU_loadchunk(const byte *&pos, const byte *end, TaggedString **strings);
+
+} // end of namespace Grim
+
+#endif
@@ -13,7 +13,10 @@
 #pragma warning(disable:4611)
 #endif
 
+#include "engines/grim/debug.h"
+
 #include "engines/grim/lua/ldo.h"
+#include "engines/grim/lua/lcache.h"
 #include "engines/grim/lua/lfunc.h"
 #include "engines/grim/lua/lgc.h"
 #include "engines/grim/lua/lmem.h"
@@ -376,10 +379,17 @@ int32 luaD_protectedrun(int32 nResults) {
 	return status;
 }
 
+static void pushchunk(TProtoFunc *tf) {
+	luaD_adjusttop(lua_state->Cstack.base + 1);  // one slot for the pseudo-function
+	lua_state->stack.stack[lua_state->Cstack.base].ttype = LUA_T_PROTO;
+	lua_state->stack.stack[lua_state->Cstack.base].value.tf = tf;
+	luaV_closure(0);
+}
+
 /*
 ** returns 0 = chunk loaded; 1 = error; 2 = no more chunks to load
 */
-static int32 protectedparser(ZIO *z, int32 bin) {
+static int32 protectedparser(ZIO *z, int32 bin, TProtoFunc **chunk) {
 	int32 status;
 	TProtoFunc *tf;
 	jmp_buf myErrorJmp;
@@ -397,32 +407,98 @@ static int32 protectedparser(ZIO *z, int32 bin) {
 		return 1;  // error code
 	if (tf == nullptr)
 		return 2;  // 'natural' end
-	luaD_adjusttop(lua_state->Cstack.base + 1);  // one slot for the pseudo-function
-	lua_state->stack.stack[lua_state->Cstack.base].ttype = LUA_T_PROTO;
-	lua_state->stack.stack[lua_state->Cstack.base].value.tf = tf;
-	luaV_closure(0);
+	pushchunk(tf);
+	*chunk = tf;
 	return 0;
 }
 
-static int32 do_main(ZIO *z, int32 bin) {
+/*
+** same as protectedparser, for chunks taken from the chunk cache
+*/
+static int32 protectedload(const byte **pos, const byte *end, TaggedString **strings) {
+	int32 status;
+	TProtoFunc *tf;
+	jmp_buf myErrorJmp;
+	jmp_buf *oldErr = lua_state->errorJmp;
+	lua_state->errorJmp = &myErrorJmp;
+	if (setjmp(myErrorJmp) == 0) {
+		tf = luaU_loadchunk(*pos, end, strings);
+		status = 0;
+	} else {
+		tf = nullptr;
+		status = 1;
+	}
+	lua_state->errorJmp = oldErr;
+	if (status)
+		return 1;  // error code
+	if (tf == nullptr)
+		return 2;  // 'natural' end
+	pushchunk(tf);
+	return 0;
+}
+
+static int32 runchunk(int32 old_blocks) {
+	int32 newelems2 = 2 * (nblocks - old_blocks);
+	GCthreshold += newelems2;
+	int32 status = luaD_protectedrun(MULT_RET);
+	GCthreshold -= newelems2;
+	return status;
+}
+
+/*
+** Parses and runs the chunks in z. If dump is given, each chunk is also
+** appended to it for the chunk cache before it runs; it's left empty if
+** some chunk can't be cached.
+*/
+static int32 do_main(ZIO *z, int32 bin, Common::Array<byte> *dump) {
 	int32 status;
 	do {
 		int32 old_blocks = (luaC_checkGC(), nblocks);
-		status = protectedparser(z, bin);
+		TProtoFunc *tf;
+		status = protectedparser(z, bin, &tf);
 		if (status == 1)
 			return 1;  // error
 		else if (status == 2)
 			return 0;  // 'natural' end
 		else {
-			int32 newelems2 = 2 * (nblocks - old_blocks);
-			GCthreshold += newelems2;
-			status = luaD_protectedrun(MULT_RET);
-			GCthreshold -= newelems2;
+			if (dump && !luaU_dumpchunk(*dump, tf)) {
+				dump->clear();  // not cacheable
+				dump = nullptr;
+			}
+			status = runchunk(old_blocks);
 		}
 	} while (bin && status == 0);
 	return status;
 }
 
+/*
+** Runs the chunks of a chunk cache entry. Returns -1 without running
+** anything if the entry is corrupted, so the caller can parse the source
+** instead.
+*/
+static int32 do_cached(const Common::Array<byte> &chunks) {
+	const byte *pos = &chunks[0];
+	const byte *end = pos + chunks.size();
+	int32 maxStrings;
+	if (!luaU_checkchunks(pos, end, &maxStrings))
+		return -1;
+	// Owned here, so that it's freed even if loading a chunk fails.
+	Common::Array<TaggedString *> strings;
+	strings.resize(maxStrings + 1);
+	int32 status;
+	do {
+		int32 old_blocks = (luaC_checkGC(), nblocks);
+		status = protectedload(&pos, end, &strings[0]);
+		if (status == 1)
+			return 1;  // error
+		else if (status == 2)
+			return 0;  // 'natural' end
+		else
+			status = runchunk(old_blocks);
+	} while (status == 0);
+	return status;
+}
+
 void luaD_gcIM(TObject *o) {
 	TObject *im = luaT_getimbyObj(o, IM_GC);
 	if (ttype(im) != LUA_T_NIL) {
@@ -462,8 +538,27 @@ int32 lua_dobuffer(const char *buff, int32 size, const char *name) {
 		build_name(buff, newname);
 		name = newname;
 	}
+	if (name != newname && size > 0 && luaU_cacheenabled()) {
+		LuaCacheKey key;
+		luaU_cachekey(&key, name, buff, size);
+		Common::Array<byte> chunks;
+		if (luaU_findcached(key, chunks) && !chunks.empty()) {
+			status = do_cached(chunks);
+			if (status != -1)
+				return status;
+			Debug::warning(Debug::Lua, "Ignoring corrupted Lua chunk cache entry for %s", name);
+			chunks.clear();
+		}
+
+		luaZ_mopen(&z, buff, size, name);
+		status = do_main(&z, buff[0] == ID_CHUNK, &chunks);
+		if (status == 0 && !chunks.empty())
+			luaU_storecached(key, chunks);
+		return status;
+	}
+
 	luaZ_mopen(&z, buff, size, name);
-	status = do_main(&z, buff[0] == ID_CHUNK);
+	status = do_main(&z, buff[0] == ID_CHUNK, nullptr);
 	return status;
 }
 
@@ -6,6 +6,9 @@
 #define FORBIDDEN_SYMBOL_EXCEPTION_setjmp
 #define FORBIDDEN_SYMBOL_EXCEPTION_longjmp
 
+#include "common/system.h"
+#include "common/util.h"
+
 #include "engines/grim/lua/ldo.h"
 #include "engines/grim/lua/lfunc.h"
 #include "engines/grim/lua/lgc.h"
@@ -21,6 +24,9 @@ namespace Grim {
 
 static int32 markobject (TObject *o);
 
+// Units of work done by the collector, counted in objects and slots visited.
+static int32 gcWork = 0;
+
 /*
 ** =======================================================
 ** REF mechanism
@@ -129,66 +135,96 @@ void luaC_strcallIM(TaggedString *l) {
 	}
 }
 
-static GCnode *listcollect(GCnode *l) {
-	GCnode *frees = nullptr;
-	while (l) {
-		GCnode *next = l->next;
-		l->marked = 0;
-		while (next && !next->marked) {
-			l->next = next->next;
-			next->next = frees;
-			frees = next;
-			next = l->next;
-		}
-		l = next;
-	}
-	return frees;
-}
-
 static void strmark(TaggedString *s) {
 	if (!s->head.marked)
 		s->head.marked = 1;
 }
 
+/*
+** =======================================================
+** Incremental collector
+** =======================================================
+** Tables, closures and protos are white (unmarked), gray (marked and waiting
+** in the gray list to have their children marked) or black (marked along with
+** their children). Strings have no children, so they go straight to black.
+** The mark phase is spread over several steps; since the stacks, the global
+** values, the locked refs and the tag methods are not covered by a barrier,
+** they are marked again in the final, atomic step, before sweeping.
+** Tables are the only objects that can be changed after creation, and
+** luaH_set turns a black table gray again before it is written to.
+**
+** The sweep is spread over steps as well. The final mark step takes the
+** table, proto and closure lists off their roots. Each sweep step then moves
+** a slice of their nodes back to the roots, or to a list of garbage that is
+** freed once the sweep is over. Objects created meanwhile go straight to the
+** roots, so the sweep never sees them. The string tables are swept in place
+** by luaS_sweepstep().
+*/
+
+struct GrayObject {
+	lua_Type type;
+	GCnode *node;
+};
+
+static GrayObject *grayList = nullptr;
+static int32 grayCount = 0;
+static int32 graySize = 0;
+static bool gcRunning = false;  // marking
+static bool gcSweeping = false;
+
+// Amount of collector work done per millisecond, refined while collecting,
+// used to turn step budgets into an amount of work.
+static int32 gcWorkRate = 5000;
+static int32 gcRateWork = 0;
+static uint32 gcRateTime = 0;
+
+static lua_GCStats gcStats;
+
+static void graymark(lua_Type type, GCnode *node) {
+	node->marked = GC_GRAY;
+	if (grayCount >= graySize)
+		graySize = luaM_growvector(&grayList, graySize, GrayObject, memEM, MAX_INT);
+	grayList[grayCount].type = type;
+	grayList[grayCount].node = node;
+	grayCount++;
+}
+
 static void protomark(TProtoFunc *f) {
-	if (!f->head.marked) {
-		LocVar *v = f->locvars;
-		int32 i;
-		f->head.marked = 1;
-		if (f->fileName)
-			strmark(f->fileName);
-		for (i = 0; i < f->nconsts; i++)
-			markobject(&f->consts[i]);
-		if (v) {
-			for (; v->line != -1; v++) {
-				if (v->varname)
-					strmark(v->varname);
-			}
+	LocVar *v = f->locvars;
+	int32 i;
+	f->head.marked = GC_BLACK;
+	if (f->fileName)
+		strmark(f->fileName);
+	for (i = 0; i < f->nconsts; i++)
+		markobject(&f->consts[i]);
+	gcWork += f->nconsts;
+	if (v) {
+		for (; v->line != -1; v++) {
+			if (v->varname)
+				strmark(v->varname);
 		}
 	}
 }
 
 static void closuremark(Closure *f) {
-	if (!f->head.marked) {
-		int32 i;
-		f->head.marked = 1;
-		for (i = f->nelems; i >= 0; i--)
-			markobject(&f->consts[i]);
-	}
+	int32 i;
+	f->head.marked = GC_BLACK;
+	for (i = f->nelems; i >= 0; i--)
+		markobject(&f->consts[i]);
+	gcWork += f->nelems + 1;
 }
 
 static void hashmark(Hash *h) {
-	if (!h->head.marked) {
-		int32 i;
-		h->head.marked = 1;
-		for (i = 0; i < nhash(h); i++) {
-			Node *n = node(h, i);
-			if (ttype(ref(n)) != LUA_T_NIL) {
-				markobject(&n->ref);
-				markobject(&n->val);
-			}
+	int32 i;
+	h->head.marked = GC_BLACK;
+	for (i = 0; i < nhash(h); i++) {
+		Node *n = node(h, i);
+		if (ttype(ref(n)) != LUA_T_NIL) {
+			markobject(&n->ref);
+			markobject(&n->val);
 		}
 	}
+	gcWork += nhash(h);
 }
 
 static void globalmark() {
@@ -207,15 +243,18 @@ static int32 markobject(TObject *o) {
 		strmark(tsvalue(o));
 		break;
 	case LUA_T_ARRAY:
-		hashmark(avalue(o));
+		if (!avalue(o)->head.marked)
+			graymark(LUA_T_ARRAY, &avalue(o)->head);
 		break;
 	case LUA_T_CLOSURE:
 	case LUA_T_CLMARK:
-		closuremark(o->value.cl);
+		if (!o->value.cl->head.marked)
+			graymark(LUA_T_CLOSURE, &o->value.cl->head);
 		break;
 	case LUA_T_PROTO:
 	case LUA_T_PMARK:
-		protomark(o->value.tf);
+		if (!o->value.tf->head.marked)
+			graymark(LUA_T_PROTO, &o->value.tf->head);
 		break;
 	default:
 		break;  // numbers, cprotos, etc
@@ -230,18 +269,117 @@ static void markall() {
 	luaT_travtagmethods(markobject);  // mark fallbacks
 }
 
-int32 lua_collectgarbage(int32 limit) {
-	int32 recovered = nblocks;  // to subtract nblocks after gc
-	Hash *freetable;
-	TaggedString *freestr;
-	TProtoFunc *freefunc;
-	Closure *freeclos;
+/*
+** Blacken gray objects until the gray list is empty or "limit" units of
+** work have been done. Returns true if the gray list was emptied.
+*/
+static bool propagatemark(int32 limit) {
+	while (grayCount > 0) {
+		if (limit >= 0 && gcWork >= limit)
+			return false;
+		GrayObject &gray = grayList[--grayCount];
+		GCnode *node = gray.node;
+		if (node->marked == GC_BLACK)
+			continue;
+		switch (gray.type) {
+		case LUA_T_ARRAY:
+			hashmark((Hash *)node);
+			break;
+		case LUA_T_CLOSURE:
+			closuremark((Closure *)node);
+			break;
+		case LUA_T_PROTO:
+			protomark((TProtoFunc *)node);
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+void luaC_barrier(Hash *t) {
+	// Only the mark phase needs it; while sweeping, black only means alive
+	if (gcRunning)
+		graymark(LUA_T_ARRAY, &t->head);
+}
+
+static void startcycle() {
+	gcRunning = true;
+	grayCount = 0;
 	markall();
-	invalidaterefs();
-	freestr = luaS_collector();
-	freetable = (Hash *)listcollect(&roottable);
-	freefunc = (TProtoFunc *)listcollect(&rootproto);
-	freeclos = (Closure *)listcollect(&rootcl);
+}
+
+struct SweepList {
+	GCnode *root;
+	GCnode *tail;  // last node moved back to root, or nullptr
+	GCnode *pending;  // nodes still to sweep
+	GCnode *frees;
+};
+
+static SweepList sweepLists[3];
+
+static void startsweep() {
+	GCnode *roots[3] = { &roottable, &rootproto, &rootcl };
+	for (int32 i = 0; i < 3; i++) {
+		SweepList &list = sweepLists[i];
+		list.root = roots[i];
+		list.tail = nullptr;
+		list.pending = roots[i]->next;
+		list.frees = nullptr;
+		roots[i]->next = nullptr;
+	}
+	luaS_startsweep();
+	gcSweeping = true;
+}
+
+static bool sweeplist(SweepList &list, int32 limit) {
+	while (list.pending) {
+		if (limit >= 0 && gcWork >= limit)
+			return false;
+		GCnode *node = list.pending;
+		list.pending = node->next;
+		if (node->marked) {
+			node->marked = GC_WHITE;
+			node->next = nullptr;
+			// New objects are only ever added at the front, so once found
+			// the tail stays the end of the list and the order is kept.
+			if (!list.tail) {
+				list.tail = list.root;
+				while (list.tail->next)
+					list.tail = list.tail->next;
+			}
+			list.tail->next = node;
+			list.tail = node;
+		} else {
+			node->next = list.frees;
+			list.frees = node;
+		}
+		gcWork++;
+	}
+	return true;
+}
+
+/*
+** Sweeps until everything is swept or "limit" units of work have been done.
+** Returns true if the sweep is over.
+*/
+static bool sweepstep(int32 limit) {
+	for (int32 i = 0; i < 3; i++) {
+		if (!sweeplist(sweepLists[i], limit))
+			return false;
+	}
+	return luaS_sweepstep(&gcWork, limit);
+}
+
+static int32 endsweep() {
+	int32 recovered = nblocks;  // to subtract nblocks after gc
+	Hash *freetable = (Hash *)sweepLists[0].frees;
+	TProtoFunc *freefunc = (TProtoFunc *)sweepLists[1].frees;
+	Closure *freeclos = (Closure *)sweepLists[2].frees;
+	TaggedString *freestr = luaS_endsweep();
+	gcSweeping = false;
+	gcStats.cycles++;
 	GCthreshold *= 4;  // to avoid GC during GC
 	luaC_hashcallIM(freetable);  // GC tag methods for tables
 	luaC_strcallIM(freestr);  // GC tag methods for userdata
@@ -251,13 +389,114 @@ int32 lua_collectgarbage(int32 limit) {
 	luaF_freeproto(freefunc);
 	luaF_freeclosure(freeclos);
 	recovered = recovered - nblocks;
+	return recovered;
+}
+
+// The final, atomic step of the mark phase.
+static void finishmark() {
+	markall();
+	propagatemark(-1);
+	gcRunning = false;
+	invalidaterefs();
+	startsweep();
+}
+
+void luaC_finishsweep() {
+	if (gcSweeping) {
+		sweepstep(-1);
+		endsweep();
+	}
+}
+
+// Converts an amount of collector work to microseconds, at the measured work rate.
+static uint32 worktime(int32 work) {
+	return (uint32)((int64)work * 1000 / gcWorkRate);
+}
+
+int32 lua_collectgarbage(int32 limit) {
+	uint32 startTime = g_system->getMillis();
+	gcWork = 0;
+	luaC_finishsweep();
+	if (!gcRunning)
+		startcycle();
+	finishmark();
+	sweepstep(-1);
+	int32 recovered = endsweep();
 	GCthreshold = (limit == 0) ? 2 * nblocks : nblocks + limit;
+	gcStats.fullCollections++;
+	gcStats.lastFullTime = g_system->getMillis() - startTime;
 	return recovered;
 }
 
+void lua_stepgarbage(int32 budget) {
+	if (!gcRunning && !gcSweeping)
+		return;
+
+	uint32 startTime = g_system->getMillis();
+	gcWork = 0;
+	int32 limit = MAX<int32>(1, (int32)((int64)budget * gcWorkRate / 1000));
+	bool finished = gcRunning ? propagatemark(limit) : sweepstep(limit);
+	int32 work = gcWork;
+	uint32 sliceEnd = g_system->getMillis();
+
+	// The clock only has millisecond resolution, so the rate is measured over
+	// many steps.
+	gcRateWork += work;
+	gcRateTime += sliceEnd - startTime;
+	if (gcRateTime >= 100) {
+		gcWorkRate = MAX<int32>(1, gcRateWork / gcRateTime);
+		gcRateWork = 0;
+		gcRateTime = 0;
+	}
+
+	if (finished && gcRunning) {
+		finishmark();
+		uint32 finishTime = g_system->getMillis() - sliceEnd;
+		gcStats.lastFinishTime = finishTime;
+		gcStats.maxFinishTime = MAX(gcStats.maxFinishTime, finishTime);
+	} else if (finished) {
+		endsweep();
+		GCthreshold = 2 * nblocks;
+	}
+	uint32 pause = g_system->getMillis() - startTime;
+	gcStats.steps++;
+	gcStats.lastStepWork = work;
+	gcStats.lastStepLimit = limit;
+	gcStats.lastStepTime = pause;
+	gcStats.maxStepTime = MAX(gcStats.maxStepTime, pause);
+	gcStats.lastStepEstimate = worktime(work);
+	gcStats.workRate = gcWorkRate;
+}
+
+void lua_startgarbage() {
+	if (!gcRunning && !gcSweeping)
+		startcycle();
+}
+
+void lua_getgcstats(lua_GCStats *stats) {
+	*stats = gcStats;
+	stats->running = gcRunning;
+	stats->sweeping = gcSweeping;
+}
+
 void luaC_checkGC() {
-	if (nblocks >= GCthreshold)
+	if (nblocks < GCthreshold)
+		return;
+	if (!gcRunning && !gcSweeping) {
+		startcycle();
+	} else if (nblocks - GCthreshold >= GCthreshold) {
+		// The incremental steps can't keep up with the allocations
 		lua_collectgarbage(0);
+	}
+}
+
+void luaC_resetGC() {
+	luaM_free(grayList);
+	grayList = nullptr;
+	grayCount = 0;
+	graySize = 0;
+	gcRunning = false;
+	gcSweeping = false;
 }
 
 } // end of namespace Grim
@@ -11,7 +11,15 @@
 
 namespace Grim {
 
+// Values of GCnode::marked for tables, closures and protos while collecting
+#define GC_WHITE	0
+#define GC_GRAY		1
+#define GC_BLACK	2
+
 void luaC_checkGC();
+void luaC_barrier(Hash *t);
+void luaC_finishsweep();
+void luaC_resetGC();
 TObject* luaC_getref(int32 r);
 int32 luaC_ref(TObject *o, int32 lock);
 void luaC_hashcallIM(Hash *l);
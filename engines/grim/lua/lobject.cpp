@@ -21,21 +21,15 @@ const char *luaO_typenames[] = { // ORDER LUA_T
 TObject luaO_nilobject = { LUA_T_NIL, { nullptr } };
 
 
-// hash dimensions values
-static int32 dimensions[] = {
-	5, 11, 23, 47, 97, 197, 397, 797, 1597, 3203, 6421,
-	12853, 25717, 51437, 102811, 205619, 411233, 822433,
-	1644817, 3289613, 6579211, 13158023, MAX_INT
-};
-
+// hash dimensions are powers of two, so that indexes are masked instead of divided
 int32 luaO_redimension(int32 oldsize) {
-	int32 i;
-	for (i = 0; dimensions[i] < MAX_INT; i++) {
-		if (dimensions[i] > oldsize)
-			return dimensions[i];
+	int32 size = 4;
+	while (size <= oldsize) {
+		if (size >= (1 << 30))
+			lua_error("table overflow");
+		size <<= 1;
 	}
-	lua_error("table overflow");
-	return 0;  // to avoid warnings
+	return size;
 }
 
 int32 luaO_equalObj(TObject *t1, TObject *t2) {
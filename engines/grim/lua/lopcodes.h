@@ -168,7 +168,31 @@ typedef enum {
 
 	POP,			//	b		-				-				TOP-=(b+1)
 	POP0,			//	-		-				-				TOP-=1
-	POP1			//	-		-				-				TOP-=2
+	POP1,			//	-		-				-				TOP-=2
+
+// Superinstructions, never emitted by the compiler: luaV_fuseopcodes writes
+// them over the first instruction of a pair, leaving the second one in place.
+	PUSHLOCALGETTABLE,		//	b		t				t[LOC[b]]  
+	PUSHLOCALGETTABLE0,		//	-		t				t[LOC[0]]  
+	PUSHLOCALGETTABLE1,		//	-		t				t[LOC[1]]  
+	PUSHLOCALGETTABLE2,		//	-		t				t[LOC[2]]  
+	PUSHLOCALGETTABLE3,		//	-		t				t[LOC[3]]  
+	PUSHLOCALGETTABLE4,		//	-		t				t[LOC[4]]  
+	PUSHLOCALGETTABLE5,		//	-		t				t[LOC[5]]  
+	PUSHLOCALGETTABLE6,		//	-		t				t[LOC[6]]  
+	PUSHLOCALGETTABLE7,		//	-		t				t[LOC[7]]  
+
+	PUSHLOCALGETDOTTED,		//	b		-				LOC[b][CNST[GETDOTTED]]  
+	PUSHLOCALGETDOTTED0,	//	-		-				LOC[0][CNST[GETDOTTED]]  
+	PUSHLOCALGETDOTTED1,	//	-		-				LOC[1][CNST[GETDOTTED]]  
+	PUSHLOCALGETDOTTED2,	//	-		-				LOC[2][CNST[GETDOTTED]]  
+	PUSHLOCALGETDOTTED3,	//	-		-				LOC[3][CNST[GETDOTTED]]  
+	PUSHLOCALGETDOTTED4,	//	-		-				LOC[4][CNST[GETDOTTED]]  
+	PUSHLOCALGETDOTTED5,	//	-		-				LOC[5][CNST[GETDOTTED]]  
+	PUSHLOCALGETDOTTED6,	//	-		-				LOC[6][CNST[GETDOTTED]]  
+	PUSHLOCALGETDOTTED7,	//	-		-				LOC[7][CNST[GETDOTTED]]  
+
+	NUM_OPCODES
 } OpCode;
 
 #define RFIELDS_PER_FLUSH 32	// records (SETMAP)
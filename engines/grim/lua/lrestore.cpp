@@ -3,6 +3,7 @@
 
 #include "common/endian.h"
 #include "common/debug.h"
+#include "common/textconsole.h"
 
 #include "engines/grim/savegame.h"
 
@@ -20,6 +21,16 @@
 
 namespace Grim {
 
+// Since minor version 26 objects are saved with dense ids instead of their addresses
+static bool denseIds = false;
+
+static void *restoreObjectId(SaveGame *savedState) {
+	PointerId ptr;
+	ptr.low = savedState->readLEUint32();
+	ptr.hi = denseIds ? 0 : savedState->readLEUint32();
+	return makePointerFromId(ptr);
+}
+
 static void restoreObjectValue(TObject *object, SaveGame *savedState) {
 	object->ttype = (lua_Type)savedState->readLESint32();
 
@@ -37,10 +48,7 @@ static void restoreObjectValue(TObject *object, SaveGame *savedState) {
 			break;
 		case LUA_T_ARRAY:
 			{
-				PointerId ptr;
-				ptr.low = savedState->readLEUint32();
-				ptr.hi = savedState->readLEUint32();
-				object->value.a = (Hash *)makePointerFromId(ptr);
+				object->value.a = (Hash *)restoreObjectId(savedState);
 			}
 			break;
 		case LUA_T_USERDATA:
@@ -55,28 +63,18 @@ static void restoreObjectValue(TObject *object, SaveGame *savedState) {
 			break;
 		case LUA_T_STRING:
 			{
-				PointerId ptr;
-				ptr.low = savedState->readLEUint32();
-				ptr.hi = savedState->readLEUint32();
-				object->value.ts = (TaggedString *)makePointerFromId(ptr);
+				object->value.ts = (TaggedString *)restoreObjectId(savedState);
 			}
 			break;
 		case LUA_T_PROTO:
 		case LUA_T_PMARK:
 			{
-				PointerId ptr;
-				ptr.low = savedState->readLEUint32();
-				ptr.hi = savedState->readLEUint32();
-				object->value.tf = (TProtoFunc *)makePointerFromId(ptr);
+				object->value.tf = (TProtoFunc *)restoreObjectId(savedState);
 			}
 			break;
 		case LUA_T_CPROTO:
 		case LUA_T_CMARK:
 			{
-				PointerId ptr;
-				ptr.low = savedState->readLEUint32();
-				ptr.hi = savedState->readLEUint32();
-
 				// WORKAROUND: C++ forbids casting from a pointer-to-function to a
 				// pointer-to-object. We use a union to work around that.
 				union {
@@ -84,17 +82,14 @@ static void restoreObjectValue(TObject *object, SaveGame *savedState) {
 					lua_CFunction funcPtr;
 				} ptrUnion;
 
-				ptrUnion.objPtr = makePointerFromId(ptr);
+				ptrUnion.objPtr = restoreObjectId(savedState);
 				object->value.f = ptrUnion.funcPtr;
 			}
 			break;
 		case LUA_T_CLOSURE:
 		case LUA_T_CLMARK:
 			{
-				PointerId ptr;
-				ptr.low = savedState->readLEUint32();
-				ptr.hi = savedState->readLEUint32();
-				object->value.cl = (Closure *)makePointerFromId(ptr);
+				object->value.cl = (Closure *)restoreObjectId(savedState);
 			}
 			break;
 		case LUA_T_LINE:
@@ -103,10 +98,7 @@ static void restoreObjectValue(TObject *object, SaveGame *savedState) {
 			}
 			break;
 		default:
-			PointerId ptr;
-			ptr.low = savedState->readLEUint32();
-			ptr.hi = savedState->readLEUint32();
-			object->value.ts = (TaggedString *)makePointerFromId(ptr);
+			object->value.ts = (TaggedString *)restoreObjectId(savedState);
 	}
 }
 
@@ -147,6 +139,42 @@ ArrayIDObj *arrayClosures = nullptr;
 ArrayIDObj *arrayProtoFuncs = nullptr;
 static bool arraysAllreadySort = false;
 
+static void restoreOwnId(ArrayIDObj *obj, int32 index, SaveGame *savedState) {
+	if (denseIds) {
+		obj->idObj.low = index + 1;
+		obj->idObj.hi = 0;
+	} else {
+		obj->idObj.low = savedState->readLESint32();
+		obj->idObj.hi = savedState->readLESint32();
+	}
+}
+
+static void *findObj(ArrayIDObj *array, int32 count, void *ptr) {
+	if (denseIds) {
+		uint32 id = makeIdFromPointer(ptr).low;
+		if (id < 1 || id > (uint32)count) {
+			warning("lua_Restore: object id %u out of range 1..%d, restoring it as NULL", id, count);
+			return nullptr;
+		}
+		return array[id - 1].object;
+	}
+
+	if (!arraysAllreadySort) {
+		arraysAllreadySort = true;
+		qsort(arrayHashTables, arrayHashTablesCount, sizeof(ArrayIDObj), sortCallback);
+		qsort(arrayProtoFuncs, arrayProtoFuncsCount, sizeof(ArrayIDObj), sortCallback);
+		qsort(arrayClosures, arrayClosuresCount, sizeof(ArrayIDObj), sortCallback);
+		qsort(arrayStrings, arrayStringsCount, sizeof(ArrayIDObj), sortCallback);
+	}
+
+	ArrayIDObj tmpId;
+	tmpId.object = nullptr;
+	tmpId.idObj = makeIdFromPointer(ptr);
+	ArrayIDObj *found = (ArrayIDObj *)bsearch(&tmpId, array, count, sizeof(ArrayIDObj), sortCallback);
+	assert(found);
+	return found->object;
+}
+
 static void recreateObj(TObject *obj) {
 	if (obj->ttype == LUA_T_CPROTO) {
 #ifdef SCUMM_64BITS
@@ -180,48 +208,19 @@ static void recreateObj(TObject *obj) {
 		if (obj->value.i == 0)
 			return;
 
-		if (!arraysAllreadySort) {
-			arraysAllreadySort = true;
-			qsort(arrayHashTables, arrayHashTablesCount, sizeof(ArrayIDObj), sortCallback);
-			qsort(arrayProtoFuncs, arrayProtoFuncsCount, sizeof(ArrayIDObj), sortCallback);
-			qsort(arrayClosures, arrayClosuresCount, sizeof(ArrayIDObj), sortCallback);
-			qsort(arrayStrings, arrayStringsCount, sizeof(ArrayIDObj), sortCallback);
-		}
-
-		ArrayIDObj *found;
-		ArrayIDObj tmpId;
-		tmpId.object = nullptr;
-
 		switch (obj->ttype) {
 		case LUA_T_PMARK:
-			tmpId.idObj = makeIdFromPointer(obj->value.tf);
-			found = (ArrayIDObj *)bsearch(&tmpId, arrayProtoFuncs, arrayProtoFuncsCount, sizeof(ArrayIDObj), sortCallback);
-			assert(found);
-			obj->value.tf = (TProtoFunc *)found->object;
-			break;
 		case LUA_T_PROTO:
-			tmpId.idObj = makeIdFromPointer(obj->value.tf);
-			found = (ArrayIDObj *)bsearch(&tmpId, arrayProtoFuncs, arrayProtoFuncsCount, sizeof(ArrayIDObj), sortCallback);
-			assert(found);
-			obj->value.tf = (TProtoFunc *)found->object;
+			obj->value.tf = (TProtoFunc *)findObj(arrayProtoFuncs, arrayProtoFuncsCount, obj->value.tf);
 			break;
 		case LUA_T_CLOSURE:
-			tmpId.idObj = makeIdFromPointer(obj->value.cl);
-			found = (ArrayIDObj *)bsearch(&tmpId, arrayClosures, arrayClosuresCount, sizeof(ArrayIDObj), sortCallback);
-			assert(found);
-			obj->value.cl = (Closure *)found->object;
+			obj->value.cl = (Closure *)findObj(arrayClosures, arrayClosuresCount, obj->value.cl);
 			break;
 		case LUA_T_ARRAY:
-			tmpId.idObj = makeIdFromPointer(obj->value.a);
-			found = (ArrayIDObj *)bsearch(&tmpId, arrayHashTables, arrayHashTablesCount, sizeof(ArrayIDObj), sortCallback);
-			assert(found);
-			obj->value.a = (Hash *)found->object;
+			obj->value.a = (Hash *)findObj(arrayHashTables, arrayHashTablesCount, obj->value.a);
 			break;
 		case LUA_T_STRING:
-			tmpId.idObj = makeIdFromPointer(obj->value.ts);
-			found = (ArrayIDObj *)bsearch(&tmpId, arrayStrings, arrayStringsCount, sizeof(ArrayIDObj), sortCallback);
-			assert(found);
-			obj->value.ts = (TaggedString *)found->object;
+			obj->value.ts = (TaggedString *)findObj(arrayStrings, arrayStringsCount, obj->value.ts);
 			break;
 		default:
 			obj->value.i = 0;
@@ -239,6 +238,7 @@ void lua_Restore(SaveGame *savedState) {
 	lua_stateinit(lua_state);
 	lua_resetglobals();
 
+	denseIds = savedState->saveMinorVersion() >= 26;
 	arrayStringsCount = savedState->readLESint32();
 	arrayClosuresCount = savedState->readLESint32();
 	arrayHashTablesCount = savedState->readLESint32();
@@ -255,8 +255,7 @@ void lua_Restore(SaveGame *savedState) {
 
 	int32 i;
 	for (i = 0; i < arrayStringsCount; i++) {
-		arraysObj->idObj.low = savedState->readLESint32();
-		arraysObj->idObj.hi = savedState->readLESint32();
+		restoreOwnId(arraysObj, i, savedState);
 		int32 constIndex = savedState->readLESint32();
 
 		TaggedString *tempString = nullptr;
@@ -284,8 +283,7 @@ void lua_Restore(SaveGame *savedState) {
 	arraysObj = (ArrayIDObj *)luaM_malloc(sizeof(ArrayIDObj) * arrayClosuresCount);
 	arrayClosures = arraysObj;
 	for (i = 0; i < arrayClosuresCount; i++) {
-		arraysObj->idObj.low = savedState->readLESint32();
-		arraysObj->idObj.hi = savedState->readLESint32();
+		restoreOwnId(arraysObj, i, savedState);
 		int32 countElements = savedState->readLESint32();
 		tempClosure = (Closure *)luaM_malloc((countElements * sizeof(TObject)) + sizeof(Closure));
 		luaO_insertlist(prevClosure, (GCnode *)tempClosure);
@@ -304,10 +302,10 @@ void lua_Restore(SaveGame *savedState) {
 	arraysObj = (ArrayIDObj *)luaM_malloc(sizeof(ArrayIDObj) * arrayHashTablesCount);
 	arrayHashTables = arraysObj;
 	for (i = 0; i < arrayHashTablesCount; i++) {
-		arraysObj->idObj.low = savedState->readLESint32();
-		arraysObj->idObj.hi = savedState->readLESint32();
+		restoreOwnId(arraysObj, i, savedState);
 		tempHash = luaM_new(Hash);
-		tempHash->nhash = savedState->readLESint32();
+		// older saves used prime dimensions, masking needs a power of two
+		tempHash->nhash = luaO_redimension(savedState->readLESint32() - 1);
 		tempHash->nuse = savedState->readLESint32();
 		tempHash->htag = savedState->readLESint32();
 		tempHash->node = hashnodecreate(tempHash->nhash);
@@ -327,15 +325,11 @@ void lua_Restore(SaveGame *savedState) {
 	arrayProtoFuncs = (ArrayIDObj *)luaM_malloc(sizeof(ArrayIDObj) * arrayProtoFuncsCount);
 	arraysObj = arrayProtoFuncs;
 	for (i = 0; i < arrayProtoFuncsCount; i++) {
-		arraysObj->idObj.low = savedState->readLESint32();
-		arraysObj->idObj.hi = savedState->readLESint32();
+		restoreOwnId(arraysObj, i, savedState);
 		tempProtoFunc = luaM_new(TProtoFunc);
 		luaO_insertlist(oldProto, (GCnode *)tempProtoFunc);
 		oldProto = (GCnode *)tempProtoFunc;
-		PointerId ptr;
-		ptr.low = savedState->readLESint32();
-		ptr.hi = savedState->readLESint32();
-		tempProtoFunc->fileName = (TaggedString *)makePointerFromId(ptr);
+		tempProtoFunc->fileName = (TaggedString *)restoreObjectId(savedState);
 		tempProtoFunc->lineDefined = savedState->readLESint32();
 		tempProtoFunc->nconsts = savedState->readLESint32();
 		if (tempProtoFunc->nconsts > 0) {
@@ -356,15 +350,14 @@ void lua_Restore(SaveGame *savedState) {
 		}
 
 		for (l = 0; l < countVariables; l++) {
-			ptr.low = savedState->readLESint32();
-			ptr.hi = savedState->readLESint32();
-			tempProtoFunc->locvars[l].varname = (TaggedString *)makePointerFromId(ptr);
+			tempProtoFunc->locvars[l].varname = (TaggedString *)restoreObjectId(savedState);
 			tempProtoFunc->locvars[l].line = savedState->readLESint32();
 		}
 
 		int32 codeSize = savedState->readLESint32();
 		tempProtoFunc->code = (byte *)luaM_malloc(codeSize);
 		savedState->read(tempProtoFunc->code, codeSize);
+		luaV_fuseopcodes(tempProtoFunc);
 		arraysObj->object = tempProtoFunc;
 		arraysObj++;
 	}
@@ -433,10 +426,7 @@ void lua_Restore(SaveGame *savedState) {
 		TObject tempObj;
 		TaggedString *tempString = nullptr;
 		tempObj.ttype = LUA_T_STRING;
-		PointerId ptr;
-		ptr.low = savedState->readLESint32();
-		ptr.hi = savedState->readLESint32();
-		tempObj.value.ts = (TaggedString *)makePointerFromId(ptr);
+		tempObj.value.ts = (TaggedString *)restoreObjectId(savedState);
 		recreateObj(&tempObj);
  		tempString = (TaggedString *)tempObj.value.ts;
 		assert(tempString);
@@ -520,16 +510,11 @@ void lua_Restore(SaveGame *savedState) {
 
 				TObject tempObj;
 				tempObj.ttype = LUA_T_CLOSURE;
-				PointerId ptr;
-				ptr.low = savedState->readLEUint32();
-				ptr.hi = savedState->readLEUint32();
-				tempObj.value.cl = (Closure *)makePointerFromId(ptr);
+				tempObj.value.cl = (Closure *)restoreObjectId(savedState);
 				recreateObj(&tempObj);
 				task->cl = (Closure *)tempObj.value.cl;
 				tempObj.ttype = LUA_T_PROTO;
-				ptr.low = savedState->readLEUint32();
-				ptr.hi = savedState->readLEUint32();
-				tempObj.value.tf = (TProtoFunc *)makePointerFromId(ptr);
+				tempObj.value.tf = (TProtoFunc *)restoreObjectId(savedState);
 				recreateObj(&tempObj);
 				task->tf = (TProtoFunc *)tempObj.value.tf;
 
@@ -554,7 +539,7 @@ void lua_Restore(SaveGame *savedState) {
 				state->some_task = state->some_task->next;
 		}
 
-		state->updated = savedState->readBool();
+		savedState->readBool(); // updated, derived from the scheduler state
 
 		byte pauseState = savedState->readByte();
 		state->all_paused = pauseState & LUA_SG_ALL_PAUSED;
@@ -597,6 +582,8 @@ void lua_Restore(SaveGame *savedState) {
 			recreateObj(&state->taskFunc);
 	}
 
+	lua_taskrebuildscheduler();
+
 	for (; currentState; currentState--)
 		lua_state = lua_state->next;
 
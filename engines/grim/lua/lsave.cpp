@@ -3,6 +3,8 @@
 
 #include "common/endian.h"
 #include "common/debug.h"
+#include "common/hashmap.h"
+#include "common/textconsole.h"
 
 #include "engines/grim/savegame.h"
 
@@ -47,6 +49,35 @@ void *makePointerFromId(PointerId ptr) {
 	return pointer;
 }
 
+struct PointerHash {
+	uint operator()(const void *ptr) const {
+		PointerId id = makeIdFromPointer(const_cast<void *>(ptr));
+		return (id.low >> 4) ^ id.hi;
+	}
+};
+
+typedef Common::HashMap<void *, int32, PointerHash> ObjectIdMap;
+
+// Dense ids of the strings, closures, tables and prototypes being saved.
+// Each kind is numbered from 1 in the order it's written; 0 is NULL.
+static ObjectIdMap *objectIds = nullptr;
+
+static void saveObjectId(void *ptr, SaveGame *savedState) {
+	int32 id = 0;
+	if (ptr) {
+		id = objectIds->getVal(ptr, 0);
+		if (id == 0)
+			warning("lua_Save: object %p is not in the saved lists, it will be restored as NULL", ptr);
+	}
+	savedState->writeLESint32(id);
+}
+
+static void numberObjects(GCnode *root) {
+	int32 id = 0;
+	for (GCnode *node = root->next; node; node = node->next)
+		(*objectIds)[node] = ++id;
+}
+
 static void saveObjectValue(TObject *object, SaveGame *savedState) {
 	savedState->writeLESint32(object->ttype);
 
@@ -61,7 +92,6 @@ static void saveObjectValue(TObject *object, SaveGame *savedState) {
 						if (list->list[l].func == object->value.f) {
 							idObj = (idObj << 16) | l;
 							savedState->writeLESint32(idObj);
-							savedState->writeLESint32(0);
 							return;
 						}
 					}
@@ -81,8 +111,7 @@ static void saveObjectValue(TObject *object, SaveGame *savedState) {
 			break;
 		case LUA_T_ARRAY:
 			{
-				savedState->writeLEUint32(makeIdFromPointer(object->value.a).low);
-				savedState->writeLEUint32(makeIdFromPointer(object->value.a).hi);
+				saveObjectId(object->value.a, savedState);
 			}
 			break;
 		case LUA_T_USERDATA:
@@ -93,22 +122,19 @@ static void saveObjectValue(TObject *object, SaveGame *savedState) {
 			break;
 		case LUA_T_STRING:
 			{
-				savedState->writeLEUint32(makeIdFromPointer(object->value.ts).low);
-				savedState->writeLEUint32(makeIdFromPointer(object->value.ts).hi);
+				saveObjectId(object->value.ts, savedState);
 			}
 			break;
 		case LUA_T_PROTO:
 		case LUA_T_PMARK:
 			{
-				savedState->writeLEUint32(makeIdFromPointer(object->value.tf).low);
-				savedState->writeLEUint32(makeIdFromPointer(object->value.tf).hi);
+				saveObjectId(object->value.tf, savedState);
 			}
 			break;
 		case LUA_T_CLOSURE:
 		case LUA_T_CLMARK:
 			{
-				savedState->writeLEUint32(makeIdFromPointer(object->value.cl).low);
-				savedState->writeLEUint32(makeIdFromPointer(object->value.cl).hi);
+				saveObjectId(object->value.cl, savedState);
 			}
 			break;
 		case LUA_T_LINE:
@@ -117,27 +143,10 @@ static void saveObjectValue(TObject *object, SaveGame *savedState) {
 			}
 			break;
 		default:
-			savedState->writeLEUint32(makeIdFromPointer(object->value.ts).low);
-			savedState->writeLEUint32(makeIdFromPointer(object->value.ts).hi);
+			saveObjectId(object->value.ts, savedState);
 	}
 }
 
-static int32 opcodeSizeTable[] = {
-	1, 2, 1, 2, 1, 1, 1, 3, 2, 1, 1, 1, 1, 1, 1, 1, 1, 3, 2, 1,
-	1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 3,
-	1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 3, 2, 1, 1, 1, 1, 1, 1, 1, 1,
-	3, 2, 1, 1, 3, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1,
-	1, 1, 1, 3, 1, 2, 3, 2, 4, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-	1, 1, 1, 1, 1, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 1, 1,
-	3, 2, 2, 2, 2, 3, 2, 1, 1, 1, 2, 1, 2, 1, 1, 1, 3, 2, 1, 1,
-	1, 1, 1, 1, 1, 1, 3, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2,
-	1, 1, 1, 1, 1, 1, 1, 1, 3, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 3,
-	2, 1, 1, 1, 1, 1, 1, 1, 1, 3, 2, 1, 1, 3, 2, 1, 1, 1, 1, 1,
-	1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 3, 1, 2, 3, 2, 4, 2, 1,
-	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 3, 2, 3, 2, 3,
-	2, 3, 2, 3, 2, 3, 2, 1, 1, 3, 2, 2, 2, 2, 3, 2, 1, 1
-};
-
 void lua_Save(SaveGame *savedState) {
 	savedState->beginSection('LUAS');
 
@@ -146,6 +155,10 @@ void lua_Save(SaveGame *savedState) {
 	int32 countElements = 0;
 	int32 maxStringLength = 0;
 
+	objectIds = new ObjectIdMap();
+	numberObjects(&rootcl);
+	numberObjects(&roottable);
+	numberObjects(&rootproto);
 
 	// Check for max length for strings and count them
 	for (i = 0; i < NUM_HASHS; i++) {
@@ -153,6 +166,7 @@ void lua_Save(SaveGame *savedState) {
 		for (l = 0; l < tempStringTable->size; l++) {
 			if (tempStringTable->hash[l] && tempStringTable->hash[l] != &EMPTY) {
 				countElements++;
+				(*objectIds)[tempStringTable->hash[l]] = countElements;
 				if (tempStringTable->hash[l]->constindex != -1) {
 					int len = strlen(tempStringTable->hash[l]->str);
 					if (maxStringLength < len) {
@@ -215,8 +229,6 @@ void lua_Save(SaveGame *savedState) {
 		for (l = 0; l < tempStringTable->size; l++) {
 			if (tempStringTable->hash[l] && tempStringTable->hash[l] != &EMPTY) {
 				tempString = tempStringTable->hash[l];
-				savedState->writeLEUint32(makeIdFromPointer(tempString).low);
-				savedState->writeLEUint32(makeIdFromPointer(tempString).hi);
 				savedState->writeLESint32(tempString->constindex);
 				if (tempString->constindex != -1) {
 					saveObjectValue(&tempString->globalval, savedState);
@@ -232,8 +244,6 @@ void lua_Save(SaveGame *savedState) {
 
 	Closure *tempClosure = (Closure *)rootcl.next;
 	while (tempClosure) {
-		savedState->writeLEUint32(makeIdFromPointer(tempClosure).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempClosure).hi);
 		savedState->writeLESint32(tempClosure->nelems);
 		for (i = 0; i <= tempClosure->nelems; i++) {
 			saveObjectValue(&tempClosure->consts[i], savedState);
@@ -243,8 +253,6 @@ void lua_Save(SaveGame *savedState) {
 
 	Hash *tempHash = (Hash *)roottable.next;
 	while (tempHash) {
-		savedState->writeLEUint32(makeIdFromPointer(tempHash).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempHash).hi);
 		savedState->writeLESint32(tempHash->nhash);
 		int32 countUsedHash = 0;
 		for (i = 0; i < tempHash->nhash; i++) {
@@ -267,10 +275,7 @@ void lua_Save(SaveGame *savedState) {
 
 	TProtoFunc *tempProtoFunc = (TProtoFunc *)rootproto.next;
 	while (tempProtoFunc) {
-		savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc).hi);
-		savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc->fileName).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc->fileName).hi);
+		saveObjectId(tempProtoFunc->fileName, savedState);
 		savedState->writeLESint32(tempProtoFunc->lineDefined);
 		savedState->writeLESint32(tempProtoFunc->nconsts);
 		for (i = 0; i < tempProtoFunc->nconsts; i++) {
@@ -283,8 +288,7 @@ void lua_Save(SaveGame *savedState) {
 
 		savedState->writeLESint32(countVariables);
 		for (i = 0; i < countVariables; i++) {
-			savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc->locvars[i].varname).low);
-			savedState->writeLEUint32(makeIdFromPointer(tempProtoFunc->locvars[i].varname).hi);
+			saveObjectId(tempProtoFunc->locvars[i].varname, savedState);
 			savedState->writeLESint32(tempProtoFunc->locvars[i].line);
 		}
 
@@ -293,7 +297,7 @@ void lua_Save(SaveGame *savedState) {
 		int32 opcodeId;
 		do {
 			opcodeId = *tmpPtr;
-			tmpPtr += opcodeSizeTable[opcodeId];
+			tmpPtr += luaV_opcodeSize[opcodeId];
 		} while (opcodeId != ENDCODE);
 		int32 codeSize = (tmpPtr - codePtr) + 2;
 		savedState->writeLESint32(codeSize);
@@ -303,8 +307,7 @@ void lua_Save(SaveGame *savedState) {
 
 	tempString = (TaggedString *)rootglobal.next;
 	while (tempString) {
-		savedState->writeLEUint32(makeIdFromPointer(tempString).low);
-		savedState->writeLEUint32(makeIdFromPointer(tempString).hi);
+		saveObjectId(tempString, savedState);
 		tempString = (TaggedString *)tempString->head.next;
 	}
 
@@ -361,10 +364,8 @@ void lua_Save(SaveGame *savedState) {
 		savedState->writeLESint32(countTasks);
 		task = state->task;
 		while (task) {
-			savedState->writeLEUint32(makeIdFromPointer(task->cl).low);
-			savedState->writeLEUint32(makeIdFromPointer(task->cl).hi);
-			savedState->writeLEUint32(makeIdFromPointer(task->tf).low);
-			savedState->writeLEUint32(makeIdFromPointer(task->tf).hi);
+			saveObjectId(task->cl, savedState);
+			saveObjectId(task->tf, savedState);
 			savedState->writeLESint32(task->base);
 			savedState->writeLESint32(task->some_base);
 			savedState->writeLESint32(task->some_results);
@@ -377,7 +378,7 @@ void lua_Save(SaveGame *savedState) {
 
 		savedState->writeLESint32(n);
 
-		savedState->writeBool(state->updated);
+		savedState->writeBool(lua_taskupdated(state));
 
 		byte pauseState = 0;
 		pauseState = state->all_paused & LUA_SG_ALL_PAUSED;
@@ -406,13 +407,16 @@ void lua_Save(SaveGame *savedState) {
 			savedState->writeLESint32(state->Cblocks[i].num);
 		}
 
-		savedState->writeLEUint32(state->sleepFor);
+		savedState->writeLEUint32(lua_tasksleeptime(state));
 		savedState->writeLEUint32(state->id);
 		saveObjectValue(&state->taskFunc, savedState);
 
 		state = state->next;
 	}
 
+	delete objectIds;
+	objectIds = nullptr;
+
 	savedState->endSection();
 }
 
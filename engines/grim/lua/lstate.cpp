@@ -79,7 +79,12 @@ void lua_stateinit(LState *state) {
 	state->paused = false;
 	state->state_counter1 = 0;
 	state->state_counter2 = 0;
-	state->updated = false;
+	state->runFrame = 0;
+	state->runPrev = nullptr;
+	state->runNext = nullptr;
+	state->runnable = false;
+	state->sleepIndex = -1;
+	state->wakeTime = 0;
 
 	state->numCblocks = 0;
 	state->Cstack.base = 0;
@@ -98,6 +103,8 @@ void lua_stateinit(LState *state) {
 }
 
 void lua_statedeinit(LState *state) {
+	lua_taskunschedule(state);
+
 	if (state->prev)
 		state->prev->next = state->next;
 	if (state->next)
@@ -211,6 +218,7 @@ void lua_open() {
 }
 
 void lua_close() {
+	luaC_finishsweep();
 	TaggedString *alludata = luaS_collectudata();
 	GCthreshold = MAX_INT;  // to avoid GC during GC
 	luaC_hashcallIM((Hash *)roottable.next);  // GC t.methods for tables
@@ -221,6 +229,7 @@ void lua_close() {
 	luaF_freeclosure((Closure *)rootcl.next);
 	luaS_free(alludata);
 	luaS_freeall();
+	luaC_resetGC();
 	luaM_free(IMtable);
 	luaM_free(refArray);
 	luaM_free(Mbuffer);
@@ -232,6 +241,7 @@ void lua_close() {
 		luaM_free(state);
 		state = tmpState;
 	}
+	lua_taskresetscheduler();
 
 	Mbuffer = nullptr;
 	IMtable = nullptr;
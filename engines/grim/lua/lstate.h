@@ -93,7 +93,12 @@ struct LState {
 	bool paused;    // true if this particular script has been paused
 	int32 state_counter1;
 	int32 state_counter2;
-	bool updated;
+	uint32 runFrame; // scheduler frame in which this state last ran
+	LState *runPrev; // runnable states, kept in the same order as the state list
+	LState *runNext;
+	bool runnable;
+	int32 sleepIndex; // position in the sleep heap, -1 if not sleeping
+	uint32 wakeTime; // scheduler clock time at which a sleeping state wakes up
 	Stack stack;  // Lua stack
 	C_Lua_Stack Cstack;  // C2lua struct
 	struct FuncState *mainState, *currState;  // point to local structs in yacc
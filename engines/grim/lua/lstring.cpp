@@ -20,8 +20,16 @@ namespace Grim {
 
 TaggedString EMPTY = {{nullptr, 2}, 0, 0L, {LUA_T_NIL, {nullptr}}, {0}};
 
+static int32 stringSession = 0;  // bumped for every new string table
+
+// Position of the incremental sweep, NUM_HASHS when not sweeping
+static int32 sweepTable = NUM_HASHS;
+static int32 sweepSlot = 0;
+static TaggedString *sweepFrees = nullptr;
+
 void luaS_init() {
 	int32 i;
+	stringSession++;
 	string_root = luaM_newvector(NUM_HASHS, stringtable);
 	for (i = 0; i < NUM_HASHS; i++) {
 		string_root[i].size = 0;
@@ -30,22 +38,33 @@ void luaS_init() {
 	}
 }
 
-static uint32 hash(const char *s, int32 tag) {
+#define HASH_SAMPLE_LEN	32  // longer strings only hash a sample of their characters
+
+static uint32 hashstring(const char *s, uint32 len) {
 	uint32 h;
-	if (tag != LUA_T_STRING) {
-#ifdef SCUMM_64BITS
-		h = (uint64)s;
-#else
-		h = (uint32)s;
-#endif
-	} else {
+	if (len < HASH_SAMPLE_LEN) {
 		h = 0;
-		while (*s)
+		while (len--)
 			h = ((h << 5) - h) ^ (byte)*(s++);
+	} else {
+		uint32 step = (len >> 5) + 1;
+		h = len;
+		for (uint32 i = 0; i < len; i += step)
+			h = ((h << 5) - h) ^ (byte)s[i];
 	}
 	return h;
 }
 
+static uint32 hashudata(void *u) {
+	// drop the alignment bits, the tables are indexed by the low bits
+#ifdef SCUMM_64BITS
+	uint64 v = (uint64)u;
+	return (uint32)(v >> 3) ^ (uint32)(v >> 32);
+#else
+	return (uint32)u >> 3;
+#endif
+}
+
 static void grow(stringtable *tb) {
 	int newsize = luaO_redimension(tb->size);
 	TaggedString **newhash = luaM_newvector(newsize, TaggedString *);
@@ -57,9 +76,9 @@ static void grow(stringtable *tb) {
 	tb->nuse = 0;
 	for (i = 0; i < tb->size; i++) {
 		if (tb->hash[i] && tb->hash[i] != &EMPTY) {
-			int32 h = tb->hash[i]->hash % newsize;
+			int32 h = tb->hash[i]->hash & (newsize - 1);
 			while (newhash[h])
-				h = (h + 1) % newsize;
+				h = (h + 1) & (newsize - 1);
 			newhash[h] = tb->hash[i];
 			tb->nuse++;
 		}
@@ -69,15 +88,23 @@ static void grow(stringtable *tb) {
 	tb->hash = newhash;
 }
 
-static TaggedString *newone(const char *buff, int32 tag, uint32 h) {
+static void sweeptable(stringtable *tb, int32 *work, int32 limit);
+
+// Strings in the part of the tables the sweep hasn't reached yet have to be
+// kept alive by hand.
+static bool unswept(stringtable *tb, int32 i) {
+	int32 n = tb - string_root;
+	return n > sweepTable || (n == sweepTable && i >= sweepSlot);
+}
+
+static TaggedString *newone(const char *buff, int32 len, int32 tag, uint32 h) {
 	TaggedString *ts;
 	if (tag == LUA_T_STRING) {
-		int l = strlen(buff);
-		ts = (TaggedString *)luaM_malloc(sizeof(TaggedString) + l);
-		strcpy(ts->str, buff);
+		ts = (TaggedString *)luaM_malloc(sizeof(TaggedString) + len);
+		memcpy(ts->str, buff, len + 1);
 		ts->globalval.ttype = LUA_T_NIL;  /* initialize global value */
 		ts->constindex = 0;
-		nblocks += gcsizestring(l);
+		nblocks += gcsizestring(len);
 	} else {
 		ts = (TaggedString *)luaM_malloc(sizeof(TaggedString));
 		ts->globalval.value.ts = (TaggedString *)const_cast<char *>(buff);
@@ -91,58 +118,75 @@ static TaggedString *newone(const char *buff, int32 tag, uint32 h) {
 	return ts;
 }
 
-static TaggedString *insert(const char *buff, int32 tag, stringtable *tb) {
+static TaggedString *insert(const char *buff, int32 len, int32 tag, uint32 h, stringtable *tb) {
 	TaggedString *ts;
-	uint32 h = hash(buff, tag);
 	int32 size = tb->size;
 	int32 i;
 	int32 j = -1;
 	if (tb->nuse * 3 >= size * 2) {
+		if (tb - string_root == sweepTable)
+			sweeptable(tb, nullptr, -1);  // growing moves the strings around
 		grow(tb);
 		size = tb->size;
 	}
-	for (i = h % size; (ts = tb->hash[i]) != nullptr; ) {
+	for (i = h & (size - 1); (ts = tb->hash[i]) != nullptr; ) {
 		if (ts == &EMPTY)
 			j = i;
 		else if ((ts->constindex >= 0) ? // is a string?
-				(tag == LUA_T_STRING && (strcmp(buff, ts->str) == 0)) :
-				((tag == ts->globalval.ttype || tag == LUA_ANYTAG) && buff == (const char *)ts->globalval.value.ts))
+				(tag == LUA_T_STRING && ts->hash == h && (strcmp(buff, ts->str) == 0)) :
+				((tag == ts->globalval.ttype || tag == LUA_ANYTAG) && buff == (const char *)ts->globalval.value.ts)) {
+			if (ts->head.marked == 0 && unswept(tb, i))
+				ts->head.marked = 1;
 			return ts;
-		if (++i == size)
-			i = 0;
+		}
+		i = (i + 1) & (size - 1);
 	}
 	// not found
 	if (j != -1)  // is there an EMPTY space?
 		i = j;
 	else
 		tb->nuse++;
-	ts = tb->hash[i] = newone(buff, tag, h);
+	ts = tb->hash[i] = newone(buff, len, tag, h);
+	if (unswept(tb, i))
+		ts->head.marked = 1;
 	return ts;
 }
 
 TaggedString *luaS_createudata(void *udata, int32 tag) {
-#ifdef SCUMM_64BITS
-	return insert((char *)udata, tag, &string_root[(uint64)udata % NUM_HASHS]);
-#else
-	return insert((char *)udata, tag, &string_root[(uint32)udata % NUM_HASHS]);
-#endif
+	uint32 h = hashudata(udata);
+	return insert((char *)udata, 0, tag, h, &string_root[h % NUM_HASHS]);
 }
 
 TaggedString *luaS_new(const char *str) {
-#ifdef SCUMM_64BITS
-	return insert(str, LUA_T_STRING, &string_root[(uint64)str[0] % NUM_HASHS]);
-#else
-	return insert(str, LUA_T_STRING, &string_root[(uint32)str[0] % NUM_HASHS]);
-#endif
+	int32 len = strlen(str);
+	uint32 h = hashstring(str, len);
+	return insert(str, len, LUA_T_STRING, h, &string_root[h % NUM_HASHS]);
+}
+
+uint32 luaS_hash(const char *str) {
+	return hashstring(str, strlen(str));
+}
+
+TaggedString *luaS_newhashed(const char *str, uint32 h) {
+	return insert(str, strlen(str), LUA_T_STRING, h, &string_root[h % NUM_HASHS]);
 }
 
 TaggedString *luaS_newfixedstring(const char *str) {
 	TaggedString *ts = luaS_new(str);
-	if (ts->head.marked == 0)
+	if (ts->head.marked != 2)
 		ts->head.marked = 2;  // avoid GC
 	return ts;
 }
 
+TaggedString *luaS_newconst(lua_ConstString *s) {
+	if (s->session != stringSession) {
+		s->ts = luaS_new(s->str);
+		s->ts->head.marked = 2;  // the pointer is cached, never collect it
+		s->session = stringSession;
+	}
+	return s->ts;
+}
+
 void luaS_free(TaggedString *l) {
 	while (l) {
 		TaggedString *next = (TaggedString *)l->head.next;
@@ -159,32 +203,59 @@ void luaS_free(TaggedString *l) {
 static void remove_from_list(GCnode *l) {
 	while (l) {
 		GCnode *next = l->next;
-		while (next && !next->marked)
-			next = l->next = next->next;
+		while (next && !next->marked) {
+			l->next = next->next;
+			next->next = next;  // no longer in the list
+			next = l->next;
+		}
 		l = next;
 	}
 }
 
-TaggedString *luaS_collector() {
-	TaggedString *frees = nullptr;
-	int32 i;
+void luaS_startsweep() {
 	remove_from_list(&rootglobal);
-	for (i = 0; i < NUM_HASHS; i++) {
-		stringtable *tb = &string_root[i];
-		int32 j;
-		for (j = 0; j < tb->size; j++) {
-			TaggedString *t = tb->hash[j];
-			if (!t)
-				continue;
+	sweepTable = 0;
+	sweepSlot = 0;
+	sweepFrees = nullptr;
+}
+
+// Sweeps the rest of the current table, or until "limit" units of work are done.
+static void sweeptable(stringtable *tb, int32 *work, int32 limit) {
+	while (sweepSlot < tb->size) {
+		if (limit >= 0 && *work >= limit)
+			return;
+		TaggedString *t = tb->hash[sweepSlot];
+		if (t) {
 			if (t->head.marked == 1)
 				t->head.marked = 0;
 			else if (!t->head.marked) {
-				t->head.next = (GCnode *)frees;
-				frees = t;
-				tb->hash[j] = &EMPTY;
+				t->head.next = (GCnode *)sweepFrees;
+				sweepFrees = t;
+				tb->hash[sweepSlot] = &EMPTY;
 			}
 		}
+		sweepSlot++;
+		if (work)
+			(*work)++;
 	}
+	sweepTable++;
+	sweepSlot = 0;
+}
+
+bool luaS_sweepstep(int32 *work, int32 limit) {
+	while (sweepTable < NUM_HASHS) {
+		sweeptable(&string_root[sweepTable], work, limit);
+		if (limit >= 0 && *work >= limit)
+			return sweepTable == NUM_HASHS;
+	}
+	return true;
+}
+
+TaggedString *luaS_endsweep() {
+	TaggedString *frees = sweepFrees;
+	sweepTable = NUM_HASHS;
+	sweepSlot = 0;
+	sweepFrees = nullptr;
 	return frees;
 }
 
@@ -13,10 +13,15 @@ namespace Grim {
 
 void luaS_init();
 TaggedString *luaS_createudata(void *udata, int32 tag);
-TaggedString *luaS_collector();
+void luaS_startsweep();
+bool luaS_sweepstep(int32 *work, int32 limit);
+TaggedString *luaS_endsweep();
 void luaS_free (TaggedString *l);
 TaggedString *luaS_new(const char *str);
+uint32 luaS_hash(const char *str);
+TaggedString *luaS_newhashed(const char *str, uint32 h);  // h must be luaS_hash(str)
 TaggedString *luaS_newfixedstring (const char *str);
+TaggedString *luaS_newconst(lua_ConstString *s);
 void luaS_rawsetglobal(TaggedString *ts, TObject *newval);
 char *luaS_travsymbol(int32 (*fn)(TObject *));
 int32 luaS_globaldefined(const char *name);
@@ -23,6 +23,7 @@ by  GNU Bison version 1.25
 #include "engines/grim/lua/lstring.h"
 #include "engines/grim/lua/lua.h"
 #include "engines/grim/lua/luadebug.h"
+#include "engines/grim/lua/lvm.h"
 #include "engines/grim/lua/lzio.h"
 
 namespace Grim {
@@ -647,6 +648,7 @@ static TProtoFunc *close_func() {
 	code_neutralop(ENDCODE);
 	f->code[0] = lua_state->currState->maxstacksize;
 	f->code = luaM_reallocvector(f->code, lua_state->currState->pc, byte);
+	luaV_fuseopcodes(f);
 	f->consts = luaM_reallocvector(f->consts, f->nconsts, TObject);
 	if (lua_state->currState->maxvars != -1) {  /* debug information? */
 		luaI_registerlocalvar(nullptr, -1);  /* flag end of vector */
@@ -7,6 +7,7 @@
 #define FORBIDDEN_SYMBOL_EXCEPTION_longjmp
 
 #include "engines/grim/lua/lauxlib.h"
+#include "engines/grim/lua/lgc.h"
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lobject.h"
 #include "engines/grim/lua/lstate.h"
@@ -21,115 +22,58 @@ namespace Grim {
 #define REHASH_LIMIT	0.70    // avoid more than this % full
 #define TagDefault		LUA_T_ARRAY;
 
+static inline uint32 hashpointer(const void *p) {
 #ifdef SCUMM_64BITS
-static int64 hashindex(TObject *ref) {
-	int64 h;
+	uint64 v = (uint64)p;
+	return (uint32)(v >> 4) ^ (uint32)(v >> 32);
+#else
+	return (uint32)p >> 3;
+#endif
+}
 
+static uint32 hashindex(TObject *ref) {
 	switch (ttype(ref)) {
 	case LUA_T_NUMBER:
-		h = (int64)nvalue(ref);
-		break;
-	case LUA_T_USERDATA:
-		h = (int64)ref->value.ud.id;
-		break;
-	case LUA_T_STRING:
-		h = (int64)tsvalue(ref);
-		break;
-	case LUA_T_ARRAY:
-		h = (int64)avalue(ref);
-		break;
-	case LUA_T_PROTO:
-		h = (int64)tfvalue(ref);
-		break;
-	case LUA_T_CPROTO:
-		h = (int64)fvalue(ref);
-		break;
-	case LUA_T_CLOSURE:
-		h = (int64)clvalue(ref);
-		break;
 	case LUA_T_TASK:
-		h = (int64)nvalue(ref);
-		break;
-	default:
-		lua_error("unexpected type to index table");
-		h = 0;  // to avoid warnings
-	}
-	return (h >= 0 ? h : -(h + 1));
-}
-
-int32 present(Hash *t, TObject *key) {
-	int32 tsize = nhash(t);
-	int64 h = hashindex(key);
-	int32 h1 = int32(h % tsize);
-	TObject *rf = ref(node(t, h1));
-	if (ttype(rf) != LUA_T_NIL && !luaO_equalObj(key, rf)) {
-		int32 h2 = int32(h % (tsize - 2) + 1);
-		do {
-			h1 += h2;
-			if (h1 >= tsize)
-				h1 -= tsize;
-			rf = ref(node(t, h1));
-		} while (ttype(rf) != LUA_T_NIL && !luaO_equalObj(key, rf));
-	}
-	return h1;
-}
-
-#else
-
-static int32 hashindex(TObject *r) {
-	int32 h;
-
-	switch (ttype(r)) {
-	case LUA_T_NUMBER:
-		h = (int32)nvalue(r);
-		break;
+		return (uint32)(int32)nvalue(ref);
 	case LUA_T_USERDATA:
-		h = (int32)r->value.ud.id;
-		break;
+		return (uint32)ref->value.ud.id;
 	case LUA_T_STRING:
-		h = (int32)tsvalue(r);
-		break;
+		return tsvalue(ref)->hash;
 	case LUA_T_ARRAY:
-		h = (int32)avalue(r);
-		break;
+		return hashpointer(avalue(ref));
 	case LUA_T_PROTO:
-		h = (int32)tfvalue(r);
-		break;
+		return hashpointer(tfvalue(ref));
 	case LUA_T_CPROTO:
-		h = (int32)fvalue(r);
-		break;
+		return hashpointer((const void *)fvalue(ref));
 	case LUA_T_CLOSURE:
-		h = (int32)clvalue(r);
-		break;
-	case LUA_T_TASK:
-		h = (int32)nvalue(r);
-		break;
+		return hashpointer(clvalue(ref));
 	default:
 		lua_error("unexpected type to index table");
-		h = 0;  // to avoid warnings
+		return 0;  // to avoid warnings
 	}
-	return (h >= 0 ? h : -(h + 1));
 }
 
+/*
+** Open addressing over a power of two sized node vector: the first slot is
+** the low bits of the hash, collisions step by an odd stride taken from the
+** high bits, which visits every slot.
+*/
 int32 present(Hash *t, TObject *key) {
-	int32 tsize = nhash(t);
-	int32 h = hashindex(key);
-	int32 h1 = h % tsize;
+	uint32 mask = nhash(t) - 1;
+	uint32 h = hashindex(key);
+	uint32 h1 = h & mask;
 	TObject *rf = ref(node(t, h1));
 	if (ttype(rf) != LUA_T_NIL && !luaO_equalObj(key, rf)) {
-		int32 h2 = h % (tsize - 2) + 1;
+		uint32 h2 = (h >> 16) | 1;
 		do {
-			h1 += h2;
-			if (h1 >= tsize)
-				h1 -= tsize;
+			h1 = (h1 + h2) & mask;
 			rf = ref(node(t, h1));
 		} while (ttype(rf) != LUA_T_NIL && !luaO_equalObj(key, rf));
 	}
 	return h1;
 }
 
-#endif
-
 /*
 ** Alloc a vector node
 */
@@ -219,6 +163,8 @@ TObject *luaH_get(Hash *t, TObject *r) {
 ** node for the given reference and also return its pointer.
 */
 TObject *luaH_set(Hash *t, TObject *r) {
+	if (t->head.marked == GC_BLACK)
+		luaC_barrier(t);
 	Node *n = node(t, present(t, r));
 	if (ttype(ref(n)) == LUA_T_NIL) {
 		nuse(t)++;
@@ -33,6 +33,182 @@ void lua_taskresume(lua_Task *task, Closure *closure, TProtoFunc *protofunc, Stk
 	task->S = &lua_state->stack;
 }
 
+/*
+** The scheduler keeps the runnable states (not paused and not sleeping) in
+** their own list, in the same order as the state list, and the sleeping
+** states in a heap ordered by wake up time, so that a frame only touches
+** the states which actually run.
+*/
+
+static LState *runHead = nullptr;
+static LState *runCursor = nullptr;  // last state visited by runtasks()
+static int32 runCount = 0;
+static LState **sleepHeap = nullptr;
+static int32 sleepHeapSize = 0;
+static int32 sleepCount = 0;
+static uint32 taskClock = 0;
+static uint32 taskFrame = 1;
+static lua_TaskStats taskStats;
+
+static inline bool wakesBefore(LState *a, LState *b) {
+	return (int32)(a->wakeTime - b->wakeTime) < 0;
+}
+
+static void sleepheap_set(int32 i, LState *state) {
+	sleepHeap[i] = state;
+	state->sleepIndex = i;
+}
+
+static void sleepheap_up(int32 i) {
+	LState *state = sleepHeap[i];
+	while (i > 0) {
+		int32 parent = (i - 1) / 2;
+		if (!wakesBefore(state, sleepHeap[parent]))
+			break;
+		sleepheap_set(i, sleepHeap[parent]);
+		i = parent;
+	}
+	sleepheap_set(i, state);
+}
+
+static void sleepheap_down(int32 i) {
+	LState *state = sleepHeap[i];
+	for (;;) {
+		int32 child = 2 * i + 1;
+		if (child >= sleepCount)
+			break;
+		if (child + 1 < sleepCount && wakesBefore(sleepHeap[child + 1], sleepHeap[child]))
+			child++;
+		if (!wakesBefore(sleepHeap[child], state))
+			break;
+		sleepheap_set(i, sleepHeap[child]);
+		i = child;
+	}
+	sleepheap_set(i, state);
+}
+
+static void sleepheap_insert(LState *state) {
+	if (sleepCount == sleepHeapSize) {
+		sleepHeapSize = sleepHeapSize ? sleepHeapSize * 2 : 32;
+		sleepHeap = luaM_reallocvector(sleepHeap, sleepHeapSize, LState *);
+	}
+	sleepheap_set(sleepCount++, state);
+	sleepheap_up(sleepCount - 1);
+}
+
+static void sleepheap_remove(LState *state) {
+	int32 i = state->sleepIndex;
+	state->sleepIndex = -1;
+	sleepCount--;
+	if (i == sleepCount)
+		return;
+	sleepheap_set(i, sleepHeap[sleepCount]);
+	if (i > 0 && wakesBefore(sleepHeap[i], sleepHeap[(i - 1) / 2]))
+		sleepheap_up(i);
+	else
+		sleepheap_down(i);
+}
+
+static void runlist_insert(LState *state) {
+	// Link after the closest runnable state preceding it in the state list
+	LState *prev = state->prev;
+	while (prev && !prev->runnable)
+		prev = prev->prev;
+
+	state->runPrev = prev;
+	state->runNext = prev ? prev->runNext : runHead;
+	if (state->runNext)
+		state->runNext->runPrev = state;
+	if (prev)
+		prev->runNext = state;
+	else
+		runHead = state;
+	state->runnable = true;
+	runCount++;
+}
+
+static void runlist_remove(LState *state) {
+	if (runCursor == state)
+		runCursor = state->runPrev;
+	if (state->runPrev)
+		state->runPrev->runNext = state->runNext;
+	else
+		runHead = state->runNext;
+	if (state->runNext)
+		state->runNext->runPrev = state->runPrev;
+	state->runPrev = nullptr;
+	state->runNext = nullptr;
+	state->runnable = false;
+	runCount--;
+}
+
+void lua_taskschedule(LState *state) {
+	if (state == lua_rootState)
+		return;
+	bool runnable = !state->all_paused && !state->paused && state->sleepIndex < 0;
+	if (runnable && !state->runnable)
+		runlist_insert(state);
+	else if (!runnable && state->runnable)
+		runlist_remove(state);
+}
+
+void lua_taskunschedule(LState *state) {
+	if (state->runnable)
+		runlist_remove(state);
+	if (state->sleepIndex >= 0)
+		sleepheap_remove(state);
+}
+
+void lua_taskresetscheduler() {
+	luaM_free(sleepHeap);
+	sleepHeap = nullptr;
+	sleepHeapSize = 0;
+	sleepCount = 0;
+	runHead = nullptr;
+	runCursor = nullptr;
+	runCount = 0;
+	taskClock = 0;
+	taskFrame = 1;
+}
+
+static void lua_tasksleep(LState *state) {
+	state->wakeTime = taskClock + state->sleepFor;
+	state->sleepFor = 0;
+	sleepheap_insert(state);
+	lua_taskschedule(state);
+}
+
+void lua_taskrebuildscheduler() {
+	for (LState *state = lua_rootState->next; state != nullptr; state = state->next) {
+		if (state->sleepFor > 0)
+			lua_tasksleep(state);
+		else
+			lua_taskschedule(state);
+	}
+}
+
+bool lua_taskupdated(LState *state) {
+	return state->sleepIndex >= 0 || state->runFrame == taskFrame;
+}
+
+int32 lua_tasksleeptime(LState *state) {
+	if (state->sleepIndex < 0)
+		return 0;
+	return (int32)(state->wakeTime - taskClock);
+}
+
+void lua_gettaskstats(lua_TaskStats *stats) {
+	int32 count = 0;
+	if (lua_rootState) {
+		for (LState *state = lua_rootState->next; state != nullptr; state = state->next)
+			count++;
+	}
+	*stats = taskStats;
+	stats->runnable = runCount;
+	stats->sleeping = sleepCount;
+	stats->paused = count - runCount - sleepCount;
+}
+
 void start_script() {
 	lua_Object paramObj = lua_getparam(1);
 	lua_Type type = paramObj == LUA_NOOBJECT ? LUA_T_NIL : ttype(Address(paramObj));
@@ -59,6 +235,7 @@ void start_script() {
 	if (state->next)
 		state->next->prev = state;
 	lua_state->next = state;
+	lua_taskschedule(state);
 
 	state->taskFunc.ttype = type;
 	state->taskFunc.value = Address(paramObj)->value;
@@ -237,6 +414,7 @@ void pause_script() {
 	for (state = lua_rootState->next; state != nullptr; state = state->next) {
 		if (state->id == task) {
 			state->paused = true;
+			lua_taskschedule(state);
 			return;
 		}
 	}
@@ -258,8 +436,8 @@ void pause_scripts() {
 			} else {
 				t->all_paused = 1;
 			}
+			lua_taskschedule(t);
 		}
-
 	}
 }
 
@@ -276,6 +454,7 @@ void unpause_script() {
 	for (state = lua_rootState->next; state != nullptr; state = state->next) {
 		if (state->id == task) {
 			state->paused = false;
+			lua_taskschedule(state);
 			return;
 		}
 	}
@@ -297,6 +476,7 @@ void unpause_scripts() {
 			} else {
 				t->all_paused = 0;
 			}
+			lua_taskschedule(t);
 		}
 	}
 }
@@ -319,31 +499,46 @@ void sleep_for() {
 }
 
 void lua_runtasks() {
-	if (!lua_state || !lua_state->next) {
+	if (!lua_state)
 		return;
+
+	// Wake up the states whose sleep ran out by the end of the last frame
+	while (sleepCount > 0 && (int32)(sleepHeap[0]->wakeTime - taskClock) <= 0) {
+		LState *state = sleepHeap[0];
+		sleepheap_remove(state);
+		lua_taskschedule(state);
 	}
+	taskClock += g_grim->getFrameTime();
+	taskFrame++;
+
+	taskStats.lastTasksRun = 0;
+	taskStats.lastPasses = 0;
+	if (runHead)
+		runtasks(lua_state);
+	taskStats.maxTasksRun = MAX(taskStats.maxTasksRun, taskStats.lastTasksRun);
+}
 
-	// Mark all the states to be updated
-	LState *state = lua_state->next;
+void runtasks(LState *const rootState) {
+	// States started or unpaused behind the cursor during a pass are picked
+	// up by another pass, so keep going until a pass finds nothing to run.
+	bool ran;
 	do {
-		if (state->sleepFor > 0) {
-			state->sleepFor -= g_grim->getFrameTime();
-		} else {
-			state->updated = false;
-		}
-		state = state->next;
-	} while	(state);
+		ran = false;
+		taskStats.lastPasses++;
+		runCursor = nullptr;
+		for (;;) {
+			lua_state = runCursor ? runCursor->runNext : runHead;
+			if (!lua_state)
+				break;
+			runCursor = lua_state;
+			if (lua_state->runFrame == taskFrame)
+				continue;
 
-	// And run them
-	runtasks(lua_state);
-}
+			lua_state->runFrame = taskFrame;
+			ran = true;
+			taskStats.lastTasksRun++;
 
-void runtasks(LState *const rootState) {
-	lua_state = lua_state->next;
-	while (lua_state) {
-		LState *nextState = nullptr;
-		bool stillRunning;
-		if (!lua_state->all_paused && !lua_state->updated && !lua_state->paused) {
+			bool stillRunning;
 			jmp_buf	errorJmp;
 			lua_state->errorJmp = &errorJmp;
 			if (setjmp(errorJmp)) {
@@ -365,32 +560,19 @@ void runtasks(LState *const rootState) {
 					stillRunning = luaD_call(base + 1, 255);
 				}
 			}
-			nextState = lua_state->next;
 			// The state returned. Delete it
 			if (!stillRunning) {
 				lua_statedeinit(lua_state);
 				luaM_free(lua_state);
-			} else {
-				lua_state->updated = true;
+			} else if (lua_state->sleepFor > 0) {
+				lua_tasksleep(lua_state);
 			}
-		} else {
-			nextState = lua_state->next;
 		}
-		lua_state = nextState;
-	}
+	} while (ran);
 
+	runCursor = nullptr;
 	// Restore the value of lua_state to the main script
 	lua_state = rootState;
-	// Check for states that may have been created in this run.
-	LState *state = lua_state->next;
-	while (state) {
-		if (!state->all_paused && !state->paused && !state->updated) {
-			// New state! Run a new pass.
-			runtasks(rootState);
-			return;
-		}
-		state = state->next;
-	}
 }
 
 } // end of namespace Grim
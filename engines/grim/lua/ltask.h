@@ -38,6 +38,14 @@ void sleep_for();
 
 void runtasks(LState *const rootState);
 
+// Scheduler bookkeeping, see ltask.cpp
+void lua_taskschedule(LState *state);
+void lua_taskunschedule(LState *state);
+void lua_taskresetscheduler();
+void lua_taskrebuildscheduler();
+bool lua_taskupdated(LState *state);
+int32 lua_tasksleeptime(LState *state);
+
 } // end of namespace Grim
 
 #endif
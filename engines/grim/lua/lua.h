@@ -111,6 +111,22 @@ void lua_pushCclosure(lua_CFunction fn, int32 n);
 void lua_pushusertag(int32 id, int32 tag);
 void lua_pushobject(lua_Object object);
 
+struct TaggedString;
+
+/*
+** A string literal that is interned once per Lua session and kept from
+** collection, so that hot engine code can push it without hashing it again.
+*/
+struct lua_ConstString {
+	const char *str;
+	TaggedString *ts;
+	int32 session;
+};
+
+#define LUA_CONSTSTRING(s)	{ s, nullptr, 0 }
+
+void lua_pushconststring(lua_ConstString *s);
+
 lua_Object lua_pop();
 lua_Object lua_getglobal(const char *name);
 lua_Object lua_rawgetglobal(const char *name);
@@ -131,6 +147,44 @@ void lua_unref(int32 ref);
 lua_Object lua_createtable();
 int32 lua_collectgarbage(int32 limit);
 
+/*
+** Incremental garbage collection. A collection cycle is started when the
+** memory in use crosses the GC threshold, or by lua_startgarbage, and
+** advanced by lua_stepgarbage, which does about "budget" microseconds of work.
+*/
+struct lua_GCStats {
+	bool running;  // marking
+	bool sweeping;
+	int32 cycles;
+	int32 steps;
+	int32 fullCollections;
+	int32 lastStepWork;  // marking or sweeping work done in the last step
+	int32 lastStepLimit;  // and the amount of work its budget allowed
+	// Pause times are in milliseconds, measured with the system clock.
+	uint32 lastStepTime;  // including the final mark step
+	uint32 maxStepTime;
+	uint32 lastFinishTime;  // final, atomic mark step of a cycle
+	uint32 maxFinishTime;
+	uint32 lastFullTime;  // lua_collectgarbage
+	uint32 lastStepEstimate;  // microseconds, estimated from the work done
+	int32 workRate;  // collector work done per millisecond
+};
+
+void lua_startgarbage();
+void lua_stepgarbage(int32 budget);
+void lua_getgcstats(lua_GCStats *stats);
+
+struct lua_TaskStats {
+	int32 runnable;
+	int32 sleeping;
+	int32 paused;
+	int32 lastTasksRun;  // tasks resumed in the last frame
+	int32 maxTasksRun;
+	int32 lastPasses;  // scheduler passes in the last frame
+};
+
+void lua_gettaskstats(lua_TaskStats *stats);
+
 void lua_runtasks();
 void current_script();
 
@@ -3,11 +3,15 @@
 ** See Copyright Notice in lua.h
 */
 
+#define FORBIDDEN_SYMBOL_EXCEPTION_setjmp
+#define FORBIDDEN_SYMBOL_EXCEPTION_longjmp
+
 #include "engines/grim/lua/lauxlib.h"
 #include "engines/grim/lua/lfunc.h"
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lstring.h"
 #include "engines/grim/lua/lundump.h"
+#include "engines/grim/lua/lvm.h"
 
 namespace Grim {
 
@@ -123,6 +127,7 @@ static TProtoFunc *LoadFunction(ZIO *Z) {
 	tf->lineDefined = LoadWord(Z);
 	tf->fileName = LoadTString(Z);
 	tf->code = (byte *)LoadBlock(LoadSize(Z), Z);
+	luaV_fuseopcodes(tf);
 	LoadConstants(tf, Z);
 	LoadLocals(tf, Z);
 	LoadFunctions(tf, Z);
@@ -28,6 +28,36 @@ namespace Grim {
 
 #define	EXTRA_STACK	5
 
+/*
+** Where the compiler supports taking the address of a label, every opcode
+** jumps straight to the handler of the next one through a table, instead of
+** going back to a single switch. The switch is kept as the fallback.
+*/
+#if defined(__GNUC__) && !defined(LUA_DEBUG)
+#define LUA_COMPUTED_GOTO
+#endif
+
+#ifdef LUA_COMPUTED_GOTO
+#define vmdispatch(o)	goto *dispatchTable[o];
+#define vmcase(op)		L_##op:
+#define vmbreak			vmdispatch(aux = *task->pc++)
+#else
+#define vmdispatch(o)	switch ((OpCode)(o))
+#define vmcase(op)		case op:
+#define vmbreak			break
+#endif
+
+const int32 luaV_opcodeSize[NUM_OPCODES] = {
+	1, 2, 1, 2, 1, 1, 1, 3, 2, 1, 1, 1, 1, 1, 1, 1, 1, 3, 2, 1,
+	1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 3,
+	1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 3, 2, 1, 1, 1, 1, 1, 1, 1, 1,
+	3, 2, 1, 1, 3, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 1,
+	1, 1, 1, 3, 1, 2, 3, 2, 4, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 1, 1,
+	3, 2, 2, 2, 2, 3, 2, 1, 1, 2, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1,
+	1, 1, 1, 1, 1, 1, 1
+};
+
 static TaggedString *strconc(char *l, char *r) {
 	size_t nl = strlen(l);
 	char *buffer = luaL_openspace(nl + strlen(r) + 1);
@@ -241,6 +271,32 @@ static void adjust_varargs(StkId first_extra_arg) {
 	*lua_state->stack.top++ = arg;
 }
 
+/*
+** Replace the most frequent pairs of opcodes in a function with a
+** superinstruction. The code keeps its size, and the second opcode of a pair
+** stays in place, since a jump may land on it.
+*/
+void luaV_fuseopcodes(TProtoFunc *tf) {
+	byte *pc = tf->code + 2;
+	while (*pc != ENDCODE) {
+		byte op = *pc;
+		byte *next = pc + luaV_opcodeSize[op];
+		if (op >= PUSHLOCAL && op <= PUSHLOCAL7) {
+			if (*next == GETTABLE)
+				*pc = PUSHLOCALGETTABLE + (op - PUSHLOCAL);
+			else if (*next >= GETDOTTED && *next <= GETDOTTEDW)
+				*pc = PUSHLOCALGETDOTTED + (op - PUSHLOCAL);
+		}
+		pc = next;
+	}
+}
+
+#ifdef LUA_COMPUTED_GOTO
+// Computed gotos are a GCC extension, also supported by Clang
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
 StkId luaV_execute(lua_Task *task) {
 	if (!task->some_flag) {
 		luaD_checkstack((*task->pc++) + EXTRA_STACK);
@@ -254,257 +310,289 @@ StkId luaV_execute(lua_Task *task) {
 	}
 	lua_state->state_counter2++;
 
+	int32 aux;
+#ifdef LUA_COMPUTED_GOTO
+	static const void *const dispatchTable[NUM_OPCODES] = {
+		&&L_ENDCODE, &&L_PUSHNIL, &&L_PUSHNIL0, &&L_PUSHNUMBER, &&L_PUSHNUMBER0, &&L_PUSHNUMBER1,
+		&&L_PUSHNUMBER2, &&L_PUSHNUMBERW, &&L_PUSHCONSTANT, &&L_PUSHCONSTANT0, &&L_PUSHCONSTANT1,
+		&&L_PUSHCONSTANT2, &&L_PUSHCONSTANT3, &&L_PUSHCONSTANT4, &&L_PUSHCONSTANT5, &&L_PUSHCONSTANT6,
+		&&L_PUSHCONSTANT7, &&L_PUSHCONSTANTW, &&L_PUSHUPVALUE, &&L_PUSHUPVALUE0, &&L_PUSHUPVALUE1,
+		&&L_PUSHLOCAL, &&L_PUSHLOCAL0, &&L_PUSHLOCAL1, &&L_PUSHLOCAL2, &&L_PUSHLOCAL3, &&L_PUSHLOCAL4,
+		&&L_PUSHLOCAL5, &&L_PUSHLOCAL6, &&L_PUSHLOCAL7, &&L_GETGLOBAL, &&L_GETGLOBAL0, &&L_GETGLOBAL1,
+		&&L_GETGLOBAL2, &&L_GETGLOBAL3, &&L_GETGLOBAL4, &&L_GETGLOBAL5, &&L_GETGLOBAL6, &&L_GETGLOBAL7,
+		&&L_GETGLOBALW, &&L_GETTABLE, &&L_GETDOTTED, &&L_GETDOTTED0, &&L_GETDOTTED1, &&L_GETDOTTED2,
+		&&L_GETDOTTED3, &&L_GETDOTTED4, &&L_GETDOTTED5, &&L_GETDOTTED6, &&L_GETDOTTED7, &&L_GETDOTTEDW,
+		&&L_PUSHSELF, &&L_PUSHSELF0, &&L_PUSHSELF1, &&L_PUSHSELF2, &&L_PUSHSELF3, &&L_PUSHSELF4,
+		&&L_PUSHSELF5, &&L_PUSHSELF6, &&L_PUSHSELF7, &&L_PUSHSELFW, &&L_CREATEARRAY, &&L_CREATEARRAY0,
+		&&L_CREATEARRAY1, &&L_CREATEARRAYW, &&L_SETLOCAL, &&L_SETLOCAL0, &&L_SETLOCAL1, &&L_SETLOCAL2,
+		&&L_SETLOCAL3, &&L_SETLOCAL4, &&L_SETLOCAL5, &&L_SETLOCAL6, &&L_SETLOCAL7, &&L_SETGLOBAL,
+		&&L_SETGLOBAL0, &&L_SETGLOBAL1, &&L_SETGLOBAL2, &&L_SETGLOBAL3, &&L_SETGLOBAL4, &&L_SETGLOBAL5,
+		&&L_SETGLOBAL6, &&L_SETGLOBAL7, &&L_SETGLOBALW, &&L_SETTABLE0, &&L_SETTABLE, &&L_SETLIST,
+		&&L_SETLIST0, &&L_SETLISTW, &&L_SETMAP, &&L_SETMAP0, &&L_EQOP, &&L_NEQOP, &&L_LTOP, &&L_LEOP,
+		&&L_GTOP, &&L_GEOP, &&L_ADDOP, &&L_SUBOP, &&L_MULTOP, &&L_DIVOP, &&L_POWOP, &&L_CONCOP,
+		&&L_MINUSOP, &&L_NOTOP, &&L_ONTJMP, &&L_ONTJMPW, &&L_ONFJMP, &&L_ONFJMPW, &&L_JMP, &&L_JMPW,
+		&&L_IFFJMP, &&L_IFFJMPW, &&L_IFTUPJMP, &&L_IFTUPJMPW, &&L_IFFUPJMP, &&L_IFFUPJMPW, &&L_CLOSURE,
+		&&L_CLOSURE0, &&L_CLOSURE1, &&L_CALLFUNC, &&L_CALLFUNC0, &&L_CALLFUNC1, &&L_RETCODE, &&L_SETLINE,
+		&&L_SETLINEW, &&L_POP, &&L_POP0, &&L_POP1, &&L_PUSHLOCALGETTABLE, &&L_PUSHLOCALGETTABLE0,
+		&&L_PUSHLOCALGETTABLE1, &&L_PUSHLOCALGETTABLE2, &&L_PUSHLOCALGETTABLE3, &&L_PUSHLOCALGETTABLE4,
+		&&L_PUSHLOCALGETTABLE5, &&L_PUSHLOCALGETTABLE6, &&L_PUSHLOCALGETTABLE7, &&L_PUSHLOCALGETDOTTED,
+		&&L_PUSHLOCALGETDOTTED0, &&L_PUSHLOCALGETDOTTED1, &&L_PUSHLOCALGETDOTTED2,
+		&&L_PUSHLOCALGETDOTTED3, &&L_PUSHLOCALGETDOTTED4, &&L_PUSHLOCALGETDOTTED5,
+		&&L_PUSHLOCALGETDOTTED6, &&L_PUSHLOCALGETDOTTED7
+	};
+#endif
+
 	while (1) {
-		switch ((OpCode)(task->aux = *task->pc++)) {
-		case PUSHNIL0:
+		vmdispatch(aux = *task->pc++) {
+		vmcase(PUSHNIL0)
 			ttype(task->S->top++) = LUA_T_NIL;
-			break;
-		case PUSHNIL:
-			task->aux = *task->pc++;
+			vmbreak;
+		vmcase(PUSHNIL)
+			aux = *task->pc++;
 			do {
 				ttype(task->S->top++) = LUA_T_NIL;
-			} while (task->aux--);
-			break;
-		case PUSHNUMBER:
-			task->aux = *task->pc++;
+			} while (aux--);
+			vmbreak;
+		vmcase(PUSHNUMBER)
+			aux = *task->pc++;
 			goto pushnumber;
-		case PUSHNUMBERW:
-			task->aux = next_word(task->pc);
+		vmcase(PUSHNUMBERW)
+			aux = next_word(task->pc);
 			goto pushnumber;
-		case PUSHNUMBER0:
-		case PUSHNUMBER1:
-		case PUSHNUMBER2:
-			task->aux -= PUSHNUMBER0;
+		vmcase(PUSHNUMBER0)
+		vmcase(PUSHNUMBER1)
+		vmcase(PUSHNUMBER2)
+			aux -= PUSHNUMBER0;
 pushnumber:
 			ttype(task->S->top) = LUA_T_NUMBER;
-			nvalue(task->S->top) = (float)task->aux;
+			nvalue(task->S->top) = (float)aux;
 			task->S->top++;
-			break;
-		case PUSHLOCAL:
-			task->aux = *task->pc++;
+			vmbreak;
+		vmcase(PUSHLOCAL)
+			aux = *task->pc++;
 			goto pushlocal;
-		case PUSHLOCAL0:
-		case PUSHLOCAL1:
-		case PUSHLOCAL2:
-		case PUSHLOCAL3:
-		case PUSHLOCAL4:
-		case PUSHLOCAL5:
-		case PUSHLOCAL6:
-		case PUSHLOCAL7:
-			task->aux -= PUSHLOCAL0;
+		vmcase(PUSHLOCAL0)
+		vmcase(PUSHLOCAL1)
+		vmcase(PUSHLOCAL2)
+		vmcase(PUSHLOCAL3)
+		vmcase(PUSHLOCAL4)
+		vmcase(PUSHLOCAL5)
+		vmcase(PUSHLOCAL6)
+		vmcase(PUSHLOCAL7)
+			aux -= PUSHLOCAL0;
 pushlocal:
-			*task->S->top++ = *((task->S->stack + task->base) + task->aux);
-			break;
-		case GETGLOBALW:
-			task->aux = next_word(task->pc);
+			*task->S->top++ = *((task->S->stack + task->base) + aux);
+			vmbreak;
+		vmcase(GETGLOBALW)
+			aux = next_word(task->pc);
 			goto getglobal;
-		case GETGLOBAL:
-			task->aux = *task->pc++;
+		vmcase(GETGLOBAL)
+			aux = *task->pc++;
 			goto getglobal;
-		case GETGLOBAL0:
-		case GETGLOBAL1:
-		case GETGLOBAL2:
-		case GETGLOBAL3:
-		case GETGLOBAL4:
-		case GETGLOBAL5:
-		case GETGLOBAL6:
-		case GETGLOBAL7:
-			task->aux -= GETGLOBAL0;
+		vmcase(GETGLOBAL0)
+		vmcase(GETGLOBAL1)
+		vmcase(GETGLOBAL2)
+		vmcase(GETGLOBAL3)
+		vmcase(GETGLOBAL4)
+		vmcase(GETGLOBAL5)
+		vmcase(GETGLOBAL6)
+		vmcase(GETGLOBAL7)
+			aux -= GETGLOBAL0;
 getglobal:
-			luaV_getglobal(tsvalue(&task->consts[task->aux]));
-			break;
-		case GETTABLE:
+			luaV_getglobal(tsvalue(&task->consts[aux]));
+			vmbreak;
+		vmcase(GETTABLE)
 			luaV_gettable();
-			break;
-		case GETDOTTEDW:
-			task->aux = next_word(task->pc); goto getdotted;
-		case GETDOTTED:
-			task->aux = *task->pc++;
+			vmbreak;
+		vmcase(GETDOTTEDW)
+			aux = next_word(task->pc); goto getdotted;
+		vmcase(GETDOTTED)
+			aux = *task->pc++;
 			goto getdotted;
-		case GETDOTTED0:
-		case GETDOTTED1:
-		case GETDOTTED2:
-		case GETDOTTED3:
-		case GETDOTTED4:
-		case GETDOTTED5:
-		case GETDOTTED6:
-		case GETDOTTED7:
-			task->aux -= GETDOTTED0;
+		vmcase(GETDOTTED0)
+		vmcase(GETDOTTED1)
+		vmcase(GETDOTTED2)
+		vmcase(GETDOTTED3)
+		vmcase(GETDOTTED4)
+		vmcase(GETDOTTED5)
+		vmcase(GETDOTTED6)
+		vmcase(GETDOTTED7)
+			aux -= GETDOTTED0;
 getdotted:
-			*task->S->top++ = task->consts[task->aux];
+			*task->S->top++ = task->consts[aux];
 			luaV_gettable();
-			break;
-		case PUSHSELFW:
-			task->aux = next_word(task->pc);
+			vmbreak;
+		vmcase(PUSHSELFW)
+			aux = next_word(task->pc);
 			goto pushself;
-		case PUSHSELF:
-			task->aux = *task->pc++;
+		vmcase(PUSHSELF)
+			aux = *task->pc++;
 			goto pushself;
-		case PUSHSELF0:
-		case PUSHSELF1:
-		case PUSHSELF2:
-		case PUSHSELF3:
-		case PUSHSELF4:
-		case PUSHSELF5:
-		case PUSHSELF6:
-		case PUSHSELF7:
-			task->aux -= PUSHSELF0;
+		vmcase(PUSHSELF0)
+		vmcase(PUSHSELF1)
+		vmcase(PUSHSELF2)
+		vmcase(PUSHSELF3)
+		vmcase(PUSHSELF4)
+		vmcase(PUSHSELF5)
+		vmcase(PUSHSELF6)
+		vmcase(PUSHSELF7)
+			aux -= PUSHSELF0;
 pushself:
 			{
 				TObject receiver = *(task->S->top - 1);
-				*task->S->top++ = task->consts[task->aux];
+				*task->S->top++ = task->consts[aux];
 				luaV_gettable();
 				*task->S->top++ = receiver;
-				break;
+				vmbreak;
 			}
-		case PUSHCONSTANTW:
-			task->aux = next_word(task->pc);
+		vmcase(PUSHCONSTANTW)
+			aux = next_word(task->pc);
 			goto pushconstant;
-		case PUSHCONSTANT:
-			task->aux = *task->pc++; goto pushconstant;
-		case PUSHCONSTANT0:
-		case PUSHCONSTANT1:
-		case PUSHCONSTANT2:
-		case PUSHCONSTANT3:
-		case PUSHCONSTANT4:
-		case PUSHCONSTANT5:
-		case PUSHCONSTANT6:
-		case PUSHCONSTANT7:
-			task->aux -= PUSHCONSTANT0;
+		vmcase(PUSHCONSTANT)
+			aux = *task->pc++; goto pushconstant;
+		vmcase(PUSHCONSTANT0)
+		vmcase(PUSHCONSTANT1)
+		vmcase(PUSHCONSTANT2)
+		vmcase(PUSHCONSTANT3)
+		vmcase(PUSHCONSTANT4)
+		vmcase(PUSHCONSTANT5)
+		vmcase(PUSHCONSTANT6)
+		vmcase(PUSHCONSTANT7)
+			aux -= PUSHCONSTANT0;
 pushconstant:
-			*task->S->top++ = task->consts[task->aux];
-			break;
-		case PUSHUPVALUE:
-			task->aux = *task->pc++;
+			*task->S->top++ = task->consts[aux];
+			vmbreak;
+		vmcase(PUSHUPVALUE)
+			aux = *task->pc++;
 			goto pushupvalue;
-		case PUSHUPVALUE0:
-		case PUSHUPVALUE1:
-			task->aux -= PUSHUPVALUE0;
+		vmcase(PUSHUPVALUE0)
+		vmcase(PUSHUPVALUE1)
+			aux -= PUSHUPVALUE0;
 pushupvalue:
-			*task->S->top++ = task->cl->consts[task->aux + 1];
-			break;
-		case SETLOCAL:
-			task->aux = *task->pc++;
+			*task->S->top++ = task->cl->consts[aux + 1];
+			vmbreak;
+		vmcase(SETLOCAL)
+			aux = *task->pc++;
 			goto setlocal;
-		case SETLOCAL0:
-		case SETLOCAL1:
-		case SETLOCAL2:
-		case SETLOCAL3:
-		case SETLOCAL4:
-		case SETLOCAL5:
-		case SETLOCAL6:
-		case SETLOCAL7:
-			task->aux -= SETLOCAL0;
+		vmcase(SETLOCAL0)
+		vmcase(SETLOCAL1)
+		vmcase(SETLOCAL2)
+		vmcase(SETLOCAL3)
+		vmcase(SETLOCAL4)
+		vmcase(SETLOCAL5)
+		vmcase(SETLOCAL6)
+		vmcase(SETLOCAL7)
+			aux -= SETLOCAL0;
 setlocal:
-			*((task->S->stack + task->base) + task->aux) = *(--task->S->top);
-			break;
-		case SETGLOBALW:
-			task->aux = next_word(task->pc);
+			*((task->S->stack + task->base) + aux) = *(--task->S->top);
+			vmbreak;
+		vmcase(SETGLOBALW)
+			aux = next_word(task->pc);
 			goto setglobal;
-		case SETGLOBAL:
-			task->aux = *task->pc++;
+		vmcase(SETGLOBAL)
+			aux = *task->pc++;
 			goto setglobal;
-		case SETGLOBAL0:
-		case SETGLOBAL1:
-		case SETGLOBAL2:
-		case SETGLOBAL3:
-		case SETGLOBAL4:
-		case SETGLOBAL5:
-		case SETGLOBAL6:
-		case SETGLOBAL7:
-			task->aux -= SETGLOBAL0;
+		vmcase(SETGLOBAL0)
+		vmcase(SETGLOBAL1)
+		vmcase(SETGLOBAL2)
+		vmcase(SETGLOBAL3)
+		vmcase(SETGLOBAL4)
+		vmcase(SETGLOBAL5)
+		vmcase(SETGLOBAL6)
+		vmcase(SETGLOBAL7)
+			aux -= SETGLOBAL0;
 setglobal:
-			luaV_setglobal(tsvalue(&task->consts[task->aux]));
-			break;
-		case SETTABLE0:
+			luaV_setglobal(tsvalue(&task->consts[aux]));
+			vmbreak;
+		vmcase(SETTABLE0)
 			luaV_settable(task->S->top - 3, 1);
-			break;
-		case SETTABLE:
+			vmbreak;
+		vmcase(SETTABLE)
 			luaV_settable(task->S->top - 3 - (*task->pc++), 2);
-			break;
-		case SETLISTW:
-			task->aux = next_word(task->pc);
-			task->aux *= LFIELDS_PER_FLUSH;
+			vmbreak;
+		vmcase(SETLISTW)
+			aux = next_word(task->pc);
+			aux *= LFIELDS_PER_FLUSH;
 			goto setlist;
-		case SETLIST:
-			task->aux = *(task->pc++) * LFIELDS_PER_FLUSH;
+		vmcase(SETLIST)
+			aux = *(task->pc++) * LFIELDS_PER_FLUSH;
 			goto setlist;
-		case SETLIST0:
-			task->aux = 0;
+		vmcase(SETLIST0)
+			aux = 0;
 setlist:
 			{
 				int32 n = *(task->pc++);
 				TObject *arr = task->S->top - n - 1;
 				for (; n; n--) {
 					ttype(task->S->top) = LUA_T_NUMBER;
-					nvalue(task->S->top) = (float)(n + task->aux);
+					nvalue(task->S->top) = (float)(n + aux);
 					*(luaH_set(avalue(arr), task->S->top)) = *(task->S->top - 1);
 					task->S->top--;
 			}
-			break;
+			vmbreak;
 		}
-		case SETMAP0:
-			task->aux = 0;
+		vmcase(SETMAP0)
+			aux = 0;
 			goto setmap;
-		case SETMAP:
-			task->aux = *task->pc++;
+		vmcase(SETMAP)
+			aux = *task->pc++;
 setmap:
 			{
-				TObject *arr = task->S->top - (2 * task->aux) - 3;
+				TObject *arr = task->S->top - (2 * aux) - 3;
 				do {
 					*(luaH_set(avalue(arr), task->S->top - 2)) = *(task->S->top - 1);
 					task->S->top -= 2;
-				} while (task->aux--);
-				break;
+				} while (aux--);
+				vmbreak;
 			}
-		case POP:
-			task->aux = *task->pc++;
+		vmcase(POP)
+			aux = *task->pc++;
 			goto pop;
-		case POP0:
-		case POP1:
-			task->aux -= POP0;
+		vmcase(POP0)
+		vmcase(POP1)
+			aux -= POP0;
 pop:
-			task->S->top -= (task->aux + 1);
-			break;
-		case CREATEARRAYW:
-			task->aux = next_word(task->pc);
+			task->S->top -= (aux + 1);
+			vmbreak;
+		vmcase(CREATEARRAYW)
+			aux = next_word(task->pc);
 			goto createarray;
-		case CREATEARRAY0:
-		case CREATEARRAY1:
-			task->aux -= CREATEARRAY0;
+		vmcase(CREATEARRAY0)
+		vmcase(CREATEARRAY1)
+			aux -= CREATEARRAY0;
 			goto createarray;
-		case CREATEARRAY:
-			task->aux = *task->pc++;
+		vmcase(CREATEARRAY)
+			aux = *task->pc++;
 createarray:
 			luaC_checkGC();
-			avalue(task->S->top) = luaH_new(task->aux);
+			avalue(task->S->top) = luaH_new(aux);
 			ttype(task->S->top) = LUA_T_ARRAY;
 			task->S->top++;
-			break;
-		case EQOP:
-		case NEQOP:
+			vmbreak;
+		vmcase(EQOP)
+		vmcase(NEQOP)
 			{
 				int32 res = luaO_equalObj(task->S->top - 2, task->S->top - 1);
 				task->S->top--;
-				if (task->aux == NEQOP)
+				if (aux == NEQOP)
 					res = !res;
 				ttype(task->S->top - 1) = res ? LUA_T_NUMBER : LUA_T_NIL;
 				nvalue(task->S->top - 1) = 1;
-				break;
+				vmbreak;
 			}
-		case LTOP:
+		vmcase(LTOP)
 			comparison(LUA_T_NUMBER, LUA_T_NIL, LUA_T_NIL, IM_LT);
-			break;
-		case LEOP:
+			vmbreak;
+		vmcase(LEOP)
 			comparison(LUA_T_NUMBER, LUA_T_NUMBER, LUA_T_NIL, IM_LE);
-			break;
-		case GTOP:
+			vmbreak;
+		vmcase(GTOP)
 			comparison(LUA_T_NIL, LUA_T_NIL, LUA_T_NUMBER, IM_GT);
-			break;
-		case GEOP:
+			vmbreak;
+		vmcase(GEOP)
 			comparison(LUA_T_NIL, LUA_T_NUMBER, LUA_T_NUMBER, IM_GE);
-			break;
-		case ADDOP:
+			vmbreak;
+		vmcase(ADDOP)
 			{
 				TObject *l = task->S->top - 2;
 				TObject *r = task->S->top - 1;
@@ -514,9 +602,9 @@ createarray:
 					nvalue(l) += nvalue(r);
 					--task->S->top;
 				}
-			break;
+			vmbreak;
 			}
-		case SUBOP:
+		vmcase(SUBOP)
 			{
 				TObject *l = task->S->top - 2;
 				TObject *r = task->S->top - 1;
@@ -526,9 +614,9 @@ createarray:
 					nvalue(l) -= nvalue(r);
 					--task->S->top;
 				}
-				break;
+				vmbreak;
 			}
-		case MULTOP:
+		vmcase(MULTOP)
 			{
 				TObject *l = task->S->top - 2;
 				TObject *r = task->S->top - 1;
@@ -538,9 +626,9 @@ createarray:
 					nvalue(l) *= nvalue(r);
 					--task->S->top;
 				}
-				break;
+				vmbreak;
 			}
-		case DIVOP:
+		vmcase(DIVOP)
 			{
 				TObject *l = task->S->top - 2;
 				TObject *r = task->S->top - 1;
@@ -550,12 +638,12 @@ createarray:
 					nvalue(l) /= nvalue(r);
 					--task->S->top;
 				}
-				break;
+				vmbreak;
 			}
-		case POWOP:
+		vmcase(POWOP)
 			call_arith(IM_POW);
-			break;
-		case CONCOP:
+			vmbreak;
+		vmcase(CONCOP)
 			{
 				TObject *l = task->S->top - 2;
 				TObject *r = task->S->top - 1;
@@ -566,107 +654,109 @@ createarray:
 					--task->S->top;
 				}
 				luaC_checkGC();
-				break;
+				vmbreak;
 			}
-		case MINUSOP:
+		vmcase(MINUSOP)
 			if (tonumber(task->S->top - 1)) {
 				ttype(task->S->top) = LUA_T_NIL;
 				task->S->top++;
 				call_arith(IM_UNM);
 			} else
 				nvalue(task->S->top - 1) = -nvalue(task->S->top - 1);
-			break;
-		case NOTOP:
+			vmbreak;
+		vmcase(NOTOP)
 			ttype(task->S->top - 1) = (ttype(task->S->top - 1) == LUA_T_NIL) ? LUA_T_NUMBER : LUA_T_NIL;
 			nvalue(task->S->top - 1) = 1;
-			break;
-		case ONTJMPW:
-			task->aux = next_word(task->pc);
+			vmbreak;
+		vmcase(ONTJMPW)
+			aux = next_word(task->pc);
 			goto ontjmp;
-		case ONTJMP:
-			task->aux = *task->pc++;
+		vmcase(ONTJMP)
+			aux = *task->pc++;
 ontjmp:
 			if (ttype(task->S->top - 1) != LUA_T_NIL)
-				task->pc += task->aux;
+				task->pc += aux;
 			else
 				task->S->top--;
-			break;
-		case ONFJMPW:
-			task->aux = next_word(task->pc);
+			vmbreak;
+		vmcase(ONFJMPW)
+			aux = next_word(task->pc);
 			goto onfjmp;
-		case ONFJMP:
-			task->aux = *task->pc++;
+		vmcase(ONFJMP)
+			aux = *task->pc++;
 onfjmp:
 			if (ttype(task->S->top - 1) == LUA_T_NIL)
-				task->pc += task->aux;
+				task->pc += aux;
 			else
 				task->S->top--;
-			break;
-		case JMPW:
-			task->aux = next_word(task->pc);
+			vmbreak;
+		vmcase(JMPW)
+			aux = next_word(task->pc);
 			goto jmp;
-		case JMP:
-			task->aux = *task->pc++;
+		vmcase(JMP)
+			aux = *task->pc++;
 jmp:
-			task->pc += task->aux;
-			break;
-		case IFFJMPW:
-			task->aux = next_word(task->pc);
+			task->pc += aux;
+			vmbreak;
+		vmcase(IFFJMPW)
+			aux = next_word(task->pc);
 			goto iffjmp;
-		case IFFJMP:
-			task->aux = *task->pc++;
+		vmcase(IFFJMP)
+			aux = *task->pc++;
 iffjmp:
 			if (ttype(--task->S->top) == LUA_T_NIL)
-				task->pc += task->aux;
-			break;
-		case IFTUPJMPW:
-			task->aux = next_word(task->pc);
+				task->pc += aux;
+			vmbreak;
+		vmcase(IFTUPJMPW)
+			aux = next_word(task->pc);
 			goto iftupjmp;
-		case IFTUPJMP:
-			task->aux = *task->pc++;
+		vmcase(IFTUPJMP)
+			aux = *task->pc++;
 iftupjmp:
 			if (ttype(--task->S->top) != LUA_T_NIL)
-				task->pc -= task->aux;
-			break;
-		case IFFUPJMPW:
-			task->aux = next_word(task->pc);
+				task->pc -= aux;
+			vmbreak;
+		vmcase(IFFUPJMPW)
+			aux = next_word(task->pc);
 			goto iffupjmp;
-		case IFFUPJMP:
-			task->aux = *task->pc++;
+		vmcase(IFFUPJMP)
+			aux = *task->pc++;
 iffupjmp:
 			if (ttype(--task->S->top) == LUA_T_NIL)
-				task->pc -= task->aux;
-			break;
-		case CLOSURE:
-			task->aux = *task->pc++;
+				task->pc -= aux;
+			vmbreak;
+		vmcase(CLOSURE)
+			aux = *task->pc++;
 			goto closure;
-		case CLOSURE0:
-		case CLOSURE1:
-			task->aux -= CLOSURE0;
+		vmcase(CLOSURE0)
+		vmcase(CLOSURE1)
+			aux -= CLOSURE0;
 closure:
-			luaV_closure(task->aux);
+			luaV_closure(aux);
 			luaC_checkGC();
-			break;
-	  case CALLFUNC:
-			task->aux = *task->pc++;
+			vmbreak;
+	  vmcase(CALLFUNC)
+			aux = *task->pc++;
 			goto callfunc;
-	  case CALLFUNC0:
-	  case CALLFUNC1:
-			task->aux -= CALLFUNC0;
+	  vmcase(CALLFUNC0)
+	  vmcase(CALLFUNC1)
+			aux -= CALLFUNC0;
 callfunc:
+			task->aux = aux;
 			lua_state->state_counter2--;
 			return -((task->S->top - task->S->stack) - (*task->pc++));
-		case ENDCODE:
+		vmcase(ENDCODE)
 			task->S->top = task->S->stack + task->base;
 			// goes through
-		case RETCODE:
+		vmcase(RETCODE)
+			task->aux = aux;
 			lua_state->state_counter2--;
-			return (task->base + ((task->aux == 123) ? *task->pc : 0));
-		case SETLINEW:
-			task->aux = next_word(task->pc);
+			return (task->base + ((aux == RETCODE) ? *task->pc : 0));
+		vmcase(SETLINEW)
+			aux = next_word(task->pc);
 			goto setline;
-		case SETLINE:
-			task->aux = *task->pc++;
+		vmcase(SETLINE)
+			aux = *task->pc++;
 setline:
 			if ((task->S->stack + task->base - 1)->ttype != LUA_T_LINE) {
 				// open space for LINE value */
@@ -674,10 +764,51 @@ setline:
 				task->base++;
 				(task->S->stack + task->base - 1)->ttype = LUA_T_LINE;
 			}
-			(task->S->stack + task->base - 1)->value.i = task->aux;
+			(task->S->stack + task->base - 1)->value.i = aux;
 			if (lua_linehook)
-				luaD_lineHook(task->aux);
-			break;
+				luaD_lineHook(aux);
+			vmbreak;
+		vmcase(PUSHLOCALGETTABLE)
+			aux = *task->pc++;
+			goto pushlocalgettable;
+		vmcase(PUSHLOCALGETTABLE0)
+		vmcase(PUSHLOCALGETTABLE1)
+		vmcase(PUSHLOCALGETTABLE2)
+		vmcase(PUSHLOCALGETTABLE3)
+		vmcase(PUSHLOCALGETTABLE4)
+		vmcase(PUSHLOCALGETTABLE5)
+		vmcase(PUSHLOCALGETTABLE6)
+		vmcase(PUSHLOCALGETTABLE7)
+			aux -= PUSHLOCALGETTABLE0;
+pushlocalgettable:
+			*task->S->top++ = *((task->S->stack + task->base) + aux);
+			task->pc++;  // skip the GETTABLE
+			luaV_gettable();
+			vmbreak;
+		vmcase(PUSHLOCALGETDOTTED)
+			aux = *task->pc++;
+			goto pushlocalgetdotted;
+		vmcase(PUSHLOCALGETDOTTED0)
+		vmcase(PUSHLOCALGETDOTTED1)
+		vmcase(PUSHLOCALGETDOTTED2)
+		vmcase(PUSHLOCALGETDOTTED3)
+		vmcase(PUSHLOCALGETDOTTED4)
+		vmcase(PUSHLOCALGETDOTTED5)
+		vmcase(PUSHLOCALGETDOTTED6)
+		vmcase(PUSHLOCALGETDOTTED7)
+			aux -= PUSHLOCALGETDOTTED0;
+pushlocalgetdotted:
+			*task->S->top++ = *((task->S->stack + task->base) + aux);
+			aux = *task->pc++;
+			if (aux == GETDOTTEDW)
+				aux = next_word(task->pc);
+			else if (aux == GETDOTTED)
+				aux = *task->pc++;
+			else
+				aux -= GETDOTTED0;
+			*task->S->top++ = task->consts[aux];
+			luaV_gettable();
+			vmbreak;
 #ifdef LUA_DEBUG
 		default:
 			LUA_INTERNALERROR("internal error - opcode doesn't match");
@@ -686,4 +817,8 @@ setline:
 	}
 }
 
+#ifdef LUA_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
+
 } // end of namespace Grim
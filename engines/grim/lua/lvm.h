@@ -9,6 +9,7 @@
 
 #include "engines/grim/lua/ldo.h"
 #include "engines/grim/lua/lobject.h"
+#include "engines/grim/lua/lopcodes.h"
 
 namespace Grim {
 
@@ -24,6 +25,9 @@ void luaV_settable(TObject *t, int32 mode);
 void luaV_getglobal(TaggedString *ts);
 void luaV_setglobal(TaggedString *ts);
 void luaV_closure(int32 nelems);
+void luaV_fuseopcodes(TProtoFunc *tf);
+
+extern const int32 luaV_opcodeSize[NUM_OPCODES];  // size of each opcode, with its parameters
 
 } // end of namespace Grim
 
@@ -56,6 +56,11 @@ byte clamp_color(int c) {
 
 int luaA_passresults();
 
+// vector components, read and written by the math opcodes
+static lua_ConstString keyX = LUA_CONSTSTRING("x");
+static lua_ConstString keyY = LUA_CONSTSTRING("y");
+static lua_ConstString keyZ = LUA_CONSTSTRING("z");
+
 void Lua_V1::new_dofile() {
 	const char *fname_str = luaL_check_string(1);
 	if (dofile(fname_str) == 0)
@@ -245,27 +250,27 @@ void Lua_V1::GetAngleBetweenVectors() {
 	}
 
 	lua_pushobject(vec1Obj);
-	lua_pushstring("x");
+	lua_pushconststring(&keyX);
 	lua_Object table = lua_gettable();
 	float x1 = lua_getnumber(table);
 	lua_pushobject(vec1Obj);
-	lua_pushstring("y");
+	lua_pushconststring(&keyY);
 	table = lua_gettable();
 	float y1 = lua_getnumber(table);
 	lua_pushobject(vec1Obj);
-	lua_pushstring("z");
+	lua_pushconststring(&keyZ);
 	table = lua_gettable();
 	float z1 = lua_getnumber(table);
 	lua_pushobject(vec2Obj);
-	lua_pushstring("x");
+	lua_pushconststring(&keyX);
 	table = lua_gettable();
 	float x2 = lua_getnumber(table);
 	lua_pushobject(vec2Obj);
-	lua_pushstring("y");
+	lua_pushconststring(&keyY);
 	table = lua_gettable();
 	float y2 = lua_getnumber(table);
 	lua_pushobject(vec2Obj);
-	lua_pushstring("z");
+	lua_pushconststring(&keyZ);
 	table = lua_gettable();
 	float z2 = lua_getnumber(table);
 
@@ -345,24 +350,24 @@ void Lua_V1::RotateVector() {
 	}
 
 	lua_pushobject(vecObj);
-	lua_pushstring("x");
+	lua_pushconststring(&keyX);
 	float x = lua_getnumber(lua_gettable());
 	lua_pushobject(vecObj);
-	lua_pushstring("y");
+	lua_pushconststring(&keyY);
 	float y = lua_getnumber(lua_gettable());
 	lua_pushobject(vecObj);
-	lua_pushstring("z");
+	lua_pushconststring(&keyZ);
 	float z = lua_getnumber(lua_gettable());
 	Math::Vector3d vec(x, y, z);
 
 	lua_pushobject(rotObj);
-	lua_pushstring("x");
+	lua_pushconststring(&keyX);
 	Math::Angle pitch = lua_getnumber(lua_gettable());
 	lua_pushobject(rotObj);
-	lua_pushstring("y");
+	lua_pushconststring(&keyY);
 	Math::Angle yaw = lua_getnumber(lua_gettable());
 	lua_pushobject(rotObj);
-	lua_pushstring("z");
+	lua_pushconststring(&keyZ);
 	Math::Angle roll = lua_getnumber(lua_gettable());
 
 	Math::Matrix3 mat;
@@ -371,15 +376,15 @@ void Lua_V1::RotateVector() {
 
 	lua_Object resObj = lua_createtable();
 	lua_pushobject(resObj);
-	lua_pushstring("x");
+	lua_pushconststring(&keyX);
 	lua_pushnumber(vec.x());
 	lua_settable();
 	lua_pushobject(resObj);
-	lua_pushstring("y");
+	lua_pushconststring(&keyY);
 	lua_pushnumber(vec.y());
 	lua_settable();
 	lua_pushobject(resObj);
-	lua_pushstring("z");
+	lua_pushconststring(&keyZ);
 	lua_pushnumber(vec.z());
 	lua_settable();
 
@@ -508,7 +513,6 @@ void Lua_V1::GetCurrentScript() {
 void Lua_V1::GetSaveGameImage() {
 	int width = 250, height = 188;
 	Bitmap *screenshot;
-	int dataSize;
 
 	lua_Object param = lua_getparam(1);
 	if (!lua_isstring(param)) {
@@ -522,9 +526,9 @@ void Lua_V1::GetSaveGameImage() {
 		lua_pushnil();
 		return;
 	}
-	dataSize = savedState->beginSection('SIMG');
-	uint16 *data = new uint16[dataSize / 2];
-	for (int l = 0; l < dataSize / 2; l++) {
+	savedState->beginSection('SIMG');
+	uint16 *data = new uint16[width * height];
+	for (int l = 0; l < width * height; l++) {
 		data[l] = savedState->readLEUint16();
 	}
 	Graphics::PixelBuffer buf(Graphics::createPixelFormat<565>(), (byte *)data);
@@ -593,23 +597,19 @@ void Lua_V1::GetSaveGameData() {
 		delete savedState;
 		return;
 	}
-	int32 dataSize = savedState->beginSection('SUBS');
+	savedState->beginSection('SUBS');
 
 	char str[200];
 	int32 strSize;
 	int count = 0;
 
-	for (;;) {
-		if (dataSize <= 0)
-			break;
+	while (!savedState->isSectionEnd()) {
 		strSize = savedState->readLESint32();
 		savedState->read(str, strSize);
 		lua_pushobject(result);
 		lua_pushnumber(count);
 		lua_pushstring(str);
 		lua_settable();
-		dataSize -= strSize;
-		dataSize -= 4;
 		count++;
 	}
 	lua_pushobject(result);
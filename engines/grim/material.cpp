@@ -38,7 +38,10 @@ Common::List<MaterialData *> *MaterialData::_materials = nullptr;
 
 MaterialData::MaterialData(const Common::String &filename, Common::SeekableReadStream *data, CMap *cmap) :
 		_fname(filename), _cmap(cmap), _refCount(1), _textures(nullptr) {
+	init(data);
+}
 
+void MaterialData::init(Common::SeekableReadStream *data) {
 	if (g_grim->getGameType() == GType_MONKEY4) {
 		initEMI(data);
 	} else {
@@ -178,6 +181,10 @@ MaterialData::~MaterialData() {
 		_materials = nullptr;
 	}
 
+	freeTextures();
+}
+
+void MaterialData::freeTextures() {
 	for (int i = 0; i < _numImages; ++i) {
 		Texture *t = _textures[i];
 		if (!t) continue;
@@ -188,6 +195,24 @@ MaterialData::~MaterialData() {
 		delete t;
 	}
 	delete[] _textures;
+	_textures = nullptr;
+	_numImages = 0;
+}
+
+void MaterialData::releaseDriverData() {
+	freeTextures();
+}
+
+void MaterialData::createDriverData() {
+	if (_textures) {
+		return;
+	}
+	Common::SeekableReadStream *data = g_resourceloader->openNewStreamFile(_fname.c_str(), true);
+	if (!data && !_fname.hasPrefix("specialty")) {
+		error("Could not reload material %s", _fname.c_str());
+	}
+	init(data);
+	delete data;
 }
 
 MaterialData *MaterialData::getMaterialData(const Common::String &filename, Common::SeekableReadStream *data, CMap *cmap) {
@@ -51,6 +51,13 @@ public:
 	static MaterialData *getMaterialData(const Common::String &filename, Common::SeekableReadStream *data, CMap *cmap);
 	static Common::List<MaterialData *> *_materials;
 
+	/**
+	 * Releases the textures before the renderer is replaced. The pixels
+	 * are dropped once uploaded, so createDriverData() reads them again.
+	 */
+	void releaseDriverData();
+	void createDriverData();
+
 	Common::String _fname;
 	const ObjectPtr<CMap> _cmap;
 	int _numImages;
@@ -58,6 +65,8 @@ public:
 	int _refCount;
 
 private:
+	void init(Common::SeekableReadStream *data);
+	void freeTextures();
 	void initGrim(Common::SeekableReadStream *data);
 	void initEMI(Common::SeekableReadStream *data);
 };
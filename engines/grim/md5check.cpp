@@ -20,13 +20,21 @@
  *
  */
 
+#include "common/config-manager.h"
 #include "common/file.h"
 #include "common/md5.h"
+#include "common/memstream.h"
+#include "common/savefile.h"
+#include "common/system.h"
+#include "common/timer.h"
+
+#include "audio/mixer.h"
 
 #include "gui/error.h"
 
 #include "engines/grim/md5check.h"
 #include "engines/grim/grim.h"
+#include "engines/grim/atomic.h"
 
 namespace Grim {
 
@@ -337,6 +345,28 @@ const char *emid_voice[] = {
 bool MD5Check::_initted = false;
 Common::Array<MD5Check::MD5Sum> *MD5Check::_files = nullptr;
 int MD5Check::_iterator = -1;
+Common::Array<MD5Check::Result> *MD5Check::_results = nullptr;
+MD5Check::CacheMap *MD5Check::_cache = nullptr;
+volatile int MD5Check::_hashed = 0;
+volatile uint32 MD5Check::_hashedKB = 0;
+uint32 MD5Check::_startTime = 0;
+uint32 MD5Check::_finishTime = 0;
+bool MD5Check::_workerRunning = false;
+Common::File *MD5Check::_file = nullptr;
+Common::MD5 *MD5Check::_md5 = nullptr;
+byte *MD5Check::_readBuffer = nullptr;
+
+// Files are hashed through a buffer this large, so the disk sees long
+// sequential reads instead of the 1000 byte ones computeStreamMD5() makes.
+// The worker hashes this many of them per tick, which bounds how long
+// stopWorker() can wait for it. Timer procs run one after the other, so
+// while anything plays it only hashes a small read per tick, not to hold up
+// the audio timers behind it.
+#define MD5_READ_SIZE (1024 * 1024)
+#define MD5_SLICE_READS 2
+#define MD5_AUDIO_READ_SIZE (64 * 1024)
+#define MD5_SAMPLE_SIZE (64 * 1024)
+#define MD5_CACHE_VERSION 1
 
 void MD5Check::init() {
 	if (_initted) {
@@ -426,8 +456,13 @@ void MD5Check::init() {
 }
 
 void MD5Check::clear() {
+	stopWorker();
 	delete _files;
 	_files = nullptr;
+	delete _results;
+	_results = nullptr;
+	delete _cache;
+	_cache = nullptr;
 	_initted = false;
 }
 
@@ -444,7 +479,11 @@ bool MD5Check::checkFiles() {
 	startCheckFiles();
 	bool ok = true;
 	while (_iterator != -1) {
+		int iterator = _iterator;
 		ok = advanceCheck() && ok;
+		if (_iterator == iterator) {
+			g_system->delayMillis(10);
+		}
 	}
 
 	return ok;
@@ -452,7 +491,23 @@ bool MD5Check::checkFiles() {
 
 void MD5Check::startCheckFiles() {
 	init();
+	stopWorker();
+	loadCache();
+
+	delete _results;
+	_results = new Common::Array<Result>();
+	_results->resize(_files->size());
 	_iterator = 0;
+	_hashed = 0;
+	_hashedKB = 0;
+	_startTime = g_system->getMillis();
+	_finishTime = 0;
+
+	// The hashing runs in a timer proc, which is the only way the engine
+	// has to get work off the main thread, so the dialog keeps drawing.
+	_readBuffer = new byte[MD5_READ_SIZE];
+	_workerRunning = true;
+	g_system->getTimerManager()->installTimerProc(workerProc, 10000, nullptr, "md5CheckWorker");
 }
 
 bool MD5Check::advanceCheck(int *pos, int *total) {
@@ -460,36 +515,242 @@ bool MD5Check::advanceCheck(int *pos, int *total) {
 		return false;
 	}
 
-	const MD5Sum &sum = (*_files)[_iterator++];
 	if (pos) {
 		*pos = _iterator;
 	}
 	if (total) {
 		*total = _files->size();
 	}
-	if ((uint32)_iterator == _files->size()) {
-		_iterator = -1;
+	if (_iterator >= atomicLoad(_hashed)) {
+		return true;
+	}
+
+	const MD5Sum &sum = (*_files)[_iterator];
+	Result &result = (*_results)[_iterator];
+	_iterator++;
+	if (pos) {
+		*pos = _iterator;
 	}
 
-	Common::File file;
-	if (file.open(sum.filename)) {
-		Common::String md5 = Common::computeStreamMD5AsString(file);
-		if (!checkMD5(sum, md5.c_str())) {
-			warning("'%s' may be corrupted. MD5: '%s'", sum.filename, md5.c_str());
+	bool ok = true;
+	if (result.opened) {
+		const char *md5 = result.md5.c_str();
+		if (!checkMD5(sum, md5)) {
+			warning("'%s' may be corrupted. MD5: '%s'", sum.filename, md5);
 			GUI::displayErrorDialog(Common::String::format("The game data file %s may be corrupted.\nIf you are sure it is "
 									"not please provide the ResidualVM team the following code, along with the file name, the language and a "
-									"description of your game version (i.e. dvd-box or jewelcase):\n%s", sum.filename, md5.c_str()).c_str());
-			return false;
+									"description of your game version (i.e. dvd-box or jewelcase):\n%s", sum.filename, md5).c_str());
+			ok = false;
+		} else {
+			result.verified = true;
 		}
 	} else {
 		warning("Could not open %s for checking", sum.filename);
 		GUI::displayErrorDialog(Common::String::format("Could not open the file %s for checking.\nIt may be missing or "
 								"you may not have the rights to open it.\nGo to http://wiki.residualvm.org/index.php/Datafiles to see a list "
 								"of the needed files.", sum.filename).c_str());
-		return false;
+		ok = false;
 	}
 
-	return true;
+	if ((uint32)_iterator == _files->size()) {
+		_iterator = -1;
+		finishCheck();
+	}
+
+	return ok;
+}
+
+float MD5Check::getThroughput() {
+	uint32 end = _finishTime ? _finishTime : g_system->getMillis();
+	uint32 elapsed = MAX<uint32>(1, end - _startTime);
+	return atomicLoad(_hashedKB) / 1024.f / (elapsed / 1000.f);
+}
+
+void MD5Check::workerProc(void *) {
+	int index = _hashed;
+	if (index >= (int)_results->size()) {
+		return;
+	}
+
+	// Open the next file on one tick, then hash a slice of it on each of the following ones.
+	bool done = _file ? hashSlice(index) : startFile(index);
+	if (done) {
+		closeFile();
+		atomicStore(_hashed, index + 1);
+	}
+}
+
+bool MD5Check::startFile(int index) {
+	const MD5Sum &sum = (*_files)[index];
+	Result &result = (*_results)[index];
+
+	Common::File *file = new Common::File();
+	if (!file->open(sum.filename)) {
+		delete file;
+		return true;
+	}
+	result.opened = true;
+	result.size = file->size();
+	computeSampleMD5(*file, result.sample);
+
+	CacheMap::const_iterator i = _cache->find(sum.filename);
+	if (i != _cache->end() && i->_value.size == result.size &&
+			memcmp(i->_value.sample, result.sample, sizeof(result.sample)) == 0) {
+		result.md5 = i->_value.md5;
+		result.cached = true;
+		delete file;
+		return true;
+	}
+
+	_file = file;
+	_md5 = new Common::MD5();
+	return false;
+}
+
+static bool isAudioPlaying() {
+	Audio::Mixer *mixer = g_system->getMixer();
+	return mixer->hasActiveChannelOfType(Audio::Mixer::kPlainSoundType) ||
+		   mixer->hasActiveChannelOfType(Audio::Mixer::kMusicSoundType) ||
+		   mixer->hasActiveChannelOfType(Audio::Mixer::kSFXSoundType) ||
+		   mixer->hasActiveChannelOfType(Audio::Mixer::kSpeechSoundType);
+}
+
+bool MD5Check::hashSlice(int index) {
+	bool audio = isAudioPlaying();
+	uint32 readSize = audio ? MD5_AUDIO_READ_SIZE : MD5_READ_SIZE;
+	int reads = audio ? 1 : MD5_SLICE_READS;
+	for (int i = 0; i < reads; ++i) {
+		uint32 size = _file->read(_readBuffer, readSize);
+		_md5->update(_readBuffer, size);
+		atomicStore(_hashedKB, _hashedKB + size / 1024);
+		if (size < readSize) {
+			byte digest[16];
+			_md5->finish(digest);
+			Common::String &md5 = (*_results)[index].md5;
+			for (int j = 0; j < 16; ++j) {
+				md5 += Common::String::format("%02x", (int)digest[j]);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+void MD5Check::closeFile() {
+	delete _file;
+	_file = nullptr;
+	delete _md5;
+	_md5 = nullptr;
+}
+
+void MD5Check::computeSampleMD5(Common::SeekableReadStream &stream, byte digest[16]) {
+	int32 pos = stream.pos();
+	uint32 size = stream.size();
+	uint32 sampleSize = MIN<uint32>(size, MD5_SAMPLE_SIZE);
+	byte *sample = new byte[sampleSize * 2];
+	stream.seek(0, SEEK_SET);
+	stream.read(sample, sampleSize);
+	stream.seek(size - sampleSize, SEEK_SET);
+	stream.read(sample + sampleSize, sampleSize);
+	stream.seek(pos, SEEK_SET);
+
+	Common::MemoryReadStream sampleStream(sample, sampleSize * 2);
+	Common::computeStreamMD5(sampleStream, digest);
+	delete[] sample;
+}
+
+void MD5Check::finishCheck() {
+	stopWorker();
+	_finishTime = g_system->getMillis();
+
+	// The worker reads the cache, so only now can it take the new results.
+	bool dirty = false;
+	for (uint i = 0; i < _results->size(); ++i) {
+		const Result &result = (*_results)[i];
+		if (result.verified && !result.cached) {
+			CacheEntry &entry = (*_cache)[(*_files)[i].filename];
+			entry.size = result.size;
+			memcpy(entry.sample, result.sample, sizeof(entry.sample));
+			entry.md5 = result.md5;
+			dirty = true;
+		}
+	}
+	if (dirty) {
+		saveCache();
+	}
+}
+
+void MD5Check::stopWorker() {
+	if (_workerRunning) {
+		// Waits for a slice being hashed, since timer procs run under the
+		// timer manager's lock.
+		g_system->getTimerManager()->removeTimerProc(workerProc);
+		_workerRunning = false;
+	}
+	closeFile();
+	delete[] _readBuffer;
+	_readBuffer = nullptr;
+}
+
+// File layout, all little endian:
+//   'MD5C', uint32 version, uint32 count,
+//   count * { uint16 len, char[len] name, uint32 size, byte[16] sample, char[32] md5 }
+void MD5Check::loadCache() {
+	if (_cache) {
+		return;
+	}
+	_cache = new CacheMap();
+
+	Common::String filename = ConfMan.getActiveDomainName() + ".md5cache";
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(filename);
+	if (!file) {
+		return;
+	}
+	bool ok = file->readUint32BE() == MKTAG('M', 'D', '5', 'C') && file->readUint32LE() == MD5_CACHE_VERSION;
+	uint32 count = ok ? file->readUint32LE() : 0;
+	for (uint32 i = 0; ok && i < count; ++i) {
+		uint16 len = file->readUint16LE();
+		Common::String name;
+		for (uint16 j = 0; j < len; ++j) {
+			name += (char)file->readByte();
+		}
+		CacheEntry &entry = (*_cache)[name];
+		entry.size = file->readUint32LE();
+		file->read(entry.sample, sizeof(entry.sample));
+		char md5[32];
+		file->read(md5, sizeof(md5));
+		entry.md5 = Common::String(md5, sizeof(md5));
+		ok = !file->eos() && !file->err();
+	}
+	if (!ok) {
+		warning("Discarding invalid game data check cache %s", filename.c_str());
+		_cache->clear();
+	}
+	delete file;
+}
+
+void MD5Check::saveCache() {
+	Common::String filename = ConfMan.getActiveDomainName() + ".md5cache";
+	Common::OutSaveFile *file = g_system->getSavefileManager()->openForSaving(filename, false);
+	if (!file) {
+		warning("Cannot write game data check cache %s", filename.c_str());
+		return;
+	}
+	file->writeUint32BE(MKTAG('M', 'D', '5', 'C'));
+	file->writeUint32LE(MD5_CACHE_VERSION);
+	file->writeUint32LE(_cache->size());
+	for (CacheMap::const_iterator i = _cache->begin(); i != _cache->end(); ++i) {
+		file->writeUint16LE(i->_key.size());
+		file->write(i->_key.c_str(), i->_key.size());
+		file->writeUint32LE(i->_value.size);
+		file->write(i->_value.sample, sizeof(i->_value.sample));
+		file->write(i->_value.md5.c_str(), 32);
+	}
+	file->finalize();
+	if (file->err()) {
+		warning("Error writing game data check cache %s", filename.c_str());
+	}
+	delete file;
 }
 
 }
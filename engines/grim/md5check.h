@@ -24,6 +24,15 @@
 #define GRIM_MD5CHECK_H
 
 #include "common/array.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/str.h"
+
+namespace Common {
+class File;
+class MD5;
+class SeekableReadStream;
+}
 
 namespace Grim {
 
@@ -31,9 +40,21 @@ class MD5Check {
 public:
 	static bool checkFiles();
 	static void startCheckFiles();
+	/**
+	 * Reports the next file hashed by the background worker. Returns false if
+	 * it failed the check; if it is not hashed yet, returns true and leaves
+	 * the position where it was.
+	 */
 	static bool advanceCheck(int *pos, int *total);
 	inline static bool advanceCheck() { return advanceCheck(NULL, NULL); }
+	/** Megabytes per second hashed by the current or last check. */
+	static float getThroughput();
 	static void clear();
+	/**
+	 * Hashes the first and last 64 KB of 'stream', which together with its
+	 * size is enough to recognise a file seen before without reading it all.
+	 */
+	static void computeSampleMD5(Common::SeekableReadStream &stream, byte digest[16]);
 
 private:
 	static void init();
@@ -46,9 +67,52 @@ private:
 	};
 	static bool checkMD5(const MD5Sum &sums, const char *md5);
 
+	// Written by the worker for each file before it bumps _hashed.
+	struct Result {
+		Result() : size(0), opened(false), cached(false), verified(false) {}
+		Common::String md5;
+		uint32 size;
+		byte sample[16];
+		bool opened;
+		bool cached;
+		bool verified;
+	};
+
+	// Verified files by name. The Common::FSNode API has no modification
+	// time, so a file is recognised by its size and the MD5 of its first
+	// and last 64 KB.
+	struct CacheEntry {
+		uint32 size;
+		byte sample[16];
+		Common::String md5;
+	};
+	typedef Common::HashMap<Common::String, CacheEntry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> CacheMap;
+
+	static void workerProc(void *);
+	static bool startFile(int index);
+	static bool hashSlice(int index);
+	static void closeFile();
+	static void finishCheck();
+	static void stopWorker();
+	static void loadCache();
+	static void saveCache();
+
 	static bool _initted;
 	static Common::Array<MD5Sum> *_files;
 	static int _iterator;
+
+	static Common::Array<Result> *_results;
+	static CacheMap *_cache;
+	static volatile int _hashed;
+	static volatile uint32 _hashedKB;
+	static uint32 _startTime;
+	static uint32 _finishTime;
+	static bool _workerRunning;
+	// The file the worker is hashing and its checksum so far, so that every
+	// tick only hashes a slice of it.
+	static Common::File *_file;
+	static Common::MD5 *_md5;
+	static byte *_readBuffer;
 };
 
 }
@@ -52,7 +52,7 @@ MD5CheckDialog::MD5CheckDialog() :
 
 	int lineCount = lines.size();
 
-	_h = 60 + kLineHeight;
+	_h = 60 + 2 * kLineHeight;
 
 	// Limit the number of lines so that the dialog still fits on the screen.
 	if (lineCount > (screenH - 20 - _h) / kLineHeight) {
@@ -74,6 +74,8 @@ MD5CheckDialog::MD5CheckDialog() :
 	height += 20;
 
 	_progressRect = Common::Rect(_x + 20, _y + height + 10, _x + _w - 20, _y + height + 20);
+	_statusText = new GUI::StaticTextWidget(this, 10, height + 24, maxlineWidth, kLineHeight, "",
+											Graphics::kTextAlignCenter);
 	check();
 }
 
@@ -97,6 +99,7 @@ void MD5CheckDialog::handleTickle() {
 		_checkOk = false;
 	}
 	_progress = (float)p / (float)t;
+	_statusText->setLabel(Common::String::format("%d of %d files checked, %.1f MB/s", p, t, MD5Check::getThroughput()));
 
 	if (p == t) {
 		setResult(_checkOk);
@@ -27,6 +27,10 @@
 
 #include "gui/dialog.h"
 
+namespace GUI {
+class StaticTextWidget;
+}
+
 namespace Grim {
 
 class MD5CheckDialog : public GUI::Dialog {
@@ -41,6 +45,7 @@ private:
 	void check();
 
 	Common::Rect _progressRect;
+	GUI::StaticTextWidget *_statusText;
 	float _progress;
 	bool _checkOk;
 };
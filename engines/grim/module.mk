@@ -30,6 +30,7 @@ MODULE_OBJS := \
 	emi/sound/vimatrack.o \
 	emi/sound/track.o \
 	emi/sound/emisound.o \
+	emi/sound/decodeaheadstream.o \
 	emi/sound/codecs/scx.o \
 	emi/animationemi.o \
 	emi/costumeemi.o \
@@ -47,12 +48,14 @@ MODULE_OBJS := \
 	imuse/imuse_music.o \
 	imuse/imuse_script.o \
 	imuse/imuse_sndmgr.o \
+	imuse/imuse_stream.o \
 	imuse/imuse_tables.o \
 	imuse/imuse_track.o \
 	lua/lapi.o \
 	lua/lauxlib.o \
 	lua/lbuffer.o \
 	lua/lbuiltin.o \
+	lua/lcache.o \
 	lua/ldo.o \
 	lua/lfunc.o \
 	lua/lgc.o \
@@ -88,6 +91,7 @@ MODULE_OBJS := \
 	actor.o \
 	animation.o \
 	bitmap.o \
+	bitmapcache.o \
 	costume.o \
 	color.o \
 	colormap.o \
@@ -127,6 +131,7 @@ MODULE_OBJS := \
 	sprite.o \
 	stuffit.o \
 	textobject.o \
+	textcache.o \
 	textsplit.o \
 	object.o \
 	debugger.o \
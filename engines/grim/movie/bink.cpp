@@ -57,16 +57,14 @@ void BinkPlayer::deinit() {
 	MoviePlayer::deinit();
 }
 
-void BinkPlayer::handleFrame() {
-	MoviePlayer::handleFrame();
-
+void BinkPlayer::handlePresentedFrame() {
 	if (!_showSubtitles || _subtitleIndex == _subtitles.end())
 		return;
 
 	unsigned int startFrame, endFrame, curFrame;
 	startFrame = _subtitleIndex->_startFrame;
 	endFrame = _subtitleIndex->_endFrame;
-	curFrame = _videoDecoder->getCurFrame();
+	curFrame = _frame;
 	if (startFrame <= curFrame && curFrame <= endFrame) {
 		if (!_subtitleIndex->active) {
 			TextObject *textObject = new TextObject();
@@ -28,62 +28,33 @@
 
 namespace Grim {
 
-#if defined(SCUMM_NEED_ALIGNMENT)
+// Block primitives. Fixed-size memcpy() calls compile to plain, and where
+// available vector, loads and stores, and stay safe on platforms that need
+// aligned accesses.
 
-#define COPY_4X1_LINE(dst, src)			\
-	do {					\
-		(dst)[0] = (src)[0];	\
-		(dst)[1] = (src)[1];	\
-		(dst)[2] = (src)[2];	\
-		(dst)[3] = (src)[3];	\
-	} while (0)
-
-#if defined(SCUMM_BIG_ENDIAN)
-
-#define WRITE_2X1_LINE(dst, v)		\
-	do {				\
-		(dst)[0] = (byte)((v >> 8) & 0xFF);	\
-		(dst)[1] = (byte)((v >> 0) & 0xFF);	\
-	} while (0)
-
-#define WRITE_4X1_LINE(dst, v)		\
-	do {				\
-		(dst)[0] = (byte)((v >> 24) & 0xFF);	\
-		(dst)[1] = (byte)((v >> 16) & 0XFF);	\
-		(dst)[2] = (byte)((v >>  8) & 0xFF);	\
-		(dst)[3] = (byte)((v >>  0) & 0xFF);	\
-	} while (0)
-
-#else /* SCUMM_BIG_ENDIAN */
-
-#define WRITE_2X1_LINE(dst, v)		\
-	do {				\
-		(dst)[0] = (byte)((v >> 0) & 0xFF);	\
-		(dst)[1] = (byte)((v >> 8) & 0xFF);	\
-	} while (0)
-
-#define WRITE_4X1_LINE(dst, v)		\
-	do {				\
-		(dst)[0] = (byte)((v >>  0) & 0xFF);	\
-		(dst)[1] = (byte)((v >>  8) & 0XFF);	\
-		(dst)[2] = (byte)((v >> 16) & 0xFF);	\
-		(dst)[3] = (byte)((v >> 24) & 0xFF);	\
-	} while (0)
-
-#endif
-
-#else /* SCUMM_NEED_ALIGNMENT */
-
-#define COPY_4X1_LINE(dst, src)			\
-	*(uint32 *)(dst) = *(const uint32 *)(src);
-
-#define WRITE_2X1_LINE(dst, v)		\
-	*(uint16 *)(dst) = v;
+static inline void writePixel(byte *dst, uint16 v) {
+	memcpy(dst, &v, 2);
+}
 
-#define WRITE_4X1_LINE(dst, v)		\
-	*(uint32 *)(dst) = v;
+template<int rowSize>
+static inline void copyBlock(byte *dst, int32 offset, int pitch, int rows) {
+	for (int i = 0; i < rows; i++) {
+		memcpy(dst, dst + offset, rowSize);
+		dst += pitch;
+	}
+}
 
-#endif
+template<int rowSize>
+static inline void fillBlock(byte *dst, uint16 color, int pitch, int rows) {
+	uint16 row[rowSize / 2];
+	for (int i = 0; i < rowSize / 2; i++) {
+		row[i] = color;
+	}
+	for (int i = 0; i < rows; i++) {
+		memcpy(dst, row, rowSize);
+		dst += pitch;
+	}
+}
 
 static int8 blocky16_table_small1[] = {
 	0, 1, 2, 3, 3, 3, 3, 2, 1, 0, 0, 0, 1, 2, 2, 1,
@@ -362,9 +333,7 @@ void Blocky16::makeTables47(int width) {
 
 void Blocky16::level3(byte *d_dst) {
 	int32 tmp2;
-	uint32 t;
 	byte code = *_d_src++;
-	int i;
 
 	if (code <= 0xF5) {
 		if (code == 0xF5) {
@@ -374,64 +343,41 @@ void Blocky16::level3(byte *d_dst) {
 		} else {
 			tmp2 = _table[code] * 2;
 		}
-		tmp2 += _offset1;
-		for (i = 0; i < 2; i++) {
-			COPY_4X1_LINE(d_dst + 0, d_dst + tmp2 + 0);
-			d_dst += _d_pitch;
-		}
+		copyBlock<4>(d_dst, tmp2 + _offset1, _d_pitch, 2);
 	} else if ((code == 0xFF) || (code == 0xF8)) {
-		WRITE_2X1_LINE(d_dst + 0, READ_LE_UINT16(_d_src + 0));
-		WRITE_2X1_LINE(d_dst + 2, READ_LE_UINT16(_d_src + 2));
+		writePixel(d_dst + 0, READ_LE_UINT16(_d_src + 0));
+		writePixel(d_dst + 2, READ_LE_UINT16(_d_src + 2));
 		d_dst += _d_pitch;
-		WRITE_2X1_LINE(d_dst + 0, READ_LE_UINT16(_d_src + 4));
-		WRITE_2X1_LINE(d_dst + 2, READ_LE_UINT16(_d_src + 6));
+		writePixel(d_dst + 0, READ_LE_UINT16(_d_src + 4));
+		writePixel(d_dst + 2, READ_LE_UINT16(_d_src + 6));
 		_d_src += 8;
 	} else if (code == 0xFD) {
-		t = *_d_src++;
-		t = READ_LE_UINT16(_param6_7Ptr + t * 2);
-		t = (t << 16) | t;
-		for (i = 0; i < 2; i++) {
-			WRITE_4X1_LINE(d_dst + 0, t);
-			d_dst += _d_pitch;
-		}
+		fillBlock<4>(d_dst, READ_LE_UINT16(_param6_7Ptr + *_d_src * 2), _d_pitch, 2);
+		_d_src++;
 	} else if (code == 0xFE) {
-		t = READ_LE_UINT16(_d_src);
+		fillBlock<4>(d_dst, READ_LE_UINT16(_d_src), _d_pitch, 2);
 		_d_src += 2;
-		t = (t << 16) | t;
-		for (i = 0; i < 2; i++) {
-			WRITE_4X1_LINE(d_dst + 0, t);
-			d_dst += _d_pitch;
-		}
 	} else if (code == 0xF6) {
-		tmp2 = _offset2;
-		for (i = 0; i < 2; i++) {
-			COPY_4X1_LINE(d_dst + 0, d_dst + tmp2 + 0);
-			d_dst += _d_pitch;
-		}
+		copyBlock<4>(d_dst, _offset2, _d_pitch, 2);
 	} else if (code == 0xF7) {
 		tmp2 = READ_LE_UINT32(_d_src);
 		_d_src += 4;
-		WRITE_2X1_LINE(d_dst + 0, READ_LE_UINT16(_param6_7Ptr + (byte)tmp2 * 2));
-		WRITE_2X1_LINE(d_dst + 2, READ_LE_UINT16(_param6_7Ptr + (byte)(tmp2 >> 8) * 2));
+		writePixel(d_dst + 0, READ_LE_UINT16(_param6_7Ptr + (byte)tmp2 * 2));
+		writePixel(d_dst + 2, READ_LE_UINT16(_param6_7Ptr + (byte)(tmp2 >> 8) * 2));
 		tmp2 >>= 16;
 		d_dst += _d_pitch;
-		WRITE_2X1_LINE(d_dst + 0, READ_LE_UINT16(_param6_7Ptr + (byte)tmp2 * 2));
-		WRITE_2X1_LINE(d_dst + 2, READ_LE_UINT16(_param6_7Ptr + (byte)(tmp2 >> 8) * 2));
+		writePixel(d_dst + 0, READ_LE_UINT16(_param6_7Ptr + (byte)tmp2 * 2));
+		writePixel(d_dst + 2, READ_LE_UINT16(_param6_7Ptr + (byte)(tmp2 >> 8) * 2));
 	} else if ((code >= 0xF9) && (code <= 0xFC))  {
-		t = READ_LE_UINT16(_paramPtr + code * 2);
-		t = (t << 16) | t;
-		for (i = 0; i < 2; i++) {
-			WRITE_4X1_LINE(d_dst + 0, t);
-			d_dst += _d_pitch;
-		}
+		fillBlock<4>(d_dst, READ_LE_UINT16(_paramPtr + code * 2), _d_pitch, 2);
 	}
 }
 
 void Blocky16::level2(byte *d_dst) {
 	int32 tmp2;
-	uint32 t = 0, val;
+	uint16 t = 0;
+	uint32 val;
 	byte code = *_d_src++;
-	int i;
 
 	if (code <= 0xF5) {
 		if (code == 0xF5) {
@@ -441,12 +387,7 @@ void Blocky16::level2(byte *d_dst) {
 		} else {
 			tmp2 = _table[code] * 2;
 		}
-		tmp2 += _offset1;
-		for (i = 0; i < 4; i++) {
-			COPY_4X1_LINE(d_dst +  0, d_dst + tmp2 +  0);
-			COPY_4X1_LINE(d_dst +  4, d_dst + tmp2 +  4);
-			d_dst += _d_pitch;
-		}
+		copyBlock<8>(d_dst, tmp2 + _offset1, _d_pitch, 4);
 	} else if (code == 0xFF) {
 		level3(d_dst);
 		d_dst += 4;
@@ -456,12 +397,7 @@ void Blocky16::level2(byte *d_dst) {
 		d_dst += 4;
 		level3(d_dst);
 	} else if (code == 0xF6) {
-		tmp2 = _offset2;
-		for (i = 0; i < 4; i++) {
-			COPY_4X1_LINE(d_dst +  0, d_dst + tmp2 +  0);
-			COPY_4X1_LINE(d_dst +  4, d_dst + tmp2 +  4);
-			d_dst += _d_pitch;
-		}
+		copyBlock<8>(d_dst, _offset2, _d_pitch, 4);
 	} else if ((code == 0xF7) || (code == 0xF8)) {
 		byte tmp = *_d_src++;
 		if (code == 0xF8) {
@@ -477,42 +413,35 @@ void Blocky16::level2(byte *d_dst) {
 		byte l = tmp_ptr[96];
 		int16 *tmp_ptr2 = (int16 *)tmp_ptr;
 		while (l--) {
-			WRITE_2X1_LINE(d_dst + READ_LE_UINT16(tmp_ptr2) * 2, val);
+			writePixel(d_dst + READ_LE_UINT16(tmp_ptr2) * 2, val);
 			tmp_ptr2++;
 		}
 		l = tmp_ptr[97];
 		val >>= 16;
 		tmp_ptr2 = (int16 *)(tmp_ptr + 32);
 		while (l--) {
-			WRITE_2X1_LINE(d_dst + READ_LE_UINT16(tmp_ptr2) * 2, val);
+			writePixel(d_dst + READ_LE_UINT16(tmp_ptr2) * 2, val);
 			tmp_ptr2++;
 		}
 	} else if (code >= 0xF9) {
 		if (code == 0xFD) {
-			t = *_d_src++;
-			t = READ_LE_UINT16(_param6_7Ptr + t * 2);
-			t = (t << 16) | t;
+			t = READ_LE_UINT16(_param6_7Ptr + *_d_src * 2);
+			_d_src++;
 		} else if (code == 0xFE) {
 			t = READ_LE_UINT16(_d_src);
-			t = (t << 16) | t;
 			_d_src += 2;
 		} else if ((code >= 0xF9) && (code <= 0xFC))  {
 			t = READ_LE_UINT16(_paramPtr + code * 2);
-			t = (t << 16) | t;
-		}
-		for (i = 0; i < 4; i++) {
-			WRITE_4X1_LINE(d_dst + 0, t);
-			WRITE_4X1_LINE(d_dst + 4, t);
-			d_dst += _d_pitch;
 		}
+		fillBlock<8>(d_dst, t, _d_pitch, 4);
 	}
 }
 
 void Blocky16::level1(byte *d_dst) {
 	int32 tmp2;
-	uint32 t = 0, val;
+	uint16 t = 0;
+	uint32 val;
 	byte code = *_d_src++;
-	int i;
 
 	if (code <= 0xF5) {
 		if (code == 0xF5) {
@@ -522,14 +451,7 @@ void Blocky16::level1(byte *d_dst) {
 		} else {
 			tmp2 = _table[code] * 2;
 		}
-		tmp2 += _offset1;
-		for (i = 0; i < 8; i++) {
-			COPY_4X1_LINE(d_dst +  0, d_dst + tmp2 +  0);
-			COPY_4X1_LINE(d_dst +  4, d_dst + tmp2 +  4);
-			COPY_4X1_LINE(d_dst +  8, d_dst + tmp2 +  8);
-			COPY_4X1_LINE(d_dst + 12, d_dst + tmp2 + 12);
-			d_dst += _d_pitch;
-		}
+		copyBlock<16>(d_dst, tmp2 + _offset1, _d_pitch, 8);
 	} else if (code == 0xFF) {
 		level2(d_dst);
 		d_dst += 8;
@@ -539,14 +461,7 @@ void Blocky16::level1(byte *d_dst) {
 		d_dst += 8;
 		level2(d_dst);
 	} else if (code == 0xF6) {
-		tmp2 = _offset2;
-		for (i = 0; i < 8; i++) {
-			COPY_4X1_LINE(d_dst +  0, d_dst + tmp2 +  0);
-			COPY_4X1_LINE(d_dst +  4, d_dst + tmp2 +  4);
-			COPY_4X1_LINE(d_dst +  8, d_dst + tmp2 +  8);
-			COPY_4X1_LINE(d_dst + 12, d_dst + tmp2 + 12);
-			d_dst += _d_pitch;
-		}
+		copyBlock<16>(d_dst, _offset2, _d_pitch, 8);
 	} else if ((code == 0xF7) || (code == 0xF8)) {
 		byte tmp = *_d_src++;
 		if (code == 0xF8) {
@@ -562,36 +477,27 @@ void Blocky16::level1(byte *d_dst) {
 		byte l = tmp_ptr[384];
 		int16 *tmp_ptr2 = (int16 *)tmp_ptr;
 		while (l--) {
-			WRITE_2X1_LINE(d_dst + READ_LE_UINT16(tmp_ptr2) * 2, val);
+			writePixel(d_dst + READ_LE_UINT16(tmp_ptr2) * 2, val);
 			tmp_ptr2++;
 		}
 		l = tmp_ptr[385];
 		val >>= 16;
 		tmp_ptr2 = (int16 *)(tmp_ptr + 128);
 		while (l--) {
-			WRITE_2X1_LINE(d_dst + READ_LE_UINT16(tmp_ptr2) * 2, val);
+			writePixel(d_dst + READ_LE_UINT16(tmp_ptr2) * 2, val);
 			tmp_ptr2++;
 		}
 	} else if (code >= 0xF9) {
 		if (code == 0xFD) {
-			t = *_d_src++;
-			t = READ_LE_UINT16(_param6_7Ptr + t * 2);
-			t = (t << 16) | t;
+			t = READ_LE_UINT16(_param6_7Ptr + *_d_src * 2);
+			_d_src++;
 		} else if (code == 0xFE) {
 			t = READ_LE_UINT16(_d_src);
-			t = (t << 16) | t;
 			_d_src += 2;
 		} else if ((code >= 0xF9) && (code <= 0xFC))  {
 			t = READ_LE_UINT16(_paramPtr + code * 2);
-			t = (t << 16) | t;
-		}
-		for (i = 0; i < 8; i++) {
-			WRITE_4X1_LINE(d_dst +  0, t);
-			WRITE_4X1_LINE(d_dst +  4, t);
-			WRITE_4X1_LINE(d_dst +  8, t);
-			WRITE_4X1_LINE(d_dst + 12, t);
-			d_dst += _d_pitch;
 		}
+		fillBlock<16>(d_dst, t, _d_pitch, 8);
 	}
 }
 
@@ -630,9 +536,9 @@ void Blocky16::init(int width, int height) {
 	// of using _frameSize.
 	int size = _blocksWidth * 8 * _blocksHeight * 8 * 2;
 	_offset = size - _frameSize;
-	uint32 deltaSize = size * 3;
-	_deltaBuf = new byte[deltaSize];
-	memset(_deltaBuf, 0, deltaSize);
+	_deltaSize = size * 3;
+	_deltaBuf = new byte[_deltaSize];
+	memset(_deltaBuf, 0, _deltaSize);
 	_deltaBufs[0] = _deltaBuf;
 	_deltaBufs[1] = _deltaBuf + _frameSize;
 	_curBuf = _deltaBuf + _frameSize * 2;
@@ -656,6 +562,7 @@ Blocky16::Blocky16() {
 	_height = _width = 0;
 	_offset = _offset1 = _offset2 = 0;
 	_frameSize = 0;
+	_deltaSize = 0;
 	_d_pitch = 0;
 }
 
@@ -744,7 +651,7 @@ static void bompDecodeMain(byte *dst, const byte *src, int size) {
 	}
 }
 
-void Blocky16::decode(byte *dst, const byte *src) {
+const byte *Blocky16::decode(const byte *src) {
 	_offset1 = ((_deltaBufs[1] - _curBuf) / 2) * 2;
 	_offset2 = ((_deltaBufs[0] - _curBuf) / 2) * 2;
 
@@ -825,7 +732,9 @@ void Blocky16::decode(byte *dst, const byte *src) {
 		}
 	}
 
-	memcpy(dst, _curBuf, _frameSize);
+	// The rotation below only moves pointers, so the frame stays in place
+	// until the next call
+	const byte *frame = _curBuf;
 
 	if (seq_nb == _prevSeqNb + 1) {
 		byte *tmp_ptr = nullptr;
@@ -841,6 +750,32 @@ void Blocky16::decode(byte *dst, const byte *src) {
 		}
 	}
 	_prevSeqNb = seq_nb;
+	return frame;
+}
+
+Blocky16State *Blocky16::saveState() const {
+	Blocky16State *state = new Blocky16State();
+	state->deltaBuf = new byte[_deltaSize];
+	memcpy(state->deltaBuf, _deltaBuf, _deltaSize);
+	state->deltaOffsets[0] = _deltaBufs[0] - _deltaBuf;
+	state->deltaOffsets[1] = _deltaBufs[1] - _deltaBuf;
+	state->curOffset = _curBuf - _deltaBuf;
+	state->prevSeqNb = _prevSeqNb;
+	return state;
+}
+
+const byte *Blocky16::getFrame() const {
+	return _curBuf;
+}
+
+void Blocky16::restoreState(const Blocky16State *state) {
+	// The tables are otherwise only built by the keyframe
+	makeTables47(_width);
+	memcpy(_deltaBuf, state->deltaBuf, _deltaSize);
+	_deltaBufs[0] = _deltaBuf + state->deltaOffsets[0];
+	_deltaBufs[1] = _deltaBuf + state->deltaOffsets[1];
+	_curBuf = _deltaBuf + state->curOffset;
+	_prevSeqNb = state->prevSeqNb;
 }
 
 } // end of namespace Grim
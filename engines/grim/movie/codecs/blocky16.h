@@ -27,6 +27,21 @@
 
 namespace Grim {
 
+/**
+ * Decoder state between two frames, enough to resume decoding after them.
+ */
+struct Blocky16State {
+	Blocky16State() : deltaBuf(nullptr), curOffset(0), prevSeqNb(0) {
+		deltaOffsets[0] = deltaOffsets[1] = 0;
+	}
+	~Blocky16State() { delete[] deltaBuf; }
+
+	byte *deltaBuf;
+	int32 deltaOffsets[2];
+	int32 curOffset;
+	int32 prevSeqNb;
+};
+
 class Blocky16 {
 private:
 
@@ -42,6 +57,7 @@ private:
 	byte *_tableSmall;
 	int16 _table[256];
 	int32 _frameSize;
+	uint32 _deltaSize;
 	int _offset;
 	int _width, _height;
 	int _blocksWidth, _blocksHeight;
@@ -58,7 +74,17 @@ public:
 	~Blocky16();
 	void init(int width, int height);
 	void deinit();
-	void decode(byte *dst, const byte *src);
+	/**
+	 * Decodes a frame and returns it, valid until the next call to decode()
+	 * or restoreState().
+	 */
+	const byte *decode(const byte *src);
+	/**
+	 * The buffer decode() starts from, blank after init().
+	 */
+	const byte *getFrame() const;
+	Blocky16State *saveState() const;
+	void restoreState(const Blocky16State *state);
 };
 
 } // end of namespace Grim
@@ -20,10 +20,12 @@
  *
  */
 
+#include "common/config-manager.h"
 #include "common/endian.h"
 #include "common/events.h"
 #include "common/file.h"
 #include "common/rational.h"
+#include "common/savefile.h"
 #include "common/system.h"
 #include "common/timer.h"
 #include "common/memstream.h"
@@ -33,6 +35,7 @@
 #include "audio/decoders/raw.h"
 
 #include "engines/grim/debug.h"
+#include "engines/grim/md5check.h"
 
 #include "engines/grim/movie/codecs/blocky8.h"
 #include "engines/grim/movie/codecs/blocky16.h"
@@ -44,6 +47,7 @@ namespace Grim {
 #define ANNO_HEADER "MakeAnim animation type 'Bl16' parameters: "
 #define BUFFER_SIZE 16385
 #define SMUSH_SPEED 66667
+#define SMUSH_INDEX_VERSION 2
 
 bool SmushDecoder::_demo = false;
 
@@ -54,7 +58,10 @@ SmushDecoder::SmushDecoder() {
 
 	_videoLooping = false;
 	_startPos = 0;
-	_frames = nullptr;
+	_audioStartFrame = 0;
+	_index = nullptr;
+	_indexCached = false;
+	_indexFileLoaded = false;
 
 	_videoTrack = nullptr;
 	_audioTrack = nullptr;
@@ -64,7 +71,15 @@ SmushDecoder::SmushDecoder() {
 SmushDecoder::~SmushDecoder() {
 	delete _videoTrack;
 	delete _audioTrack;
-	delete[] _frames;
+	if (!_indexCached) {
+		clearSnapshots(_index);
+		delete _index;
+	}
+	saveFrameIndexes();
+	for (FrameIndexMap::iterator i = _indexCache.begin(); i != _indexCache.end(); ++i) {
+		clearSnapshots(i->_value);
+		delete i->_value;
+	}
 }
 
 void SmushDecoder::init() {
@@ -72,48 +87,322 @@ void SmushDecoder::init() {
 	_audioTrack->init();
 }
 
-void SmushDecoder::initFrames() {
-	delete[] _frames;
-	_frames = new Frame[_videoTrack->getFrameCount()];
+void SmushDecoder::selectFrameIndex() {
+	int32 fileSize = _file->size();
+	byte sample[16];
+	FrameIndex *index = nullptr;
+
+	if (!_cacheName.empty()) {
+		if (!_indexFileLoaded)
+			loadFrameIndexes();
+
+		MD5Check::computeSampleMD5(*_file, sample);
+
+		FrameIndexMap::iterator i = _indexCache.find(_cacheName);
+		if (i != _indexCache.end()) {
+			index = i->_value;
+			if (index->fileSize != fileSize || memcmp(index->sample, sample, sizeof(sample)) != 0) {
+				clearSnapshots(index);
+				index->frames.clear();
+				index->audioEnd = 0;
+				index->fileSize = fileSize;
+				memcpy(index->sample, sample, sizeof(sample));
+				index->checked = true;
+			} else if (!index->checked) {
+				if (!checkFrameIndex(index)) {
+					Debug::debug(Debug::Movie, "Ignoring stale SMUSH index for %s", index->name.c_str());
+					index->frames.clear();
+					index->audioEnd = 0;
+				}
+				index->checked = true;
+			}
+		}
+
+		// Only keep the snapshots of one movie around, they are large
+		for (i = _indexCache.begin(); i != _indexCache.end(); ++i) {
+			if (i->_value != index)
+				clearSnapshots(i->_value);
+		}
+	}
+
+	if (!index) {
+		index = new FrameIndex();
+		index->fileSize = fileSize;
+		index->audioEnd = 0;
+		index->savedFrames = 0;
+		index->checked = true;
+		if (!_cacheName.empty()) {
+			index->name = _cacheName;
+			memcpy(index->sample, sample, sizeof(sample));
+			_indexCache[_cacheName] = index;
+		}
+	}
+	_index = index;
+	_indexCached = !_cacheName.empty();
+}
+
+// File layout, all little endian:
+//   'SMIX', uint32 version, uint32 movie count, count * {
+//     uint32 name length, char[length] name, uint32 movie size,
+//     byte[16] movie sample md5, uint32 frame count,
+//     frame count * { uint32 pos, byte keyframe, uint32 audio pos },
+//     uint32 audio end }
+// Frame positions are checked against a movie when it is first loaded.
+void SmushDecoder::loadFrameIndexes() {
+	_indexFileLoaded = true;
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(getIndexFileName());
+	if (!file) {
+		return;
+	}
+
+	bool ok = file->readUint32BE() == MKTAG('S', 'M', 'I', 'X') && file->readUint32LE() == SMUSH_INDEX_VERSION;
+	uint32 movies = ok ? file->readUint32LE() : 0;
+	for (uint32 m = 0; ok && m < movies; m++) {
+		FrameIndex *index = new FrameIndex();
+		uint32 length = file->readUint32LE();
+		ok = length > 0 && length < 256;
+		if (ok) {
+			char name[256];
+			file->read(name, length);
+			index->name = Common::String(name, length);
+			index->fileSize = file->readSint32LE();
+			ok = file->read(index->sample, sizeof(index->sample)) == sizeof(index->sample);
+		}
+		uint32 count = ok ? file->readUint32LE() : 0;
+		ok = ok && count <= (uint32)file->size() / 9;
+
+		int32 lastPos = -1;
+		int32 lastAudioPos = 0;
+		for (uint32 i = 0; ok && i < count; i++) {
+			Frame frame;
+			frame.frame = i;
+			frame.pos = file->readSint32LE();
+			frame.keyframe = file->readByte() != 0;
+			frame.audioPos = file->readSint32LE();
+			// Positions only go forward and stay inside the movie
+			ok = frame.pos > lastPos && frame.pos < index->fileSize && frame.audioPos >= lastAudioPos;
+			lastPos = frame.pos;
+			lastAudioPos = frame.audioPos;
+			index->frames.push_back(frame);
+		}
+		if (ok) {
+			index->audioEnd = file->readSint32LE();
+			ok = index->audioEnd >= lastAudioPos && !file->eos() && !file->err() &&
+				 !_indexCache.contains(index->name);
+		}
+
+		if (ok) {
+			index->savedFrames = count;
+			index->checked = false;
+			_indexCache[index->name] = index;
+		} else {
+			delete index;
+		}
+	}
+	if (!ok) {
+		Debug::debug(Debug::Movie, "Ignoring the rest of damaged SMUSH index %s", getIndexFileName().c_str());
+	}
+	delete file;
+}
+
+// Every indexed position must hold a frame, optionally after an annotation,
+// that ends where the next indexed frame starts.
+bool SmushDecoder::checkFrameIndex(const FrameIndex *index) {
+	const Common::Array<Frame> &frames = index->frames;
+	if (frames.size() > (uint)_videoTrack->getFrameCount() || (!frames.empty() && frames[0].pos != (int)_startPos))
+		return false;
 
 	int seekPos = _file->pos();
-	int curFrame = -1;
-	_file->seek(_startPos, SEEK_SET);
-	while (curFrame < _videoTrack->getFrameCount() - 1) {
-		Frame &frame = _frames[++curFrame];
-		frame.frame = curFrame;
-		frame.pos = _file->pos();
-		frame.keyframe = false;
+	bool ok = true;
+	for (uint i = 0; ok && i < frames.size(); i++) {
+		_file->seek(frames[i].pos, SEEK_SET);
+		uint32 tag = _file->readUint32BE();
+		uint32 size = _file->readUint32BE();
+		if (tag == MKTAG('A', 'N', 'N', 'O') && size <= (uint32)(index->fileSize - _file->pos())) {
+			_file->seek(size, SEEK_CUR);
+			tag = _file->readUint32BE();
+			size = _file->readUint32BE();
+		}
+		int32 end = i + 1 < frames.size() ? frames[i + 1].pos : index->fileSize;
+		ok = !_file->err() && tag == MKTAG('F', 'R', 'M', 'E') && size <= (uint32)(end - _file->pos()) &&
+			 (i + 1 == frames.size() || _file->pos() + (int32)size == end);
+	}
+	_file->clearErr();
+	_file->seek(seekPos, SEEK_SET);
+	return ok;
+}
 
+void SmushDecoder::saveFrameIndexes() {
+	bool changed = false;
+	for (FrameIndexMap::iterator i = _indexCache.begin(); i != _indexCache.end(); ++i) {
+		changed |= i->_value->frames.size() != i->_value->savedFrames;
+	}
+	if (!changed) {
+		return;
+	}
+
+	Common::String filename = getIndexFileName();
+	Common::OutSaveFile *file = g_system->getSavefileManager()->openForSaving(filename, false);
+	if (!file) {
+		warning("Cannot write SMUSH index %s", filename.c_str());
+		return;
+	}
+	uint32 movies = 0;
+	for (FrameIndexMap::iterator i = _indexCache.begin(); i != _indexCache.end(); ++i) {
+		if (!i->_value->frames.empty())
+			movies++;
+	}
+	file->writeUint32BE(MKTAG('S', 'M', 'I', 'X'));
+	file->writeUint32LE(SMUSH_INDEX_VERSION);
+	file->writeUint32LE(movies);
+	for (FrameIndexMap::iterator i = _indexCache.begin(); i != _indexCache.end(); ++i) {
+		const FrameIndex *index = i->_value;
+		if (index->frames.empty())
+			continue;
+		file->writeUint32LE(index->name.size());
+		file->write(index->name.c_str(), index->name.size());
+		file->writeSint32LE(index->fileSize);
+		file->write(index->sample, sizeof(index->sample));
+		file->writeUint32LE(index->frames.size());
+		for (uint f = 0; f < index->frames.size(); f++) {
+			const Frame &frame = index->frames[f];
+			file->writeSint32LE(frame.pos);
+			file->writeByte(frame.keyframe);
+			file->writeSint32LE(frame.audioPos);
+		}
+		file->writeSint32LE(index->audioEnd);
+	}
+	file->finalize();
+	if (file->err()) {
+		warning("Error writing SMUSH index %s", filename.c_str());
+	} else {
+		for (FrameIndexMap::iterator i = _indexCache.begin(); i != _indexCache.end(); ++i) {
+			i->_value->savedFrames = i->_value->frames.size();
+		}
+	}
+	delete file;
+}
+
+Common::String SmushDecoder::getIndexFileName() {
+	return ConfMan.getActiveDomainName() + ".smushidx";
+}
+
+void SmushDecoder::indexFrames(int lastFrame) {
+	Common::Array<Frame> &frames = _index->frames;
+	if ((int)frames.size() > lastFrame)
+		return;
+
+	int seekPos = _file->pos();
+	if (frames.empty()) {
+		_file->seek(_startPos, SEEK_SET);
+	} else {
+		// Continue after the last indexed frame
+		_file->seek(frames.back().pos, SEEK_SET);
 		uint32 tag = _file->readUint32BE();
-		uint32 size;
+		uint32 size = _file->readUint32BE();
 		if (tag == MKTAG('A', 'N', 'N', 'O')) {
+			_file->seek(size, SEEK_CUR);
+			_file->readUint32BE();
 			size = _file->readUint32BE();
+		}
+		_file->seek(size, SEEK_CUR);
+	}
+
+	while ((int)frames.size() <= lastFrame) {
+		int pos = _file->pos();
+		uint32 tag = _file->readUint32BE();
+		uint32 size = _file->readUint32BE();
+		if (tag == MKTAG('A', 'N', 'N', 'O')) {
 			_file->seek(size, SEEK_CUR);
 			tag = _file->readUint32BE();
+			size = _file->readUint32BE();
 		}
 		assert(tag == MKTAG('F', 'R', 'M', 'E'));
-		size = _file->readUint32BE();
 
-		while (size > 0) {
-			uint32 subType = _file->readUint32BE();
-			uint32 subSize = _file->readUint32BE();
+		bool keyframe;
+		int32 samples;
+		scanFrameChunks(size, keyframe, samples);
+		addIndexFrame(pos, keyframe, samples);
+	}
 
-			if (subType == MKTAG('B', 'l', '1', '6')) {
-				_file->seek(18, SEEK_CUR);
-				if (_file->readByte() == 0) {
-					frame.keyframe = true;
-				}
-				_file->seek(subSize - 19, SEEK_CUR);
-			} else
-				_file->seek(subSize, SEEK_CUR);
-			size -= subSize + 8 + (subSize & 1);
+	_file->seek(seekPos, SEEK_SET);
+}
+
+void SmushDecoder::scanFrameChunks(uint32 size, bool &keyframe, int32 &samples) {
+	int32 end = _file->pos() + size;
+	keyframe = false;
+	samples = 0;
+
+	while (_file->pos() + 8 <= end) {
+		uint32 subType = _file->readUint32BE();
+		uint32 subSize = _file->readUint32BE();
+		int32 subPos = _file->pos();
+
+		if (subType == MKTAG('B', 'l', '1', '6')) {
+			_file->seek(18, SEEK_CUR);
+			if (_file->readByte() == 0) {
+				keyframe = true;
+			}
+		} else if (subType == MKTAG('W', 'a', 'v', 'e')) {
+			int32 decompressedSize = _file->readSint32BE();
+			if (decompressedSize < 0) {
+				_file->readUint32BE();
+				decompressedSize = _file->readSint32BE();
+			}
+			samples += decompressedSize;
 		}
+		_file->seek(subPos + subSize + (subSize & 1), SEEK_SET);
+	}
 
-		_file->seek(size, SEEK_CUR);
+	_file->seek(end, SEEK_SET);
+}
+
+void SmushDecoder::addIndexFrame(int pos, bool keyframe, int32 samples) {
+	Frame frame;
+	frame.frame = _index->frames.size();
+	frame.pos = pos;
+	frame.keyframe = keyframe;
+	frame.audioPos = _index->audioEnd;
+	_index->frames.push_back(frame);
+	_index->audioEnd += samples;
+}
+
+void SmushDecoder::takeSnapshot() {
+	int frame = _videoTrack->getCurFrame();
+	if ((frame + 1) % kSnapshotInterval != 0 || !_videoTrack->isFrameDecoded())
+		return;
+
+	// Seeking past a keyframe starts from there anyway
+	if (frame + 1 < (int)_index->frames.size() && _index->frames[frame + 1].keyframe)
+		return;
+
+	for (Common::List<Snapshot>::const_iterator i = _index->snapshots.begin(); i != _index->snapshots.end(); ++i) {
+		if (i->frame == frame)
+			return;
 	}
 
-	_file->seek(seekPos, SEEK_SET);
+	Blocky16State *state = _videoTrack->saveState();
+	if (!state)
+		return;
+
+	if (_index->snapshots.size() >= (uint)kMaxSnapshots) {
+		delete _index->snapshots.front().state;
+		_index->snapshots.pop_front();
+	}
+	Snapshot snapshot;
+	snapshot.frame = frame;
+	snapshot.state = state;
+	_index->snapshots.push_back(snapshot);
+}
+
+void SmushDecoder::clearSnapshots(FrameIndex *index) {
+	if (!index)
+		return;
+
+	for (Common::List<Snapshot>::iterator i = index->snapshots.begin(); i != index->snapshots.end(); ++i) {
+		delete i->state;
+	}
+	index->snapshots.clear();
 }
 
 void SmushDecoder::close() {
@@ -122,8 +411,14 @@ void SmushDecoder::close() {
 	_videoTrack = nullptr;
 	_videoLooping = false;
 	_startPos = 0;
-	delete[] _frames;
-	_frames = nullptr;
+	if (!_indexCached) {
+		clearSnapshots(_index);
+		delete _index;
+	} else if (_index) {
+		saveFrameIndexes();
+	}
+	_index = nullptr;
+	_indexCached = false;
 	if (_file) {
 		delete _file;
 		_file = nullptr;
@@ -259,6 +554,7 @@ bool SmushDecoder::loadStream(Common::SeekableReadStream *stream) {
 	}
 
 	_startPos = _file->pos();
+	selectFrameIndex();
 
 	init();
 	return true;
@@ -296,6 +592,7 @@ void SmushDecoder::handleFrame() {
 		return;
 	}
 
+	int32 framePos = _file->pos();
 	tag = _file->readUint32BE();
 	size = _file->readUint32BE();
 	if (tag == MKTAG('A', 'N', 'N', 'O')) {
@@ -329,9 +626,21 @@ void SmushDecoder::handleFrame() {
 	}
 
 	assert(tag == MKTAG('F', 'R', 'M', 'E'));
+
+	// Index the frames as they are played for the first time
+	if ((int)_index->frames.size() == _videoTrack->getCurFrame() + 1) {
+		int32 dataPos = _file->pos();
+		bool keyframe;
+		int32 samples;
+		scanFrameChunks(size, keyframe, samples);
+		_file->seek(dataPos, SEEK_SET);
+		addIndexFrame(framePos, keyframe, samples);
+	}
+
 	handleFRME(_file, size);
 
 	_videoTrack->finishFrame();
+	takeSnapshot();
 }
 
 void SmushDecoder::handleFRME(Common::SeekableReadStream *stream, uint32 size) {
@@ -352,7 +661,8 @@ void SmushDecoder::handleFRME(Common::SeekableReadStream *stream, uint32 size) {
 			_videoTrack->handleBlocky16(memStream, subSize);
 			break;
 		case MKTAG('W', 'a', 'v', 'e'):
-			_audioTrack->handleVIMA(memStream, blockSize);
+			if (_videoTrack->getCurFrame() + 1 >= _audioStartFrame)
+				_audioTrack->handleVIMA(memStream, blockSize);
 			break;
 			// Demo only:
 		case MKTAG('F', 'O', 'B', 'J'):
@@ -389,51 +699,74 @@ bool SmushDecoder::seekIntern(const Audio::Timestamp &time) {
 		return false;
 	}
 
-	if (!_frames) {
-		initFrames();
-	}
+	int lastFrame = MIN<int>(wantedFrame, _videoTrack->getFrameCount() - 1);
+	indexFrames(lastFrame);
+	const Common::Array<Frame> &frames = _index->frames;
 
 	// Track down the keyframe
 	int keyframe = 0;
-	for (int i = wantedFrame; i >= 0; --i) {
-		if (_frames[i].keyframe) {
+	for (int i = lastFrame; i >= 0; --i) {
+		if (frames[i].keyframe) {
 			keyframe = i;
 			break;
 		}
 	}
-	_videoTrack->setFrameStart(keyframe);
 
-	// VIMA frames are 50 frames ahead of time, so we have to make sure we have 50 frames
-	// of audio before the wantedFrame. Here we use 51 to have a bit of safe margin
-	if (wantedFrame - keyframe < 51) {
-		keyframe = wantedFrame - 51;
+	// Resume from the latest decoder snapshot between the keyframe and the target
+	const Snapshot *snapshot = nullptr;
+	for (Common::List<Snapshot>::const_iterator i = _index->snapshots.begin(); i != _index->snapshots.end(); ++i) {
+		if (i->frame >= keyframe && i->frame < wantedFrame && (!snapshot || i->frame > snapshot->frame))
+			snapshot = &*i;
 	}
-	if (keyframe < 0) {
-		keyframe = 0;
+	int videoStart = keyframe;
+	if (snapshot) {
+		_videoTrack->restoreState(snapshot->state);
+		videoStart = snapshot->frame + 1;
 	}
+	_videoTrack->setFrameStart(videoStart);
 
-	_file->seek(_frames[keyframe].pos, SEEK_SET);
-	_videoTrack->setCurFrame(keyframe - 1);
+	// VIMA frames are 50 frames ahead of time, so we have to make sure we have 50 frames
+	// of audio before the wantedFrame. Here we use 51 to have a bit of safe margin.
+	// VIMA chunks decode on their own, so the frames before that only need their video.
+	int audioStart = MAX(wantedFrame - 51, 0);
+	int startFrame = MIN(videoStart, audioStart);
+	if (!_audioTrack->isVima()) {
+		audioStart = startFrame;
+	}
+
+	_audioStartFrame = audioStart;
+	_file->seek(frames[startFrame].pos, SEEK_SET);
+	_videoTrack->setCurFrame(startFrame - 1);
 
 	while (_videoTrack->getCurFrame() < wantedFrame - 1) {
 		decodeNextFrame();
 	}
+	_audioStartFrame = 0;
 
 	// As said, VIMA is 50 frames ahead of time. Every frame it pushes 1470 samples, and 50 * 1470 = 73500.
 	// The first frame, instead of 1470, it pushes 73500 samples to have this 50-frames-time.
-	// So if we have used frame 0 as keyframe we can remove safely time * rate samples, and we will
-	// still have the 50 frames margin. If we have used a later frame as keyframe we don't have the 73500
-	// samples pushed the first frame, so we have to be careful not to remove too much data,
-	// otherwise the audio will start at a later point. (72030 == 73500 - 1470)
-	int offset = (keyframe == 0 ? 0 : 72030);
+	// So if the audio started at frame 0 we can remove safely time * rate samples, and we will
+	// still have the 50 frames margin. If it started at a later frame we don't have the samples
+	// that the frames before it pushed ahead of their time, so we have to be careful not to remove
+	// too much data, otherwise the audio will start at a later point. The index knows how many
+	// samples that is (72030 == 73500 - 1470 for the usual movies).
+	int offset = 0;
+	if (audioStart > 0) {
+		if (_audioTrack->isVima()) {
+			offset = frames[audioStart].audioPos -
+			         _videoTrack->getFrameTime(audioStart).convertToFramerate(_audioTrack->getRate()).totalNumberOfFrames();
+		} else {
+			offset = 72030;
+		}
+	}
 
-	// Skip decoded audio between the keyframe and the target frame
+	// Skip decoded audio between the audio start and the target frame
 	Audio::Timestamp delay = 0;
 	if (_videoTrack->getCurFrame() > 0) {
 		delay = _videoTrack->getFrameTime(_videoTrack->getCurFrame());
 	}
-	if (keyframe > 0) {
-		delay = delay - _videoTrack->getFrameTime(keyframe);
+	if (audioStart > 0) {
+		delay = delay - _videoTrack->getFrameTime(audioStart);
 	}
 
 	int32 sampleCount = (delay.msecs() / 1000.f) * _audioTrack->getRate() - offset;
@@ -474,14 +807,16 @@ SmushDecoder::SmushVideoTrack::SmushVideoTrack(int width, int height, int fps, i
 SmushDecoder::SmushVideoTrack::~SmushVideoTrack() {
 	delete _blocky8;
 	delete _blocky16;
-	_surface.free();
+	// The retail surface shows the frames of the Blocky16 decoder
+	if (!_is16Bit)
+		_surface.free();
 }
 
 void SmushDecoder::SmushVideoTrack::init() {
 	_curFrame = -1;
 	_frameStart = -1;
 	if (_is16Bit) { // Retail only
-		_surface.create(_width, _height, _format);
+		_surface.init(_width, _height, _width * 2, const_cast<byte *>(_blocky16->getFrame()), _format);
 	}
 }
 
@@ -518,7 +853,7 @@ void SmushDecoder::SmushVideoTrack::handleBlocky16(Common::SeekableReadStream *s
 	byte *ptr = new byte[size];
 	stream->read(ptr, size);
 
-	_blocky16->decode((byte *)_surface.getPixels(), ptr);
+	_surface.setPixels(const_cast<byte *>(_blocky16->decode(ptr)));
 	delete[] ptr;
 }
 
@@ -573,6 +908,15 @@ void SmushDecoder::SmushVideoTrack::handleDeltaPalette(Common::SeekableReadStrea
 	}
 }
 
+Blocky16State *SmushDecoder::SmushVideoTrack::saveState() const {
+	return _blocky16 ? _blocky16->saveState() : nullptr;
+}
+
+void SmushDecoder::SmushVideoTrack::restoreState(const Blocky16State *state) {
+	if (_blocky16)
+		_blocky16->restoreState(state);
+}
+
 Graphics::Surface *SmushDecoder::SmushVideoTrack::decodeNextFrame() {
 	return &_surface;
 }
@@ -612,7 +956,7 @@ void SmushDecoder::SmushAudioTrack::handleVIMA(Common::SeekableReadStream *strea
 
 	// this will be deleted using free() by the stream, so allocate it using malloc().
 	int16 *dst = (int16 *)malloc(decompressedSize * _channels * 2);
-	decompressVima(src, dst, decompressedSize * _channels * 2, smushDestTable);
+	decompressVima(src, dst, decompressedSize * _channels * 2);
 
 	int flags = Audio::FLAG_16BITS;
 	if (_channels == 2) {
@@ -23,6 +23,11 @@
 #ifndef GRIM_SMUSH_DECODER_H
 #define GRIM_SMUSH_DECODER_H
 
+#include "common/array.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/list.h"
+
 #include "audio/audiostream.h"
 
 #include "video/video_decoder.h"
@@ -37,6 +42,7 @@ namespace Grim {
 
 class Blocky8;
 class Blocky16;
+struct Blocky16State;
 
 class SmushDecoder : public Video::VideoDecoder {
 public:
@@ -46,6 +52,13 @@ public:
 	int getX() const { return _videoTrack->_x; }
 	int getY() const { return _videoTrack->_y; }
 	void setLooping(bool l);
+	/**
+	 * Names the movie loaded next, so its seek index and decoder snapshots
+	 * are kept for the next time it is loaded. The indexes of all movies are
+	 * also saved to one file in the savefile directory and reused across
+	 * sessions.
+	 */
+	void setCacheName(const Common::String &name) { _cacheName = name; }
 	bool isRewindable() const override { return true; }
 	bool isSeekable() const override { return true; }
 	bool rewind() override;
@@ -79,6 +92,9 @@ protected:
 		bool isSeekable() const override { return true; }
 		bool seek(const Audio::Timestamp &time) override { return true; }
 		void setFrameStart(int frame);
+		bool isFrameDecoded() const { return _curFrame > _frameStart; }
+		Blocky16State *saveState() const;
+		void restoreState(const Blocky16State *state);
 
 		void handleBlocky16(Common::SeekableReadStream *stream, uint32 size);
 		void handleFrameObject(Common::SeekableReadStream *stream, uint32 size);
@@ -114,6 +130,7 @@ protected:
 		bool seek(const Audio::Timestamp &time) override;
 		void skipSamples(int samples);
 		inline int getRate() const { return _queueStream->getRate(); }
+		bool isVima() const { return _isVima; }
 
 		void handleVIMA(Common::SeekableReadStream *stream, uint32 size);
 		void handleIACT(Common::SeekableReadStream *stream, int32 size);
@@ -127,7 +144,41 @@ protected:
 		Audio::QueuingAudioStream *_queueStream;
 	};
 private:
-	void initFrames();
+	struct Frame {
+		int frame;
+		int pos;
+		bool keyframe;
+		int32 audioPos; //< Audio samples queued by the frames before this one
+	};
+	struct Snapshot {
+		int frame; //< The last frame decoded before the state was saved
+		Blocky16State *state;
+	};
+	struct FrameIndex {
+		Common::String name;
+		int32 fileSize;
+		byte sample[16];
+		int32 audioEnd;
+		uint savedFrames; //< Frames already in the index file
+		bool checked; //< Frame positions checked against the movie
+		Common::Array<Frame> frames;
+		Common::List<Snapshot> snapshots;
+	};
+	typedef Common::HashMap<Common::String, FrameIndex *> FrameIndexMap;
+
+	static const int kSnapshotInterval = 60;
+	static const int kMaxSnapshots = 4;
+
+	void selectFrameIndex();
+	void loadFrameIndexes();
+	bool checkFrameIndex(const FrameIndex *index);
+	void saveFrameIndexes();
+	static Common::String getIndexFileName();
+	void indexFrames(int lastFrame);
+	void scanFrameChunks(uint32 size, bool &keyframe, int32 &samples);
+	void addIndexFrame(int pos, bool keyframe, int32 samples);
+	void takeSnapshot();
+	static void clearSnapshots(FrameIndex *index);
 
 	SmushAudioTrack *_audioTrack;
 	SmushVideoTrack *_videoTrack;
@@ -138,12 +189,17 @@ private:
 
 	bool _videoPause;
 	bool _videoLooping;
-	struct Frame {
-		int frame;
-		int pos;
-		bool keyframe;
-	};
-	Frame *_frames;
+	int _audioStartFrame;
+
+	// Frame positions, keyframes and audio positions, filled in as frames are
+	// played and scanned ahead of a seek. Named movies keep theirs in the
+	// cache across loads and in an index file across sessions, the snapshots
+	// only for the movie loaded last.
+	Common::String _cacheName;
+	FrameIndex *_index;
+	bool _indexCached;
+	bool _indexFileLoaded;
+	FrameIndexMap _indexCache;
 	static bool _demo;
 };
 
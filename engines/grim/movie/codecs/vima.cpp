@@ -21,6 +21,9 @@
  */
 
 #include "common/endian.h"
+#include "common/util.h"
+
+#include "engines/grim/movie/codecs/vima.h"
 
 namespace Grim {
 
@@ -99,6 +102,40 @@ static int8 *offsets[] = {
 	imcOtherTable4, imcOtherTable5, imcOtherTable6
 };
 
+// One entry for every step index and every code of that index's width,
+// sign bit included. Bits 0-6 hold the next step index, bit 7 is set for
+// the escape code that is followed by a literal sample and the remaining
+// bits hold the signed delta.
+static int32 vimaStepTable[89 * 128];
+static bool vimaStepTableReady = false;
+
+static void buildVimaStepTable(const uint16 *destTable) {
+	for (int pos = 0; pos < 89; pos++) {
+		int numBits = imcTable2[pos];
+		int highBit = 1 << (numBits - 1);
+		int lowBits = highBit - 1;
+
+		for (int code = 0; code < (1 << numBits); code++) {
+			int val = code & lowBits;
+			int nextPos = CLIP(pos + offsets[numBits - 2][val], 0, 88);
+			int32 entry;
+
+			if (val == lowBits) {
+				entry = nextPos | 0x80;
+			} else {
+				int delta = destTable[(val << (7 - numBits)) | (pos << 6)];
+				if (val)
+					delta += (imcTable1[pos] >> (numBits - 1));
+				if (code & highBit)
+					delta = -delta;
+				entry = nextPos | (delta * 256);
+			}
+			vimaStepTable[pos * 128 + code] = entry;
+		}
+	}
+	vimaStepTableReady = true;
+}
+
 void vimaInit(uint16 *destTable) {
 	int destTableStartPos, incer;
 
@@ -115,9 +152,99 @@ void vimaInit(uint16 *destTable) {
 			destTable[destTablePos] = put;
 		}
 	}
+
+	if (!vimaStepTableReady)
+		buildVimaStepTable(destTable);
+}
+
+namespace {
+
+// MSB-first reader over the VIMA bitstream. Every sample takes at least four
+// bits, so the bytes up to safeEnd are known to belong to the stream and are
+// loaded eight at a time. Past that point only the bytes that are actually
+// needed are read, which never goes further than the old decoder did.
+class VimaBitReader {
+public:
+	VimaBitReader(const byte *src, const byte *safeEnd) :
+			_src(src), _safeEnd(safeEnd), _bits(0), _count(0) {}
+
+	void need(int numBits) {
+		if (_count >= numBits)
+			return;
+		while (_count <= 56 && _src < _safeEnd) {
+			_bits |= (uint64)*_src++ << (56 - _count);
+			_count += 8;
+		}
+		while (_count < numBits) {
+			_bits |= (uint64)*_src++ << (56 - _count);
+			_count += 8;
+		}
+	}
+
+	uint32 take(int numBits) {
+		uint32 val = (uint32)(_bits >> (64 - numBits));
+		_bits <<= numBits;
+		_count -= numBits;
+		return val;
+	}
+
+private:
+	const byte *_src;
+	const byte *_safeEnd;
+	uint64 _bits;
+	int _count;
+};
+
+} // end of anonymous namespace
+
+void decompressVima(const byte *src, int16 *dest, int destLen) {
+	int numChannels = 1;
+	byte sBytes[2];
+	int16 sWords[2];
+
+	sBytes[0] = *src++;
+	if (sBytes[0] & 0x80) {
+		sBytes[0] = ~sBytes[0];
+		numChannels = 2;
+	}
+	sWords[0] = READ_BE_UINT16(src);
+	src += 2;
+	if (numChannels > 1) {
+		sBytes[1] = *src++;
+		sWords[1] = READ_BE_UINT16(src);
+		src += 2;
+	}
+
+	int numSamples = destLen / (numChannels * 2);
+	VimaBitReader reader(src, src + 2 + numSamples * numChannels / 2);
+
+	// The channels are stored one after the other in a single bitstream, so
+	// the second one can only be decoded once the first one is done.
+	for (int channel = 0; channel < numChannels; channel++) {
+		int16 *destPos = dest + channel;
+		int currTablePos = sBytes[channel];
+		int outputWord = sWords[channel];
+
+		for (int sample = 0; sample < numSamples; sample++) {
+			int numBits = imcTable2[currTablePos];
+			reader.need(numBits);
+			int32 entry = vimaStepTable[currTablePos * 128 + reader.take(numBits)];
+
+			if (entry & 0x80) {
+				reader.need(16);
+				outputWord = (int16)reader.take(16);
+			} else {
+				outputWord = CLIP(outputWord + (entry >> 8), -0x8000, 0x7fff);
+			}
+
+			WRITE_BE_UINT16(destPos, outputWord);
+			destPos += numChannels;
+			currTablePos = entry & 0x7f;
+		}
+	}
 }
 
-void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable) {
+void decompressVimaReference(const byte *src, int16 *dest, int destLen, uint16 *destTable) {
 	int numChannels = 1;
 	byte sBytes[2];
 	int16 sWords[2];
@@ -26,7 +26,17 @@
 namespace Grim {
 
 void vimaInit(uint16 *destTable);
-void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable);
+
+/**
+ * Decodes a VIMA block. The step table it decodes with is built by the first
+ * vimaInit() call, so that has to run once before any block is decoded.
+ */
+void decompressVima(const byte *src, int16 *dest, int destLen);
+
+/**
+ * The original bit-by-bit decoder, kept to check decompressVima() against.
+ */
+void decompressVimaReference(const byte *src, int16 *dest, int destLen, uint16 *destTable);
 
 } // end of namespace Grim
 
@@ -47,9 +47,18 @@ MoviePlayer::MoviePlayer() {
 	_x = 0;
 	_y = 0;
 	_videoDecoder = nullptr;
-	_internalSurface = nullptr;
 	_externalSurface = new Graphics::Surface();
 	_timerStarted = false;
+	for (int i = 0; i < kFrameQueueSize; i++) {
+		_frameQueue[i].surface = new Graphics::Surface();
+		_frameQueue[i].frame = -1;
+		_frameQueue[i].time = 0;
+	}
+	_queueHead = 0;
+	_queueCount = 0;
+	_clockTime = 0;
+	_clockMillis = 0;
+	_clockRunning = false;
 }
 
 MoviePlayer::~MoviePlayer() {
@@ -61,12 +70,20 @@ MoviePlayer::~MoviePlayer() {
 	deinit();
 	delete _videoDecoder;
 	delete _externalSurface;
+	for (int i = 0; i < kFrameQueueSize; i++) {
+		delete _frameQueue[i].surface;
+	}
 }
 
 void MoviePlayer::pause(bool p) {
 	Common::StackLock lock(_frameMutex);
 	_videoPause = p;
 	_videoDecoder->pauseVideo(p);
+
+	Common::StackLock queueLock(_queueMutex);
+	_clockTime = _videoDecoder->getTime();
+	_clockMillis = g_system->getMillis();
+	_clockRunning = !p;
 }
 
 void MoviePlayer::stop() {
@@ -82,9 +99,40 @@ void MoviePlayer::timerCallback(void *instance) {
 		movie->postHandleFrame();
 }
 
+static void copyFrameSurface(Graphics::Surface *dst, const Graphics::Surface *src) {
+	// Keep the pixel buffer of the queue slot when the frame size is unchanged
+	if (dst->w != src->w || dst->h != src->h || dst->format != src->format)
+		dst->create(src->w, src->h, src->format);
+
+	const byte *srcRow = (const byte *)src->getPixels();
+	byte *dstRow = (byte *)dst->getPixels();
+	for (int y = 0; y < src->h; y++) {
+		memcpy(dstRow, srcRow, src->w * src->format.bytesPerPixel);
+		srcRow += src->pitch;
+		dstRow += dst->pitch;
+	}
+}
+
 bool MoviePlayer::prepareFrame() {
-	if (!_videoLooping && _videoDecoder->endOfVideo()) {
-		_videoFinished = true;
+	uint32 time = _videoDecoder->getTime();
+	{
+		Common::StackLock lock(_queueMutex);
+		// The clock went back: the movie was rewound or seeked
+		if (time < _clockTime)
+			clearFrameQueue();
+		_clockTime = time;
+		_clockMillis = g_system->getMillis();
+		_clockRunning = !_videoPause && !_videoFinished;
+		dropStaleFrames(time);
+
+		// Only finish once the last decoded frame is due
+		if (!_videoLooping && _videoDecoder->endOfVideo() &&
+		    (_queueCount == 0 || _frameQueue[(_queueHead + _queueCount - 1) % kFrameQueueSize].time <= time)) {
+			_videoFinished = true;
+		}
+
+		if (_queueCount == kFrameQueueSize)
+			return false;
 	}
 
 	if (_videoPause) {
@@ -99,27 +147,79 @@ bool MoviePlayer::prepareFrame() {
 		return false;
 	}
 
-	if (_videoDecoder->getTimeToNextFrame() > 0)
+	handleFrame();
+	if (_videoFinished || _videoDecoder->endOfVideo())
 		return false;
 
-	handleFrame();
-	_internalSurface = _videoDecoder->decodeNextFrame();
-	if (_frame != _videoDecoder->getCurFrame()) {
-		_updateNeeded = true;
+	if (_videoDecoder->getTime() < time) {
+		// handleFrame() rewound a looping movie
+		Common::StackLock lock(_queueMutex);
+		clearFrameQueue();
+		_clockTime = _videoDecoder->getTime();
+		_clockMillis = g_system->getMillis();
 	}
 
-	_movieTime = _videoDecoder->getTime();
-	_frame = _videoDecoder->getCurFrame();
+	uint32 frameTime = _videoDecoder->getTime() + _videoDecoder->getTimeToNextFrame();
+	const Graphics::Surface *surface = _videoDecoder->decodeNextFrame();
+	if (!surface)
+		return false;
+
+	Common::StackLock lock(_queueMutex);
+	QueuedFrame &queued = _frameQueue[(_queueHead + _queueCount) % kFrameQueueSize];
+	copyFrameSurface(queued.surface, surface);
+	queued.frame = _videoDecoder->getCurFrame();
+	queued.time = frameTime;
+	_queueCount++;
 
 	return true;
 }
 
-Graphics::Surface *MoviePlayer::getDstSurface() {
-	Common::StackLock lock(_frameMutex);
-	if (_updateNeeded && _internalSurface) {
-		_externalSurface->copyFrom(*_internalSurface);
+uint32 MoviePlayer::getClockTime() {
+	if (!_clockRunning)
+		return _clockTime;
+	return _clockTime + (g_system->getMillis() - _clockMillis);
+}
+
+void MoviePlayer::dropStaleFrames(uint32 time) {
+	// A due frame is stale once the frame after it is due as well
+	while (_queueCount > 1 && _frameQueue[(_queueHead + 1) % kFrameQueueSize].time <= time) {
+		_queueHead = (_queueHead + 1) % kFrameQueueSize;
+		_queueCount--;
+	}
+}
+
+void MoviePlayer::clearFrameQueue() {
+	_queueHead = 0;
+	_queueCount = 0;
+}
+
+void MoviePlayer::presentFrame() {
+	{
+		Common::StackLock lock(_queueMutex);
+		uint32 time = getClockTime();
+		dropStaleFrames(time);
+		if (_queueCount == 0 || _frameQueue[_queueHead].time > time)
+			return;
+
+		// Hand the frame over by swapping surfaces with the queue slot
+		QueuedFrame &queued = _frameQueue[_queueHead];
+		Graphics::Surface *surface = _externalSurface;
+		_externalSurface = queued.surface;
+		queued.surface = surface;
+		_queueHead = (_queueHead + 1) % kFrameQueueSize;
+		_queueCount--;
+
+		_movieTime = time;
+		if (_frame == queued.frame)
+			return;
+		_updateNeeded = true;
+		_frame = queued.frame;
 	}
 
+	handlePresentedFrame();
+}
+
+Graphics::Surface *MoviePlayer::getDstSurface() {
 	return _externalSurface;
 }
 
@@ -133,6 +233,12 @@ void MoviePlayer::init() {
 	_movieTime = 0;
 	_updateNeeded = false;
 	_videoFinished = false;
+
+	Common::StackLock lock(_queueMutex);
+	clearFrameQueue();
+	_clockTime = 0;
+	_clockMillis = g_system->getMillis();
+	_clockRunning = false;
 }
 
 void MoviePlayer::deinit() {
@@ -141,7 +247,12 @@ void MoviePlayer::deinit() {
 	if (_videoDecoder)
 		_videoDecoder->close();
 
-	_internalSurface = nullptr;
+	Common::StackLock lock(_queueMutex);
+	clearFrameQueue();
+	_clockRunning = false;
+	for (int i = 0; i < kFrameQueueSize; i++) {
+		_frameQueue[i].surface->free();
+	}
 
 	if (_externalSurface)
 		_externalSurface->free();
@@ -165,7 +276,6 @@ bool MoviePlayer::play(const Common::String &filename, bool looping, int x, int
 	Debug::debug(Debug::Movie, "Playing video '%s'.\n", filename.c_str());
 
 	init();
-	_internalSurface = nullptr;
 
 	if (start) {
 		_videoDecoder->start();
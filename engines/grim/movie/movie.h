@@ -34,11 +34,30 @@ class SaveGame;
 
 class MoviePlayer {
 protected:
+	struct QueuedFrame {
+		Graphics::Surface *surface;
+		int32 frame;
+		uint32 time;
+	};
+
+	static const int kFrameQueueSize = 3;
+
 	Common::String _fname;
-	Common::Mutex _frameMutex;
+	Common::Mutex _frameMutex;              //< Guards the decoder
 	Video::VideoDecoder *_videoDecoder;     //< Initialize this to your needed subclass of VideoDecoder in the constructor
-	const Graphics::Surface *_internalSurface;
 	Graphics::Surface *_externalSurface;
+
+	// Frames decoded ahead by the timer, oldest first, and the movie clock
+	// as last seen by it. The main thread only needs _queueMutex to pick
+	// the frame to show, so it never waits for the decoder.
+	Common::Mutex _queueMutex;
+	QueuedFrame _frameQueue[kFrameQueueSize];
+	int _queueHead;
+	int _queueCount;
+	uint32 _clockTime;
+	uint32 _clockMillis;
+	bool _clockRunning;
+
 	int32 _frame;
 	bool _updateNeeded;
 	bool _showSubtitles;
@@ -79,6 +98,13 @@ public:
 	virtual void clearUpdateNeeded() { _updateNeeded = false; }
 	virtual int32 getMovieTime() { return (int32)_movieTime; }
 
+	/**
+	 * Shows the newest decoded frame that is due, handing its surface over
+	 * to getDstSurface() without a copy. Called by the engine once per
+	 * rendered frame.
+	 */
+	void presentFrame();
+
 	/**
 	 * Saves the state of the video to a savegame
 	 * @param state         The state to save to
@@ -89,14 +115,18 @@ public:
 protected:
 	static void timerCallback(void *ptr);
 	/**
-	 * Handles basic stuff per frame, like copying the latest frame to
-	 * _externalBuffer, and updating the frame-counters.
+	 * Handles basic stuff per frame, like decoding the next frame into the
+	 * frame queue while it has room.
 	 *
-	 * @return false if a frame wasnt drawn to _externalBuffer, true otherwise.
+	 * @return false if no frame was queued, true otherwise.
 	 * @see handleFrame
 	 */
 	virtual bool prepareFrame();
 
+	uint32 getClockTime();
+	void dropStaleFrames(uint32 time);
+	void clearFrameQueue();
+
 	/**
 	 * Frame-handling function.
 	 *
@@ -109,6 +139,15 @@ protected:
 	 */
 	virtual void handleFrame() {};
 
+	/**
+	 * Called on the main thread when presentFrame() shows a new frame, for
+	 * anything that has to follow what is on screen rather than the
+	 * decoder, which runs ahead.
+	 *
+	 * @see presentFrame
+	 */
+	virtual void handlePresentedFrame() {};
+
 	/**
 	 * Frame-handling function.
 	 *
@@ -39,6 +39,7 @@ SmushPlayer::SmushPlayer(bool demo) : MoviePlayer(), _demo(demo) {
 }
 
 bool SmushPlayer::loadFile(const Common::String &filename) {
+	_smushDecoder->setCacheName(filename);
 	if (!_demo)
 		return _videoDecoder->loadStream(g_resourceloader->openNewStreamFile(filename.c_str()));
 	else
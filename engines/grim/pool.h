@@ -23,8 +23,9 @@
 #ifndef GRIM_POOL_H
 #define GRIM_POOL_H
 
+#include "common/array.h"
 #include "common/hashmap.h"
-#include "common/list.h"
+#include "common/textconsole.h"
 
 #include "engines/grim/savegame.h"
 
@@ -39,39 +40,68 @@ public:
 	virtual int32 getTag() const = 0;
 };
 
+/**
+ * Objects of a pool live in a generational slot map: the low bits of an id
+ * are the index of its slot, the high bits the generation of the slot when
+ * the id was handed out, so that ids of deleted objects are not reused for
+ * a long time and looking up an id is an array access.
+ * Ids read from savegames are kept as they are; the rare ones whose slot is
+ * already taken are kept aside in a hash map.
+ */
 template<class T>
 class PoolObject : public PoolObjectBase {
 public:
 	class Pool {
 	public:
-		template<class it, class Type>
+		template<class Objects, class Type>
 		class Iterator {
 		public:
-			Iterator(const Iterator &i) : _i(i._i) { }
-			Iterator(const it &i) : _i(i) { }
-
-			int32 getId() const { return _i->_key; }
-			Type &getValue() const { return _i->_value; }
-
-			Type &operator*() const { return _i->_value; }
-
-			Iterator &operator=(const Iterator &i) { _i = i._i; return *this; }
-
-			bool operator==(const Iterator i) const { return _i == i._i; }
-			bool operator!=(const Iterator i) const { return _i != i._i; }
-
-			Iterator &operator++() { ++_i; return *this; }
-			Iterator operator++(int) { Iterator iter = *this; ++_i; return iter; }
-
-			Iterator &operator--() { --_i; return *this; }
-			Iterator operator--(int) { Iterator iter = *this; --_i; return iter; }
+			Iterator(const Iterator &i) : _pool(i._pool), _objects(i._objects), _i(i._i) { _pool->retain(); }
+			Iterator(const Pool *pool, Objects *objects, uint i) : _pool(pool), _objects(objects), _i(i) {
+				_pool->retain();
+				skipRemoved();
+			}
+			~Iterator() { _pool->release(); }
+
+			int32 getId() const { return (*_objects)[_i]->getId(); }
+			Type &getValue() const { return (*_objects)[_i]; }
+
+			Type &operator*() const { return (*_objects)[_i]; }
+
+			Iterator &operator=(const Iterator &i) {
+				i._pool->retain();
+				_pool->release();
+				_pool = i._pool;
+				_objects = i._objects;
+				_i = i._i;
+				return *this;
+			}
+
+			// Objects may be added or removed while iterating, so all the positions
+			// past the last object are the end.
+			bool operator==(const Iterator i) const { return _i == i._i || (atEnd() && i.atEnd()); }
+			bool operator!=(const Iterator i) const { return !(*this == i); }
+
+			Iterator &operator++() { ++_i; skipRemoved(); return *this; }
+			Iterator operator++(int) { Iterator iter = *this; ++*this; return iter; }
+
+			Iterator &operator--() { while (_i > 0 && !(*_objects)[--_i]) { } return *this; }
+			Iterator operator--(int) { Iterator iter = *this; --*this; return iter; }
 
 		private:
-			it _i;
+			bool atEnd() const { return _i >= _objects->size(); }
+			void skipRemoved() {
+				while (_i < _objects->size() && !(*_objects)[_i])
+					++_i;
+			}
+
+			const Pool *_pool;
+			Objects *_objects;
+			uint _i;
 		};
 
-		typedef Iterator<typename Common::HashMap<int32, T *>::iterator, T *> iterator;
-		typedef Iterator<typename Common::HashMap<int32, T *>::const_iterator, T *const> const_iterator;
+		typedef Iterator<Common::Array<T *>, T *> iterator;
+		typedef Iterator<const Common::Array<T *>, T *const> const_iterator;
 
 		Pool();
 		~Pool();
@@ -90,50 +120,65 @@ public:
 		void restoreObjects(SaveGame *save);
 
 	private:
+		enum {
+			SlotBits = 16,
+			SlotMask = (1 << SlotBits) - 1,
+			MaxGeneration = 0x7fff
+		};
+
+		struct Slot {
+			T *object;
+			int32 index;        // position of the object in _objects
+			int32 generation;   // highest generation handed out or restored
+		};
+
+		int32 newId();
+		void insert(T *obj);
+		void compact();
+		void deleteAll();
+		void retain() const { ++_iterators; }
+		void release() const;
+
 		bool _restoring;
-		Common::HashMap<int32, T*> _map;
+		Common::Array<Slot> _slots;
+		Common::Array<int32> _freeSlots;  // reused oldest first
+		uint _freeHead;
+		Common::HashMap<int32, T *> _overflow;
+
+		// In creation order. Removed objects leave a hole until no iterator
+		// is left, as objects delete themselves and iterations nest.
+		Common::Array<T *> _objects;
+		int _holes;
+		mutable int _iterators;
 	};
 
 	/**
 	 * @short Smart pointer class
-	 * This class wraps a C pointer to T, subclass of PoolObject, which gets reset to NULL as soon as
-	 * the object is deleted, e.g by Pool::restoreObjects().
+	 * This class wraps the id of T, subclass of PoolObject, and resolves it through the pool
+	 * on every access, so that it reads as NULL as soon as the object is deleted, e.g by
+	 * Pool::restoreObjects().
 	 * Its operator overloads allows the Ptr class to be used as if it was a raw C pointer.
 	 */
 	class Ptr {
 	public:
-		Ptr() : _obj(NULL) { }
-		Ptr(T *obj) : _obj(obj) {
-			if (_obj)
-				_obj->addPointer(this);
-		}
-		Ptr(const Ptr &ptr) : _obj(ptr._obj) {
-			if (_obj)
-				_obj->addPointer(this);
-		}
-		~Ptr() {
-			if (_obj)
-				_obj->removePointer(this);
-		}
+		Ptr() : _id(0) { }
+		Ptr(T *obj) : _id(obj ? obj->getId() : 0) { }
 
-		Ptr &operator=(T *obj);
-		Ptr &operator=(const Ptr &ptr);
+		Ptr &operator=(T *obj) { _id = obj ? obj->getId() : 0; return *this; }
 
-		inline operator bool() const { return _obj; }
-		inline bool operator!() const { return !_obj; }
-		inline bool operator==(T *obj) const { return _obj == obj; }
-		inline bool operator!=(T *obj) const { return _obj != obj; }
+		inline operator bool() const { return get(); }
+		inline bool operator!() const { return !get(); }
+		inline bool operator==(T *obj) const { return get() == obj; }
+		inline bool operator!=(T *obj) const { return get() != obj; }
 
-		inline T *operator->() const { return _obj; }
-		inline T &operator*() const { return *_obj; }
-		inline operator T*() const { return _obj; }
+		inline T *operator->() const { return get(); }
+		inline T &operator*() const { return *get(); }
+		inline operator T*() const { return get(); }
 
 	private:
-		inline void reset() { _obj = NULL; }
+		inline T *get() const { return _id && s_pool ? s_pool->getObject(_id) : nullptr; }
 
-		T *_obj;
-
-		friend class PoolObject;
+		int32 _id;
 	};
 
 	virtual ~PoolObject();
@@ -152,40 +197,28 @@ protected:
 	static void restoreStaticState(SaveGame *state) {}
 
 private:
-	void addPointer(Ptr *pointer) { _pointers.push_back(pointer); }
-	void removePointer(Ptr *pointer) { _pointers.remove(pointer); }
-
 	int _id;
-	static int s_id;
 	static Pool *s_pool;
 
-	Common::List<Ptr *> _pointers;
-
 	friend class Pool;
-	friend class Ptr;
 };
 
 template <class T>
 bool operator==(T *obj, const typename PoolObject<T>::Ptr &ptr) {
-	return obj == ptr._obj;
+	return ptr == obj;
 }
 
 template <class T>
 bool operator!=(T *obj, const typename PoolObject<T>::Ptr &ptr) {
-	return obj != ptr._obj;
+	return ptr != obj;
 }
 
-template <class T>
-int PoolObject<T>::s_id = 0;
-
 template <class T>
 typename PoolObject<T>::Pool *PoolObject<T>::s_pool = NULL;
 
 template <class T>
-PoolObject<T>::PoolObject() {
-	++s_id;
-	_id = s_id;
-
+PoolObject<T>::PoolObject() :
+	_id(0) {
 	if (!s_pool) {
 		s_pool = new Pool();
 	}
@@ -195,18 +228,11 @@ PoolObject<T>::PoolObject() {
 template <class T>
 PoolObject<T>::~PoolObject() {
 	s_pool->removeObject(_id);
-
-	for (typename Common::List<Ptr *>::iterator i = _pointers.begin(); i != _pointers.end(); ++i) {
-		(*i)->reset();
-	}
 }
 
 template <class T>
 void PoolObject<T>::setId(int id) {
 	_id = id;
-	if (id > s_id) {
-		s_id = id;
-	}
 }
 
 template <class T>
@@ -228,7 +254,7 @@ typename PoolObject<T>::Pool &PoolObject<T>::getPool() {
 
 template <class T>
 PoolObject<T>::Pool::Pool() :
-	_restoring(false) {
+	_restoring(false), _freeHead(0), _holes(0), _iterators(0) {
 }
 
 template <class T>
@@ -236,53 +262,193 @@ PoolObject<T>::Pool::~Pool() {
 	PoolObject<T>::s_pool = NULL;
 }
 
+template <class T>
+int32 PoolObject<T>::Pool::newId() {
+	int32 slot = -1;
+	while (_freeHead < _freeSlots.size()) {
+		int32 free = _freeSlots[_freeHead++];
+		// a freed slot may since have been taken by a restored id
+		if (!_slots[free].object) {
+			slot = free;
+			break;
+		}
+	}
+	if (_freeHead == _freeSlots.size()) {
+		_freeSlots.clear();
+		_freeHead = 0;
+	}
+
+	if (slot == -1) {
+		if (_slots.size() > SlotMask) {
+			error("Too many objects in the pool of %s", tag2str(T::getStaticTag()));
+		}
+		slot = _slots.size();
+		Slot empty = { nullptr, -1, 0 };
+		_slots.push_back(empty);
+	}
+
+	int32 generation = _slots[slot].generation + 1;
+	if (generation > MaxGeneration) {
+		generation = 1;
+	}
+	_slots[slot].generation = generation;
+	return (generation << SlotBits) | slot;
+}
+
+template <class T>
+void PoolObject<T>::Pool::insert(T *obj) {
+	int32 id = obj->_id;
+	if (getObject(id)) {
+		removeObject(id);
+	}
+
+	int32 slot = id & SlotMask;
+	while ((int32)_slots.size() <= slot) {
+		Slot empty = { nullptr, -1, 0 };
+		_freeSlots.push_back(_slots.size());
+		_slots.push_back(empty);
+	}
+
+	Slot &s = _slots[slot];
+	s.generation = MAX<int32>(s.generation, (id >> SlotBits) & MaxGeneration);
+	if (s.object || id < 0) {
+		_overflow[id] = obj;
+	} else {
+		s.object = obj;
+		s.index = _objects.size();
+	}
+	_objects.push_back(obj);
+}
+
+template <class T>
+void PoolObject<T>::Pool::compact() {
+	// Moving objects would make live iterators skip or repeat some of them
+	if (!_holes || _iterators) {
+		return;
+	}
+
+	uint count = 0;
+	for (uint i = 0; i < _objects.size(); ++i) {
+		T *obj = _objects[i];
+		if (!obj) {
+			continue;
+		}
+		Slot &s = _slots[obj->_id & SlotMask];
+		if (s.object == obj) {
+			s.index = count;
+		}
+		_objects[count++] = obj;
+	}
+	_objects.resize(count);
+	_holes = 0;
+}
+
+template <class T>
+void PoolObject<T>::Pool::release() const {
+	if (--_iterators == 0) {
+		const_cast<Pool *>(this)->compact();
+	}
+}
+
+template <class T>
+void PoolObject<T>::Pool::deleteAll() {
+	// Deleted objects leave holes, so indices stay valid
+	while (getSize() > 0) {
+		for (uint i = 0; i < _objects.size(); ++i) {
+			if (_objects[i]) {
+				delete _objects[i];
+			}
+		}
+	}
+	compact();
+}
+
 template <class T>
 void PoolObject<T>::Pool::addObject(T *obj) {
 	if (!_restoring) {
-		_map.setVal(obj->_id, obj);
+		if (!obj->_id) {
+			obj->_id = newId();
+		}
+		insert(obj);
 	}
 }
 
 template <class T>
 void PoolObject<T>::Pool::removeObject(int32 id) {
-	_map.erase(id);
+	uint32 slot = id & SlotMask;
+	T *obj = nullptr;
+	int32 index = -1;
+	if (slot < _slots.size() && _slots[slot].object && _slots[slot].object->_id == id) {
+		Slot &s = _slots[slot];
+		obj = s.object;
+		index = s.index;
+		s.object = nullptr;
+		s.index = -1;
+		_freeSlots.push_back(slot);
+	} else if (!_overflow.empty()) {
+		typename Common::HashMap<int32, T *>::iterator it = _overflow.find(id);
+		if (it == _overflow.end()) {
+			return;
+		}
+		obj = it->_value;
+		_overflow.erase(it);
+		for (uint i = 0; i < _objects.size(); ++i) {
+			if (_objects[i] == obj) {
+				index = i;
+				break;
+			}
+		}
+	}
+
+	if (index != -1) {
+		_objects[index] = nullptr;
+		++_holes;
+	}
 }
 
 template <class T>
 T *PoolObject<T>::Pool::getObject(int32 id) {
-	return _map.getVal(id, NULL);
+	uint32 slot = id & SlotMask;
+	if (slot < _slots.size()) {
+		T *obj = _slots[slot].object;
+		if (obj && obj->_id == id) {
+			return obj;
+		}
+	}
+	if (!_overflow.empty()) {
+		return _overflow.getVal(id, nullptr);
+	}
+	return nullptr;
 }
 
 template <class T>
 typename PoolObject<T>::Pool::iterator PoolObject<T>::Pool::begin() {
-	return iterator(_map.begin());
+	return iterator(this, &_objects, 0);
 }
 
 template <class T>
 typename PoolObject<T>::Pool::const_iterator PoolObject<T>::Pool::begin() const {
-	return const_iterator(_map.begin());
+	return const_iterator(this, &_objects, 0);
 }
 
 template <class T>
 typename PoolObject<T>::Pool::iterator PoolObject<T>::Pool::end() {
-	return iterator(_map.end());
+	return iterator(this, &_objects, _objects.size());
 }
 
 template <class T>
 typename PoolObject<T>::Pool::const_iterator PoolObject<T>::Pool::end() const {
-	return const_iterator(_map.end());
+	return const_iterator(this, &_objects, _objects.size());
 }
 
 template <class T>
 int PoolObject<T>::Pool::getSize() const {
-	return _map.size();
+	return _objects.size() - _holes;
 }
 
 template <class T>
 void PoolObject<T>::Pool::deleteObjects() {
-	while (!_map.empty()) {
-		delete *begin();
-	}
+	deleteAll();
 	delete this;
 }
 
@@ -292,7 +458,7 @@ void PoolObject<T>::Pool::saveObjects(SaveGame *state) {
 
 	T::saveStaticState(state);
 
-	state->writeLEUint32(_map.size());
+	state->writeLEUint32(getSize());
 	for (iterator i = begin(); i != end(); ++i) {
 		T *a = *i;
 		state->writeLESint32(i.getId());
@@ -311,53 +477,29 @@ void PoolObject<T>::Pool::restoreObjects(SaveGame *state) {
 
 	int32 size = state->readLEUint32();
 	_restoring = true;
-	Common::HashMap<int32, T *> tempMap;
+	Common::Array<T *> restored;
+	restored.reserve(size);
 	for (int32 i = 0; i < size; ++i) {
 		int32 id = state->readLESint32();
-		T *t = _map.getVal(id);
-		_map.erase(id);
-		if (!t) {
+		T *t = getObject(id);
+		if (t) {
+			removeObject(id);
+		} else {
 			t = new T();
 			t->setId(id);
 		}
-		tempMap[id] = t;
+		restored.push_back(t);
 		t->restoreState(state);
 	}
-	for (iterator i = begin(); i != end(); ++i) {
-		delete *i;
+	deleteAll();
+	for (uint i = 0; i < restored.size(); ++i) {
+		insert(restored[i]);
 	}
-	_map = tempMap;
 	_restoring = false;
 
 	state->endSection();
 }
 
-template<class T>
-typename PoolObject<T>::Ptr &PoolObject<T>::Ptr::operator=(T *obj) {
-	if (_obj) {
-		_obj->removePointer(this);
-	}
-	_obj = obj;
-	if (obj) {
-		obj->addPointer(this);
-	}
-
-	return *this;
-}
-
-template<class T>
-typename PoolObject<T>::Ptr &PoolObject<T>::Ptr::operator=(const Ptr &ptr) {
-	if (_obj) {
-		_obj->removePointer(this);
-	}
-	_obj = ptr._obj;
-	if (_obj) {
-		_obj->addPointer(this);
-	}
-
-	return *this;
-}
-
 }
 
 #endif
@@ -32,7 +32,9 @@
 #include "engines/grim/savegame.h"
 #include "engines/grim/lab.h"
 #include "engines/grim/bitmap.h"
+#include "engines/grim/bitmapcache.h"
 #include "engines/grim/font.h"
+#include "engines/grim/gfx_base.h"
 #include "engines/grim/model.h"
 #include "engines/grim/sprite.h"
 #include "engines/grim/inputdialog.h"
@@ -44,12 +46,15 @@
 #include "engines/grim/patchr.h"
 #include "engines/grim/md5check.h"
 #include "engines/grim/update/update.h"
+#include "engines/grim/set.h"
+#include "engines/grim/textcache.h"
 
 #include "common/algorithm.h"
 #include "common/zlib.h"
 #include "common/memstream.h"
 #include "common/file.h"
 #include "common/config-manager.h"
+#include "common/system.h"
 
 namespace Grim {
 
@@ -73,6 +78,8 @@ public:
 ResourceLoader::ResourceLoader() {
 	_cacheDirty = false;
 	_cacheMemorySize = 0;
+	_textCache = new TextCache(ConfMan.getActiveDomainName() + ".textcache");
+	_bitmapCache = new BitmapCache(ConfMan.getActiveDomainName(), ConfMan.getBool("disk_bitmap_cache"));
 
 	Lab *l;
 	Common::ArchiveMemberList files, updFiles;
@@ -196,9 +203,10 @@ ResourceLoader::ResourceLoader() {
 			continue;
 
 		l = new Lab();
-		if (l->open(filename))
+		if (l->open(filename)) {
 			SearchMan.add(filename, l, priority--, true);
-		else
+			_labs.push_back(l);
+		} else
 			delete l;
 	}
 
@@ -225,6 +233,8 @@ ResourceLoader::~ResourceLoader() {
 	clearList(_keyframeAnims);
 	clearList(_lipsyncs);
 	MD5Check::clear();
+	delete _textCache;
+	delete _bitmapCache;
 }
 
 static int sortCallback(const void *entry1, const void *entry2) {
@@ -533,6 +543,10 @@ void ResourceLoader::uncacheModel(Model *m) {
 	_models.remove(m);
 }
 
+void ResourceLoader::uncacheModelEMI(EMIModel *m) {
+	_emiModels.remove(m);
+}
+
 void ResourceLoader::uncacheColormap(CMap *c) {
 	_colormaps.remove(c);
 }
@@ -549,6 +563,85 @@ void ResourceLoader::uncacheAnimationEmi(AnimationEmi *a) {
 	_emiAnims.remove(a);
 }
 
+void ResourceLoader::releaseDriverData() {
+	for (Common::List<Model *>::const_iterator i = _models.begin(); i != _models.end(); ++i) {
+		Model *m = *i;
+		for (int j = 0; j < m->_numHierNodes; ++j) {
+			if (m->_rootHierNode[j]._mesh)
+				g_driver->destroyMesh(m->_rootHierNode[j]._mesh);
+		}
+	}
+	for (Common::List<EMIModel *>::const_iterator i = _emiModels.begin(); i != _emiModels.end(); ++i) {
+		g_driver->destroyEMIModel(*i);
+	}
+}
+
+void ResourceLoader::createDriverData() {
+	for (Common::List<Model *>::const_iterator i = _models.begin(); i != _models.end(); ++i) {
+		Model *m = *i;
+		for (int j = 0; j < m->_numHierNodes; ++j) {
+			if (m->_rootHierNode[j]._mesh)
+				g_driver->createMesh(m->_rootHierNode[j]._mesh);
+		}
+	}
+	for (Common::List<EMIModel *>::const_iterator i = _emiModels.begin(); i != _emiModels.end(); ++i) {
+		g_driver->createEMIModel(*i);
+	}
+}
+
+bool ResourceLoader::getLabEntry(const Common::String &fname, Common::String &lab, uint32 &offset, uint32 &size) const {
+	Common::ArchiveMemberPtr member = SearchMan.getMember(fname);
+	if (!member)
+		return false;
+
+	// The member is only a LabEntry if one of our LABs handed it out
+	for (Common::Array<Lab *>::const_iterator i = _labs.begin(); i != _labs.end(); ++i) {
+		Common::ArchiveMemberPtr entry = (*i)->getMember(fname);
+		if (entry && entry.get() == member.get()) {
+			const LabEntry *labEntry = static_cast<const LabEntry *>(entry.get());
+			lab = (*i)->getFileName();
+			offset = labEntry->getOffset();
+			size = labEntry->getSize();
+			return true;
+		}
+	}
+	return false;
+}
+
+void ResourceLoader::warmTextCache() {
+	uint32 startTime = g_system->getMillis();
+	Common::ArchiveMemberList files;
+	SearchMan.listMatchingMembers(files, "*.set");
+	SearchMan.listMatchingMembers(files, "*.key");
+
+	// Models and costumes are left to be cached on first use, since
+	// loading them needs a colormap or an owning actor.
+	int parsed = 0;
+	for (Common::ArchiveMemberList::const_iterator i = files.begin(); i != files.end(); ++i) {
+		Common::String name = (*i)->getName();
+		Common::SeekableReadStream *stream = openNewStreamFile(name);
+		if (!stream)
+			continue;
+
+		char header[7];
+		bool text = stream->read(header, sizeof(header)) == sizeof(header);
+		stream->seek(0, SEEK_SET);
+		if (text && name.matchString("*.set", true)) {
+			if (memcmp(header, "section", 7) == 0) {
+				Set::cacheText(name, stream);
+				++parsed;
+			}
+		} else if (text && READ_BE_UINT32(header) != MKTAG('F','Y','E','K')) {
+			delete new KeyframeAnim(name, stream);
+			++parsed;
+		}
+		delete stream;
+	}
+	_textCache->flush();
+
+	debug("Text resource cache warmed with %d files, %d entries in %d ms", parsed, _textCache->size(), g_system->getMillis() - startTime);
+}
+
 ModelPtr ResourceLoader::getModel(const Common::String &fname, CMap *c) {
 	Common::String filename = fname;
 	filename.toLowercase();
@@ -46,6 +46,8 @@ class Sprite;
 class EMICostume;
 class Lab;
 class Actor;
+class TextCache;
+class BitmapCache;
 
 typedef ObjectPtr<Material> MaterialPtr;
 typedef ObjectPtr<Model> ModelPtr;
@@ -79,6 +81,7 @@ public:
 	LipSyncPtr getLipSync(const Common::String &fname);
 	AnimationEmiPtr getAnimationEmi(const Common::String &fname);
 	void uncacheModel(Model *m);
+	void uncacheModelEMI(EMIModel *m);
 	void uncacheColormap(CMap *c);
 	void uncacheKeyframe(KeyframeAnim *kf);
 	void uncacheLipSync(LipSync *l);
@@ -92,6 +95,22 @@ public:
 
 	static Common::String fixFilename(const Common::String &filename, bool append = true);
 
+	/** Moves the meshes of all loaded models to a new renderer. */
+	void releaseDriverData();
+	void createDriverData();
+
+	/** Cache of parsed text resources, shared by the text loaders. */
+	TextCache *getTextCache() const { return _textCache; }
+	/** Parses every text set and keyframe into the text cache ahead of play. */
+	void warmTextCache();
+	/** Cache of decoded codec 3 bitmaps. */
+	BitmapCache *getBitmapCache() const { return _bitmapCache; }
+	/**
+	 * Finds the LAB entry a file name resolves to, which identifies its data
+	 * without reading it. Returns false if the file doesn't come from a LAB.
+	 */
+	bool getLabEntry(const Common::String &fname, Common::String &lab, uint32 &offset, uint32 &size) const;
+
 private:
 	Common::SeekableReadStream *loadFile(const Common::String &filename) const;
 	Common::SeekableReadStream *getFileFromCache(const Common::String &filename) const;
@@ -109,6 +128,10 @@ private:
 	Common::List<KeyframeAnim *> _keyframeAnims;
 	Common::List<LipSync *> _lipsyncs;
 	Common::List<AnimationEmi *> _emiAnims;
+
+	Common::Array<Lab *> _labs;
+	TextCache *_textCache;
+	BitmapCache *_bitmapCache;
 };
 
 extern ResourceLoader *g_resourceloader;
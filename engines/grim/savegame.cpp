@@ -23,6 +23,7 @@
 #include "common/endian.h"
 #include "common/savefile.h"
 #include "common/system.h"
+#include "common/zlib.h"
 
 #include "math/vector3d.h"
 
@@ -35,7 +36,11 @@ namespace Grim {
 #define SAVEGAME_FOOTERTAG  'ESAV'
 
 uint SaveGame::SAVEGAME_MAJOR_VERSION = 22;
-uint SaveGame::SAVEGAME_MINOR_VERSION = 23;
+uint SaveGame::SAVEGAME_MINOR_VERSION = 26;
+
+// Savegames from this minor version on store their sections as a sequence of
+// chunks, so they can be written and read without buffering whole sections.
+#define SAVEGAME_STREAMED_MINOR_VERSION 24
 
 SaveGame *SaveGame::openForLoading(const Common::String &filename) {
 	Common::InSaveFile *inSaveFile = g_system->getSavefileManager()->openForLoading(filename);
@@ -43,6 +48,13 @@ SaveGame *SaveGame::openForLoading(const Common::String &filename) {
 		warning("SaveGame::openForLoading() Error opening savegame file %s", filename.c_str());
 		return nullptr;
 	}
+	// The default savefile manager already takes care of compressed savefiles,
+	// but other backends may hand us the raw data.
+	inSaveFile = Common::wrapCompressedReadStream(inSaveFile);
+	if (!inSaveFile) {
+		warning("SaveGame::openForLoading() Error decompressing savegame file %s", filename.c_str());
+		return nullptr;
+	}
 
 	SaveGame *save = new SaveGame();
 
@@ -61,11 +73,13 @@ SaveGame *SaveGame::openForLoading(const Common::String &filename) {
 }
 
 SaveGame *SaveGame::openForSaving(const Common::String &filename) {
-	Common::OutSaveFile *outSaveFile =  g_system->getSavefileManager()->openForSaving(filename);
+	// Compress the savegame ourselves, so that every backend gets compressed savegames.
+	Common::OutSaveFile *outSaveFile = g_system->getSavefileManager()->openForSaving(filename, false);
 	if (!outSaveFile) {
 		warning("SaveGame::openForSaving() Error creating savegame file %s", filename.c_str());
 		return nullptr;
 	}
+	outSaveFile = Common::wrapCompressedWriteStream(outSaveFile);
 
 	SaveGame *save = new SaveGame();
 
@@ -85,7 +99,7 @@ SaveGame *SaveGame::openForSaving(const Common::String &filename) {
 SaveGame::SaveGame() :
 		_currentSection(0), _sectionBuffer(nullptr), _majorVersion(0),
 		_minorVersion(0), _saving(false), _inSaveFile(nullptr), _outSaveFile(nullptr),
-		_sectionSize(0), _sectionAlloc(0), _sectionPtr(0) {
+		_sectionSize(0), _sectionAlloc(0), _sectionPtr(0), _sectionMore(false) {
 
 }
 
@@ -114,103 +128,163 @@ uint SaveGame::saveMinorVersion() const {
 	return _minorVersion;
 }
 
-uint32 SaveGame::beginSection(uint32 sectionTag) {
+bool SaveGame::isStreamed() const {
+	return _minorVersion >= SAVEGAME_STREAMED_MINOR_VERSION;
+}
+
+void SaveGame::beginSection(uint32 sectionTag) {
 	assert(_majorVersion == SAVEGAME_MAJOR_VERSION);
 
 	if (_currentSection != 0)
 		error("Tried to begin a new save game section with ending old section");
 	_currentSection = sectionTag;
 	_sectionSize = 0;
-	if (!_saving) {
-		uint32 tag = 0;
+	_sectionPtr = 0;
+	_sectionMore = false;
+	if (_saving) {
+		if (!_sectionBuffer) {
+			_sectionAlloc = _chunkSize;
+			_sectionBuffer = (byte *)malloc(_sectionAlloc);
+			if (!_sectionBuffer)
+				error("Could not allocate memory for save game");
+		}
+		return;
+	}
 
-		while (tag != sectionTag) {
-			tag = _inSaveFile->readUint32BE();
-			if (tag == SAVEGAME_FOOTERTAG)
+	if (isStreamed()) {
+		for (;;) {
+			uint32 tag = _inSaveFile->readUint32BE();
+			if (tag == SAVEGAME_FOOTERTAG || _inSaveFile->eos())
 				error("Unable to find requested section of savegame");
-			_sectionSize = _inSaveFile->readUint32BE();
-			_inSaveFile->seek(_sectionSize, SEEK_CUR);
-		}
-		if (!_sectionBuffer || _sectionAlloc < _sectionSize) {
-			_sectionAlloc = _sectionSize;
-			byte *buff = (byte *)realloc(_sectionBuffer, _sectionAlloc);
-			if (buff == nullptr) {
-				free(_sectionBuffer);
-				error("Could not allocate memory for save game");
-			}
-			_sectionBuffer = buff;
+			_sectionMore = true;
+			if (tag == sectionTag)
+				break;
+			skipChunks();
 		}
+		readNextChunk();
+		return;
+	}
 
-		_inSaveFile->seek(-(int32)_sectionSize, SEEK_CUR);
-		_inSaveFile->read(_sectionBuffer, _sectionSize);
+	uint32 tag = 0;
 
-	} else {
-		if (!_sectionBuffer) {
-			_sectionAlloc = _allocAmmount;
-			_sectionBuffer = (byte *)malloc(_sectionAlloc);
+	while (tag != sectionTag) {
+		tag = _inSaveFile->readUint32BE();
+		if (tag == SAVEGAME_FOOTERTAG)
+			error("Unable to find requested section of savegame");
+		_sectionSize = _inSaveFile->readUint32BE();
+		_inSaveFile->seek(_sectionSize, SEEK_CUR);
+	}
+	if (!_sectionBuffer || _sectionAlloc < _sectionSize) {
+		_sectionAlloc = _sectionSize;
+		byte *buff = (byte *)realloc(_sectionBuffer, _sectionAlloc);
+		if (buff == nullptr) {
+			free(_sectionBuffer);
+			error("Could not allocate memory for save game");
 		}
+		_sectionBuffer = buff;
 	}
-	_sectionPtr = 0;
-	return _sectionSize;
+
+	_inSaveFile->seek(-(int32)_sectionSize, SEEK_CUR);
+	_inSaveFile->read(_sectionBuffer, _sectionSize);
 }
 
 void SaveGame::endSection() {
 	if (_currentSection == 0)
 		error("Tried to end a save game section without starting a section");
 	if (_saving) {
-		_outSaveFile->writeUint32BE(_currentSection);
-		_outSaveFile->writeUint32BE(_sectionSize);
-		_outSaveFile->write(_sectionBuffer, _sectionSize);
+		flushChunk(false);
+	} else if (_sectionMore) {
+		skipChunks();
 	}
 	_currentSection = 0;
 }
 
-void SaveGame::read(void *data, int size) {
+bool SaveGame::isSectionEnd() {
 	if (_saving)
-		error("SaveGame::readBlock called when storing a savegame");
+		error("SaveGame::isSectionEnd called when storing a savegame");
 	if (_currentSection == 0)
-		error("Tried to read a block without starting a section");
-	memcpy(data, &_sectionBuffer[_sectionPtr], size);
-	_sectionPtr += size;
+		error("Tried to check the end of a section without starting a section");
+	// The last chunk of a section may be empty.
+	while (_sectionPtr == _sectionSize && _sectionMore)
+		readNextChunk();
+	return _sectionPtr == _sectionSize;
 }
 
-uint32 SaveGame::readLEUint32() {
+void SaveGame::flushChunk(bool more) {
+	if (_sectionPtr == 0)
+		_outSaveFile->writeUint32BE(_currentSection);
+	_outSaveFile->writeUint32BE(_sectionSize | (more ? _chunkMoreFlag : 0));
+	_outSaveFile->write(_sectionBuffer, _sectionSize);
+	_sectionMore = more;
+	_sectionPtr += _sectionSize;
+	_sectionSize = 0;
+}
+
+void SaveGame::readNextChunk() {
+	if (!_sectionMore)
+		error("Tried to read past the end of save game section");
+	uint32 header = _inSaveFile->readUint32BE();
+	_sectionMore = (header & _chunkMoreFlag) != 0;
+	_sectionSize = header & ~_chunkMoreFlag;
+	if (_sectionSize > _chunkSize)
+		error("Invalid chunk size in save game section");
+	if (!_sectionBuffer || _sectionAlloc < _sectionSize) {
+		_sectionAlloc = _chunkSize;
+		byte *buff = (byte *)realloc(_sectionBuffer, _sectionAlloc);
+		if (buff == nullptr) {
+			free(_sectionBuffer);
+			error("Could not allocate memory for save game");
+		}
+		_sectionBuffer = buff;
+	}
+	_inSaveFile->read(_sectionBuffer, _sectionSize);
+	_sectionPtr = 0;
+}
+
+void SaveGame::skipChunks() {
+	while (_sectionMore) {
+		uint32 header = _inSaveFile->readUint32BE();
+		_sectionMore = (header & _chunkMoreFlag) != 0;
+		_inSaveFile->skip(header & ~_chunkMoreFlag);
+	}
+}
+
+void SaveGame::read(void *data, int size) {
 	if (_saving)
 		error("SaveGame::readBlock called when storing a savegame");
 	if (_currentSection == 0)
 		error("Tried to read a block without starting a section");
-	uint32 data = READ_LE_UINT32(&_sectionBuffer[_sectionPtr]);
-	_sectionPtr += 4;
-	return data;
+	byte *dst = (byte *)data;
+	while (size > 0) {
+		if (_sectionPtr == _sectionSize)
+			readNextChunk();
+		uint32 len = MIN<uint32>(size, _sectionSize - _sectionPtr);
+		memcpy(dst, &_sectionBuffer[_sectionPtr], len);
+		_sectionPtr += len;
+		dst += len;
+		size -= len;
+	}
+}
+
+uint32 SaveGame::readLEUint32() {
+	byte data[4];
+	read(data, 4);
+	return READ_LE_UINT32(data);
 }
 
 uint16 SaveGame::readLEUint16() {
-	if (_saving)
-		error("SaveGame::readBlock called when storing a savegame");
-	if (_currentSection == 0)
-		error("Tried to read a block without starting a section");
-	uint16 data = READ_LE_UINT16(&_sectionBuffer[_sectionPtr]);
-	_sectionPtr += 2;
-	return data;
+	byte data[2];
+	read(data, 2);
+	return READ_LE_UINT16(data);
 }
 
 int32 SaveGame::readLESint32() {
-	if (_saving)
-		error("SaveGame::readBlock called when storing a savegame");
-	if (_currentSection == 0)
-		error("Tried to read a block without starting a section");
-	int32 data = (int32)READ_LE_UINT32(&_sectionBuffer[_sectionPtr]);
-	_sectionPtr += 4;
-	return data;
+	return (int32)readLEUint32();
 }
 
 byte SaveGame::readByte() {
-	if (_saving)
-		error("SaveGame::readBlock called when storing a savegame");
-	if (_currentSection == 0)
-		error("Tried to read a block without starting a section");
-	byte data = _sectionBuffer[_sectionPtr];
-	_sectionPtr++;
+	byte data;
+	read(&data, 1);
 	return data;
 }
 
@@ -218,62 +292,38 @@ bool SaveGame::readBool() {
 	return readByte() != 0;
 }
 
-void SaveGame::checkAlloc(int size) {
-	if (_sectionSize + size > _sectionAlloc) {
-		while (_sectionSize + size > _sectionAlloc)
-			_sectionAlloc += _allocAmmount;
-		_sectionBuffer = (byte *)realloc(_sectionBuffer, _sectionAlloc);
-		if (!_sectionBuffer)
-			error("Failed to allocate space for buffer");
-	}
-}
-
 void SaveGame::write(const void *data, int size) {
 	if (!_saving)
 		error("SaveGame::writeBlock called when restoring a savegame");
 	if (_currentSection == 0)
 		error("Tried to write a block without starting a section");
 
-	checkAlloc(size);
-
-	memcpy(&_sectionBuffer[_sectionSize], data, size);
-	_sectionSize += size;
+	const byte *src = (const byte *)data;
+	while (size > 0) {
+		if (_sectionSize == _chunkSize)
+			flushChunk(true);
+		uint32 len = MIN<uint32>(size, _chunkSize - _sectionSize);
+		memcpy(&_sectionBuffer[_sectionSize], src, len);
+		_sectionSize += len;
+		src += len;
+		size -= len;
+	}
 }
 
 void SaveGame::writeLEUint32(uint32 data) {
-	if (!_saving)
-		error("SaveGame::writeBlock called when restoring a savegame");
-	if (_currentSection == 0)
-		error("Tried to write a block without starting a section");
-
-	checkAlloc(4);
-
-	WRITE_LE_UINT32(&_sectionBuffer[_sectionSize], data);
-	_sectionSize += 4;
+	byte buf[4];
+	WRITE_LE_UINT32(buf, data);
+	write(buf, 4);
 }
 
 void SaveGame::writeLEUint16(uint16 data) {
-	if (!_saving)
-		error("SaveGame::writeBlock called when restoring a savegame");
-	if (_currentSection == 0)
-		error("Tried to write a block without starting a section");
-
-	checkAlloc(2);
-
-	WRITE_LE_UINT16(&_sectionBuffer[_sectionSize], data);
-	_sectionSize += 2;
+	byte buf[2];
+	WRITE_LE_UINT16(buf, data);
+	write(buf, 2);
 }
 
 void SaveGame::writeLESint32(int32 data) {
-	if (!_saving)
-		error("SaveGame::writeBlock called when restoring a savegame");
-	if (_currentSection == 0)
-		error("Tried to write a block without starting a section");
-
-	checkAlloc(4);
-
-	WRITE_LE_UINT32(&_sectionBuffer[_sectionSize], (uint32)data);
-	_sectionSize += 4;
+	writeLEUint32((uint32)data);
 }
 
 void SaveGame::writeBool(bool data) {
@@ -281,15 +331,7 @@ void SaveGame::writeBool(bool data) {
 }
 
 void SaveGame::writeByte(byte data) {
-	if (!_saving)
-		error("SaveGame::writeBlock called when restoring a savegame");
-	if (_currentSection == 0)
-		error("Tried to write a block without starting a section");
-
-	checkAlloc(1);
-
-	_sectionBuffer[_sectionSize] = data;
-	_sectionSize++;
+	write(&data, 1);
 }
 
 void SaveGame::writeVector3d(const Math::Vector3d &vec) {
@@ -342,8 +384,16 @@ float SaveGame::readFloat() {
 
 Common::String SaveGame::readString() {
 	int32 len = readLESint32();
-	Common::String s((const char *)&_sectionBuffer[_sectionPtr], len);
-	_sectionPtr += len;
+	if (_sectionPtr + len <= _sectionSize) {
+		Common::String s((const char *)&_sectionBuffer[_sectionPtr], len);
+		_sectionPtr += len;
+		return s;
+	}
+
+	char *buf = new char[len];
+	read(buf, len);
+	Common::String s(buf, len);
+	delete[] buf;
 	return s;
 }
 
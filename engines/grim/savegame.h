@@ -61,8 +61,18 @@ public:
 
 	uint saveMajorVersion() const;
 	uint saveMinorVersion() const;
-	uint32 beginSection(uint32 sectionTag);
+	/**
+	 * Begins a new section.
+	 * Sections of streamed savegames are written in chunks of _chunkSize bytes, so
+	 * their total size is not known up front; use isSectionEnd() to find out
+	 * whether there is more data to read.
+	 */
+	void beginSection(uint32 sectionTag);
 	void endSection();
+	/**
+	 * Returns true when all the data of the section being loaded has been read.
+	 */
+	bool isSectionEnd();
 	void read(void *data, int size);
 	void write(const void *data, int size);
 	uint32 readLEUint32();
@@ -85,11 +95,14 @@ public:
 	float readFloat();
 	Common::String readString();
 
-	void checkAlloc(int size);
-
 protected:
 	SaveGame();
 
+	bool isStreamed() const;
+	void flushChunk(bool more);
+	void readNextChunk();
+	void skipChunks();
+
 	uint _majorVersion;
 	uint _minorVersion;
 	bool _saving;
@@ -100,8 +113,10 @@ protected:
 	uint32 _sectionAlloc;
 	uint32 _sectionPtr;
 	byte *_sectionBuffer;
+	bool _sectionMore;
 
-	static const int _allocAmmount = 1048576;
+	static const uint32 _chunkSize = 131072;
+	static const uint32 _chunkMoreFlag = 0x80000000;
 };
 
 } // end of namespace Grim
@@ -40,13 +40,13 @@
 namespace Grim {
 
 Set::Set(const Common::String &sceneName, Common::SeekableReadStream *data) :
-		_locked(false), _name(sceneName), _enableLights(false) {
+		_locked(false), _textOnly(false), _name(sceneName), _enableLights(false) {
 
 	char header[7];
 	data->read(header, 7);
 	data->seek(0, SEEK_SET);
 	if (memcmp(header, "section", 7) == 0) {
-		TextSplitter ts(_name, data);
+		TextSplitter ts(_name, data, g_resourceloader->getTextCache());
 		loadText(ts);
 	} else {
 		loadBinary(data);
@@ -54,7 +54,7 @@ Set::Set(const Common::String &sceneName, Common::SeekableReadStream *data) :
 }
 
 Set::Set() :
-		_cmaps(nullptr), _locked(false), _enableLights(false), _numSetups(0),
+		_cmaps(nullptr), _locked(false), _textOnly(false), _enableLights(false), _numSetups(0),
 		_numLights(0), _numSectors(0), _numObjectStates(0), _minVolume(0),
 		_maxVolume(0), _numCmaps(0), _numShadows(0), _currSetup(nullptr),
 		_setups(nullptr), _lights(nullptr), _sectors(nullptr), _shadows(nullptr) {
@@ -69,7 +69,8 @@ Set::~Set() {
 			delete _setups[i]._bkgndZBm;
 		}
 		delete[] _setups;
-		turnOffLights();
+		if (!_textOnly)
+			turnOffLights();
 		delete[] _lights;
 		for (int i = 0; i < _numSectors; ++i) {
 			delete _sectors[i];
@@ -84,6 +85,14 @@ Set::~Set() {
 	}
 }
 
+void Set::cacheText(const Common::String &name, Common::SeekableReadStream *data) {
+	Set set;
+	set._name = name;
+	set._textOnly = true;
+	TextSplitter ts(name, data, g_resourceloader->getTextCache());
+	set.loadText(ts);
+}
+
 void Set::loadText(TextSplitter &ts) {
 	char tempBuf[256];
 
@@ -93,7 +102,8 @@ void Set::loadText(TextSplitter &ts) {
 	char cmap_name[256];
 	for (int i = 0; i < _numCmaps; i++) {
 		ts.scanString(" colormap %256s", 1, cmap_name);
-		_cmaps[i] = g_resourceloader->getColormap(cmap_name);
+		if (!_textOnly)
+			_cmaps[i] = g_resourceloader->getColormap(cmap_name);
 	}
 
 	if (ts.checkString("section: objectstates") || ts.checkString("sections: object_states")) {
@@ -329,14 +339,16 @@ void Set::Setup::load(Set *set, int id, TextSplitter &ts) {
 	_name = buf;
 
 	ts.scanString(" background %256s", 1, buf);
-	_bkgndBm = loadBackground(buf);
+	_bkgndBm = nullptr;
+	if (!set->_textOnly)
+		_bkgndBm = loadBackground(buf);
 
 	// ZBuffer is optional
 	_bkgndZBm = nullptr;
 	if (ts.checkString("zbuffer")) {
 		ts.scanString(" zbuffer %256s", 1, buf);
 		// Don't even try to load if it's the "none" bitmap
-		if (strcmp(buf, "<none>.lbm") != 0) {
+		if (strcmp(buf, "<none>.lbm") != 0 && !set->_textOnly) {
 			_bkgndZBm = Bitmap::create(buf);
 			Debug::debug(Debug::Bitmaps | Debug::Sets,
 						 "Loading scene z-buffer bitmap: %s\n", buf);
@@ -360,7 +372,7 @@ void Set::Setup::load(Set *set, int id, TextSplitter &ts) {
 		if (ts.checkString("object_z"))
 			ts.scanString(" object_z %256s %256s", 2, zname, zbitmap);
 
-		if (zbitmap[0] == '\0' || strcmp(name, zname) == 0) {
+		if ((zbitmap[0] == '\0' || strcmp(name, zname) == 0) && !set->_textOnly) {
 			set->addObjectState(id, ObjectState::OBJSTATE_BACKGROUND, bitmap, zbitmap, true);
 		}
 	}
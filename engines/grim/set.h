@@ -52,6 +52,12 @@ public:
 	void loadText(TextSplitter &ts);
 	void loadBinary(Common::SeekableReadStream *data);
 
+	/**
+	 * Runs the text loader over 'data' only so that the text resource cache
+	 * records it, without loading the colormaps and bitmaps the set names.
+	 */
+	static void cacheText(const Common::String &name, Common::SeekableReadStream *data);
+
 	void saveState(SaveGame *savedState) const;
 	bool restoreState(SaveGame *savedState);
 
@@ -141,6 +147,7 @@ public:
 
 private:
 	bool _locked;
+	bool _textOnly;
 	Common::String _name;
 	int _numCmaps;
 	ObjectPtr<CMap> *_cmaps;
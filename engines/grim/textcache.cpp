@@ -0,0 +1,142 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#include "common/savefile.h"
+#include "common/system.h"
+
+#include "engines/grim/debug.h"
+#include "engines/grim/resource.h"
+#include "engines/grim/textcache.h"
+
+namespace Grim {
+
+// File layout, all little endian:
+//   'TXTC', uint32 version,
+//   uint32 count, count * { uint16 len, char[len] name, uint16 len, char[len] lab,
+//                            uint32 offset, uint32 size, uint32 len, byte[len] recorded calls }
+// Bump the version whenever TextSplitter records its calls differently. A
+// loader that changes the calls it makes needs no bump: the replay notices
+// and parses the text instead.
+#define TEXT_CACHE_VERSION 3
+
+TextCache::TextCache(const Common::String &filename) :
+		_filename(filename), _dirty(false) {
+	Common::InSaveFile *file = g_system->getSavefileManager()->openForLoading(filename);
+	if (!file)
+		return;
+
+	bool ok = file->readUint32BE() == MKTAG('T', 'X', 'T', 'C') && file->readUint32LE() == TEXT_CACHE_VERSION;
+	uint32 count = ok ? file->readUint32LE() : 0;
+	for (uint32 i = 0; ok && i < count; i++) {
+		uint16 len = file->readUint16LE();
+		Common::String name;
+		for (uint16 j = 0; j < len; j++)
+			name += (char)file->readByte();
+		Entry &entry = _entries[name];
+		len = file->readUint16LE();
+		for (uint16 j = 0; j < len; j++)
+			entry.lab += (char)file->readByte();
+		entry.offset = file->readUint32LE();
+		entry.size = file->readUint32LE();
+		uint32 dataSize = file->readUint32LE();
+		if (file->eos() || file->err() || dataSize > (uint32)(file->size() - file->pos())) {
+			ok = false;
+			break;
+		}
+		entry.data.resize(dataSize);
+		if (dataSize)
+			file->read(&entry.data[0], dataSize);
+	}
+	if (!ok || file->err()) {
+		Debug::debug(Debug::Engine, "Discarding stale text resource cache %s", filename.c_str());
+		_entries.clear();
+	}
+	delete file;
+}
+
+TextCache::~TextCache() {
+	flush();
+}
+
+bool TextCache::makeKey(Key &key, const Common::String &name, uint32 size) {
+	key.name = name;
+	// The size check catches a loader that names a file other than the one it read
+	return g_resourceloader->getLabEntry(name, key.lab, key.offset, key.size) && key.size == size;
+}
+
+bool TextCache::find(const Key &key, Common::Array<byte> &data) const {
+	EntryMap::const_iterator i = _entries.find(key.name);
+	if (i == _entries.end() || i->_value.offset != key.offset || i->_value.size != key.size ||
+			!i->_value.lab.equalsIgnoreCase(key.lab))
+		return false;
+	data = i->_value.data;
+	return true;
+}
+
+void TextCache::store(const Key &key, const Common::Array<byte> &data) {
+	Entry &entry = _entries[key.name];
+	entry.lab = key.lab;
+	entry.offset = key.offset;
+	entry.size = key.size;
+	entry.data = data;
+	_dirty = true;
+}
+
+void TextCache::remove(const Key &key) {
+	if (!_entries.contains(key.name))
+		return;
+	_entries.erase(key.name);
+	_dirty = true;
+}
+
+void TextCache::flush() {
+	if (!_dirty)
+		return;
+
+	Common::OutSaveFile *file = g_system->getSavefileManager()->openForSaving(_filename, false);
+	if (!file) {
+		warning("Cannot write text resource cache %s", _filename.c_str());
+		return;
+	}
+	file->writeUint32BE(MKTAG('T', 'X', 'T', 'C'));
+	file->writeUint32LE(TEXT_CACHE_VERSION);
+	file->writeUint32LE(_entries.size());
+	for (EntryMap::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
+		file->writeUint16LE(i->_key.size());
+		file->write(i->_key.c_str(), i->_key.size());
+		file->writeUint16LE(i->_value.lab.size());
+		file->write(i->_value.lab.c_str(), i->_value.lab.size());
+		file->writeUint32LE(i->_value.offset);
+		file->writeUint32LE(i->_value.size);
+		file->writeUint32LE(i->_value.data.size());
+		if (!i->_value.data.empty())
+			file->write(&i->_value.data[0], i->_value.data.size());
+	}
+	file->finalize();
+	if (file->err())
+		warning("Error writing text resource cache %s", _filename.c_str());
+	delete file;
+	_dirty = false;
+}
+
+} // end of namespace Grim
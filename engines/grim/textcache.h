@@ -0,0 +1,85 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+
+#ifndef GRIM_TEXTCACHE_H
+#define GRIM_TEXTCACHE_H
+
+#include "common/array.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/str.h"
+
+namespace Grim {
+
+/**
+ * Keeps, per target, what TextSplitter recorded while parsing each text
+ * resource, so that later loads of the same file replay it instead of
+ * scanning the text. Entries are keyed by file name and the LAB entry the
+ * name resolves to, so a hit needs no read of the file. The whole cache is
+ * discarded when TEXT_CACHE_VERSION changes, which has to be bumped with any
+ * change to what TextSplitter records.
+ */
+class TextCache {
+public:
+	struct Key {
+		Common::String name;
+		Common::String lab;
+		uint32 offset;
+		uint32 size;
+	};
+
+	TextCache(const Common::String &filename);
+	~TextCache();
+
+	/**
+	 * Fills in the key of a file of the given size. Returns false for files
+	 * that don't come from a LAB, which aren't cached.
+	 */
+	static bool makeKey(Key &key, const Common::String &name, uint32 size);
+
+	bool find(const Key &key, Common::Array<byte> &data) const;
+	void store(const Key &key, const Common::Array<byte> &data);
+	void remove(const Key &key);
+
+	/** Writes the cache out if anything was added since the last flush. */
+	void flush();
+
+	uint32 size() const { return _entries.size(); }
+
+private:
+	struct Entry {
+		Common::String lab;
+		uint32 offset;
+		uint32 size;
+		Common::Array<byte> data;
+	};
+	typedef Common::HashMap<Common::String, Entry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> EntryMap;
+
+	EntryMap _entries;
+	Common::String _filename;
+	bool _dirty;
+};
+
+} // end of namespace Grim
+
+#endif
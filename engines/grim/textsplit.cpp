@@ -22,12 +22,19 @@
 
 #include "common/util.h"
 #include "common/textconsole.h"
+#include "common/hash-str.h"
 #include "common/stream.h"
 
 #include "engines/grim/textsplit.h"
 
 namespace Grim {
 
+// The parser works on the line in place, so tabs are folded into spaces
+// wherever a character is looked at rather than in a copy of the line.
+static inline char foldTab(char c) {
+	return c == '\t' ? ' ' : c;
+}
+
 static bool isCodeSeparator(char c) {
 	return (c == ' ' || c == ',' || c == '.' || c == '%' || c == '\'' || c == ':');
 }
@@ -44,87 +51,131 @@ int power(int base, int exp) {
 	return res;
 }
 
-static float str2float(const char *str) {
-	int len = strlen(str);
-	int dotpos = len;
-	char *int_part = new char[len + 1];
-	int j = 0;
-	for (int i = 0; i < len; ++i) {
-		if (str[i] != '.') {
-			int_part[j++] = str[i];
-		} else {
-			dotpos = i;
-			break;
-		}
-	}
-	int_part[j++] = '\0';
+static bool isNum(char c) {
+	return (c >= '0' && c <= '9');
+}
+
+// Like atoi() on the characters [str, end).
+static int parseDecimal(const char *str, const char *end) {
+	bool negative = false;
+	if (str != end && (*str == '-' || *str == '+'))
+		negative = *str++ == '-';
+	uint32 value = 0;
+	for (; str != end && isNum(*str); ++str)
+		value = value * 10 + (*str - '0');
+	return negative ? -(int)value : (int)value;
+}
+
+static int hexDigit(char c) {
+	if (isNum(c))
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Like strtol(str, NULL, 16) on the characters [str, end), truncated to int.
+static int parseHex(const char *str, const char *end) {
+	bool negative = false;
+	if (str != end && (*str == '-' || *str == '+'))
+		negative = *str++ == '-';
+	if (end - str > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X') && hexDigit(str[2]) >= 0)
+		str += 2;
+	uint64 value = 0;
+	for (; str != end && hexDigit(*str) >= 0; ++str)
+		value = (value << 4) | hexDigit(*str);
+	return (int)(negative ? 0 - value : value);
+}
+
+static float str2float(const char *str, const char *end) {
+	const char *dot = str;
+	while (dot != end && *dot != '.')
+		++dot;
 
 	// Must use double here. float doesn't have enough precision for the sector
 	// vertices, and the pathfinder may break, like when olivia returns from
 	// the microphone after reciting a poem.
-	double num = atoi(int_part);
-	int sign = (str[0] == '-' ? -1 : 1);
-	j = 0;
-	for (int i = dotpos + 1; i < len; ++i) {
-		double part = (double)(str[i] - 48) / (double)power(10, ++j);
+	double num = parseDecimal(str, dot);
+	int sign = (str != end && str[0] == '-' ? -1 : 1);
+	int j = 0;
+	for (const char *c = dot + (dot != end); c < end; ++c) {
+		double part = (double)(*c - 48) / (double)power(10, ++j);
 		num += part * sign;
 	}
 
-	delete[] int_part;
-
 	return num;
 }
 
-static bool isNum(char c) {
-	return (c >= '0' && c <= '9');
+// Whether 'c' is accepted by the %[...] class in 'code'.
+static bool inCharacterClass(const char *code, char c) {
+	bool isNegated = code[1] == '^';
+	bool inSet = false;
+	for (const char *k = code + (isNegated ? 2 : 1); *k != '\0' && *k != ']'; ++k) {
+		assert(*k != '[' && *k != '-');
+		if (*k == c) {
+			inSet = true;
+			break;
+		}
+	}
+	return inSet != isNegated;
 }
 
-static char *parseCharacterClass(const char *code, bool *isNegated) {
-	uint32 length = strlen(code);
-
-	char *chars = new char[length];
-	*isNegated = code[1] == '^';
-	uint32 j = 0;
-	uint32 k = (*isNegated ? 2 : 1);
+static void recordBytes(Common::Array<byte> &record, const void *data, uint32 size) {
+	uint32 pos = record.size();
+	record.resize(pos + size);
+	memcpy(&record[pos], data, size);
+}
 
-	for (; k < length && code[k] != ']'; ++k) {
-		assert(code[k] != '[' && code[k] != '-');
-		chars[j++] = code[k];
-	}
-	chars[j++] = '\0';
+static void recordUint32(Common::Array<byte> &record, uint32 value) {
+	byte buf[4];
+	WRITE_LE_UINT32(buf, value);
+	recordBytes(record, buf, 4);
+}
 
-	return chars;
+static void recordString(Common::Array<byte> &record, const char *str) {
+	recordBytes(record, str, strlen(str) + 1);
 }
 
-// This function is modelled after sscanf, and supports a subset of its features. See sscanf documentation
-// for information about the syntax it accepts.
-static void parse(const char *line, const char *fmt, int field_count, va_list va) {
-	char *str = strdup(line);
-	const int len = strlen(str);
-	for (int i = 0; i < len; ++i) {
-		if (str[i] == '\t')
-			str[i] = ' ';
+// Stores a %s or %[ field of 'len' characters with strncpy() semantics,
+// terminated as the scanner always has, so that a replayed field leaves
+// the destination exactly as parsing would.
+static void storeString(char *string, const char *s, uint32 len, unsigned int fieldWidth, bool bracket) {
+	uint32 n = MIN<uint32>(len, fieldWidth);
+	for (uint32 k = 0; k < n; ++k)
+		string[k] = foldTab(s[k]);
+	if (n < fieldWidth)
+		memset(string + n, 0, fieldWidth - n);
+	if (bracket) {
+		string[fieldWidth - 1] = '\0';
+	} else if (fieldWidth <= len) {
+		// add terminating \0
+		string[fieldWidth] = '\0';
 	}
+}
 
-	char *format = strdup(fmt);
-	const int formatlen = strlen(format);
-	for (int i = 0; i < formatlen; ++i) {
-		if (format[i] == '\t')
-			format[i] = ' ';
-	}
+// This function is modelled after sscanf, and supports a subset of its features. See sscanf documentation
+// for information about the syntax it accepts. Fields are converted straight from the line, without
+// copying it or allocating.
+// If 'record' is given, every stored field is appended to it as a type byte
+// followed by the value, and the list is closed by a zero byte.
+static void parse(const char *line, const char *fmt, int field_count, va_list va, Common::Array<byte> *record) {
+	const int len = strlen(line);
+	const int formatlen = strlen(fmt);
 
 	int count = 0;
-	const char *src = str;
-	const char *end = str + len;
+	const char *src = line;
+	const char *end = line + len;
 	for (int i = 0; i < formatlen; ++i) {
-		if (format[i] == '%') {
+		if (fmt[i] == '%') {
 			char code[10];
 			char width[10];
 			int j = 0;
 			int jw = 0;
 			bool inBrackets = false;
-			while (++i < formatlen && !isCodeSeparator(format[i])) {
-				char c = format[i];
+			while (++i < formatlen && !isCodeSeparator(foldTab(fmt[i]))) {
+				char c = foldTab(fmt[i]);
 				if (c == '[') {
 					inBrackets = true;
 				} else if (inBrackets && c == ']') {
@@ -140,120 +191,190 @@ static void parse(const char *line, const char *fmt, int field_count, va_list va
 			width[jw] = '\0';
 
 			void *var = va_arg(va, void *);
-			if (strcmp(code, "n") == 0) {
-				*(int*)var = src - str;
+			if (code[0] == 'n' && code[1] == '\0') {
+				*(int*)var = src - line;
+				if (record) {
+					record->push_back('i');
+					recordUint32(*record, *(int*)var);
+				}
 				continue;
 			}
 
-			char s[2000];
-
 			unsigned int fieldWidth = 1;
 			if (width[0] != '\0') {
 				fieldWidth = atoi(width);
 			}
 
-			j = 0;
+			const char *token = src;
 			if (code[0] == 'c') {
-				for (unsigned int n = 0; n < fieldWidth; ++n) {
-					s[j++] = src[0];
-					++src;
-				}
+				src += fieldWidth;
 			} else if (code[0] == '[') {
-				bool isNegated;
-				char *allowed = parseCharacterClass(code, &isNegated);
-
-				while (src != end) {
-					bool inSet = strchr(allowed, src[0]) != nullptr;
-					if ((isNegated && inSet) || (!isNegated && !inSet))
-						break;
-
-					s[j++] = src[0];
+				while (src != end && inCharacterClass(code, foldTab(src[0]))) {
 					++src;
 				}
-
-				delete[] allowed;
 			} else {
-				char nextChar = format[i];
-				while (src[0] == ' ') { //skip initial whitespace
+				char nextChar = i < formatlen ? foldTab(fmt[i]) : '\0';
+				while (foldTab(src[0]) == ' ') { //skip initial whitespace
 					++src;
 				}
-				while (src != end && src[0] != nextChar && !isSeparator(src[0])) {
-					s[j++] = src[0];
+				token = src;
+				while (src != end && foldTab(src[0]) != nextChar && !isSeparator(foldTab(src[0]))) {
 					++src;
 				}
 			}
+			const uint32 tokenLen = src - token;
 
-			s[j] = '\0';
 			--i;
 
 			if (width[0] == '\0') {
-				fieldWidth = strlen(s);
+				fieldWidth = tokenLen;
 			}
 
-			if (strcmp(code, "d") == 0) {
-				*(int*)var = atoi(s);
-			} else if (strcmp(code, "x") == 0) {
-				*(int*)var = strtol(s, (char **) nullptr, 16);
-			} else if (strcmp(code, "f") == 0) {
-				*(float*)var = str2float(s);
-			} else if (strcmp(code, "c") == 0) {
-				*(char*)var = s[0];
-			} else if (strcmp(code, "s") == 0) {
-				char *string = (char*)var;
-				strncpy(string, s, fieldWidth);
-				if (fieldWidth <= strlen(s)) {
-					// add terminating \0
-					string[fieldWidth] = '\0';
+			if (code[0] == 'd' && code[1] == '\0') {
+				*(int*)var = parseDecimal(token, src);
+				if (record) {
+					record->push_back('i');
+					recordUint32(*record, *(int*)var);
+				}
+			} else if (code[0] == 'x' && code[1] == '\0') {
+				*(int*)var = parseHex(token, src);
+				if (record) {
+					record->push_back('i');
+					recordUint32(*record, *(int*)var);
+				}
+			} else if (code[0] == 'f' && code[1] == '\0') {
+				*(float*)var = str2float(token, src);
+				if (record) {
+					uint32 bits;
+					memcpy(&bits, var, sizeof(bits));
+					record->push_back('f');
+					recordUint32(*record, bits);
+				}
+			} else if (code[0] == 'c' && code[1] == '\0') {
+				*(char*)var = foldTab(token[0]);
+				if (record) {
+					record->push_back('c');
+					record->push_back(foldTab(token[0]));
+				}
+			} else if ((code[0] == 's' && code[1] == '\0') || code[0] == '[') {
+				bool bracket = code[0] == '[';
+				storeString((char*)var, token, tokenLen, fieldWidth, bracket);
+				if (record) {
+					record->push_back(bracket ? '[' : 's');
+					recordUint32(*record, fieldWidth);
+					uint32 pos = record->size();
+					record->resize(pos + tokenLen + 1);
+					for (uint32 k = 0; k < tokenLen; ++k)
+						(*record)[pos + k] = foldTab(token[k]);
+					(*record)[pos + tokenLen] = 0;
 				}
-			} else if (code[0] == '[') {
-				char *string = (char*)var;
-				strncpy(string, s, fieldWidth);
-				string[fieldWidth - 1] = '\0';
 			} else {
-				error("Code not handled: \"%s\" \"%s\"\n\"%s\" \"%s\"", code, s, line, fmt);
+				error("Code not handled: \"%s\" \"%s\"\n\"%s\" \"%s\"", code, Common::String(token, src).c_str(), line, fmt);
 			}
 
 			++count;
 			continue;
 		}
 
-		while (src[0] == ' ') {
+		char f = foldTab(fmt[i]);
+		while (foldTab(src[0]) == ' ') {
 			++src;
 		}
 		if (src == end)
 			break;
 
-		if (src[0] != format[i] && format[i] != ' ') {
+		if (foldTab(src[0]) != f && f != ' ') {
 			error("Expected line of format '%s', got '%s'", fmt, line);
 		}
 
 		if (src == end)
 			break;
-		if (format[i] != ' ') {
+		if (f != ' ') {
 			++src;
 			if (src == end)
 				break;
 		}
 	}
-	free(str);
-	free(format);
 
 	if (count < field_count) {
 		error("Expected line of format '%s', got '%s'", fmt, line);
 	}
+	if (record)
+		record->push_back(0);
 }
 
 
-TextSplitter::TextSplitter(const Common::String &fname, Common::SeekableReadStream *data) : _fname(fname) {
-	char *line;
-	int i;
-	uint32 len = data->size();
+// Tags written ahead of each recorded call, followed by its arguments and
+// results:
+//   N                    nextLine()
+//   L string / Z         getCurrentLine(), the first time for each line
+//   E byte               isEof()
+//   G uint32             getLineNumber()
+//   J uint32             setLineNumber(line)
+//   C uint32 byte        checkString(needle), with the hash of the needle
+//   X uint32             expectString(expected), with the hash of the string
+//   S uint32 byte uint32 fields
+//                        scan*() with the offset, whether it went to the next
+//                        line, the hash of the format and the fields parse()
+//                        recorded
+enum {
+	kOpNextLine = 'N',
+	kOpLine = 'L',
+	kOpNoLine = 'Z',
+	kOpEof = 'E',
+	kOpGetLineNumber = 'G',
+	kOpSetLineNumber = 'J',
+	kOpCheckString = 'C',
+	kOpExpectString = 'X',
+	kOpScan = 'S'
+};
+
+TextSplitter::TextSplitter(const Common::String &fname, Common::SeekableReadStream *data, TextCache *cache) :
+		_fname(fname), _data(data), _stringData(nullptr), _currLine(nullptr), _numLines(0), _lineIndex(0), _lines(nullptr),
+		_cache(cache), _replayPos(0), _recording(false), _replaying(false), _lineLogged(false), _replayLine(nullptr),
+		_replayLineIndex(0), _replayAdvances(0) {
+	if (_cache && TextCache::makeKey(_key, fname, data->size())) {
+		if (_cache->find(_key, _replay)) {
+			if (checkReplay()) {
+				_replaying = true;
+				return;
+			}
+			warning("Cached parse of %s is damaged, parsing it again", _fname.c_str());
+			_cache->remove(_key);
+		}
+		_recording = true;
+	}
+
+	readText();
+	splitLines();
+	processLine();
+}
+
+TextSplitter::~TextSplitter() {
+	if (_recording)
+		_cache->store(_key, _record);
+	else if (_replaying && _replayPos != _replay.size()) {
+		warning("Cached parse of %s has calls its loader did not make", _fname.c_str());
+		_cache->remove(_key);
+	}
+	delete[] _stringData;
+	delete[] _lines;
+}
+
+void TextSplitter::readText() {
+	uint32 len = _data->size();
 
 	_stringData = new char[len + 1];
-	data->read(_stringData, len);
+	_data->seek(0, SEEK_SET);
+	_data->read(_stringData, len);
 	_stringData[len] = '\0';
+}
+
+void TextSplitter::splitLines() {
+	char *line;
+	int i;
+
 	// Find out how many lines of text there are
-	_numLines = _lineIndex = 0;
 	line = (char *)_stringData;
 	while (line) {
 		line = strchr(line, '\n');
@@ -272,91 +393,185 @@ TextSplitter::TextSplitter(const Common::String &fname, Common::SeekableReadStre
 		_lines[i] = lastLine;
 		line++;
 	}
-	_currLine = nullptr;
+}
+
+void TextSplitter::nextLine() {
+	_lineLogged = false;
+	if (_replaying && replayMatch(kOpNextLine)) {
+		_replayAdvances++;
+		return;
+	}
+	if (_recording)
+		recordOp(kOpNextLine);
 	processLine();
 }
 
-TextSplitter::~TextSplitter() {
-	delete[] _stringData;
-	delete[] _lines;
+char *TextSplitter::getCurrentLine() {
+	if (!_recording && !_replaying)
+		return _currLine;
+	if (_lineLogged)
+		return _replaying ? _replayLine : _currLine;
+
+	_lineLogged = true;
+	if (_replaying) {
+		if (_replayPos < _replay.size() && _replay[_replayPos] == kOpNoLine) {
+			_replayPos++;
+			_replayLine = nullptr;
+			return _replayLine;
+		}
+		if (replayMatch(kOpLine)) {
+			_replayLine = replayString();
+			return _replayLine;
+		}
+		return _currLine;
+	}
+	if (_currLine) {
+		recordOp(kOpLine);
+		recordString(_record, _currLine);
+	} else {
+		recordOp(kOpNoLine);
+	}
+	return _currLine;
+}
+
+bool TextSplitter::isEof() {
+	if (_replaying && replayMatch(kOpEof))
+		return replayByte() != 0;
+
+	bool eof = _lineIndex == _numLines;
+	if (_recording) {
+		recordOp(kOpEof);
+		_record.push_back(eof);
+	}
+	return eof;
+}
+
+int TextSplitter::getLineNumber() {
+	if (_replaying && replayMatch(kOpGetLineNumber))
+		return replayUint32();
+
+	if (_recording) {
+		recordOp(kOpGetLineNumber);
+		recordUint32(_record, _lineIndex);
+	}
+	return _lineIndex;
+}
+
+void TextSplitter::setLineNumber(int line) {
+	_lineLogged = false;
+	if (_replaying && replayMatch(kOpSetLineNumber) && replayMatchUint32(line)) {
+		_replayLineIndex = line - 1;
+		_replayAdvances = 0;
+		return;
+	}
+	if (_recording) {
+		recordOp(kOpSetLineNumber);
+		recordUint32(_record, line);
+	}
+	_lineIndex = line - 1;
+	processLine();
 }
 
 bool TextSplitter::checkString(const char *needle) {
+	if (_replaying && replayMatch(kOpCheckString) && replayMatchHash(needle))
+		return replayByte() != 0;
+
+	bool found;
 	// checkString also needs to check for extremely optional
 	// components like "object_art" which can be missing entirely
-	if (!getCurrentLine()) {
-		return false;
+	if (!_currLine) {
+		found = false;
 	} else {
-		Common::String haystack(getCurrentLine());
-		Common::String needleStr(needle);
-		haystack.toLowercase();
-		needleStr.toLowercase();
-		return haystack.contains(needleStr);
+		found = needle[0] == '\0';
+		for (const char *h = _currLine; !found && *h != '\0'; ++h) {
+			int k = 0;
+			while (needle[k] != '\0' && tolower(h[k]) == tolower(needle[k]))
+				++k;
+			found = needle[k] == '\0';
+		}
 	}
+	if (_recording) {
+		recordOp(kOpCheckString);
+		recordUint32(_record, Common::hashit(needle));
+		_record.push_back(found);
+	}
+	return found;
 }
 
 void TextSplitter::expectString(const char *expected) {
+	_lineLogged = false;
+	if (_replaying && replayMatch(kOpExpectString) && replayMatchHash(expected)) {
+		_replayAdvances++;
+		return;
+	}
 	if (!_currLine)
 		error("Expected `%s', got EOF on file %s", expected, _fname.c_str());
-	if (scumm_stricmp(getCurrentLine(), expected) != 0)
-		error("Expected `%s', got '%s' on file %s", expected, getCurrentLine(), _fname.c_str());
-	nextLine();
+	if (scumm_stricmp(_currLine, expected) != 0)
+		error("Expected `%s', got '%s' on file %s", expected, _currLine, _fname.c_str());
+	if (_recording) {
+		recordOp(kOpExpectString);
+		recordUint32(_record, Common::hashit(expected));
+	}
+	processLine();
 }
 
 void TextSplitter::scanString(const char *fmt, int field_count, ...) {
-	if (!_currLine)
-		error("Expected line of format '%s', got EOF on file %s", fmt, _fname.c_str());
-
 	va_list va;
 	va_start(va, field_count);
-
-	parse(getCurrentLine(), fmt, field_count, va);
-
+	scan(0, true, fmt, field_count, va);
 	va_end(va);
-
-	nextLine();
 }
 
 void TextSplitter::scanStringAtOffset(int offset, const char *fmt, int field_count, ...) {
-	if (!_currLine)
-		error("Expected line of format '%s', got EOF on file %s", fmt, _fname.c_str());
-
 	va_list va;
 	va_start(va, field_count);
-
-	parse(getCurrentLine() + offset, fmt, field_count, va);
-
+	scan(offset, true, fmt, field_count, va);
 	va_end(va);
-
-	nextLine();
 }
 
 void TextSplitter::scanStringNoNewLine(const char *fmt, int field_count, ...) {
-	if (!_currLine)
-		error("Expected line of format '%s', got EOF on file %s", fmt, _fname.c_str());
-
 	va_list va;
 	va_start(va, field_count);
-
-	parse(getCurrentLine(), fmt, field_count, va);
-
+	scan(0, false, fmt, field_count, va);
 	va_end(va);
 }
 
 void TextSplitter::scanStringAtOffsetNoNewLine(int offset, const char *fmt, int field_count, ...) {
-	if (!_currLine)
-		error("Expected line of format '%s', got EOF on file %s", fmt, _fname.c_str());
-
 	va_list va;
 	va_start(va, field_count);
+	scan(offset, false, fmt, field_count, va);
+	va_end(va);
+}
 
-	parse(getCurrentLine() + offset, fmt, field_count, va);
+void TextSplitter::scan(int offset, bool newLine, const char *fmt, int field_count, va_list va) {
+	if (newLine)
+		_lineLogged = false;
 
-	va_end(va);
+	if (_replaying && replayMatch(kOpScan) && replayMatchUint32(offset) &&
+			replayMatch(newLine) && replayMatchHash(fmt)) {
+		replayFields(va);
+		if (newLine)
+			_replayAdvances++;
+		return;
+	}
+
+	if (!_currLine)
+		error("Expected line of format '%s', got EOF on file %s", fmt, _fname.c_str());
+
+	if (_recording) {
+		recordOp(kOpScan);
+		recordUint32(_record, offset);
+		_record.push_back(newLine);
+		recordUint32(_record, Common::hashit(fmt));
+	}
+	parse(_currLine + offset, fmt, field_count, va, _recording ? &_record : nullptr);
+
+	if (newLine)
+		processLine();
 }
 
 void TextSplitter::processLine() {
-	if (isEof())
+	if (_lineIndex == _numLines)
 		return;
 
 	_currLine = _lines[_lineIndex++];
@@ -374,12 +589,164 @@ void TextSplitter::processLine() {
 
 	// Skip blank lines
 	if (*_currLine == '\0')
-		nextLine();
+		processLine();
 
 	// Convert to lower case
-	if (!isEof())
+	if (_lineIndex != _numLines)
 		for (char *s = _currLine; *s != '\0'; s++)
 			*s = tolower(*s);
 }
 
+void TextSplitter::recordOp(byte op) {
+	_record.push_back(op);
+}
+
+static bool skipReplayBytes(const Common::Array<byte> &replay, uint32 &pos, uint32 size) {
+	if (replay.size() - pos < size)
+		return false;
+	pos += size;
+	return true;
+}
+
+static bool skipReplayString(const Common::Array<byte> &replay, uint32 &pos) {
+	if (pos >= replay.size())
+		return false;
+	const void *end = memchr(&replay[pos], 0, replay.size() - pos);
+	if (!end)
+		return false;
+	pos = (const byte *)end - &replay[0] + 1;
+	return true;
+}
+
+// Walks the whole recording once, so that the replay can read the arguments
+// and results of every call it has matched without checking them again.
+bool TextSplitter::checkReplay() const {
+	uint32 pos = 0;
+	while (pos < _replay.size()) {
+		bool ok;
+		switch (_replay[pos++]) {
+		case kOpNextLine:
+		case kOpNoLine:
+			ok = true;
+			break;
+		case kOpLine:
+			ok = skipReplayString(_replay, pos);
+			break;
+		case kOpEof:
+			ok = skipReplayBytes(_replay, pos, 1);
+			break;
+		case kOpGetLineNumber:
+		case kOpSetLineNumber:
+		case kOpExpectString:
+			ok = skipReplayBytes(_replay, pos, 4);
+			break;
+		case kOpCheckString:
+			ok = skipReplayBytes(_replay, pos, 5);
+			break;
+		case kOpScan:
+			ok = skipReplayBytes(_replay, pos, 9);
+			while (ok) {
+				if (pos >= _replay.size()) {
+					ok = false;
+					break;
+				}
+				byte type = _replay[pos++];
+				if (type == 0)
+					break;
+				if (type == 'i' || type == 'f')
+					ok = skipReplayBytes(_replay, pos, 4);
+				else if (type == 'c')
+					ok = skipReplayBytes(_replay, pos, 1);
+				else if (type == 's' || type == '[')
+					ok = skipReplayBytes(_replay, pos, 4) && skipReplayString(_replay, pos);
+				else
+					ok = false;
+			}
+			break;
+		default:
+			ok = false;
+			break;
+		}
+		if (!ok)
+			return false;
+	}
+	return true;
+}
+
+// The loader made a call the recording does not have. Drop the entry, and
+// bring the parser to where the replayed calls have left it to go on from
+// there.
+void TextSplitter::stopReplay() {
+	warning("Cached parse of %s is out of step with its loader, parsing it again", _fname.c_str());
+	_cache->remove(_key);
+	_replaying = false;
+
+	readText();
+	splitLines();
+	_lineIndex = _replayLineIndex;
+	processLine();
+	for (int i = 0; i < _replayAdvances; i++)
+		processLine();
+}
+
+bool TextSplitter::replayMatch(byte op) {
+	if (_replayPos < _replay.size() && _replay[_replayPos] == op) {
+		_replayPos++;
+		return true;
+	}
+	stopReplay();
+	return false;
+}
+
+bool TextSplitter::replayMatchUint32(uint32 value) {
+	if (READ_LE_UINT32(&_replay[_replayPos]) == value) {
+		_replayPos += 4;
+		return true;
+	}
+	stopReplay();
+	return false;
+}
+
+bool TextSplitter::replayMatchHash(const char *str) {
+	return replayMatchUint32(Common::hashit(str));
+}
+
+byte TextSplitter::replayByte() {
+	return _replay[_replayPos++];
+}
+
+uint32 TextSplitter::replayUint32() {
+	uint32 value = READ_LE_UINT32(&_replay[_replayPos]);
+	_replayPos += 4;
+	return value;
+}
+
+char *TextSplitter::replayString() {
+	char *str = (char *)&_replay[_replayPos];
+	_replayPos += strlen(str) + 1;
+	return str;
+}
+
+void TextSplitter::replayFields(va_list va) {
+	for (;;) {
+		byte type = replayByte();
+		if (type == 0)
+			break;
+
+		void *var = va_arg(va, void *);
+		if (type == 'i') {
+			*(int *)var = (int)replayUint32();
+		} else if (type == 'f') {
+			uint32 bits = replayUint32();
+			memcpy(var, &bits, sizeof(bits));
+		} else if (type == 'c') {
+			*(char *)var = (char)replayByte();
+		} else {
+			unsigned int fieldWidth = replayUint32();
+			const char *str = replayString();
+			storeString((char *)var, str, strlen(str), fieldWidth, type == '[');
+		}
+	}
+}
+
 } // end of namespace Grim
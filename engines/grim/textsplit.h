@@ -23,6 +23,10 @@
 #ifndef GRIM_TEXTSPLIT_HH
 #define GRIM_TEXTSPLIT_HH
 
+#include "common/array.h"
+
+#include "engines/grim/textcache.h"
+
 namespace Common {
 class SeekableReadStream;
 }
@@ -32,22 +36,26 @@ namespace Grim {
 // A utility class to help in parsing the text-format files.  Splits
 // the text data into lines, skipping comments, trailing whitespace,
 // and empty lines.  Also folds everything to lowercase.
+//
+// When given a TextCache, every call made on the splitter is recorded with
+// its results and stored in the cache on destruction.  String arguments,
+// formats included, are only kept as hashes.  A later splitter over
+// the same LAB entry replays the results without reading the text, as long
+// as the loader makes the same calls.  When it does not, the entry is
+// dropped and the splitter reads the text and goes on parsing it from where
+// the replayed calls left it, so the stream must outlive the splitter.
 
 class TextSplitter {
 public:
-	TextSplitter(const Common::String &fname, Common::SeekableReadStream *data);
+	TextSplitter(const Common::String &fname, Common::SeekableReadStream *data, TextCache *cache = nullptr);
 	~TextSplitter();
 
-	char *nextLine() {
-		processLine();
-		return _currLine;
-	}
+	void nextLine();
 
-	char *getCurrentLine() { return _currLine; }
-	const char *getCurrentLine() const { return _currLine; }
-	bool isEof() const { return _lineIndex == _numLines; }
-	int getLineNumber() { return _lineIndex; }
-	void setLineNumber(int line) { _lineIndex = line - 1; processLine(); }
+	char *getCurrentLine();
+	bool isEof();
+	int getLineNumber();
+	void setLineNumber(int line);
 
 	// Check if the current line contains 'needle'
 	bool checkString(const char *needle);
@@ -74,12 +82,41 @@ public:
 
 private:
 	Common::String _fname;
+	Common::SeekableReadStream *_data;
 	char *_stringData;
 	char *_currLine;
 	int _numLines, _lineIndex;
 	char **_lines;
 
+	TextCache *_cache;
+	TextCache::Key _key;
+	Common::Array<byte> _record;
+	Common::Array<byte> _replay;
+	uint32 _replayPos;
+	bool _recording;
+	bool _replaying;
+	bool _lineLogged;
+	char *_replayLine;
+	// Where the replayed calls have moved the parser: the line index the last
+	// setLineNumber() left, and the lines advanced since.
+	int _replayLineIndex;
+	int _replayAdvances;
+
+	void readText();
+	void splitLines();
 	void processLine();
+	void scan(int offset, bool newLine, const char *fmt, int field_count, va_list va);
+
+	void recordOp(byte op);
+	bool checkReplay() const;
+	void stopReplay();
+	bool replayMatch(byte op);
+	bool replayMatchUint32(uint32 value);
+	bool replayMatchHash(const char *str);
+	byte replayByte();
+	uint32 replayUint32();
+	char *replayString();
+	void replayFields(va_list va);
 };
 
 } // end of namespace Grim
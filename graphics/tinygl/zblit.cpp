@@ -313,8 +313,15 @@ FORCEINLINE void BlitImage::tglBlitRLE(int dstX, int dstY, int srcX, int srcY, i
 	uint32 lineIndex = 0;
 	int maxY = srcY + clampHeight;
 	int maxX = srcX + clampWidth;
-	while (lineIndex < _lines.size() && _lines[lineIndex]._y < srcY) {
-		lineIndex++;
+	// Lines are sorted by row, so find the first one of the source rectangle by bisection
+	uint32 lineEnd = _lines.size();
+	while (lineIndex < lineEnd) {
+		uint32 mid = (lineIndex + lineEnd) / 2;
+		if (_lines[mid]._y < srcY) {
+			lineIndex = mid + 1;
+		} else {
+			lineEnd = mid;
+		}
 	}
 
 	if (_binaryTransparent || (kDisableBlending || !kEnableAlphaBlending)) { // If bitmap is binary transparent or if  we need complex forms of blending (not just alpha) we need to use writePixel, which is slower 
@@ -2,6 +2,7 @@
 
 #include "common/md5.h"
 #include "common/stream.h"
+#include "common/util.h"
 
 /*
  * those are the standard RFC 1321 test vectors
@@ -47,4 +48,31 @@ class MD5TestSuite : public CxxTest::TestSuite {
 		}
 	}
 
+	void test_MD5() {
+		int i, j;
+		char output[33];
+		unsigned char md5sum[16];
+		Common::MD5 md5;
+
+		for (i = 0; i < 7; i++) {
+			// Hand the string over in pieces of growing size
+			const byte *data = (const byte *)md5_test_string[i];
+			uint32 left = strlen(md5_test_string[i]);
+			for (uint32 size = 1; left > 0; size++) {
+				uint32 n = MIN(size, left);
+				md5.update(data, n);
+				data += n;
+				left -= n;
+			}
+			md5.finish(md5sum);
+
+			for (j = 0; j < 16; j++) {
+				sprintf(output + j * 2, "%02x", md5sum[j]);
+			}
+
+			Common::String tmp(output);
+			TS_ASSERT_EQUALS(tmp, md5_test_digest[i]);
+		}
+	}
+
 };